@@ -0,0 +1,206 @@
+#include "base/init.h"
+#include "base/common.h"
+#include "base/thread.h"
+#include "common/protocol.h"
+#include "utils/bench.h"
+#include "utils/io.h"
+#include "log/log_space.h"
+#include "log/utils.h"
+#include "log/view.h"
+
+ABSL_FLAG(size_t, batch_size, 32, "Records per APPEND_BATCH request");
+ABSL_FLAG(size_t, record_size, 16, "Log data bytes of each record");
+ABSL_FLAG(absl::Duration, duration, absl::Seconds(10), "Duration of each mode");
+ABSL_FLAG(int, worker_cpu, -1, "Pin function worker thread to this CPU");
+ABSL_FLAG(int, engine_cpu, -1, "Pin engine thread to this CPU");
+
+using namespace faas;
+
+using protocol::Message;
+using protocol::MessageHelper;
+using protocol::SharedLogOpType;
+using protocol::SharedLogResultType;
+
+static constexpr uint16_t kSequencerId = 1;
+static constexpr uint16_t kStorageShardId = 0;
+static constexpr uint16_t kIndexNodeId = 2;
+
+// Single sequencer and storage node, hosting a single storage shard, which
+// is indexed by a single index node
+static std::unique_ptr<log::View> CreateView() {
+    log::ViewProto view_proto;
+    view_proto.set_view_id(0);
+    view_proto.set_metalog_replicas(1);
+    view_proto.set_userlog_replicas(1);
+    view_proto.set_num_phylogs(1);
+    view_proto.add_sequencer_nodes(kSequencerId);
+    view_proto.add_storage_nodes(1);
+    view_proto.add_storage_shard_ids(kStorageShardId);
+    view_proto.add_storage_plan(1);
+    view_proto.set_index_replicas(1);
+    view_proto.set_num_index_shards(1);
+    view_proto.add_index_nodes(kIndexNodeId);
+    view_proto.add_index_tier_plan(kIndexNodeId);
+    return std::make_unique<log::View>(view_proto);
+}
+
+// Engine side of the function worker's fifos. Each request is taken by
+// LogProducer, and sequenced right away by a NEW_LOGS meta log, so that
+// responses only wait for the engine's own work.
+class EngineLoop {
+public:
+    EngineLoop(const log::View* view, int input_fd, int output_fd)
+        : producer_(kStorageShardId, view, kSequencerId, 0, 0),
+          input_fd_(input_fd), output_fd_(output_fd),
+          shard_progress_(0) {}
+
+    void Run() {
+        Message request;
+        bool eof;
+        while (io_utils::RecvMessage(input_fd_, &request, &eof)) {
+            HandleRequest(request);
+        }
+        CHECK(eof) << "Failed to read request";
+    }
+
+private:
+    log::LogProducer producer_;
+    int input_fd_;
+    int output_fd_;
+    uint32_t shard_progress_;
+    std::string data_;
+
+    void HandleRequest(const Message& request) {
+        // Engine copies records out of the message, as it does for ops
+        std::span<const char> payload = MessageHelper::GetInlineData(request);
+        data_.assign(payload.data(), payload.size());
+        uint64_t localid;
+        uint64_t next_seqnum;
+        size_t num_records;
+        if (MessageHelper::GetSharedLogOpType(request) == SharedLogOpType::APPEND_BATCH) {
+            num_records = request.log_batch_size;
+            std::vector<std::span<const uint64_t>> user_tags;
+            std::vector<std::span<const char>> log_data;
+            CHECK(log_utils::SplitAppendBatchPayload(
+                STRING_AS_SPAN(data_), num_records, &user_tags, &log_data));
+            producer_.LocalAppendBatch(this, num_records, &localid, &next_seqnum);
+        } else {
+            num_records = 1;
+            producer_.LocalAppend(this, &localid, &next_seqnum);
+        }
+        Sequence(num_records);
+
+        log::LogProducer::AppendResultVec results;
+        producer_.PollAppendResults(&results);
+        CHECK_EQ(results.size(), 1U);
+        const log::LogProducer::AppendResult& result = results[0];
+        Message response = MessageHelper::NewSharedLogOpSucceeded(
+            SharedLogResultType::APPEND_OK, result.seqnum);
+        if (result.batch_seqnums != nullptr) {
+            MessageHelper::SetInlineData(
+                &response, std::span<const uint64_t>(*result.batch_seqnums));
+        }
+        response.log_client_data = request.log_client_data;
+        CHECK(io_utils::SendMessage(output_fd_, response));
+    }
+
+    void Sequence(size_t num_records) {
+        log::MetaLogProto metalog;
+        metalog.set_logspace_id(producer_.identifier());
+        metalog.set_metalog_seqnum(producer_.metalog_position());
+        metalog.set_type(log::MetaLogProto::NEW_LOGS);
+        auto* new_logs = metalog.mutable_new_logs_proto();
+        new_logs->set_start_seqnum(producer_.local_seqnum_position());
+        new_logs->add_shard_ids(kStorageShardId);
+        new_logs->add_shard_starts(shard_progress_);
+        new_logs->add_shard_deltas(gsl::narrow_cast<uint32_t>(num_records));
+        shard_progress_ += gsl::narrow_cast<uint32_t>(num_records);
+        CHECK(producer_.ProvideMetaLog(metalog));
+    }
+
+    DISALLOW_COPY_AND_ASSIGN(EngineLoop);
+};
+
+// Issues appends one at a time, like a function worker waiting on each
+// request. Returns the append rate in records per millisecond.
+static double RunMode(bool batched, size_t batch_size, size_t record_size) {
+    int request_fds[2];
+    int response_fds[2];
+    PCHECK(pipe(request_fds) == 0);
+    PCHECK(pipe(response_fds) == 0);
+
+    std::unique_ptr<log::View> view = CreateView();
+    EngineLoop engine_loop(view.get(), request_fds[0], response_fds[1]);
+    base::Thread engine_thread("Engine", [&] () {
+        if (absl::GetFlag(FLAGS_engine_cpu) != -1) {
+            bench_utils::PinCurrentThreadToCpu(absl::GetFlag(FLAGS_engine_cpu));
+        }
+        engine_loop.Run();
+    });
+    engine_thread.Start();
+
+    Message request;
+    memset(&request, 0, sizeof(Message));
+    request.message_type = static_cast<uint16_t>(protocol::MessageType::SHARED_LOG_OP);
+    std::string record_data(record_size, 'x');
+    if (batched) {
+        request.log_op = static_cast<uint16_t>(SharedLogOpType::APPEND_BATCH);
+        request.log_batch_size = gsl::narrow_cast<uint32_t>(batch_size);
+        protocol::AppendBatchRecordHeader header;
+        memset(&header, 0, sizeof(header));
+        header.data_size = gsl::narrow_cast<uint32_t>(record_size);
+        request.payload_size = 0;
+        for (size_t i = 0; i < batch_size; i++) {
+            MessageHelper::AppendInlineData(&request, std::span<const char>(
+                reinterpret_cast<const char*>(&header), sizeof(header)));
+            MessageHelper::AppendInlineData(&request, STRING_AS_SPAN(record_data));
+        }
+    } else {
+        request.log_op = static_cast<uint16_t>(SharedLogOpType::APPEND);
+        MessageHelper::SetInlineData(&request, record_data);
+    }
+
+    size_t records_per_request = batched ? batch_size : 1;
+    Message response;
+    bench_utils::BenchLoop bench_loop(absl::GetFlag(FLAGS_duration), [&] () -> bool {
+        request.log_client_data++;
+        CHECK(io_utils::SendMessage(request_fds[1], request));
+        CHECK(io_utils::RecvMessage(response_fds[0], &response, nullptr));
+        CHECK_EQ(response.log_client_data, request.log_client_data);
+        CHECK_EQ(response.log_result, static_cast<uint16_t>(SharedLogResultType::APPEND_OK));
+        return true;
+    });
+
+    PCHECK(close(request_fds[1]) == 0);
+    engine_thread.Join();
+    PCHECK(close(request_fds[0]) == 0);
+    PCHECK(close(response_fds[0]) == 0);
+    PCHECK(close(response_fds[1]) == 0);
+
+    double rate = static_cast<double>(bench_loop.loop_count() * records_per_request)
+                  / absl::ToDoubleMilliseconds(bench_loop.elapsed_time());
+    LOG(INFO) << (batched ? "APPEND_BATCH" : "APPEND") << " requests: "
+              << bench_loop.loop_count() << " in "
+              << absl::ToInt64Milliseconds(bench_loop.elapsed_time()) << " milliseconds";
+    LOG(INFO) << (batched ? "APPEND_BATCH" : "APPEND") << " rate: "
+              << rate << " records per millisecond";
+    return rate;
+}
+
+int main(int argc, char* argv[]) {
+    base::InitMain(argc, argv);
+    if (absl::GetFlag(FLAGS_worker_cpu) != -1) {
+        bench_utils::PinCurrentThreadToCpu(absl::GetFlag(FLAGS_worker_cpu));
+    }
+    size_t batch_size = absl::GetFlag(FLAGS_batch_size);
+    size_t record_size = absl::GetFlag(FLAGS_record_size);
+    CHECK(0 < batch_size && batch_size <= MAX_APPEND_BATCH_SIZE)
+        << "Invalid batch size: " << batch_size;
+    CHECK_LE(batch_size * (sizeof(protocol::AppendBatchRecordHeader) + record_size),
+             size_t{MESSAGE_INLINE_DATA_SIZE}) << "Records do not fit in inline data";
+
+    double append_rate = RunMode(/* batched= */ false, batch_size, record_size);
+    double batch_rate = RunMode(/* batched= */ true, batch_size, record_size);
+    LOG(INFO) << "Speedup of APPEND_BATCH over APPEND: " << batch_rate / append_rate;
+    return 0;
+}
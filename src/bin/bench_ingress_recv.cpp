@@ -0,0 +1,102 @@
+#include "base/init.h"
+#include "base/common.h"
+#include "common/flags.h"
+#include "common/protocol.h"
+#include "common/time.h"
+#include "utils/io.h"
+#include "utils/socket.h"
+#include "utils/bench.h"
+#include "server/constants.h"
+#include "server/server_base.h"
+#include "server/io_worker.h"
+#include "server/ingress_connection.h"
+
+#include <sys/socket.h>
+
+ABSL_FLAG(size_t, payload_size, 64, "Payload size of each SharedLogMessage");
+ABSL_FLAG(size_t, batch_size, 64, "Number of messages written by each send");
+ABSL_FLAG(absl::Duration, duration, absl::Seconds(10), "Duration to send messages");
+
+ABSL_DECLARE_FLAG(bool, io_uring_enable_buf_ring);
+
+using namespace faas;
+
+// Sends SharedLogMessages over TCP loopback to an IngressConnection running
+// on a single IOWorker. Run with and without --io_uring_enable_buf_ring to
+// compare multishot recv against one-shot recv with copying.
+int main(int argc, char* argv[]) {
+    base::InitMain(argc, argv);
+
+    uint16_t port;
+    int listen_fd = utils::TcpSocketBindArbitraryPort("127.0.0.1", &port);
+    CHECK(listen_fd != -1);
+    CHECK(utils::SocketListen(listen_fd, 1));
+    int send_fd = utils::TcpSocketConnect("127.0.0.1", port);
+    CHECK(send_fd != -1);
+    int recv_fd = accept(listen_fd, nullptr, nullptr);
+    PCHECK(recv_fd != -1) << "accept failed";
+    close(listen_fd);
+
+    server::IOWorker io_worker("Bench", server::ServerBase::kDefaultIOWorkerBufferSize);
+    int pipe_fds[2] = { -1, -1 };
+    PCHECK(socketpair(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0, pipe_fds) == 0)
+        << "socketpair failed";
+    io_worker.Start(pipe_fds[1]);
+
+    std::atomic<size_t> num_messages{0};
+    std::atomic<size_t> num_bytes{0};
+    auto connection = std::make_shared<server::IngressConnection>(
+        kStorageIngressTypeId, recv_fd, sizeof(protocol::SharedLogMessage));
+    connection->SetMessageFullSizeCallback(
+        &server::IngressConnection::SharedLogMessageFullSizeCallback);
+    connection->SetNewMessageCallback(
+        server::IngressConnection::BuildNewSharedLogMessageCallback(
+            [&] (const protocol::SharedLogMessage& message, std::span<const char> payload) {
+                DCHECK_EQ(static_cast<size_t>(message.payload_size), payload.size());
+                num_messages.fetch_add(1, std::memory_order_relaxed);
+                num_bytes.fetch_add(sizeof(message) + payload.size(),
+                                    std::memory_order_relaxed);
+            }));
+    connection->set_id(0);
+    server::ConnectionBase* conn_ptr = connection.get();
+    PCHECK(write(pipe_fds[0], &conn_ptr, __FAAS_PTR_SIZE) == __FAAS_PTR_SIZE);
+
+    size_t payload_size = absl::GetFlag(FLAGS_payload_size);
+    size_t batch_size = absl::GetFlag(FLAGS_batch_size);
+    size_t message_size = sizeof(protocol::SharedLogMessage) + payload_size;
+    std::string batch(message_size * batch_size, '\0');
+    for (size_t i = 0; i < batch_size; i++) {
+        protocol::SharedLogMessage message;
+        memset(&message, 0, sizeof(message));
+        message.payload_size = gsl::narrow_cast<uint32_t>(payload_size);
+        memcpy(batch.data() + i * message_size, &message, sizeof(message));
+    }
+
+    size_t num_sent = 0;
+    bench_utils::BenchLoop bench_loop(absl::GetFlag(FLAGS_duration), [&] () -> bool {
+        CHECK(io_utils::SendData(send_fd, STRING_AS_SPAN(batch)));
+        num_sent += batch_size;
+        return true;
+    });
+    shutdown(send_fd, SHUT_WR);
+
+    // IOWorker hands the connection back through the pipe once it is closed
+    server::ConnectionBase* closed_conn = nullptr;
+    PCHECK(read(pipe_fds[0], &closed_conn, __FAAS_PTR_SIZE) == __FAAS_PTR_SIZE);
+    CHECK_EQ(closed_conn, conn_ptr);
+    close(send_fd);
+    io_worker.ScheduleStop();
+    io_worker.WaitForFinish();
+    close(pipe_fds[0]);
+
+    CHECK_EQ(num_messages.load(), num_sent);
+    double elapsed_sec = absl::ToDoubleSeconds(bench_loop.elapsed_time());
+    LOG(INFO) << "Buffer ring: "
+              << (absl::GetFlag(FLAGS_io_uring_enable_buf_ring) ? "enabled" : "disabled");
+    LOG(INFO) << "Elapsed time: " << bench_loop.elapsed_time();
+    LOG(INFO) << fmt::format("Messages per second: {:.1f}",
+                             static_cast<double>(num_messages.load()) / elapsed_sec);
+    LOG(INFO) << fmt::format("Throughput: {:.2f} MB/s",
+                             static_cast<double>(num_bytes.load()) / elapsed_sec / 1e6);
+    return 0;
+}
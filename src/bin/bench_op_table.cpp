@@ -0,0 +1,110 @@
+#include "base/init.h"
+#include "base/common.h"
+#include "base/thread.h"
+#include "utils/bench.h"
+#include "log/utils.h"
+
+ABSL_FLAG(std::string, impl, "sharded",
+          "Op table implementation: sharded, sharded_timeout or threaded_map");
+ABSL_FLAG(int, num_threads, 8, "Number of threads issuing and completing ops");
+ABSL_FLAG(int, inflight_ops, 64, "Ongoing ops of each thread");
+ABSL_FLAG(absl::Duration, duration, absl::Seconds(10), "Duration to run");
+ABSL_FLAG(absl::Duration, op_timeout, absl::Seconds(1),
+          "Op timeout of sharded_timeout, which must exceed the lifetime of ops");
+
+using namespace faas;
+
+struct DummyOp {
+    uint64_t id;
+};
+
+// Each loop puts a new op, and polls the oldest ongoing op of this thread.
+// Op ids are interleaved among threads, like ids from a shared counter.
+template<class TableType>
+static void RunBench(TableType* table) {
+    int num_threads = absl::GetFlag(FLAGS_num_threads);
+    size_t inflight_ops = gsl::narrow_cast<size_t>(absl::GetFlag(FLAGS_inflight_ops));
+    CHECK_GT(num_threads, 0);
+    CHECK_GT(inflight_ops, 0U);
+    std::vector<size_t> loop_counts(num_threads, 0);
+    std::vector<absl::Duration> elapsed_times(num_threads);
+    std::vector<std::unique_ptr<base::Thread>> threads;
+    for (int i = 0; i < num_threads; i++) {
+        threads.emplace_back(new base::Thread(fmt::format("Bench-{}", i), [&, i] () {
+            std::vector<DummyOp> ops(inflight_ops);
+            uint64_t next_id = static_cast<uint64_t>(i);
+            size_t pos = 0;
+            bench_utils::BenchLoop bench_loop(absl::GetFlag(FLAGS_duration), [&] () -> bool {
+                DummyOp* op = &ops[pos++ % inflight_ops];
+                if (pos > inflight_ops) {
+                    CHECK_EQ(table->PollChecked(op->id), op);
+                }
+                op->id = next_id;
+                next_id += static_cast<uint64_t>(num_threads);
+                table->PutChecked(op->id, op);
+                return true;
+            });
+            for (size_t j = 0; j < std::min(pos, inflight_ops); j++) {
+                table->RemoveChecked(ops[j].id);
+            }
+            loop_counts[i] = bench_loop.loop_count();
+            elapsed_times[i] = bench_loop.elapsed_time();
+        }));
+    }
+    for (auto& thread : threads) {
+        thread->Start();
+    }
+    for (auto& thread : threads) {
+        thread->Join();
+    }
+    double total_rate = 0;
+    for (int i = 0; i < num_threads; i++) {
+        total_rate += loop_counts[i] / absl::ToDoubleMilliseconds(elapsed_times[i]);
+    }
+    LOG(INFO) << "Threads: " << num_threads;
+    LOG(INFO) << "Total op rate: " << total_rate << " put-and-poll per millisecond";
+    LOG(INFO) << "Per-thread op rate: " << total_rate / num_threads
+              << " put-and-poll per millisecond";
+}
+
+// Polls expired ops at 1/16 of the timeout, as the engine does for reads.
+// Ops are removed well before they expire, so polls only drop stale keys
+// from the expiry wheel.
+static void RunBenchWithTimeout() {
+    absl::Duration op_timeout = absl::GetFlag(FLAGS_op_timeout);
+    CHECK(op_timeout > absl::ZeroDuration()) << "Op timeout must be positive";
+    log_utils::ShardedOpTable<DummyOp> table(op_timeout);
+    std::atomic<bool> stopped(false);
+    size_t num_polls = 0;
+    base::Thread expire_thread("Expire", [&] () {
+        std::vector<std::pair<uint64_t, DummyOp*>> expired_ops;
+        while (!stopped.load(std::memory_order_relaxed)) {
+            absl::SleepFor(op_timeout / 16);
+            table.PollExpired(&expired_ops);
+            CHECK(expired_ops.empty()) << "Ops expired, as the op timeout is too short";
+            num_polls++;
+        }
+    });
+    expire_thread.Start();
+    RunBench(&table);
+    stopped.store(true, std::memory_order_relaxed);
+    expire_thread.Join();
+    LOG(INFO) << "Expiry polls: " << num_polls;
+}
+
+int main(int argc, char* argv[]) {
+    base::InitMain(argc, argv);
+    std::string impl = absl::GetFlag(FLAGS_impl);
+    if (impl == "sharded") {
+        log_utils::ShardedOpTable<DummyOp> table;
+        RunBench(&table);
+    } else if (impl == "sharded_timeout") {
+        RunBenchWithTimeout();
+    } else if (impl == "threaded_map") {
+        log_utils::ThreadedMap<DummyOp> table;
+        RunBench(&table);
+    } else {
+        LOG(FATAL) << "Unknown op table implementation: " << impl;
+    }
+    return 0;
+}
@@ -0,0 +1,109 @@
+#include "base/init.h"
+#include "base/common.h"
+#include "utils/bench.h"
+#include "utils/random.h"
+#include "log/index_local_seq_cache.h"
+
+__BEGIN_THIRD_PARTY_HEADERS
+#include <tkrzw_dbm_cache.h>
+__END_THIRD_PARTY_HEADERS
+
+ABSL_FLAG(std::string, impl, "table", "Cache implementation: table or cachedbm");
+ABSL_FLAG(int, cache_cap, 1000000, "Capacity of the cache in number of seqnums");
+ABSL_FLAG(size_t, num_seqnums, 1000000, "Number of distinct seqnums to put and look up");
+ABSL_FLAG(absl::Duration, duration, absl::Seconds(10), "Duration to run lookups");
+ABSL_FLAG(int, cpu, -1, "Pin benchmark thread to this CPU");
+
+using namespace faas;
+
+// The seqnum cache used before SeqnumCache switched to an open-addressing
+// table, kept here as the baseline
+class CacheDBMSeqnumCache {
+public:
+    explicit CacheDBMSeqnumCache(int cap_num_rec)
+        : dbm_(new tkrzw::CacheDBM(int64_t{cap_num_rec}, -1)) {}
+
+    void Put(uint64_t seqnum, uint16_t storage_shard_id) {
+        std::string key_str = fmt::format("0_{:016x}", seqnum);
+        std::string data = fmt::format("{}", storage_shard_id);
+        dbm_->Set(key_str, data, false);
+    }
+
+    bool Get(uint64_t seqnum, uint16_t* storage_shard_id) {
+        std::string key_str = fmt::format("0_{:016x}", seqnum);
+        std::string data;
+        if (!dbm_->Get(key_str, &data).IsOK()) {
+            return false;
+        }
+        int parsed_storage_shard_id;
+        CHECK(absl::SimpleAtoi(data.c_str(), &parsed_storage_shard_id));
+        *storage_shard_id = gsl::narrow_cast<uint16_t>(parsed_storage_shard_id);
+        return true;
+    }
+
+private:
+    std::unique_ptr<tkrzw::CacheDBM> dbm_;
+    DISALLOW_COPY_AND_ASSIGN(CacheDBMSeqnumCache);
+};
+
+static constexpr size_t kNumLookupSeqnums = 1 << 20;
+
+template<class CacheType>
+static void RunBench(CacheType* cache, std::span<const uint64_t> seqnums,
+                     std::span<const uint64_t> lookup_seqnums, size_t rss_before) {
+    for (size_t i = 0; i < seqnums.size(); i++) {
+        cache->Put(seqnums[i], gsl::narrow_cast<uint16_t>(i % 16));
+    }
+    size_t rss_after = bench_utils::ReadResidentBytes();
+    size_t cached = std::min(seqnums.size(), static_cast<size_t>(absl::GetFlag(FLAGS_cache_cap)));
+    LOG(INFO) << "Bytes per entry (RSS delta): "
+              << static_cast<double>(rss_after - rss_before) / static_cast<double>(cached);
+
+    size_t num_hits = 0;
+    size_t pos = 0;
+    bench_utils::BenchLoop bench_loop(absl::GetFlag(FLAGS_duration), [&] () -> bool {
+        uint64_t seqnum = lookup_seqnums[pos++ % lookup_seqnums.size()];
+        uint16_t storage_shard_id;
+        if (cache->Get(seqnum, &storage_shard_id)) {
+            num_hits++;
+        }
+        return true;
+    });
+    LOG(INFO) << "Elapsed milliseconds: "
+              << absl::ToInt64Milliseconds(bench_loop.elapsed_time());
+    LOG(INFO) << "Lookup rate: "
+              << bench_loop.loop_count() / absl::ToDoubleMilliseconds(bench_loop.elapsed_time())
+              << " lookups per millisecond";
+    LOG(INFO) << "Hit ratio: "
+              << static_cast<double>(num_hits) / static_cast<double>(bench_loop.loop_count());
+}
+
+int main(int argc, char* argv[]) {
+    base::InitMain(argc, argv);
+    if (absl::GetFlag(FLAGS_cpu) != -1) {
+        bench_utils::PinCurrentThreadToCpu(absl::GetFlag(FLAGS_cpu));
+    }
+    int cache_cap = absl::GetFlag(FLAGS_cache_cap);
+    std::string impl = absl::GetFlag(FLAGS_impl);
+    size_t num_seqnums = absl::GetFlag(FLAGS_num_seqnums);
+    CHECK_GT(num_seqnums, 0U);
+    std::vector<uint64_t> seqnums(num_seqnums);
+    for (size_t i = 0; i < num_seqnums; i++) {
+        seqnums[i] = bits::JoinTwo32(1, gsl::narrow_cast<uint32_t>(i));
+    }
+    std::vector<uint64_t> lookup_seqnums(kNumLookupSeqnums);
+    for (size_t i = 0; i < kNumLookupSeqnums; i++) {
+        lookup_seqnums[i] = seqnums[utils::GetRandomInt(0, gsl::narrow_cast<int>(num_seqnums))];
+    }
+    size_t rss_before = bench_utils::ReadResidentBytes();
+    if (impl == "table") {
+        log::SeqnumCache cache(cache_cap);
+        RunBench(&cache, VECTOR_AS_SPAN(seqnums), VECTOR_AS_SPAN(lookup_seqnums), rss_before);
+    } else if (impl == "cachedbm") {
+        CacheDBMSeqnumCache cache(cache_cap);
+        RunBench(&cache, VECTOR_AS_SPAN(seqnums), VECTOR_AS_SPAN(lookup_seqnums), rss_before);
+    } else {
+        LOG(FATAL) << "Unknown cache implementation: " << impl;
+    }
+    return 0;
+}
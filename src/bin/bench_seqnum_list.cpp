@@ -0,0 +1,106 @@
+#include "base/init.h"
+#include "base/common.h"
+#include "utils/bench.h"
+#include "utils/random.h"
+#include "log/seqnum_list.h"
+
+ABSL_FLAG(size_t, num_entries, 10000000, "Number of seqnums appended in total");
+ABSL_FLAG(size_t, num_lists, 10000, "Number of lists, e.g. tags of a user log space");
+ABSL_FLAG(int, num_payloads, 1, "Distinct payloads, e.g. engines appending to a tag");
+ABSL_FLAG(absl::Duration, duration, absl::Seconds(10),
+          "Duration to run queries, for sealed blocks and unsealed tails each");
+ABSL_FLAG(int, cpu, -1, "Pin benchmark thread to this CPU");
+
+using namespace faas;
+
+static constexpr size_t kNumQueries = 1 << 20;
+
+// Queries seqnums stored at random positions within the range of each list
+// given by `range_fn`, lists with empty ranges are skipped
+static void RunQueries(std::string_view name, const std::vector<log::SeqnumList>& lists,
+                       std::function<std::pair<size_t, size_t>(size_t)> range_fn) {
+    std::vector<std::pair<size_t, uint32_t>> queries;
+    queries.reserve(kNumQueries);
+    for (size_t i = 0; queries.size() < kNumQueries && i < 64 * kNumQueries; i++) {
+        size_t list = static_cast<size_t>(
+            utils::GetRandomInt(0, gsl::narrow_cast<int>(lists.size())));
+        auto [begin, end] = range_fn(list);
+        if (begin == end) {
+            continue;
+        }
+        size_t pos = static_cast<size_t>(utils::GetRandomInt(
+            gsl::narrow_cast<int>(begin), gsl::narrow_cast<int>(end)));
+        queries.emplace_back(list, lists[list].at(pos));
+    }
+    if (queries.empty()) {
+        LOG(INFO) << name << ": no entries to query";
+        return;
+    }
+    size_t num_found = 0;
+    size_t pos = 0;
+    bench_utils::BenchLoop bench_loop(absl::GetFlag(FLAGS_duration), [&] () -> bool {
+        const auto& [list, seqnum] = queries[pos++ % queries.size()];
+        if (lists[list].LowerBound(seqnum) < lists[list].size()) {
+            num_found++;
+        }
+        return true;
+    });
+    CHECK_EQ(num_found, bench_loop.loop_count());
+    LOG(INFO) << name << " query rate: "
+              << bench_loop.loop_count() / absl::ToDoubleMilliseconds(bench_loop.elapsed_time())
+              << " queries per millisecond";
+}
+
+int main(int argc, char* argv[]) {
+    base::InitMain(argc, argv);
+    if (absl::GetFlag(FLAGS_cpu) != -1) {
+        bench_utils::PinCurrentThreadToCpu(absl::GetFlag(FLAGS_cpu));
+    }
+    size_t num_entries = absl::GetFlag(FLAGS_num_entries);
+    size_t num_lists = absl::GetFlag(FLAGS_num_lists);
+    int num_payloads = absl::GetFlag(FLAGS_num_payloads);
+    CHECK_GT(num_entries, 0U);
+    CHECK_GT(num_lists, 0U);
+    CHECK_GT(num_payloads, 0);
+
+    // Each seqnum goes to a random list, as entries of random tags do
+    size_t rss_before = bench_utils::ReadResidentBytes();
+    std::vector<log::SeqnumList> lists(num_lists);
+    for (size_t i = 0; i < num_entries; i++) {
+        size_t list = static_cast<size_t>(
+            utils::GetRandomInt(0, gsl::narrow_cast<int>(num_lists)));
+        uint16_t payload = static_cast<uint16_t>(utils::GetRandomInt(0, num_payloads));
+        lists[list].Append(gsl::narrow_cast<uint32_t>(i), payload);
+    }
+    size_t rss_after = bench_utils::ReadResidentBytes();
+
+    size_t memory_usage = 0;
+    for (const log::SeqnumList& list : lists) {
+        memory_usage += list.memory_usage();
+    }
+    LOG(INFO) << "sizeof(SeqnumList): " << sizeof(log::SeqnumList);
+    LOG(INFO) << "Entries per list: "
+              << static_cast<double>(num_entries) / static_cast<double>(num_lists);
+    LOG(INFO) << "Bytes per entry (memory_usage): "
+              << static_cast<double>(memory_usage) / static_cast<double>(num_entries);
+    LOG(INFO) << "Bytes per entry (RSS delta): "
+              << static_cast<double>(rss_after - rss_before) / static_cast<double>(num_entries);
+
+    // Only full blocks of kBlockSize entries are sealed in compressed form
+    std::vector<size_t> num_sealed(num_lists);
+    size_t total_sealed = 0;
+    for (size_t i = 0; i < num_lists; i++) {
+        num_sealed[i] = lists[i].size() / log::SeqnumList::kBlockSize
+                        * log::SeqnumList::kBlockSize;
+        total_sealed += num_sealed[i];
+    }
+    LOG(INFO) << "Entries in sealed blocks: "
+              << static_cast<double>(total_sealed) / static_cast<double>(num_entries);
+    RunQueries("Sealed", lists, [&] (size_t list) {
+        return std::make_pair(size_t{0}, num_sealed[list]);
+    });
+    RunQueries("Unsealed", lists, [&] (size_t list) {
+        return std::make_pair(num_sealed[list], lists[list].size());
+    });
+    return 0;
+}
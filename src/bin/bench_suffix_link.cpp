@@ -0,0 +1,144 @@
+#include "base/init.h"
+#include "base/common.h"
+#include "utils/bench.h"
+#include "utils/bits.h"
+#include "utils/random.h"
+#include "log/index_local_suffix.h"
+#include "log/view.h"
+
+ABSL_FLAG(size_t, num_entries, 1000000, "Number of link entries, one per NEW_LOGS meta log");
+ABSL_FLAG(int, num_shards, 8, "Number of storage shards");
+ABSL_FLAG(int, shards_per_entry, 4, "Productive storage shards of each entry");
+ABSL_FLAG(std::string, direction, "next", "Query direction: next or prev");
+ABSL_FLAG(absl::Duration, duration, absl::Seconds(10), "Duration to run queries");
+ABSL_FLAG(int, cpu, -1, "Pin benchmark thread to this CPU");
+
+using namespace faas;
+
+static constexpr uint16_t kSequencerId = 1;
+static constexpr uint16_t kFirstIndexNodeId = 2;
+static constexpr size_t kNumQuerySeqnums = 1 << 20;
+
+// Single sequencer and storage node, hosting all storage shards. View sizes
+// its global storage shard ids by index nodes, so there is one index node,
+// serving its own index shard, per storage shard.
+static std::unique_ptr<log::View> CreateView(int num_shards) {
+    log::ViewProto view_proto;
+    view_proto.set_view_id(0);
+    view_proto.set_metalog_replicas(1);
+    view_proto.set_userlog_replicas(1);
+    view_proto.set_num_phylogs(1);
+    view_proto.add_sequencer_nodes(kSequencerId);
+    view_proto.add_storage_nodes(1);
+    for (int i = 0; i < num_shards; i++) {
+        view_proto.add_storage_shard_ids(static_cast<uint32_t>(i));
+        view_proto.add_storage_plan(1);
+    }
+    view_proto.set_index_replicas(1);
+    view_proto.set_num_index_shards(static_cast<uint32_t>(num_shards));
+    for (int i = 0; i < num_shards; i++) {
+        uint32_t index_node_id = kFirstIndexNodeId + static_cast<uint32_t>(i);
+        view_proto.add_index_nodes(index_node_id);
+        view_proto.add_index_tier_plan(index_node_id);
+    }
+    return std::make_unique<log::View>(view_proto);
+}
+
+// Feeds `num_entries` NEW_LOGS meta logs, each with a random subset of
+// productive shards appending 1 to 4 records. Returns the next seqnum.
+static uint32_t FillLink(log::SeqnumSuffixLink* link, size_t num_entries,
+                         int num_shards, int shards_per_entry) {
+    std::vector<uint32_t> shard_progresses(static_cast<size_t>(num_shards), 0);
+    std::vector<int> shards(static_cast<size_t>(num_shards));
+    absl::c_iota(shards, 0);
+    uint32_t seqnum = 0;
+    log::MetaLogProto metalog;
+    metalog.set_logspace_id(link->identifier());
+    metalog.set_type(log::MetaLogProto::NEW_LOGS);
+    for (size_t i = 0; i < num_entries; i++) {
+        metalog.set_metalog_seqnum(gsl::narrow_cast<uint32_t>(i));
+        auto* new_logs = metalog.mutable_new_logs_proto();
+        new_logs->Clear();
+        new_logs->set_start_seqnum(seqnum);
+        for (int j = 0; j < shards_per_entry; j++) {
+            std::swap(shards[static_cast<size_t>(j)],
+                      shards[static_cast<size_t>(utils::GetRandomInt(j, num_shards))]);
+        }
+        std::sort(shards.begin(), shards.begin() + shards_per_entry);
+        for (int j = 0; j < shards_per_entry; j++) {
+            size_t shard = static_cast<size_t>(shards[static_cast<size_t>(j)]);
+            uint32_t delta = static_cast<uint32_t>(utils::GetRandomInt(1, 5));
+            new_logs->add_shard_ids(static_cast<uint32_t>(shard));
+            new_logs->add_shard_starts(shard_progresses[shard]);
+            new_logs->add_shard_deltas(delta);
+            shard_progresses[shard] += delta;
+            seqnum += delta;
+        }
+        CHECK(link->ProvideMetaLog(metalog));
+    }
+    return seqnum;
+}
+
+int main(int argc, char* argv[]) {
+    base::InitMain(argc, argv);
+    if (absl::GetFlag(FLAGS_cpu) != -1) {
+        bench_utils::PinCurrentThreadToCpu(absl::GetFlag(FLAGS_cpu));
+    }
+    size_t num_entries = absl::GetFlag(FLAGS_num_entries);
+    int num_shards = absl::GetFlag(FLAGS_num_shards);
+    int shards_per_entry = absl::GetFlag(FLAGS_shards_per_entry);
+    std::string direction = absl::GetFlag(FLAGS_direction);
+    CHECK_GT(num_entries, 0U);
+    CHECK(0 < shards_per_entry && shards_per_entry <= num_shards);
+    CHECK(direction == "next" || direction == "prev") << "Unknown direction: " << direction;
+
+    std::unique_ptr<log::View> view = CreateView(num_shards);
+    size_t rss_before = bench_utils::ReadResidentBytes();
+    log::SeqnumSuffixLink link(view.get(), kSequencerId, 0);
+    uint32_t end_seqnum = FillLink(&link, num_entries, num_shards, shards_per_entry);
+    size_t rss_after = bench_utils::ReadResidentBytes();
+
+    size_t num_link_entries = 0;
+    size_t num_range_entries = 0;
+    size_t size = 0;
+    link.Aggregate(&num_link_entries, &num_range_entries, &size);
+    LOG(INFO) << "Link entries: " << num_link_entries
+              << ", range entries: " << num_range_entries;
+    LOG(INFO) << "Bytes per entry (Aggregate): "
+              << static_cast<double>(size) / static_cast<double>(num_link_entries);
+    LOG(INFO) << "Bytes per entry (RSS delta): "
+              << static_cast<double>(rss_after - rss_before) / static_cast<double>(num_link_entries);
+
+    uint64_t head;
+    uint16_t storage_shard_id;
+    link.GetHead(&head, &storage_shard_id);
+    uint32_t head_lowhalf = bits::LowHalf64(head);
+    std::vector<uint64_t> query_seqnums(kNumQuerySeqnums);
+    for (size_t i = 0; i < kNumQuerySeqnums; i++) {
+        uint32_t seqnum = head_lowhalf + static_cast<uint32_t>(utils::GetRandomInt(
+            0, gsl::narrow_cast<int>(end_seqnum - head_lowhalf)));
+        query_seqnums[i] = bits::JoinTwo32(link.identifier(), seqnum);
+    }
+
+    bool read_next = (direction == "next");
+    size_t num_found = 0;
+    size_t pos = 0;
+    bench_utils::BenchLoop bench_loop(absl::GetFlag(FLAGS_duration), [&] () -> bool {
+        uint64_t query_seqnum = query_seqnums[pos++ % kNumQuerySeqnums];
+        uint64_t seqnum;
+        bool found = read_next ? link.FindNext(query_seqnum, &seqnum, &storage_shard_id)
+                               : link.FindPrev(query_seqnum, &seqnum, &storage_shard_id);
+        if (found) {
+            num_found++;
+        }
+        return true;
+    });
+    LOG(INFO) << "Elapsed milliseconds: "
+              << absl::ToInt64Milliseconds(bench_loop.elapsed_time());
+    LOG(INFO) << "Query rate: "
+              << bench_loop.loop_count() / absl::ToDoubleMilliseconds(bench_loop.elapsed_time())
+              << " queries per millisecond";
+    LOG(INFO) << "Found ratio: "
+              << static_cast<double>(num_found) / static_cast<double>(bench_loop.loop_count());
+    return 0;
+}
@@ -5,6 +5,9 @@
 
 ABSL_FLAG(int, node_id, -1,
           "My node ID. Also settable through environment variable FAAS_NODE_ID.");
+ABSL_FLAG(std::string, checkpoint_path, "",
+          "Directory for index checkpoints, which are loaded on restart. "
+          "Empty disables checkpoints.");
 
 namespace faas {
 
@@ -29,6 +32,8 @@ void IndexMain(int argc, char* argv[]) {
     }
     auto index = std::make_unique<log::Indexer>(node_id);
 
+    index->set_checkpoint_path(absl::GetFlag(FLAGS_checkpoint_path));
+
     index->Start();
     server_ptr.store(index.get());
     index->WaitForFinish();
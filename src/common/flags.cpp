@@ -11,6 +11,8 @@ ABSL_FLAG(int, socket_listen_backlog, 64, "Backlog for listen");
 ABSL_FLAG(bool, tcp_enable_reuseport, false, "Enable SO_REUSEPORT");
 ABSL_FLAG(bool, tcp_enable_nodelay, true, "Enable TCP_NODELAY");
 ABSL_FLAG(bool, tcp_enable_keepalive, true, "Enable TCP keep-alive");
+ABSL_FLAG(bool, egress_hub_vectored_send, true,
+          "EgressHub sends pending messages with a single sendmsg per loop iteration");
 
 ABSL_FLAG(std::string, zookeeper_host, "localhost:2181", "ZooKeeper host");
 ABSL_FLAG(std::string, zookeeper_root_path, "/faas", "Root path for all znodes");
@@ -92,6 +92,8 @@ enum class SharedLogOpType : uint16_t {
     TRIM        = 0x04,  // FuncWorker to Engine, Engine to Sequencer
     SET_AUXDATA = 0x05,  // FuncWorker to Engine, Engine to Storage
     READ_NEXT_B = 0x06,  // FuncWorker to Engine, Engine to Index
+    READ_RANGE  = 0x07,  // FuncWorker to Engine
+    APPEND_BATCH = 0x08, // FuncWorker to Engine
     READ_AT     = 0x10,  // Index to Storage
     REPLICATE   = 0x11,  // Engine to Storage
     INDEX_DATA  = 0x12,  // Engine to Index, Storage to IndexNode
@@ -102,6 +104,8 @@ enum class SharedLogOpType : uint16_t {
     READ_PREV_INDEX_RESULT = 0x17, // IndexNode to IndexNode, IndexNode to Engine
     READ_NEXT_B_INDEX_RESULT = 0x18, // IndexNode to IndexNode, IndexNode to Engine
     READ_MIN    = 0x19, // Engine to Index (get MIN seqnum of tag)
+    REPLICATE_BATCH = 0x1a, // Engine to Storage
+    INDEX_CATCHUP = 0x1b, // Index to Storage (resend index data after metalog_position)
     RESPONSE    = 0x20,
     REGISTER    = 0x40 // Engine to Storage, Engine to Sequencer, Sequencer to Sequencer
 };
@@ -185,7 +189,17 @@ struct Message {
     uint64_t log_tag;             // [40:48]
     uint64_t log_client_data;     // [48:56] will be preserved for response to clients
 
-    uint64_t _8_padding_8_;
+    union {
+        struct {
+            union {
+                uint32_t log_range_max_count;  // [56:60] Used in READ_RANGE, and carries
+                                               //         the number of records in responses
+                uint32_t log_batch_size;       // [56:60] Used in APPEND_BATCH
+            };
+            uint32_t log_range_max_bytes;  // [60:64] Used in READ_RANGE, 0 for no limit
+        } __attribute__ ((packed));
+        uint64_t _8_padding_8_;
+    };
 
     char inline_data[__FAAS_MESSAGE_SIZE - __FAAS_CACHE_LINE_SIZE]
         __attribute__ ((aligned (__FAAS_CACHE_LINE_SIZE)));
@@ -195,6 +209,34 @@ struct Message {
 #define MESSAGE_INLINE_DATA_SIZE (__FAAS_MESSAGE_SIZE - MESSAGE_HEADER_SIZE)
 static_assert(sizeof(Message) == __FAAS_MESSAGE_SIZE, "Unexpected Message size");
 
+// Records in READ_RANGE responses are laid out back to back. Each record starts
+// with this header, followed by user tags, log data, and auxiliary data.
+// The records are inlined if they fit, otherwise payload_size is negative and
+// they are stored in the shm region named by GetSharedLogReadRangeShmName.
+struct ReadRangeRecordHeader {
+    uint64_t seqnum;
+    uint32_t data_size;
+    uint16_t num_tags;
+    uint16_t aux_data_size;
+} __attribute__ ((packed));
+
+static_assert(sizeof(ReadRangeRecordHeader) == 16, "Unexpected ReadRangeRecordHeader size");
+
+// Records in APPEND_BATCH requests and REPLICATE_BATCH messages are laid out
+// back to back. Each record starts with this header, followed by user tags
+// and log data. APPEND_BATCH requests use shm regions named by
+// GetSharedLogAppendBatchShmName when records do not fit inline.
+struct AppendBatchRecordHeader {
+    uint32_t data_size;
+    uint16_t num_tags;
+    uint16_t _2_padding_2_;
+} __attribute__ ((packed));
+
+static_assert(sizeof(AppendBatchRecordHeader) == 8, "Unexpected AppendBatchRecordHeader size");
+
+// Seqnums of APPEND_BATCH are returned inline in the response
+#define MAX_APPEND_BATCH_SIZE (MESSAGE_INLINE_DATA_SIZE / sizeof(uint64_t))
+
 enum class ConnType : uint16_t {
     GATEWAY_TO_ENGINE      = 0,
     ENGINE_TO_GATEWAY      = 1,
@@ -276,7 +318,7 @@ struct SharedLogMessage {
     };
 
     union {
-        uint32_t metalog_position; // [16:20] (only used by META_PROG | REGISTRATION)
+        uint32_t metalog_position; // [16:20] (only used by META_PROG | REGISTRATION | INDEX_CATCHUP)
         uint32_t user_logspace;    // [16:20]
     };
 
@@ -320,6 +362,7 @@ struct SharedLogMessage {
         uint64_t prev_found_seqnum; // [56:64]
         uint64_t seqnum_timestamp;  // [56:64] (only used by Index Tier MIN requests)
         uint64_t found_seqnum; // [56:64] (only used by AGGREGATING)
+        uint64_t num_records;  // [56:64] (only used by REPLICATE_BATCH)
     };
 
 } __attribute__ (( packed, aligned(__FAAS_CACHE_LINE_SIZE) ));
@@ -614,6 +657,12 @@ public:
         return message;
     }
 
+    static SharedLogMessage NewReplicateBatchMessage() {
+        NEW_EMPTY_SHAREDLOG_MESSAGE(message);
+        message.op_type = static_cast<uint16_t>(SharedLogOpType::REPLICATE_BATCH);
+        return message;
+    }
+
     static SharedLogMessage NewSetAuxDataMessage(uint64_t seqnum) {
         NEW_EMPTY_SHAREDLOG_MESSAGE(message);
         message.op_type = static_cast<uint16_t>(SharedLogOpType::SET_AUXDATA);
@@ -651,6 +700,26 @@ public:
         return message;
     }
 
+    static SharedLogMessage NewIndexCatchupMessage(uint32_t logspace_id,
+                                                   uint32_t metalog_position) {
+        NEW_EMPTY_SHAREDLOG_MESSAGE(message);
+        message.op_type = static_cast<uint16_t>(SharedLogOpType::INDEX_CATCHUP);
+        message.logspace_id = logspace_id;
+        message.metalog_position = metalog_position;
+        return message;
+    }
+
+    static SharedLogMessage NewTrimMessage(uint32_t logspace_id, uint32_t user_logspace,
+                                           uint64_t user_tag, uint64_t trim_seqnum) {
+        NEW_EMPTY_SHAREDLOG_MESSAGE(message);
+        message.op_type = static_cast<uint16_t>(SharedLogOpType::TRIM);
+        message.logspace_id = logspace_id;
+        message.user_logspace = user_logspace;
+        message.query_tag = user_tag;
+        message.trim_seqnum = trim_seqnum;
+        return message;
+    }
+
     static SharedLogMessage NewReadMessage(SharedLogOpType op_type) {
         NEW_EMPTY_SHAREDLOG_MESSAGE(message);
         message.op_type = static_cast<uint16_t>(op_type);
@@ -713,6 +713,19 @@ bool Engine::SendSharedLogMessage(protocol::ConnType conn_type, uint16_t dst_nod
     return true;
 }
 
+bool Engine::SendSharedLogMessage(protocol::ConnType conn_type, uint16_t dst_node_id,
+                                  std::shared_ptr<const std::string> encoded_message) {
+    DCHECK_GE(encoded_message->size(), sizeof(SharedLogMessage));
+    EgressHub* hub = CurrentIOWorkerChecked()->PickOrCreateConnection<EgressHub>(
+        ServerBase::GetEgressHubTypeId(conn_type, dst_node_id),
+        absl::bind_front(&Engine::CreateEgressHub, this, conn_type, dst_node_id));
+    if (hub == nullptr) {
+        return false;
+    }
+    hub->SendSharedMessage(std::move(encoded_message));
+    return true;
+}
+
 EgressHub* Engine::CreateEgressHub(protocol::ConnType conn_type,
                                    uint16_t dst_node_id, IOWorker* io_worker) {
     struct sockaddr_in addr;
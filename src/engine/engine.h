@@ -133,6 +133,10 @@ private:
                               std::span<const char> payload1 = EMPTY_CHAR_SPAN,
                               std::span<const char> payload2 = EMPTY_CHAR_SPAN,
                               std::span<const char> payload3 = EMPTY_CHAR_SPAN);
+    // The encoded message (SharedLogMessage followed by payload) can be
+    // shared by multiple sends without copying
+    bool SendSharedLogMessage(protocol::ConnType conn_type, uint16_t dst_node_id,
+                              std::shared_ptr<const std::string> encoded_message);
     server::EgressHub* CreateEgressHub(protocol::ConnType conn_type,
                                        uint16_t dst_node_id,
                                        server::IOWorker* io_worker);
@@ -78,5 +78,13 @@ std::string GetFuncCallOutputFifoName(uint64_t full_call_id) {
     return fmt::format("{}.o", full_call_id);
 }
 
+std::string GetSharedLogReadRangeShmName(uint64_t full_call_id, uint64_t client_data) {
+    return fmt::format("{}.r{}", full_call_id, client_data);
+}
+
+std::string GetSharedLogAppendBatchShmName(uint64_t full_call_id, uint64_t client_data) {
+    return fmt::format("{}.a{}", full_call_id, client_data);
+}
+
 }  // namespace ipc
 }  // namespace faas
@@ -18,6 +18,8 @@ std::string GetFuncWorkerOutputFifoName(uint16_t client_id);
 std::string GetFuncCallInputShmName(uint64_t full_call_id);
 std::string GetFuncCallOutputShmName(uint64_t full_call_id);
 std::string GetFuncCallOutputFifoName(uint64_t full_call_id);
+std::string GetSharedLogReadRangeShmName(uint64_t full_call_id, uint64_t client_data);
+std::string GetSharedLogAppendBatchShmName(uint64_t full_call_id, uint64_t client_data);
 
 }  // namespace ipc
 }  // namespace faas
@@ -1,103 +1,147 @@
 #include "log/cache.h"
 
-__BEGIN_THIRD_PARTY_HEADERS
-#include <tkrzw_dbm_cache.h>
-__END_THIRD_PARTY_HEADERS
-
 namespace faas {
 namespace log {
 
-LRUCache::LRUCache(int mem_cap_mb) {
-    int64_t cap_mem_size = -1;
+namespace {
+// Approximate per-slot bookkeeping cost (hash map slot, clock entry,
+// control block of shared_ptr, and LogEntry itself)
+constexpr size_t kSlotOverhead = sizeof(LogEntry) + 64;
+
+static inline size_t HashSeqnum(uint64_t seqnum) {
+    // Finalizer of MurmurHash3, spreading consecutive seqnums across shards
+    seqnum ^= seqnum >> 33;
+    seqnum *= 0xff51afd7ed558ccdULL;
+    seqnum ^= seqnum >> 33;
+    return static_cast<size_t>(seqnum);
+}
+}  // namespace
+
+LRUCache::LRUCache(int mem_cap_mb)
+    : shard_mem_cap_(0) {
     if (mem_cap_mb > 0) {
-        cap_mem_size = int64_t{mem_cap_mb} << 20;
+        shard_mem_cap_ = std::max<size_t>((static_cast<size_t>(mem_cap_mb) << 20) / kNumShards, 1);
+    }
+    for (Shard& shard : shards_) {
+        absl::MutexLock lk(&shard.mu);
+        shard.mem_size = 0;
+        shard.num_evictions = 0;
     }
-    dbm_.reset(new tkrzw::CacheDBM(/* cap_rec_num= */ -1, cap_mem_size));
 }
 
 LRUCache::~LRUCache() {}
 
-namespace {
-static inline std::string EncodeLogEntry(const LogMetaData& log_metadata,
-                                         std::span<const uint64_t> user_tags,
-                                         std::span<const char> log_data) {
+void LRUCache::Put(const LogMetaData& log_metadata, std::span<const uint64_t> user_tags,
+                   std::span<const char> log_data) {
     DCHECK_EQ(log_metadata.num_tags, user_tags.size());
     DCHECK_EQ(log_metadata.data_size, log_data.size());
-    size_t total_size = log_data.size()
-                      + user_tags.size() * sizeof(uint64_t)
-                      + sizeof(LogMetaData);
-    std::string encoded;
-    encoded.resize(total_size);
-    char* ptr = encoded.data();
-    DCHECK_GT(log_data.size(), 0U);
-    memcpy(ptr, log_data.data(), log_data.size());
-    ptr += log_data.size();
-    if (user_tags.size() > 0) {
-        memcpy(ptr, user_tags.data(), user_tags.size() * sizeof(uint64_t));
-        ptr += user_tags.size() * sizeof(uint64_t);
+    auto log_entry = std::make_shared<LogEntry>();
+    log_entry->metadata = log_metadata;
+    log_entry->user_tags.assign(user_tags.begin(), user_tags.end());
+    log_entry->data.assign(log_data.data(), log_data.size());
+
+    Shard* shard = GetShard(log_metadata.seqnum);
+    absl::MutexLock lk(&shard->mu);
+    Slot* slot = GetOrCreateSlot(shard, log_metadata.seqnum);
+    if (slot->log_entry != nullptr) {
+        // Log entries are immutable, keep the existing one
+        return;
     }
-    memcpy(ptr, &log_metadata, sizeof(LogMetaData));
-    return encoded;
+    slot->log_entry = std::move(log_entry);
+    UpdateMemSize(shard, slot);
+    EvictIfNeeded(shard);
 }
 
-static inline void DecodeLogEntry(std::string encoded, LogEntry* log_entry) {
-    DCHECK_GT(encoded.size(), sizeof(LogMetaData));
-    LogMetaData& metadata = log_entry->metadata;
-    memcpy(&metadata,
-           encoded.data() + encoded.size() - sizeof(LogMetaData),
-           sizeof(LogMetaData));
-    size_t total_size = metadata.data_size
-                      + metadata.num_tags * sizeof(uint64_t)
-                      + sizeof(LogMetaData);
-    DCHECK_EQ(total_size, encoded.size());
-    if (metadata.num_tags > 0) {
-        std::span<const uint64_t> user_tags(
-            reinterpret_cast<const uint64_t*>(encoded.data() + metadata.data_size),
-            metadata.num_tags);
-        log_entry->user_tags.assign(user_tags.begin(), user_tags.end());
-    } else {
-        log_entry->user_tags.clear();
+std::shared_ptr<const LogEntry> LRUCache::Get(uint64_t seqnum) {
+    Shard* shard = GetShard(seqnum);
+    absl::MutexLock lk(&shard->mu);
+    auto iter = shard->slots.find(seqnum);
+    if (iter == shard->slots.end() || iter->second.log_entry == nullptr) {
+        return nullptr;
     }
-    encoded.resize(metadata.data_size);
-    log_entry->data = std::move(encoded);
+    iter->second.referenced = true;
+    DCHECK_EQ(seqnum, iter->second.log_entry->metadata.seqnum);
+    return iter->second.log_entry;
 }
-}  // namespace
 
-void LRUCache::Put(const LogMetaData& log_metadata, std::span<const uint64_t> user_tags,
-                   std::span<const char> log_data) {
-    std::string key_str = fmt::format("0_{:016x}", log_metadata.seqnum);
-    std::string data = EncodeLogEntry(log_metadata, user_tags, log_data);
-    dbm_->Set(key_str, data, /* overwrite= */ false);
+void LRUCache::PutAuxData(uint64_t seqnum, std::span<const char> data) {
+    Shard* shard = GetShard(seqnum);
+    absl::MutexLock lk(&shard->mu);
+    Slot* slot = GetOrCreateSlot(shard, seqnum);
+    slot->aux_data.emplace(data.data(), data.size());
+    UpdateMemSize(shard, slot);
+    EvictIfNeeded(shard);
 }
 
-std::optional<LogEntry> LRUCache::Get(uint64_t seqnum) {
-    std::string key_str = fmt::format("0_{:016x}", seqnum);
-    std::string data;
-    auto status = dbm_->Get(key_str, &data);
-    if (status.IsOK()) {
-        LogEntry log_entry;
-        DecodeLogEntry(std::move(data), &log_entry);
-        DCHECK_EQ(seqnum, log_entry.metadata.seqnum);
-        return log_entry;
-    } else {
+std::optional<std::string> LRUCache::GetAuxData(uint64_t seqnum) {
+    Shard* shard = GetShard(seqnum);
+    absl::MutexLock lk(&shard->mu);
+    auto iter = shard->slots.find(seqnum);
+    if (iter == shard->slots.end() || !iter->second.aux_data.has_value()) {
         return std::nullopt;
     }
+    iter->second.referenced = true;
+    return iter->second.aux_data;
 }
 
-void LRUCache::PutAuxData(uint64_t seqnum, std::span<const char> data) {
-    std::string key_str = fmt::format("1_{:016x}", seqnum);
-    dbm_->Set(key_str, std::string_view(data.data(), data.size()),
-              /* overwrite= */ true);
+uint64_t LRUCache::num_evictions() const {
+    uint64_t sum = 0;
+    for (const Shard& shard : shards_) {
+        absl::MutexLock lk(&shard.mu);
+        sum += shard.num_evictions;
+    }
+    return sum;
 }
 
-std::optional<std::string> LRUCache::GetAuxData(uint64_t seqnum) {
-    std::string key_str = fmt::format("1_{:016x}", seqnum);
-    std::string data;
-    auto status = dbm_->Get(key_str, &data);
-    if (status.IsOK()) {
-        return data;
-    } else {
-        return std::nullopt;
+LRUCache::Shard* LRUCache::GetShard(uint64_t seqnum) {
+    return &shards_[HashSeqnum(seqnum) % kNumShards];
+}
+
+LRUCache::Slot* LRUCache::GetOrCreateSlot(Shard* shard, uint64_t seqnum) {
+    auto [iter, inserted] = shard->slots.try_emplace(seqnum);
+    Slot* slot = &iter->second;
+    if (inserted) {
+        slot->mem_size = kSlotOverhead;
+        slot->referenced = false;
+        shard->mem_size += kSlotOverhead;
+        shard->clock.push_back(seqnum);
+    }
+    return slot;
+}
+
+void LRUCache::UpdateMemSize(Shard* shard, Slot* slot) {
+    size_t mem_size = kSlotOverhead;
+    if (slot->log_entry != nullptr) {
+        mem_size += slot->log_entry->data.size()
+                  + slot->log_entry->user_tags.size() * sizeof(uint64_t);
+    }
+    if (slot->aux_data.has_value()) {
+        mem_size += slot->aux_data->size();
+    }
+    DCHECK_GE(shard->mem_size, slot->mem_size);
+    shard->mem_size = shard->mem_size - slot->mem_size + mem_size;
+    slot->mem_size = mem_size;
+}
+
+void LRUCache::EvictIfNeeded(Shard* shard) {
+    if (shard_mem_cap_ == 0) {
+        return;
+    }
+    // Always keep at least one slot, even if it alone exceeds the cap
+    while (shard->mem_size > shard_mem_cap_ && shard->clock.size() > 1) {
+        uint64_t seqnum = shard->clock.front();
+        shard->clock.pop_front();
+        auto iter = shard->slots.find(seqnum);
+        DCHECK(iter != shard->slots.end());
+        if (iter->second.referenced) {
+            iter->second.referenced = false;
+            shard->clock.push_back(seqnum);
+            continue;
+        }
+        DCHECK_GE(shard->mem_size, iter->second.mem_size);
+        shard->mem_size -= iter->second.mem_size;
+        shard->slots.erase(iter);
+        shard->num_evictions++;
     }
 }
 
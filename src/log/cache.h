@@ -2,12 +2,13 @@
 
 #include "log/common.h"
 
-// Forward declarations
-namespace tkrzw { class CacheDBM; }
-
 namespace faas {
 namespace log {
 
+// Log cache keyed by seqnum, sharded by hash of seqnum to avoid contention
+// among IO workers. Cached log entries are immutable and reference counted,
+// so cache hits do not copy log data. Each shard evicts with the CLOCK
+// (second chance) policy once its share of the memory capacity is used up.
 class LRUCache {
 public:
     explicit LRUCache(int mem_cap_mb);
@@ -15,13 +16,40 @@ public:
 
     void Put(const LogMetaData& log_metadata, std::span<const uint64_t> user_tags,
              std::span<const char> log_data);
-    std::optional<LogEntry> Get(uint64_t seqnum);
+    std::shared_ptr<const LogEntry> Get(uint64_t seqnum);
 
     void PutAuxData(uint64_t seqnum, std::span<const char> data);
     std::optional<std::string> GetAuxData(uint64_t seqnum);
 
+    uint64_t num_evictions() const;
+
 private:
-    std::unique_ptr<tkrzw::CacheDBM> dbm_;
+    static constexpr size_t kNumShards = 16;
+
+    struct Slot {
+        std::shared_ptr<const LogEntry> log_entry;
+        std::optional<std::string>      aux_data;
+        size_t                          mem_size;
+        bool                            referenced;
+    };
+
+    struct Shard {
+        mutable absl::Mutex mu;
+        absl::flat_hash_map</* seqnum */ uint64_t, Slot> slots ABSL_GUARDED_BY(mu);
+        // Seqnums in insertion order, scanned by the CLOCK hand from the front
+        std::deque<uint64_t> clock                           ABSL_GUARDED_BY(mu);
+        size_t   mem_size                                    ABSL_GUARDED_BY(mu);
+        uint64_t num_evictions                               ABSL_GUARDED_BY(mu);
+    };
+
+    // Zero means no limit
+    size_t shard_mem_cap_;
+    Shard shards_[kNumShards];
+
+    Shard* GetShard(uint64_t seqnum);
+    Slot* GetOrCreateSlot(Shard* shard, uint64_t seqnum) ABSL_EXCLUSIVE_LOCKS_REQUIRED(shard->mu);
+    void UpdateMemSize(Shard* shard, Slot* slot) ABSL_EXCLUSIVE_LOCKS_REQUIRED(shard->mu);
+    void EvictIfNeeded(Shard* shard) ABSL_EXCLUSIVE_LOCKS_REQUIRED(shard->mu);
 
     DISALLOW_COPY_AND_ASSIGN(LRUCache);
 };
@@ -1,10 +1,21 @@
 #include "log/db.h"
 
+#include "server/io_uring.h"
 #include "utils/bits.h"
+#include "utils/fs.h"
+#include "utils/io.h"
+
+#include <charconv>
+#include <endian.h>
+#include <fcntl.h>
+#include <dirent.h>
+#include <sys/stat.h>
 
 __BEGIN_THIRD_PARTY_HEADERS
 
 #include <rocksdb/db.h>
+#include <rocksdb/version.h>
+#include <rocksdb/write_batch.h>
 
 #include <tkrzw_dbm.h>
 #include <tkrzw_dbm_hash.h>
@@ -16,6 +27,13 @@ __END_THIRD_PARTY_HEADERS
 ABSL_FLAG(int, rocksdb_max_background_jobs, 2, "");
 ABSL_FLAG(size_t, rocksdb_block_cache_size_mb, 1024, "");
 ABSL_FLAG(bool, rocksdb_enable_compression, false, "");
+ABSL_FLAG(size_t, segment_file_prealloc_mb, 64, "");
+ABSL_FLAG(bool, rocksdb_multiget_async_io, true,
+          "If enabled, MultiGet reads data blocks of different keys in parallel "
+          "(requires RocksDB 7.0 or later)");
+ABSL_FLAG(bool, db_read_legacy_hex_keys, false,
+          "If enabled, fall back to hex string keys written by older versions "
+          "when a binary key is not found");
 
 #define ROCKSDB_CHECK_OK(STATUS_VAR, OP_NAME)               \
     do {                                                    \
@@ -38,6 +56,33 @@ ABSL_FLAG(bool, rocksdb_enable_compression, false, "");
 namespace faas {
 namespace log {
 
+namespace {
+// Keys are stored as big-endian integers, so that the byte order of keys
+// matches their numeric order
+class DBKey {
+public:
+    explicit DBKey(uint32_t key) {
+        uint32_t be_key = htobe32(key);
+        memcpy(buf_, &be_key, sizeof(be_key));
+    }
+
+    std::string_view view() const { return std::string_view(buf_, sizeof(buf_)); }
+    rocksdb::Slice slice() const { return rocksdb::Slice(buf_, sizeof(buf_)); }
+
+private:
+    char buf_[sizeof(uint32_t)];
+};
+}  // namespace
+
+void DBInterface::MultiGet(uint32_t logspace_id, std::span<const uint32_t> keys,
+                           std::vector<std::optional<std::string>>* values) {
+    values->clear();
+    values->reserve(keys.size());
+    for (uint32_t key : keys) {
+        values->push_back(Get(logspace_id, key));
+    }
+}
+
 RocksDBBackend::RocksDBBackend(std::string_view db_path) {
     rocksdb::Options options;
     options.create_if_missing = true;
@@ -78,9 +123,11 @@ std::optional<std::string> RocksDBBackend::Get(uint32_t logspace_id, uint32_t ke
         HLOG_F(WARNING, "Log space {} not created", bits::HexStr0x(logspace_id));
         return std::nullopt;
     }
-    std::string key_str = bits::HexStr(key);
     std::string data;
-    auto status = db_->Get(rocksdb::ReadOptions(), cf_handle, key_str, &data);
+    auto status = db_->Get(rocksdb::ReadOptions(), cf_handle, DBKey(key).slice(), &data);
+    if (status.IsNotFound() && absl::GetFlag(FLAGS_db_read_legacy_hex_keys)) {
+        status = db_->Get(rocksdb::ReadOptions(), cf_handle, bits::HexStr(key), &data);
+    }
     if (status.IsNotFound()) {
         return std::nullopt;
     }
@@ -88,19 +135,88 @@ std::optional<std::string> RocksDBBackend::Get(uint32_t logspace_id, uint32_t ke
     return data;
 }
 
+void RocksDBBackend::MultiGet(uint32_t logspace_id, std::span<const uint32_t> keys,
+                              std::vector<std::optional<std::string>>* values) {
+    values->clear();
+    rocksdb::ColumnFamilyHandle* cf_handle = GetCFHandle(logspace_id);
+    if (cf_handle == nullptr) {
+        HLOG_F(WARNING, "Log space {} not created", bits::HexStr0x(logspace_id));
+        values->resize(keys.size());
+        return;
+    }
+    std::vector<DBKey> db_keys;
+    std::vector<rocksdb::Slice> key_slices;
+    db_keys.reserve(keys.size());
+    key_slices.reserve(keys.size());
+    for (uint32_t key : keys) {
+        db_keys.emplace_back(key);
+        key_slices.push_back(db_keys.back().slice());
+    }
+    std::vector<rocksdb::PinnableSlice> data(keys.size());
+    std::vector<rocksdb::Status> statuses(keys.size());
+    rocksdb::ReadOptions read_options;
+#if ROCKSDB_MAJOR >= 7
+    read_options.async_io = absl::GetFlag(FLAGS_rocksdb_multiget_async_io);
+#endif
+    db_->MultiGet(read_options, cf_handle, keys.size(), key_slices.data(),
+                  data.data(), statuses.data());
+    values->reserve(keys.size());
+    for (size_t i = 0; i < keys.size(); i++) {
+        if (statuses[i].IsNotFound()) {
+            if (absl::GetFlag(FLAGS_db_read_legacy_hex_keys)) {
+                values->push_back(Get(logspace_id, keys[i]));
+            } else {
+                values->push_back(std::nullopt);
+            }
+            continue;
+        }
+        ROCKSDB_CHECK_OK(statuses[i], MultiGet);
+        values->push_back(data[i].ToString());
+    }
+}
+
 void RocksDBBackend::Put(uint32_t logspace_id, uint32_t key, std::span<const char> data) {
     rocksdb::ColumnFamilyHandle* cf_handle = GetCFHandle(logspace_id);
     if (cf_handle == nullptr) {
         HLOG_F(ERROR, "Log space {} not created", bits::HexStr0x(logspace_id));
         return;
     }
-    std::string key_str = bits::HexStr(key);
     auto status = db_->Put(
         rocksdb::WriteOptions(), cf_handle,
-        key_str, rocksdb::Slice(data.data(), data.size()));
+        DBKey(key).slice(), rocksdb::Slice(data.data(), data.size()));
     ROCKSDB_CHECK_OK(status, Put);
 }
 
+void RocksDBBackend::PutBatch(uint32_t logspace_id, std::span<const KeyValue> batch) {
+    rocksdb::ColumnFamilyHandle* cf_handle = GetCFHandle(logspace_id);
+    if (cf_handle == nullptr) {
+        HLOG_F(ERROR, "Log space {} not created", bits::HexStr0x(logspace_id));
+        return;
+    }
+    rocksdb::WriteBatch write_batch;
+    for (const KeyValue& record : batch) {
+        auto status = write_batch.Put(
+            cf_handle, DBKey(record.key).slice(), rocksdb::Slice(record.data.data(), record.data.size()));
+        ROCKSDB_CHECK_OK(status, WriteBatch::Put);
+    }
+    auto status = db_->Write(rocksdb::WriteOptions(), &write_batch);
+    ROCKSDB_CHECK_OK(status, Write);
+}
+
+void RocksDBBackend::DeleteRange(uint32_t logspace_id, uint32_t start_key, uint32_t end_key) {
+    rocksdb::ColumnFamilyHandle* cf_handle = GetCFHandle(logspace_id);
+    if (cf_handle == nullptr) {
+        HLOG_F(ERROR, "Log space {} not created", bits::HexStr0x(logspace_id));
+        return;
+    }
+    // Keys are big-endian, so the key range matches the byte order range
+    DBKey start(start_key);
+    DBKey end(end_key);
+    auto status = db_->DeleteRange(
+        rocksdb::WriteOptions(), cf_handle, start.slice(), end.slice());
+    ROCKSDB_CHECK_OK(status, DeleteRange);
+}
+
 rocksdb::ColumnFamilyHandle* RocksDBBackend::GetCFHandle(uint32_t logspace_id) {
     absl::ReaderMutexLock lk(&mu_);
     if (!column_families_.contains(logspace_id)) {
@@ -170,9 +286,11 @@ std::optional<std::string> TkrzwDBMBackend::Get(uint32_t logspace_id, uint32_t k
         HLOG_F(WARNING, "Log space {} not created", bits::HexStr0x(logspace_id));
         return std::nullopt;
     }
-    std::string key_str = bits::HexStr(key);
     std::string data;
-    auto status = dbm->Get(key_str, &data);
+    auto status = dbm->Get(DBKey(key).view(), &data);
+    if (!status.IsOK() && absl::GetFlag(FLAGS_db_read_legacy_hex_keys)) {
+        status = dbm->Get(bits::HexStr(key), &data);
+    }
     if (status.IsOK()) {
         return data;
     } else {
@@ -185,11 +303,40 @@ void TkrzwDBMBackend::Put(uint32_t logspace_id, uint32_t key, std::span<const ch
     if (dbm == nullptr) {
         HLOG_F(FATAL, "Log space {} not created", bits::HexStr0x(logspace_id));
     }
-    std::string key_str = bits::HexStr(key);
-    auto status = dbm->Set(key_str, std::string_view(data.data(), data.size()));
+    auto status = dbm->Set(DBKey(key).view(), std::string_view(data.data(), data.size()));
     TKRZW_CHECK_OK(status, Set);
 }
 
+void TkrzwDBMBackend::PutBatch(uint32_t logspace_id, std::span<const KeyValue> batch) {
+    tkrzw::DBM* dbm = GetDBM(logspace_id);
+    if (dbm == nullptr) {
+        HLOG_F(FATAL, "Log space {} not created", bits::HexStr0x(logspace_id));
+    }
+    std::vector<DBKey> keys;
+    keys.reserve(batch.size());
+    std::map<std::string_view, std::string_view> records;
+    for (const KeyValue& record : batch) {
+        keys.emplace_back(record.key);
+        records[keys.back().view()] = std::string_view(record.data.data(), record.data.size());
+    }
+    auto status = dbm->SetMulti(records, /* overwrite= */ true);
+    TKRZW_CHECK_OK(status, SetMulti);
+}
+
+void TkrzwDBMBackend::DeleteRange(uint32_t logspace_id, uint32_t start_key, uint32_t end_key) {
+    tkrzw::DBM* dbm = GetDBM(logspace_id);
+    if (dbm == nullptr) {
+        HLOG_F(FATAL, "Log space {} not created", bits::HexStr0x(logspace_id));
+    }
+    // Tkrzw has no range deletion, and hash databases are not ordered anyway
+    for (uint32_t key = start_key; key < end_key; key++) {
+        auto status = dbm->Remove(DBKey(key).view());
+        if (status != tkrzw::Status::NOT_FOUND_ERROR) {
+            TKRZW_CHECK_OK(status, Remove);
+        }
+    }
+}
+
 tkrzw::DBM* TkrzwDBMBackend::GetDBM(uint32_t logspace_id) {
     absl::ReaderMutexLock lk(&mu_);
     if (!dbs_.contains(logspace_id)) {
@@ -198,5 +345,459 @@ tkrzw::DBM* TkrzwDBMBackend::GetDBM(uint32_t logspace_id) {
     return dbs_.at(logspace_id).get();
 }
 
+
+SegmentFileBackend::SegmentFileBackend(std::string_view db_path)
+    : db_path_(db_path),
+      segment_prealloc_size_(absl::GetFlag(FLAGS_segment_file_prealloc_mb) << 20),
+      io_uring_(new server::IOUring()) {
+    HLOG_F(INFO, "Use segment files at path {}", db_path);
+    if (!fs_utils::IsDirectory(db_path_) && !fs_utils::MakeDirectory(db_path_)) {
+        PLOG_F(FATAL, "Failed to create directory {}", db_path_);
+    }
+}
+
+SegmentFileBackend::~SegmentFileBackend() {
+    absl::MutexLock write_lk(&write_mu_);
+    absl::MutexLock lk(&mu_);
+    for (const auto& [logspace_id, log_space] : log_spaces_) {
+        absl::MutexLock log_space_lk(&log_space->mu);
+        for (const auto& [segment_id, segment] : log_space->segments) {
+            if (segment->write_fd != -1) {
+                CloseWriteFd(segment.get());
+            }
+        }
+    }
+}
+
+SegmentFileBackend::Segment::~Segment() {
+    PCHECK(close(read_fd) == 0) << "Failed to close segment file";
+}
+
+void SegmentFileBackend::InstallLogSpace(uint32_t logspace_id) {
+    HLOG_F(INFO, "Install log space {}", bits::HexStr0x(logspace_id));
+    auto log_space = std::make_unique<LogSpace>();
+    log_space->logspace_id = logspace_id;
+    log_space->dir_path = fs_utils::JoinPath(db_path_, bits::HexStr(logspace_id));
+    log_space->writable_segment = nullptr;
+    if (fs_utils::IsDirectory(log_space->dir_path)) {
+        RecoverLogSpace(log_space.get());
+        RecoverTrimmedRanges(log_space.get());
+    } else if (!fs_utils::MakeDirectory(log_space->dir_path)) {
+        PLOG_F(FATAL, "Failed to create directory {}", log_space->dir_path);
+    }
+    {
+        absl::MutexLock lk(&mu_);
+        DCHECK(!log_spaces_.contains(logspace_id));
+        log_spaces_[logspace_id] = std::move(log_space);
+    }
+}
+
+std::optional<std::string> SegmentFileBackend::Get(uint32_t logspace_id, uint32_t key) {
+    LogSpace* log_space = GetLogSpace(logspace_id);
+    if (log_space == nullptr) {
+        HLOG_F(WARNING, "Log space {} not created", bits::HexStr0x(logspace_id));
+        return std::nullopt;
+    }
+    std::shared_ptr<const Segment> segment;
+    RecordLocation location;
+    {
+        absl::ReaderMutexLock lk(&log_space->mu);
+        auto iter = log_space->segments.find(key >> kSegmentKeyBits);
+        if (iter == log_space->segments.end()) {
+            return std::nullopt;
+        }
+        segment = iter->second;
+        location = segment->index[key & (kKeysPerSegment - 1)];
+    }
+    int fd = segment->read_fd;
+    if (location.size == 0) {
+        return std::nullopt;
+    }
+    std::string data;
+    data.resize(location.size);
+    size_t pos = 0;
+    while (pos < data.size()) {
+        ssize_t nread = pread(fd, data.data() + pos, data.size() - pos,
+                              static_cast<off_t>(location.offset + pos));
+        if (nread < 0 && errno == EINTR) {
+            continue;
+        }
+        if (nread <= 0) {
+            PLOG_F(FATAL, "Failed to read record {} of log space {}",
+                   bits::HexStr0x(key), bits::HexStr0x(logspace_id));
+        }
+        pos += static_cast<size_t>(nread);
+    }
+    return data;
+}
+
+void SegmentFileBackend::Put(uint32_t logspace_id, uint32_t key, std::span<const char> data) {
+    KeyValue record = { .key = key, .data = data };
+    PutBatch(logspace_id, std::span<const KeyValue>(&record, 1));
+}
+
+void SegmentFileBackend::PutBatch(uint32_t logspace_id, std::span<const KeyValue> batch) {
+    LogSpace* log_space = GetLogSpace(logspace_id);
+    if (log_space == nullptr) {
+        HLOG_F(FATAL, "Log space {} not created", bits::HexStr0x(logspace_id));
+    }
+    absl::MutexLock write_lk(&write_mu_);
+    std::string buffer;
+    std::vector<std::pair</* key */ uint32_t, RecordLocation>> locations;
+    locations.reserve(batch.size());
+    size_t pos = 0;
+    while (pos < batch.size()) {
+        // Records of the same segment are written with a single write
+        uint32_t segment_id = batch[pos].key >> kSegmentKeyBits;
+        Segment* segment = SwitchWritableSegment(log_space, segment_id);
+        uint64_t start_offset = segment->write_offset;
+        buffer.clear();
+        size_t first = locations.size();
+        for (; pos < batch.size() && (batch[pos].key >> kSegmentKeyBits) == segment_id; pos++) {
+            const KeyValue& record = batch[pos];
+            DCHECK_GT(record.data.size(), 0U);
+            RecordHeader header = {
+                .key = record.key,
+                .size = gsl::narrow_cast<uint32_t>(record.data.size())
+            };
+            buffer.append(reinterpret_cast<const char*>(&header), sizeof(RecordHeader));
+            uint64_t offset = start_offset + buffer.size();
+            CHECK_LE(offset + record.data.size(), std::numeric_limits<uint32_t>::max())
+                << "Segment file too large";
+            buffer.append(record.data.data(), record.data.size());
+            locations.emplace_back(record.key, RecordLocation {
+                .offset = gsl::narrow_cast<uint32_t>(offset),
+                .size = header.size
+            });
+        }
+        WriteAll(segment->write_fd, start_offset, STRING_AS_SPAN(buffer));
+        segment->write_offset += buffer.size();
+        // Records become visible to readers only after they are written
+        absl::MutexLock lk(&log_space->mu);
+        for (size_t i = first; i < locations.size(); i++) {
+            const auto& [key, location] = locations[i];
+            segment->index[key & (kKeysPerSegment - 1)] = location;
+        }
+    }
+}
+
+// Segments entirely below `end_key` are dropped along with their files. Records
+// of a partially trimmed segment are only unindexed, and the segment file is
+// removed once later trims cover the whole segment. Trimmed ranges are
+// persisted before either happens, so that recovery does not index trimmed
+// records again.
+void SegmentFileBackend::DeleteRange(uint32_t logspace_id, uint32_t start_key, uint32_t end_key) {
+    LogSpace* log_space = GetLogSpace(logspace_id);
+    if (log_space == nullptr) {
+        HLOG_F(WARNING, "Log space {} not created", bits::HexStr0x(logspace_id));
+        return;
+    }
+    if (start_key >= end_key) {
+        return;
+    }
+    absl::MutexLock write_lk(&write_mu_);
+    std::vector<std::pair<uint32_t, uint32_t>>& ranges = log_space->trimmed_ranges;
+    {
+        // Ranges below all segments on disk are no longer needed
+        absl::ReaderMutexLock lk(&log_space->mu);
+        uint64_t min_segment_start = std::numeric_limits<uint64_t>::max();
+        for (const auto& [segment_id, segment] : log_space->segments) {
+            min_segment_start = std::min(min_segment_start,
+                                         uint64_t{segment_id} << kSegmentKeyBits);
+        }
+        ranges.erase(
+            std::remove_if(ranges.begin(), ranges.end(),
+                           [min_segment_start] (const std::pair<uint32_t, uint32_t>& range) {
+                               return range.second <= min_segment_start;
+                           }),
+            ranges.end());
+    }
+    // Merge [start_key, end_key) into sorted disjoint ranges
+    auto iter = absl::c_lower_bound(
+        ranges, std::make_pair(start_key, uint32_t{0}));
+    if (iter != ranges.begin() && std::prev(iter)->second >= start_key) {
+        --iter;
+    }
+    uint32_t merged_start = start_key;
+    uint32_t merged_end = end_key;
+    auto merge_end = iter;
+    while (merge_end != ranges.end() && merge_end->first <= merged_end) {
+        merged_start = std::min(merged_start, merge_end->first);
+        merged_end = std::max(merged_end, merge_end->second);
+        ++merge_end;
+    }
+    iter = ranges.erase(iter, merge_end);
+    ranges.insert(iter, std::make_pair(merged_start, merged_end));
+    PersistTrimmedRanges(log_space);
+
+    std::vector<std::shared_ptr<Segment>> dropped_segments;
+    {
+        absl::MutexLock lk(&log_space->mu);
+        TrimSegments(log_space, start_key, end_key, &dropped_segments);
+    }
+    RemoveSegmentFiles(log_space, dropped_segments);
+    if (!dropped_segments.empty()) {
+        HLOG_F(INFO, "Dropped {} segments of log space {}",
+               dropped_segments.size(), bits::HexStr0x(logspace_id));
+    }
+}
+
+void SegmentFileBackend::TrimSegments(LogSpace* log_space, uint32_t start_key, uint32_t end_key,
+                                      std::vector<std::shared_ptr<Segment>>* dropped_segments) {
+    auto iter = log_space->segments.begin();
+    while (iter != log_space->segments.end()) {
+        Segment* segment = iter->second.get();
+        uint64_t segment_start = uint64_t{segment->segment_id} << kSegmentKeyBits;
+        uint64_t segment_end = segment_start + kKeysPerSegment;
+        if (segment_end <= end_key) {
+            dropped_segments->push_back(std::move(iter->second));
+            log_space->segments.erase(iter++);
+            continue;
+        }
+        for (uint64_t key = std::max<uint64_t>(segment_start, start_key); key < end_key; key++) {
+            segment->index[key & (kKeysPerSegment - 1)] = RecordLocation { .offset = 0, .size = 0 };
+        }
+        ++iter;
+    }
+}
+
+void SegmentFileBackend::RemoveSegmentFiles(LogSpace* log_space,
+                                            std::span<const std::shared_ptr<Segment>> segments) {
+    for (const std::shared_ptr<Segment>& segment : segments) {
+        if (segment.get() == log_space->writable_segment) {
+            CloseWriteFd(segment.get());
+            log_space->writable_segment = nullptr;
+        }
+        std::string path = SegmentFilePath(log_space, segment->segment_id);
+        if (unlink(path.c_str()) != 0) {
+            PLOG_F(ERROR, "Failed to remove segment file {}", path);
+        }
+    }
+}
+
+void SegmentFileBackend::PersistTrimmedRanges(LogSpace* log_space) {
+    std::string path = TrimFilePath(log_space);
+    std::string tmp_path = fmt::format("{}.tmp", path);
+    auto fd = fs_utils::Create(tmp_path);
+    if (!fd.has_value()) {
+        HLOG_F(FATAL, "Failed to create trim file {}", tmp_path);
+    }
+    std::string data;
+    for (const auto& [start_key, end_key] : log_space->trimmed_ranges) {
+        data.append(reinterpret_cast<const char*>(&start_key), sizeof(uint32_t));
+        data.append(reinterpret_cast<const char*>(&end_key), sizeof(uint32_t));
+    }
+    if (!io_utils::WriteData(*fd, STRING_AS_SPAN(data)) || fsync(*fd) != 0) {
+        PLOG_F(FATAL, "Failed to write trim file {}", tmp_path);
+    }
+    PCHECK(close(*fd) == 0) << "Failed to close trim file";
+    if (rename(tmp_path.c_str(), path.c_str()) != 0) {
+        PLOG_F(FATAL, "Failed to rename {} to {}", tmp_path, path);
+    }
+    if (!fs_utils::SyncDirectory(log_space->dir_path)) {
+        HLOG_F(FATAL, "Failed to sync directory {}", log_space->dir_path);
+    }
+}
+
+SegmentFileBackend::LogSpace* SegmentFileBackend::GetLogSpace(uint32_t logspace_id) {
+    absl::ReaderMutexLock lk(&mu_);
+    if (!log_spaces_.contains(logspace_id)) {
+        return nullptr;
+    }
+    return log_spaces_.at(logspace_id).get();
+}
+
+std::string SegmentFileBackend::SegmentFilePath(const LogSpace* log_space,
+                                                uint32_t segment_id) {
+    return fs_utils::JoinPath(log_space->dir_path,
+                              fmt::format("{}.seg", bits::HexStr(segment_id)));
+}
+
+std::string SegmentFileBackend::TrimFilePath(const LogSpace* log_space) {
+    return fs_utils::JoinPath(log_space->dir_path, "trim");
+}
+
+void SegmentFileBackend::RecoverLogSpace(LogSpace* log_space) {
+    DIR* dir = opendir(log_space->dir_path.c_str());
+    if (dir == nullptr) {
+        PLOG_F(FATAL, "Failed to open directory {}", log_space->dir_path);
+    }
+    auto close_dir = gsl::finally([dir] { closedir(dir); });
+    absl::MutexLock lk(&log_space->mu);
+    struct dirent* entry;
+    while ((entry = readdir(dir)) != nullptr) {
+        std::string_view file_name(entry->d_name);
+        if (!absl::ConsumeSuffix(&file_name, ".seg")) {
+            continue;
+        }
+        uint32_t segment_id;
+        auto result = std::from_chars(file_name.data(), file_name.data() + file_name.size(),
+                                      segment_id, /* base= */ 16);
+        if (result.ec != std::errc() || result.ptr != file_name.data() + file_name.size()) {
+            HLOG_F(WARNING, "Unknown segment file {}", entry->d_name);
+            continue;
+        }
+        auto segment = std::make_unique<Segment>();
+        segment->segment_id = segment_id;
+        segment->write_fd = -1;
+        auto fd = fs_utils::Open(SegmentFilePath(log_space, segment_id), O_RDONLY);
+        if (!fd.has_value()) {
+            HLOG_F(FATAL, "Failed to open segment file {}", entry->d_name);
+        }
+        segment->read_fd = *fd;
+        RecoverSegment(segment.get());
+        log_space->segments[segment_id] = std::move(segment);
+    }
+    HLOG_F(INFO, "Recovered {} segments of log space {}",
+           log_space->segments.size(), bits::HexStr0x(log_space->logspace_id));
+}
+
+void SegmentFileBackend::RecoverTrimmedRanges(LogSpace* log_space) {
+    std::string path = TrimFilePath(log_space);
+    if (!fs_utils::Exists(path)) {
+        return;
+    }
+    std::string data;
+    if (!fs_utils::ReadContents(path, &data) || data.size() % (2 * sizeof(uint32_t)) != 0) {
+        HLOG_F(FATAL, "Failed to read trim file {}", path);
+    }
+    absl::MutexLock write_lk(&write_mu_);
+    std::vector<std::shared_ptr<Segment>> dropped_segments;
+    {
+        absl::MutexLock lk(&log_space->mu);
+        for (size_t pos = 0; pos < data.size(); pos += 2 * sizeof(uint32_t)) {
+            uint32_t start_key, end_key;
+            memcpy(&start_key, data.data() + pos, sizeof(uint32_t));
+            memcpy(&end_key, data.data() + pos + sizeof(uint32_t), sizeof(uint32_t));
+            log_space->trimmed_ranges.emplace_back(start_key, end_key);
+            TrimSegments(log_space, start_key, end_key, &dropped_segments);
+        }
+    }
+    // Files of segments dropped right before a crash
+    RemoveSegmentFiles(log_space, dropped_segments);
+    HLOG_F(INFO, "Recovered {} trimmed ranges of log space {}, dropped {} segments",
+           log_space->trimmed_ranges.size(), bits::HexStr0x(log_space->logspace_id),
+           dropped_segments.size());
+}
+
+void SegmentFileBackend::RecoverSegment(Segment* segment) {
+    segment->index.assign(kKeysPerSegment, RecordLocation { .offset = 0, .size = 0 });
+    struct stat statbuf;
+    PCHECK(fstat(segment->read_fd, &statbuf) == 0) << "fstat failed";
+    uint64_t file_size = gsl::narrow_cast<uint64_t>(statbuf.st_size);
+    uint64_t offset = 0;
+    // Pre-allocated space is zero-filled, so a zero-sized header marks the end
+    while (offset + sizeof(RecordHeader) <= file_size) {
+        RecordHeader header;
+        ssize_t nread = pread(segment->read_fd, &header, sizeof(RecordHeader),
+                              static_cast<off_t>(offset));
+        if (nread != static_cast<ssize_t>(sizeof(RecordHeader)) || header.size == 0
+                || (header.key >> kSegmentKeyBits) != segment->segment_id
+                || offset + sizeof(RecordHeader) + header.size > file_size) {
+            break;
+        }
+        offset += sizeof(RecordHeader);
+        segment->index[header.key & (kKeysPerSegment - 1)] = RecordLocation {
+            .offset = gsl::narrow_cast<uint32_t>(offset),
+            .size = header.size
+        };
+        offset += header.size;
+    }
+    segment->write_offset = offset;
+}
+
+SegmentFileBackend::Segment* SegmentFileBackend::SwitchWritableSegment(
+        LogSpace* log_space, uint32_t segment_id) {
+    Segment* current = log_space->writable_segment;
+    if (current != nullptr && current->segment_id == segment_id) {
+        return current;
+    }
+    if (current != nullptr) {
+        CloseWriteFd(current);
+        log_space->writable_segment = nullptr;
+    }
+    std::string path = SegmentFilePath(log_space, segment_id);
+    Segment* segment = nullptr;
+    {
+        absl::ReaderMutexLock lk(&log_space->mu);
+        if (log_space->segments.contains(segment_id)) {
+            segment = log_space->segments.at(segment_id).get();
+        }
+    }
+    int write_fd = open(path.c_str(), O_CREAT | O_WRONLY | O_CLOEXEC, __FAAS_FILE_CREAT_MODE);
+    if (write_fd == -1) {
+        PLOG_F(FATAL, "Failed to open segment file {}", path);
+    }
+    if (segment == nullptr) {
+        if (segment_prealloc_size_ > 0 && fallocate(
+                write_fd, 0, 0, static_cast<off_t>(segment_prealloc_size_)) != 0) {
+            PLOG_F(WARNING, "Failed to pre-allocate segment file {}", path);
+        }
+        auto new_segment = std::make_unique<Segment>();
+        new_segment->segment_id = segment_id;
+        auto read_fd = fs_utils::Open(path, O_RDONLY);
+        if (!read_fd.has_value()) {
+            HLOG_F(FATAL, "Failed to open segment file {}", path);
+        }
+        new_segment->read_fd = *read_fd;
+        new_segment->write_offset = 0;
+        new_segment->index.assign(kKeysPerSegment, RecordLocation { .offset = 0, .size = 0 });
+        segment = new_segment.get();
+        absl::MutexLock lk(&log_space->mu);
+        log_space->segments[segment_id] = std::move(new_segment);
+    }
+    URING_CHECK_OK(io_uring_->RegisterFd(write_fd));
+    segment->write_fd = write_fd;
+    log_space->writable_segment = segment;
+    HVLOG_F(1, "Segment {} of log space {} becomes writable",
+            bits::HexStr0x(segment_id), bits::HexStr0x(log_space->logspace_id));
+    return segment;
+}
+
+void SegmentFileBackend::CloseWriteFd(Segment* segment) {
+    bool closed = false;
+    URING_CHECK_OK(io_uring_->Close(segment->write_fd, [&closed] () { closed = true; }));
+    size_t inflight_ops;
+    while (!closed) {
+        io_uring_->EventLoopRunOnce(&inflight_ops);
+    }
+    segment->write_fd = -1;
+}
+
+void SegmentFileBackend::WriteAll(int fd, uint64_t offset, std::span<const char> data) {
+    while (data.size() > 0) {
+        bool finished = false;
+        int error = 0;
+        size_t nwrite = 0;
+        URING_CHECK_OK(io_uring_->WriteAt(
+            fd, data, offset,
+            [&finished, &error, &nwrite] (int cb_status, size_t cb_nwrite) {
+                finished = true;
+                // errno is only valid within the callback, as completions
+                // of other ops may overwrite it
+                error = (cb_status != 0) ? errno : 0;
+                nwrite = cb_nwrite;
+            }
+        ));
+        size_t inflight_ops;
+        while (!finished) {
+            io_uring_->EventLoopRunOnce(&inflight_ops);
+        }
+        if (error == EINTR || error == EAGAIN) {
+            continue;
+        }
+        if (error != 0) {
+            errno = error;
+            PLOG(FATAL) << "Failed to write segment file";
+        }
+        if (nwrite == 0) {
+            LOG(FATAL) << "Segment file write makes no progress";
+        }
+        // Partial write may happen, continue with the remaining data
+        offset += nwrite;
+        data = data.subspan(nwrite);
+    }
+}
+
 }  // namespace log
 }  // namespace faas
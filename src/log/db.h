@@ -5,6 +5,7 @@
 // Forward declarations
 namespace rocksdb { class DB; class ColumnFamilyHandle; }
 namespace tkrzw { class DBM; }
+namespace faas { namespace server { class IOUring; } }
 
 namespace faas {
 namespace log {
@@ -13,9 +14,22 @@ class DBInterface {
 public:
     virtual ~DBInterface() {}
 
+    struct KeyValue {
+        uint32_t              key;
+        std::span<const char> data;
+    };
+
     virtual void InstallLogSpace(uint32_t logspace_id) = 0;
     virtual std::optional<std::string> Get(uint32_t logspace_id, uint32_t key) = 0;
+    // Look up all `keys` at once, `values` will have the same size as `keys`.
+    // The default implementation simply calls Get for each key.
+    virtual void MultiGet(uint32_t logspace_id, std::span<const uint32_t> keys,
+                          std::vector<std::optional<std::string>>* values);
     virtual void Put(uint32_t logspace_id, uint32_t key, std::span<const char> data) = 0;
+    // Write all records of `batch` within a single DB operation
+    virtual void PutBatch(uint32_t logspace_id, std::span<const KeyValue> batch) = 0;
+    // Delete all records with keys in [start_key, end_key)
+    virtual void DeleteRange(uint32_t logspace_id, uint32_t start_key, uint32_t end_key) = 0;
 };
 
 class RocksDBBackend final : public DBInterface {
@@ -25,7 +39,11 @@ public:
 
     void InstallLogSpace(uint32_t logspace_id) override;
     std::optional<std::string> Get(uint32_t logspace_id, uint32_t key) override;
+    void MultiGet(uint32_t logspace_id, std::span<const uint32_t> keys,
+                  std::vector<std::optional<std::string>>* values) override;
     void Put(uint32_t logspace_id, uint32_t key, std::span<const char> data) override;
+    void PutBatch(uint32_t logspace_id, std::span<const KeyValue> batch) override;
+    void DeleteRange(uint32_t logspace_id, uint32_t start_key, uint32_t end_key) override;
 
 private:
     std::unique_ptr<rocksdb::DB> db_;
@@ -48,6 +66,8 @@ public:
     void InstallLogSpace(uint32_t logspace_id) override;
     std::optional<std::string> Get(uint32_t logspace_id, uint32_t key) override;
     void Put(uint32_t logspace_id, uint32_t key, std::span<const char> data) override;
+    void PutBatch(uint32_t logspace_id, std::span<const KeyValue> batch) override;
+    void DeleteRange(uint32_t logspace_id, uint32_t start_key, uint32_t end_key) override;
 
 private:
     Type type_;
@@ -63,5 +83,95 @@ private:
     DISALLOW_COPY_AND_ASSIGN(TkrzwDBMBackend);
 };
 
+// Stores each log space as append-only segment files. Keys are assumed to be
+// (mostly) increasing, as seqnums are. Every segment covers a fixed range of
+// kKeysPerSegment keys, and keeps a dense in-memory index from key to record
+// location, so that Get is a single pread.
+class SegmentFileBackend final : public DBInterface {
+public:
+    explicit SegmentFileBackend(std::string_view db_path);
+    ~SegmentFileBackend();
+
+    void InstallLogSpace(uint32_t logspace_id) override;
+    std::optional<std::string> Get(uint32_t logspace_id, uint32_t key) override;
+    void Put(uint32_t logspace_id, uint32_t key, std::span<const char> data) override;
+    void PutBatch(uint32_t logspace_id, std::span<const KeyValue> batch) override;
+    void DeleteRange(uint32_t logspace_id, uint32_t start_key, uint32_t end_key) override;
+
+private:
+    static constexpr uint32_t kSegmentKeyBits = 16;
+    static constexpr uint32_t kKeysPerSegment = 1U << kSegmentKeyBits;
+
+    struct RecordHeader {
+        uint32_t key;
+        uint32_t size;
+    };
+
+    struct RecordLocation {
+        uint32_t offset;  // Offset of record data within the segment file
+        uint32_t size;    // 0 if the key is not stored
+    };
+
+    struct Segment {
+        ~Segment();
+
+        uint32_t segment_id;
+        int      read_fd;
+        int      write_fd;      // -1 if the segment is not writable
+        uint64_t write_offset;  // Only accessed by writers
+        std::vector<RecordLocation> index;
+    };
+
+    struct LogSpace {
+        uint32_t    logspace_id;
+        std::string dir_path;
+        Segment*    writable_segment;  // Only accessed by writers
+        // Sorted and disjoint [start_key, end_key) ranges trimmed from segments
+        // still on disk, persisted in the trim file. Only accessed by writers.
+        std::vector<std::pair<uint32_t, uint32_t>> trimmed_ranges;
+
+        absl::Mutex mu;
+        // Readers hold a reference while reading, as trimming may drop segments
+        absl::flat_hash_map</* segment_id */ uint32_t, std::shared_ptr<Segment>>
+            segments ABSL_GUARDED_BY(mu);
+    };
+
+    std::string db_path_;
+    size_t segment_prealloc_size_;
+
+    absl::Mutex mu_;
+    absl::flat_hash_map</* logspace_id */ uint32_t, std::unique_ptr<LogSpace>>
+        log_spaces_ ABSL_GUARDED_BY(mu_);
+
+    absl::Mutex write_mu_;
+    std::unique_ptr<server::IOUring> io_uring_ ABSL_GUARDED_BY(write_mu_);
+
+    LogSpace* GetLogSpace(uint32_t logspace_id);
+    std::string SegmentFilePath(const LogSpace* log_space, uint32_t segment_id);
+
+    std::string TrimFilePath(const LogSpace* log_space);
+
+    void RecoverLogSpace(LogSpace* log_space);
+    void RecoverSegment(Segment* segment);
+    void RecoverTrimmedRanges(LogSpace* log_space);
+
+    // Unindexes keys in [start_key, end_key) of `log_space`, and moves out
+    // segments entirely below `end_key`. Requires holding `log_space->mu`.
+    void TrimSegments(LogSpace* log_space, uint32_t start_key, uint32_t end_key,
+                      std::vector<std::shared_ptr<Segment>>* dropped_segments);
+    void RemoveSegmentFiles(LogSpace* log_space,
+                            std::span<const std::shared_ptr<Segment>> segments)
+        ABSL_EXCLUSIVE_LOCKS_REQUIRED(write_mu_);
+    void PersistTrimmedRanges(LogSpace* log_space) ABSL_EXCLUSIVE_LOCKS_REQUIRED(write_mu_);
+
+    Segment* SwitchWritableSegment(LogSpace* log_space, uint32_t segment_id)
+        ABSL_EXCLUSIVE_LOCKS_REQUIRED(write_mu_);
+    void CloseWriteFd(Segment* segment) ABSL_EXCLUSIVE_LOCKS_REQUIRED(write_mu_);
+    void WriteAll(int fd, uint64_t offset, std::span<const char> data)
+        ABSL_EXCLUSIVE_LOCKS_REQUIRED(write_mu_);
+
+    DISALLOW_COPY_AND_ASSIGN(SegmentFileBackend);
+};
+
 }  // namespace log
 }  // namespace faas
@@ -8,6 +8,8 @@
 
 #include "engine/engine.h"
 #include "log/flags.h"
+#include "ipc/base.h"
+#include "ipc/shm_region.h"
 #include "utils/bits.h"
 #include "utils/random.h"
 #include "server/constants.h"
@@ -37,7 +39,20 @@ Engine::Engine(engine::Engine* engine)
       log_header_(fmt::format("LogEngine[{}-N]: ", my_node_id())),
       current_view_(nullptr),
       current_view_active_(false),
-      min_seqnum_tag_completion_(absl::GetFlag(FLAGS_slog_activate_min_seqnum_completion))
+      min_seqnum_tag_completion_(absl::GetFlag(FLAGS_slog_activate_min_seqnum_completion)),
+      index_partition_by_tag_(absl::GetFlag(FLAGS_slog_index_partition_by_tag)),
+      onging_reads_(absl::Milliseconds(
+          std::max(0, absl::GetFlag(FLAGS_slog_engine_read_timeout_ms)))),
+      has_trim_seqnums_(false),
+      read_ahead_depth_(gsl::narrow_cast<size_t>(
+          std::max(0, absl::GetFlag(FLAGS_slog_engine_read_ahead_depth)))),
+      range_read_timeout_us_(int64_t{std::max(0, absl::GetFlag(FLAGS_slog_engine_read_timeout_ms))} * 1000),
+      single_flight_reads_(absl::GetFlag(FLAGS_slog_engine_single_flight_reads)),
+      hedge_index_reads_(absl::GetFlag(FLAGS_slog_engine_hedge_index_reads)
+                         && index_partition_by_tag_),
+      hedge_min_delay_us_(absl::GetFlag(FLAGS_slog_engine_hedge_min_delay_us)),
+      index_tier_read_delay_stat_(stat::StatisticsCollector<int32_t>::StandardReportCallback(
+          "index_tier_read_delay"))
 #ifdef __FAAS_STAT_THREAD
       ,
       statistics_thread_("BG_ST", [this] { this->StatisticsThreadMain(); }),
@@ -52,7 +67,10 @@ Engine::Engine(engine::Engine* engine)
       local_index_miss_counter_(0),
       index_min_read_ops_counter_(0),
       log_cache_hit_counter_(0),
-      log_cache_miss_counter_(0) 
+      log_cache_miss_counter_(0),
+      single_flight_hit_counter_(0),
+      hedged_reads_counter_(0),
+      hedge_wins_counter_(0)
 #endif
       {
           if(absl::GetFlag(FLAGS_slog_engine_index_tier_only)){
@@ -69,6 +87,47 @@ Engine::Engine(engine::Engine* engine)
 
 Engine::~Engine() {}
 
+void Engine::PublishViewSnapshot() {
+    auto snapshot = std::make_unique<ViewSnapshot>();
+    snapshot->view = current_view_;
+    snapshot->view_active = current_view_active_;
+    snapshot->views = views_;
+    snapshot->storage_shards = view_mutable_.engine_storage_shards();
+    auto add_producer = [&snapshot] (uint32_t logspace_id, LockablePtr<LogProducer> producer_ptr) {
+        snapshot->producers[logspace_id] = producer_ptr;
+    };
+    producer_collection_.ForEachActiveLogSpace(add_producer);
+    producer_collection_.ForEachFinalizedLogSpace(add_producer);
+    auto add_index = [&snapshot] (uint32_t logspace_id, LockablePtr<IndexComplete> index_ptr) {
+        snapshot->complete_indices[logspace_id] = index_ptr;
+    };
+    index_complete_collection_.ForEachActiveLogSpace(add_index);
+    index_complete_collection_.ForEachFinalizedLogSpace(add_index);
+    suffix_chain_collection_.ForEachLogSpace(
+        [&snapshot] (uint32_t id, LockablePtr<SeqnumSuffixChain> suffix_chain_ptr) {
+            snapshot->suffix_chains[bits::LowHalf32(id)] = suffix_chain_ptr;
+        }
+    );
+    tag_cache_collection_.ForEachLogSpace(
+        [&snapshot] (uint32_t id, LockablePtr<TagCache> tag_cache_ptr) {
+            snapshot->tag_caches[bits::LowHalf32(id)] = tag_cache_ptr;
+        }
+    );
+    view_snapshot_.Publish(std::move(snapshot));
+}
+
+const View* Engine::FindView(uint16_t view_id) {
+    {
+        utils::EpochGuard epoch_guard;
+        const ViewSnapshot* snapshot = view_snapshot_.Load();
+        if (snapshot != nullptr && view_id < snapshot->views.size()) {
+            return snapshot->views.at(view_id);
+        }
+    }
+    absl::ReaderMutexLock view_lk(&view_mu_);
+    return view_id < views_.size() ? views_.at(view_id) : nullptr;
+}
+
 void Engine::OnViewCreated(const View* view) {
     DCHECK(zk_session()->WithinMyEventLoopThread());
     if (postpone_registration()){
@@ -131,6 +190,7 @@ void Engine::OnViewCreated(const View* view) {
         current_view_ = view;
         views_.push_back(view);
         log_header_ = fmt::format("LogEngine[{}-{}]: ", my_node_id(), view->id());
+        PublishViewSnapshot();
     }
 }
 
@@ -144,6 +204,7 @@ void Engine::OnViewFrozen(const View* view) {
     if (view_mutable_.IsEngineActive(view->id(), active_sequencer_nodes)) {
         DCHECK(current_view_active_);
         current_view_active_ = false;
+        PublishViewSnapshot();
     }
 }
 
@@ -204,6 +265,7 @@ void Engine::OnViewFinalized(const FinalizedView* finalized_view) {
             default:
                 break;
         }
+        PublishViewSnapshot();
     }
     if (!append_results.empty()) {
         SomeIOWorker()->ScheduleFunction(
@@ -226,10 +288,13 @@ void Engine::OnViewFinalized(const FinalizedView* finalized_view) {
             nullptr, [this, misses = std::move(local_index_misses), finalized_view = finalized_view, storage_shards = my_storage_shards] 
             {
                 for(const IndexQueryResult& miss : misses){
-                    LocalOp* op = onging_reads_.GetChecked(miss.original_query.client_data);
+                    // Owned until HandleIndexTierRead puts it back
+                    LocalOp* op;
+                    if (!onging_reads_.Poll(miss.original_query.client_data, &op)) {
+                        continue;
+                    }
                     uint32_t logspace_identifier = finalized_view->view()->LogSpaceIdentifier(op->user_logspace);
                     if(!storage_shards.contains(logspace_identifier)){
-                        onging_reads_.RemoveChecked(op->id);
                         FinishLocalOpWithFailure(op, SharedLogResultType::DATA_LOST);
                         continue;
                     }
@@ -314,39 +379,71 @@ static Message BuildLocalReadOKResponse(const LogEntry& log_entry) {
     } while (0)
 
 void Engine::HandleLocalAppend(LocalOp* op) {
-    DCHECK(op->type == SharedLogOpType::APPEND);
-    HVLOG_F(1, "Handle local append: op_id={}, logspace={}, num_tags={}, size={}",
-            op->id, op->user_logspace, op->user_tags.size(), op->data.length());
+    DCHECK(  op->type == SharedLogOpType::APPEND
+          || op->type == SharedLogOpType::APPEND_BATCH);
+    bool batched = (op->type == SharedLogOpType::APPEND_BATCH);
+    HVLOG_F(1, "Handle local append: op_id={}, logspace={}, num_tags={}, size={}, batch_size={}",
+            op->id, op->user_logspace, op->user_tags.size(), op->data.length(), op->batch_size);
 #ifdef __FAAS_OP_TRACING
     SaveTracePoint(op->id, "HandleLocalAppend");
 #endif
     const View* view = nullptr;
     const View::StorageShard* storage_shard = nullptr;
-    LogMetaData log_metadata = MetaDataFromAppendOp(op);
+    LogMetaData log_metadata = batched ? LogMetaData {
+        .user_logspace = op->user_logspace,
+        .seqnum = kInvalidLogSeqNum,
+        .localid = 0,
+        .num_tags = 0,
+        .data_size = 0
+    } : MetaDataFromAppendOp(op);
     uint64_t next_seqnum;
+    LockablePtr<TagCache> tag_cache_ptr;
     {
-        absl::ReaderMutexLock view_lk(&view_mu_);
-        if (!current_view_active_) {
+        utils::EpochGuard epoch_guard;
+        const ViewSnapshot* snapshot = view_snapshot_.Load();
+        if (snapshot == nullptr || !snapshot->view_active) {
             HLOG(WARNING) << "Current view not active";
             FinishLocalOpWithFailure(op, SharedLogResultType::DISCARDED);
             return;
         }
-        view = current_view_;
+        view = snapshot->view;
         uint32_t logspace_id = view->LogSpaceIdentifier(op->user_logspace);
-        storage_shard = view_mutable_.GetEngineStorageShard(logspace_id);
+        if (auto iter = snapshot->storage_shards.find(logspace_id);
+                iter != snapshot->storage_shards.end()) {
+            storage_shard = iter->second;
+        }
         if (storage_shard == nullptr){
             HLOG_F(WARNING, "No storage shard for logspace={}", logspace_id);
             return;
         }
         log_metadata.seqnum = bits::JoinTwo32(logspace_id, 0);
-        auto producer_ptr = producer_collection_.GetLogSpaceChecked(logspace_id);
+        if (indexing_strategy_ == IndexingStrategy::DISTRIBUTED && min_seqnum_tag_completion_) {
+            tag_cache_ptr = snapshot->tag_caches.at(bits::LowHalf32(logspace_id));
+        }
+        auto producer_ptr = snapshot->producers.at(logspace_id);
+        bool producer_active;
         {
             auto locked_producer = producer_ptr.Lock();
-            locked_producer->LocalAppend(op, &log_metadata.localid, &next_seqnum);
+            // The snapshot can be stale: once OnViewFinalized has polled the
+            // producer, appends taken by it would never be answered
+            producer_active = !locked_producer->frozen() && !locked_producer->finalized();
+            if (producer_active) {
+                if (batched) {
+                    locked_producer->LocalAppendBatch(op, op->batch_size,
+                                                      &log_metadata.localid, &next_seqnum);
+                } else {
+                    locked_producer->LocalAppend(op, &log_metadata.localid, &next_seqnum);
+                }
+            }
 #ifdef __FAAS_OP_TRACING
             SaveTracePoint(op->id, "AfterPutToPendingList");
 #endif
         }
+        if (!producer_active) {
+            HLOG_F(WARNING, "Log space {} is frozen or finalized", bits::HexStr0x(logspace_id));
+            FinishLocalOpWithFailure(op, SharedLogResultType::DISCARDED);
+            return;
+        }
     }
 #ifdef __FAAS_OP_STAT
     append_ops_counter_.fetch_add(1, std::memory_order_acq_rel);
@@ -355,19 +452,18 @@ void Engine::HandleLocalAppend(LocalOp* op) {
         || !min_seqnum_tag_completion_
         || op->user_tags.empty() 
         || (op->user_tags.size() == 1 && op->user_tags.at(0) == kEmptyLogTag)) {
-        ReplicateLogEntry(view, storage_shard, log_metadata, VECTOR_AS_SPAN(op->user_tags), op->data.to_span());
+        if (batched) {
+            ReplicateLogBatch(view, storage_shard, log_metadata, op->batch_size, op->data.to_span());
+        } else {
+            ReplicateLogEntry(view, storage_shard, log_metadata, VECTOR_AS_SPAN(op->user_tags), op->data.to_span());
+        }
     } else {
         std::vector<uint64_t> tags_without_min_seqnum;
         {
-            absl::ReaderMutexLock view_lk(&view_mu_);
-            uint32_t logspace_id = view->LogSpaceIdentifier(op->user_logspace);
-            auto tag_cache_ptr = tag_cache_collection_.GetLogSpaceChecked(bits::LowHalf32(logspace_id));
-            {
-                auto tag_cache = tag_cache_ptr.Lock();
-                for (uint64_t tag : op->user_tags) {
-                    if (!tag_cache->TagExists(op->user_logspace, tag)){
-                        tags_without_min_seqnum.push_back(tag);
-                    }
+            auto tag_cache = tag_cache_ptr.Lock();
+            for (uint64_t tag : op->user_tags) {
+                if (!tag_cache->TagExists(op->user_logspace, tag)){
+                    tags_without_min_seqnum.push_back(tag);
                 }
             }
         }
@@ -375,39 +471,137 @@ void Engine::HandleLocalAppend(LocalOp* op) {
             HVLOG_F(1, "No seqnum for tag={}. Send index request", tag);
             HandleIndexTierMinSeqnumRead(op, tag, view->id(), next_seqnum, storage_shard);
         }
-        ReplicateLogEntry(view, storage_shard, log_metadata, VECTOR_AS_SPAN(op->user_tags), op->data.to_span());
+        if (batched) {
+            ReplicateLogBatch(view, storage_shard, log_metadata, op->batch_size, op->data.to_span());
+        } else {
+            ReplicateLogEntry(view, storage_shard, log_metadata, VECTOR_AS_SPAN(op->user_tags), op->data.to_span());
+        }
     }
 }
 
 void Engine::HandleLocalTrim(LocalOp* op) {
     DCHECK(op->type == SharedLogOpType::TRIM);
-    NOT_IMPLEMENTED();
+    HVLOG_F(1, "Handle local trim: op_id={}, logspace={}, tag={}, trim_seqnum={}",
+            op->id, op->user_logspace, op->query_tag, bits::HexStr0x(op->seqnum));
+    uint32_t logspace_id;
+    {
+        absl::ReaderMutexLock view_lk(&view_mu_);
+        ONHOLD_IF_SEEN_FUTURE_VIEW(op);
+        logspace_id = current_view_->LogSpaceIdentifier(op->user_logspace);
+    }
+    // The sequencer appends a TRIM meta log, and responds once it is replicated
+    SharedLogMessage request = SharedLogMessageHelper::NewTrimMessage(
+        logspace_id, op->user_logspace, op->query_tag, op->seqnum);
+    request.client_data = op->id;
+    onging_trims_.PutChecked(op->id, op);
+    if (!SendSequencerMessage(bits::LowHalf32(logspace_id), &request)) {
+        HLOG_F(ERROR, "Failed to send trim request to sequencer {}",
+               bits::LowHalf32(logspace_id));
+        onging_trims_.RemoveChecked(op->id);
+        FinishLocalOpWithFailure(op, SharedLogResultType::TRIM_FAILED);
+    }
+}
+
+void Engine::UpdateTrimSeqnum(uint32_t user_logspace, uint64_t user_tag,
+                              uint64_t trim_seqnum) {
+    absl::MutexLock trim_lk(&trim_mu_);
+    uint64_t& current = trim_seqnums_[std::make_pair(user_logspace, user_tag)];
+    current = std::max(current, trim_seqnum);
+    has_trim_seqnums_.store(true, std::memory_order_release);
+}
+
+uint64_t Engine::GetTrimSeqnum(uint32_t user_logspace, uint64_t user_tag) {
+    if (!has_trim_seqnums_.load(std::memory_order_acquire)) {
+        return 0;
+    }
+    absl::ReaderMutexLock trim_lk(&trim_mu_);
+    uint64_t trim_seqnum = 0;
+    if (auto iter = trim_seqnums_.find(std::make_pair(user_logspace, kEmptyLogTag));
+            iter != trim_seqnums_.end()) {
+        trim_seqnum = iter->second;
+    }
+    if (user_tag != kEmptyLogTag) {
+        if (auto iter = trim_seqnums_.find(std::make_pair(user_logspace, user_tag));
+                iter != trim_seqnums_.end()) {
+            trim_seqnum = std::max(trim_seqnum, iter->second);
+        }
+    }
+    return trim_seqnum;
 }
 
 void Engine::HandleIndexTierRead(LocalOp* op, uint16_t view_id, const View::StorageShard* storage_shard){
     HVLOG(1) << "Send request to index tier";
     std::vector<uint16_t> index_nodes;
-    storage_shard->PickIndexNodePerShard(index_nodes);
-    uint16_t aggregator_node = storage_shard->PickAggregatorNode(index_nodes);
-    uint16_t aggregate_type = storage_shard->UseMasterSlaveMerging() ? protocol::kUseMasterSlave : protocol::kUseAggregator;
+    uint16_t aggregator_node;
+    uint16_t aggregate_type;
+    const View::NodeIdVec* hedge_replicas = nullptr;
+    if (index_partition_by_tag_ && op->query_tag != kEmptyLogTag) {
+        // Only one index shard has the tag, which answers without aggregation
+        const View::NodeIdVec& replicas = storage_shard->GetIndexNodes(
+            storage_shard->TagIndexShard(op->user_logspace, op->query_tag));
+        index_nodes.push_back(index_replica_stats_.PickReplica(replicas));
+        if (op->type != SharedLogOpType::READ_NEXT_B) {
+            hedge_replicas = &replicas;
+        }
+        aggregator_node = index_nodes.front();
+        aggregate_type = protocol::kUseMasterSlave;
+    } else {
+        // Same shard order as PickIndexNodePerShard, with replicas picked by latency
+        size_t num_shards = storage_shard->num_index_shards();
+        size_t first_shard = storage_shard->PickIndexShard();
+        for (size_t i = first_shard; i < num_shards + first_shard; i++) {
+            index_nodes.push_back(index_replica_stats_.PickReplica(
+                storage_shard->GetIndexNodes(i % num_shards)));
+        }
+        aggregator_node = storage_shard->PickAggregatorNode(index_nodes);
+        aggregate_type = storage_shard->UseMasterSlaveMerging() ? protocol::kUseMasterSlave : protocol::kUseAggregator;
+    }
+    uint64_t op_id = op->id;
     SharedLogMessage request = BuildIndexTierReadRequestMessage(op, aggregator_node, aggregate_type);
     request.sequencer_id = bits::HighHalf32(storage_shard->shard_id());
     request.view_id = view_id;
+    if (hedge_replicas != nullptr) {
+        // Registered before sending, as the response may arrive at any time.
+        // Reads are registered even if hedging is disabled, so that replica
+        // latencies are still estimated.
+        request.client_data |= kHedgedReadClientDataFlag;
+        uint16_t index_node = index_nodes.front();
+        int64_t delay = std::max(hedge_min_delay_us_,
+                                 index_replica_stats_.GetP95Latency(index_node).value_or(0));
+        int64_t now = GetMonotonicMicroTimestamp();
+        op->hedge_tracked = true;
+        HedgedReadShard& shard = GetHedgedReadShard(op_id);
+        absl::MutexLock lk(&shard.mu);
+        shard.reads.emplace(op_id, HedgedRead {
+            .request = request,
+            .replicas = std::vector<uint16_t>(hedge_replicas->begin(), hedge_replicas->end()),
+            .index_node = index_node,
+            .hedge_index_node = std::nullopt,
+            .start_timestamp = now,
+            .hedge_timestamp = 0
+        });
+        if (hedge_index_reads_ && hedge_replicas->size() > 1) {
+            shard.deadlines.emplace(now + delay, op_id);
+        }
+    }
+    // The op may finish or expire at any time after this
+    onging_reads_.PutChecked(op_id, op);
     bool send_success = true;
     for(uint16_t index_node : index_nodes){
         send_success &= SendIndexTierReadRequest(index_node, &request);
     }
     if (!send_success) {
         HLOG_F(WARNING, "Failed to send index tier request. Aggregator node={}", aggregator_node);
-        onging_reads_.RemoveChecked(op->id);
-        FinishLocalOpWithFailure(op, SharedLogResultType::DATA_LOST);
+        if (onging_reads_.Poll(op_id, &op)) {
+            FinishLocalOpWithFailure(op, SharedLogResultType::DATA_LOST);
+        }
         return;
     }
 #ifdef __FAAS_OP_STAT
     local_index_miss_counter_.fetch_add(1, std::memory_order_acq_rel);
 #endif 
 #ifdef __FAAS_OP_TRACING
-    SaveTracePoint(op->id, "SentIndexTierReadRequest");
+    SaveTracePoint(op_id, "SentIndexTierReadRequest");
 #endif
     HVLOG_F(1, "Sent request to index tier successfully. Aggregator node={}", aggregator_node);
     return;
@@ -415,7 +609,8 @@ void Engine::HandleIndexTierRead(LocalOp* op, uint16_t view_id, const View::Stor
 
 void Engine::HandleIndexTierMinSeqnumRead(LocalOp* op, uint64_t tag, uint16_t view_id, uint64_t log_tail_timestamp, const View::StorageShard* storage_shard) {
     HVLOG(1) << "Send seqnum min request to index tier";
-    uint16_t index_node = storage_shard->PickIndexNodeByTag(tag);
+    uint16_t index_node = index_replica_stats_.PickReplica(
+        storage_shard->GetIndexNodes(tag % storage_shard->num_index_shards()));
     SharedLogMessage request = BuildIndexTierMinSeqnumRequestMessage(op, tag, log_tail_timestamp);
     request.sequencer_id = bits::HighHalf32(storage_shard->shard_id());
     request.view_id = view_id;
@@ -433,13 +628,22 @@ void Engine::HandleIndexTierMinSeqnumRead(LocalOp* op, uint64_t tag, uint16_t vi
 void Engine::HandleLocalRead(LocalOp* op) {
     DCHECK(  op->type == SharedLogOpType::READ_NEXT
           || op->type == SharedLogOpType::READ_PREV
-          || op->type == SharedLogOpType::READ_NEXT_B);
+          || op->type == SharedLogOpType::READ_NEXT_B
+          || op->type == SharedLogOpType::READ_RANGE);
     HVLOG_F(1, "Handle local read: op_id={}, logspace={}, tag={}, seqnum={}",
             op->id, op->user_logspace, op->query_tag, bits::HexStr0x(op->seqnum));
 #ifdef __FAAS_OP_TRACING
     SaveTracePoint(op->id, "HandleLocalRead");
 #endif
-    onging_reads_.PutChecked(op->id, op);
+    if (uint64_t trim_seqnum = GetTrimSeqnum(op->user_logspace, op->query_tag);
+            op->seqnum < trim_seqnum) {
+        if (op->type == SharedLogOpType::READ_PREV) {
+            HVLOG_F(1, "Seqnum {} is trimmed", bits::HexStr0x(op->seqnum));
+            FinishLocalOpWithFailure(op, SharedLogResultType::EMPTY);
+            return;
+        }
+        op->seqnum = trim_seqnum;
+    }
     uint32_t logspace_id;
     uint16_t view_id;
     const View::StorageShard* storage_shard = nullptr;
@@ -447,28 +651,40 @@ void Engine::HandleLocalRead(LocalOp* op) {
     LockablePtr<TagCache> tag_cache_ptr;
     LockablePtr<IndexComplete> index_ptr;
     {
-        absl::ReaderMutexLock view_lk(&view_mu_);
-        ONHOLD_IF_SEEN_FUTURE_VIEW(op);
-        logspace_id = current_view_->LogSpaceIdentifier(op->user_logspace);
-        if(view_mutable_.engine_storage_shards().contains(logspace_id)){
-            storage_shard = view_mutable_.GetEngineStorageShard(logspace_id);
+        utils::EpochGuard epoch_guard;
+        const ViewSnapshot* snapshot = view_snapshot_.Load();
+        if (snapshot == nullptr || snapshot->view == nullptr
+              || log_utils::GetViewId(op->metalog_progress) > snapshot->view->id()) {
+            // Whether to hold the op for a future view is decided under view_mu_
+            absl::ReaderMutexLock view_lk(&view_mu_);
+            ONHOLD_IF_SEEN_FUTURE_VIEW(op);
+            snapshot = view_snapshot_.Load();
         }
-        view_id = current_view_->id();
+        logspace_id = snapshot->view->LogSpaceIdentifier(op->user_logspace);
+        if (auto iter = snapshot->storage_shards.find(logspace_id);
+                iter != snapshot->storage_shards.end()) {
+            storage_shard = iter->second;
+        }
+        view_id = snapshot->view->id();
         if (storage_shard != nullptr){
             if (indexing_strategy_ == IndexingStrategy::DISTRIBUTED) {
-                suffix_chain_ptr = suffix_chain_collection_.GetLogSpaceChecked(bits::LowHalf32(logspace_id));
-                tag_cache_ptr = tag_cache_collection_.GetLogSpaceChecked(bits::LowHalf32(logspace_id));
+                suffix_chain_ptr = snapshot->suffix_chains.at(bits::LowHalf32(logspace_id));
+                tag_cache_ptr = snapshot->tag_caches.at(bits::LowHalf32(logspace_id));
             } else if (indexing_strategy_ == IndexingStrategy::COMPLETE) {
-                index_ptr = index_complete_collection_.GetLogSpaceChecked(logspace_id);
+                index_ptr = snapshot->complete_indices.at(logspace_id);
             }
         }
     }
     if (storage_shard == nullptr){
-        onging_reads_.RemoveChecked(op->id);
         HLOG(ERROR) << "No storage shard for current view";
         FinishLocalOpWithFailure(op, SharedLogResultType::DATA_LOST);
         return;
     }
+    // Only after the op is not held for a future view, which handles it again
+    if (JoinInflightRead(op)) {
+        HVLOG_F(1, "Read op {} waits for an identical read in flight", op->id);
+        return;
+    }
 #ifdef __FAAS_OP_STAT
     read_ops_counter_.fetch_add(1, std::memory_order_acq_rel);
 #endif 
@@ -476,6 +692,9 @@ void Engine::HandleLocalRead(LocalOp* op) {
         HandleIndexTierRead(op, view_id, storage_shard);
         return;
     }
+    // Once put into onging_reads_, the op may finish or expire at any time,
+    // so it is not accessed after that
+    uint64_t op_id = op->id;
     IndexQuery query = BuildIndexQuery(op);
     if (indexing_strategy_ == IndexingStrategy::DISTRIBUTED) {
         IndexQueryResultVec query_results;
@@ -483,6 +702,7 @@ void Engine::HandleLocalRead(LocalOp* op) {
         if(op->query_tag == kEmptyLogTag){
             // use seqnum suffix
             if(query.query_seqnum >= suffix_chain_heads_[bits::LowHalf32(logspace_id)]) {
+                onging_reads_.PutChecked(op_id, op);
                 {
                     auto locked_suffix_chain = suffix_chain_ptr.Lock();
                     locked_suffix_chain->MakeQuery(query);
@@ -496,12 +716,14 @@ void Engine::HandleLocalRead(LocalOp* op) {
                 if (!cache_result.IsFound()) {
                     op->index_lookup_miss = true;
                 }
+                onging_reads_.PutChecked(op_id, op);
                 query_results.push_back(cache_result);
                 ProcessIndexQueryResults(query_results, &local_index_misses);
             }
         }
         // use tag cache
         else {
+            onging_reads_.PutChecked(op_id, op);
             {
                 auto locked_tag_cache = tag_cache_ptr.Lock();
                 locked_tag_cache->MakeQuery(query);
@@ -526,7 +748,7 @@ void Engine::HandleLocalRead(LocalOp* op) {
             }
         }
         if (index_ptr != nullptr && use_complete_index) {
-            IndexQuery query = BuildIndexQuery(op);
+            onging_reads_.PutChecked(op_id, op);
             IndexQueryResultVec query_results;
             {
                 auto locked_index = index_ptr.Lock();
@@ -539,13 +761,183 @@ void Engine::HandleLocalRead(LocalOp* op) {
             HandleIndexTierRead(op, view_id, storage_shard);
         }
 #ifdef __FAAS_OP_TRACING
-    SaveTracePoint(op->id, "CompleteIndexQueryingDone");
+    SaveTracePoint(op_id, "CompleteIndexQueryingDone");
 #endif
     } else {
         UNREACHABLE();
     }
 }
 
+bool Engine::JoinInflightRead(LocalOp* op) {
+    // Blocking and range reads are not shared
+    if (!single_flight_reads_ || (op->type != SharedLogOpType::READ_NEXT
+                                  && op->type != SharedLogOpType::READ_PREV)) {
+        return false;
+    }
+    InflightReadKey key(static_cast<uint16_t>(op->type), op->user_logspace,
+                        op->query_tag, op->seqnum);
+    absl::MutexLock lk(&inflight_read_mu_);
+    auto iter = inflight_reads_.find(key);
+    if (iter == inflight_reads_.end()) {
+        inflight_reads_[key] = InflightRead {
+            .leader_op_id = op->id,
+            .metalog_progress = op->metalog_progress,
+            .waiters = {}
+        };
+        return false;
+    }
+    if (op->metalog_progress > iter->second.metalog_progress) {
+        // The leader may not observe log entries this read requires
+        return false;
+    }
+    iter->second.waiters.push_back(op);
+#ifdef __FAAS_OP_STAT
+    single_flight_hit_counter_.fetch_add(1, std::memory_order_acq_rel);
+#endif
+    return true;
+}
+
+void Engine::OnLocalOpFinished(LocalOp* op, const Message& response,
+                               uint64_t metalog_progress, bool success) {
+    if (op->hedge_tracked) {
+        // Finished by other paths, e.g. expiry or send failures
+        RemoveHedgedRead(op->id);
+    }
+    if (!single_flight_reads_ || (op->type != SharedLogOpType::READ_NEXT
+                                  && op->type != SharedLogOpType::READ_PREV)) {
+        return;
+    }
+    std::vector<LocalOp*> waiters;
+    {
+        InflightReadKey key(static_cast<uint16_t>(op->type), op->user_logspace,
+                            op->query_tag, op->seqnum);
+        absl::MutexLock lk(&inflight_read_mu_);
+        auto iter = inflight_reads_.find(key);
+        if (iter == inflight_reads_.end() || iter->second.leader_op_id != op->id) {
+            return;
+        }
+        waiters = std::move(iter->second.waiters);
+        inflight_reads_.erase(iter);
+    }
+    if (!waiters.empty()) {
+        HVLOG_F(1, "Complete {} waiters of read op {}", waiters.size(), op->id);
+    }
+    for (LocalOp* waiter : waiters) {
+        Message waiter_response = response;
+        FinishLocalOpWithResponse(waiter, &waiter_response, metalog_progress, success);
+    }
+}
+
+void Engine::ExpireOngoingReads() {
+    std::vector<std::pair<uint64_t, LocalOp*>> expired_reads;
+    onging_reads_.PollExpired(&expired_reads);
+    for (const auto& [op_id, op] : expired_reads) {
+        HLOG_F(WARNING, "Read op {} timed out: logspace={}, tag={}, seqnum={}",
+               op_id, op->user_logspace, op->query_tag, bits::HexStr0x(op->seqnum));
+        FinishLocalOpWithFailure(op, SharedLogResultType::DATA_LOST);
+    }
+    // Expired range reads return records read so far
+    std::vector<std::unique_ptr<RangeRead>> expired_range_reads;
+    int64_t now = GetMonotonicMicroTimestamp();
+    {
+        absl::MutexLock lk(&range_read_mu_);
+        for (auto iter = range_reads_.begin(); iter != range_reads_.end();) {
+            if (now - iter->second->start_timestamp > range_read_timeout_us_) {
+                expired_range_reads.push_back(std::move(iter->second));
+                range_reads_.erase(iter++);
+            } else {
+                ++iter;
+            }
+        }
+    }
+    for (std::unique_ptr<RangeRead>& range_read : expired_range_reads) {
+        HLOG_F(WARNING, "Range read op {} timed out with {} pending storage reads",
+               range_read->op->id, range_read->num_pending_reads);
+        FinishReadRange(std::move(range_read));
+    }
+}
+
+void Engine::HedgeIndexTierReads() {
+    std::vector<std::pair<uint16_t, SharedLogMessage>> hedge_requests;
+    int64_t now = GetMonotonicMicroTimestamp();
+    for (HedgedReadShard& shard : hedged_read_shards_) {
+        absl::MutexLock lk(&shard.mu);
+        while (!shard.deadlines.empty() && shard.deadlines.top().first <= now) {
+            uint64_t op_id = shard.deadlines.top().second;
+            shard.deadlines.pop();
+            auto iter = shard.reads.find(op_id);
+            if (iter == shard.reads.end()) {
+                continue;
+            }
+            HedgedRead& hedged_read = iter->second;
+            std::vector<uint16_t> other_replicas;
+            for (uint16_t index_node : hedged_read.replicas) {
+                if (index_node != hedged_read.index_node) {
+                    other_replicas.push_back(index_node);
+                }
+            }
+            DCHECK(!other_replicas.empty());
+            uint16_t hedge_index_node = index_replica_stats_.PickReplica(other_replicas);
+            hedged_read.hedge_index_node = hedge_index_node;
+            hedged_read.hedge_timestamp = now;
+            SharedLogMessage request = hedged_read.request;
+            request.client_data |= kHedgeCopyClientDataFlag;
+            request.aggregator_node_id = hedge_index_node;
+            hedge_requests.emplace_back(hedge_index_node, request);
+        }
+    }
+    for (auto& [index_node, request] : hedge_requests) {
+        HVLOG_F(1, "Hedge index tier read {} to index node {}",
+                request.client_data & ~(kHedgedReadClientDataFlag | kHedgeCopyClientDataFlag),
+                index_node);
+        if (!SendIndexTierReadRequest(index_node, &request)) {
+            HLOG_F(WARNING, "Failed to send hedged index tier request to index node {}", index_node);
+        }
+    }
+#ifdef __FAAS_OP_STAT
+    hedged_reads_counter_.fetch_add(hedge_requests.size(), std::memory_order_acq_rel);
+#endif
+}
+
+bool Engine::OnRecvHedgedReadResponse(uint64_t client_data) {
+    uint64_t op_id = client_data & ~(kHedgedReadClientDataFlag | kHedgeCopyClientDataFlag);
+    bool from_hedge = (client_data & kHedgeCopyClientDataFlag) != 0;
+    int64_t now = GetMonotonicMicroTimestamp();
+    int64_t read_delay;
+    {
+        HedgedReadShard& shard = GetHedgedReadShard(op_id);
+        absl::MutexLock lk(&shard.mu);
+        auto iter = shard.reads.find(op_id);
+        if (iter == shard.reads.end()) {
+            HVLOG_F(1, "Drop second response of hedged read {}", op_id);
+            return false;
+        }
+        const HedgedRead& hedged_read = iter->second;
+        read_delay = now - hedged_read.start_timestamp;
+        if (from_hedge) {
+            DCHECK(hedged_read.hedge_index_node.has_value());
+            index_replica_stats_.AddSample(*hedged_read.hedge_index_node,
+                                           now - hedged_read.hedge_timestamp);
+#ifdef __FAAS_OP_STAT
+            hedge_wins_counter_.fetch_add(1, std::memory_order_acq_rel);
+#endif
+        }
+        // If the hedge wins, the elapsed time is a lower bound of the latency of
+        // the first replica, which still slows it down in replica selection
+        index_replica_stats_.AddSample(hedged_read.index_node, read_delay);
+        shard.reads.erase(iter);
+    }
+    absl::MutexLock lk(&read_delay_stat_mu_);
+    index_tier_read_delay_stat_.AddSample(gsl::narrow_cast<int32_t>(read_delay));
+    return true;
+}
+
+void Engine::RemoveHedgedRead(uint64_t op_id) {
+    HedgedReadShard& shard = GetHedgedReadShard(op_id);
+    absl::MutexLock lk(&shard.mu);
+    shard.reads.erase(op_id);
+}
+
 void Engine::HandleLocalSetAuxData(LocalOp* op) {
     uint64_t seqnum = op->seqnum;
     LogCachePutAuxData(seqnum, op->data.to_span());
@@ -555,7 +947,7 @@ void Engine::HandleLocalSetAuxData(LocalOp* op) {
     if (!absl::GetFlag(FLAGS_slog_engine_propagate_auxdata)) {
         return;
     }
-    if (auto log_entry = LogCacheGet(seqnum); log_entry.has_value()) {
+    if (auto log_entry = LogCacheGet(seqnum); log_entry != nullptr) {
         if (auto aux_data = LogCacheGetAuxData(seqnum); aux_data.has_value()) {
             uint16_t view_id = log_utils::GetViewId(seqnum);
             absl::ReaderMutexLock view_lk(&view_mu_);
@@ -603,6 +995,14 @@ void Engine::OnRecvNewMetaLogs(const SharedLogMessage& message,
     LogProducer::AppendResultVec append_results;
     IndexQueryResultVec query_results;
     IndexQueryResultVec local_index_misses;
+    absl::InlinedVector<const MetaLogProto::TrimProto*, 4> trims;
+    for (const MetaLogProto& metalog_proto : metalogs_proto.metalogs()) {
+        if (metalog_proto.type() == MetaLogProto::TRIM) {
+            const MetaLogProto::TrimProto& trim = metalog_proto.trim_proto();
+            UpdateTrimSeqnum(trim.user_logspace(), trim.user_tag(), trim.trim_seqnum());
+            trims.push_back(&trim);
+        }
+    }
     {
         absl::ReaderMutexLock view_lk(&view_mu_);
         IGNORE_IF_NO_CONNECTION_FOR_LOGSPACE(message.logspace_id, metalogs_proto.metalogs().at(metalogs_proto.metalogs_size()-1).metalog_seqnum());
@@ -631,6 +1031,12 @@ void Engine::OnRecvNewMetaLogs(const SharedLogMessage& message,
                 }
                 locked_suffix_chain->PollQueryResults(&query_results);
             }
+            if (!trims.empty()) {
+                auto locked_tag_cache = tag_cache_collection_.GetLogSpaceChecked(message.sequencer_id).Lock();
+                for (const MetaLogProto::TrimProto* trim : trims) {
+                    locked_tag_cache->Trim(trim->user_logspace(), trim->user_tag(), trim->trim_seqnum());
+                }
+            }
         } else if (indexing_strategy_ == IndexingStrategy::COMPLETE){
             auto index_ptr = index_complete_collection_.GetLogSpaceChecked(message.logspace_id);
             {
@@ -725,8 +1131,13 @@ void Engine::OnRecvNewIndexData(const SharedLogMessage& message,
 void Engine::ProcessLocalIndexMisses(const IndexQueryResultVec& misses, uint32_t logspace_id){
     absl::ReaderMutexLock view_lk(&view_mu_);
     for(const IndexQueryResult& miss : misses){
+        // Owned until HandleIndexTierRead puts it back
+        LocalOp* op;
+        if (!onging_reads_.Poll(miss.original_query.client_data, &op)) {
+            continue;
+        }
         HandleIndexTierRead(
-            onging_reads_.GetChecked(miss.original_query.client_data), 
+            op, 
             current_view_->id(), 
             view_mutable_.GetEngineStorageShard(logspace_id)
         );
@@ -744,7 +1155,21 @@ void Engine::OnRecvResponse(const SharedLogMessage& message,
     if (    result == SharedLogResultType::READ_OK
          || result == SharedLogResultType::EMPTY
          || result == SharedLogResultType::DATA_LOST) {
+        if (message.client_data == kReadAheadClientData) {
+            OnRecvReadAheadResponse(message, payload);
+            return;
+        }
+        if ((message.client_data & kReadRangeClientDataFlag) != 0) {
+            OnRecvReadRangeResponse(message, payload);
+            return;
+        }
         uint64_t op_id = message.client_data;
+        if ((op_id & kHedgedReadClientDataFlag) != 0) {
+            if (!OnRecvHedgedReadResponse(op_id)) {
+                return;
+            }
+            op_id &= ~(kHedgedReadClientDataFlag | kHedgeCopyClientDataFlag);
+        }
         LocalOp* op;
         if (!onging_reads_.Poll(op_id, &op)) {
             HLOG_F(WARNING, "Cannot find read op with id {}. result_type={}, origin_node_id={}", 
@@ -752,6 +1177,8 @@ void Engine::OnRecvResponse(const SharedLogMessage& message,
             );
             return;
         }
+        // Already removed from hedged reads above
+        op->hedge_tracked = false;
 #ifdef __FAAS_OP_TRACING
         SaveTracePoint(op->id, "ReceiveResponseFrom(Index|Storage)");
 #endif
@@ -764,12 +1191,29 @@ void Engine::OnRecvResponse(const SharedLogMessage& message,
             std::span<const char> log_data;
             std::span<const char> aux_data;
             log_utils::SplitPayloadForMessage(message, payload, &user_tags, &log_data, &aux_data);
-            Message response = BuildLocalReadOKResponse(seqnum, user_tags, log_data);
-            if (aux_data.size() > 0) {
-                response.log_aux_data_size = gsl::narrow_cast<uint16_t>(aux_data.size());
-                MessageHelper::AppendInlineData(&response, aux_data);
+            if (op->type == SharedLogOpType::READ_RANGE) {
+                // Found by the index tier, which serves a single record
+                auto range_read = std::make_unique<RangeRead>();
+                range_read->op = op;
+                range_read->metalog_progress = message.user_metalog_progress;
+                range_read->log_entries.push_back(std::make_shared<LogEntry>(LogEntry {
+                    .metadata = log_utils::GetMetaDataFromMessage(message),
+                    .user_tags = UserTagVec(user_tags.begin(), user_tags.end()),
+                    .data = std::string(log_data.data(), log_data.size())
+                }));
+                range_read->aux_data.push_back(std::nullopt);
+                if (aux_data.size() > 0) {
+                    range_read->aux_data[0].emplace(aux_data.data(), aux_data.size());
+                }
+                FinishReadRange(std::move(range_read));
+            } else {
+                Message response = BuildLocalReadOKResponse(seqnum, user_tags, log_data);
+                if (aux_data.size() > 0) {
+                    response.log_aux_data_size = gsl::narrow_cast<uint16_t>(aux_data.size());
+                    MessageHelper::AppendInlineData(&response, aux_data);
+                }
+                FinishLocalOpWithResponse(op, &response, message.user_metalog_progress);
             }
-            FinishLocalOpWithResponse(op, &response, message.user_metalog_progress);
             // Put the received seqnum into seqnum cache for empty tag queries
             if (local_index_miss && query_tag == kEmptyLogTag && seqnum_cache_.has_value()){
                 seqnum_cache_->Put(seqnum, message.storage_shard_id);
@@ -792,6 +1236,25 @@ void Engine::OnRecvResponse(const SharedLogMessage& message,
         } else {
             UNREACHABLE();
         }
+    } else if (   result == SharedLogResultType::TRIM_OK
+               || result == SharedLogResultType::TRIM_FAILED) {
+        LocalOp* op;
+        if (!onging_trims_.Poll(message.client_data, &op)) {
+            HLOG_F(WARNING, "Cannot find trim op with id {}", message.client_data);
+            return;
+        }
+        if (result == SharedLogResultType::TRIM_OK) {
+            HVLOG_F(1, "Trim of logspace {} (tag {}) at seqnum {} succeeded",
+                    op->user_logspace, op->query_tag, bits::HexStr0x(op->seqnum));
+            UpdateTrimSeqnum(op->user_logspace, op->query_tag, op->seqnum);
+            Message response = MessageHelper::NewSharedLogOpSucceeded(
+                SharedLogResultType::TRIM_OK, op->seqnum);
+            FinishLocalOpWithResponse(op, &response, /* metalog_progress= */ 0);
+        } else {
+            HLOG_F(WARNING, "Trim of logspace {} at seqnum {} failed",
+                   op->user_logspace, bits::HexStr0x(op->seqnum));
+            FinishLocalOpWithFailure(op, SharedLogResultType::TRIM_FAILED);
+        }
     } else if (   result == SharedLogResultType::INDEX_OK
                || result == SharedLogResultType::INDEX_MIN_OK
                || result == SharedLogResultType::INDEX_MIN_FAILED) {
@@ -970,6 +1433,7 @@ void Engine::OnRecvRegistrationResponse(const protocol::SharedLogMessage& receiv
         std::vector<SharedLogRequest> ready_requests;
         future_requests_.OnNewView(current_view_, &ready_requests);
         current_view_active_ = true;
+        PublishViewSnapshot();
         registered();
         HLOG(INFO) << "Current view active. Vamos!";
         if (!ready_requests.empty()) {
@@ -991,7 +1455,9 @@ void Engine::ProcessAppendResults(const LogProducer::AppendResultVec& results) {
 #ifdef __FAAS_OP_TRACING
         SaveTracePoint(op->id, "ProcessAppendResult");
 #endif
-        if (result.seqnum != kInvalidLogSeqNum) {
+        if (op->type == SharedLogOpType::APPEND_BATCH) {
+            FinishAppendBatch(op, result);
+        } else if (result.seqnum != kInvalidLogSeqNum) {
             LogMetaData log_metadata = MetaDataFromAppendOp(op);
             log_metadata.seqnum = result.seqnum;
             log_metadata.localid = result.localid;
@@ -1005,18 +1471,79 @@ void Engine::ProcessAppendResults(const LogProducer::AppendResultVec& results) {
     }
 }
 
+void Engine::FinishAppendBatch(LocalOp* op, const LogProducer::AppendResult& result) {
+    DCHECK(op->type == SharedLogOpType::APPEND_BATCH);
+    const std::vector<uint64_t>& seqnums = *result.batch_seqnums;
+    DCHECK_EQ(seqnums.size(), size_t{op->batch_size});
+    std::vector<std::span<const uint64_t>> user_tags;
+    std::vector<std::span<const char>> log_data;
+    if (!log_utils::SplitAppendBatchPayload(op->data.to_span(), op->batch_size,
+                                            &user_tags, &log_data)) {
+        HLOG(FATAL) << "Append batch validated on arrival cannot be malformed";
+    }
+    size_t num_appended = 0;
+    for (size_t i = 0; i < seqnums.size(); i++) {
+        if (seqnums[i] == kInvalidLogSeqNum) {
+            continue;
+        }
+        num_appended++;
+        LogMetaData log_metadata = {
+            .user_logspace = op->user_logspace,
+            .seqnum = seqnums[i],
+            .localid = result.localid + i,
+            .num_tags = user_tags[i].size(),
+            .data_size = log_data[i].size()
+        };
+        LogCachePut(log_metadata, user_tags[i], log_data[i]);
+    }
+    HVLOG_F(1, "Append batch finished: op_id={}, batch_size={}, appended={}",
+            op->id, seqnums.size(), num_appended);
+    // Appended records cannot be revoked, so the batch fails only if all of them are discarded
+    if (num_appended == 0) {
+        FinishLocalOpWithFailure(op, SharedLogResultType::DISCARDED);
+        return;
+    }
+    Message response = MessageHelper::NewSharedLogOpSucceeded(
+        SharedLogResultType::APPEND_OK, result.seqnum);
+    response.log_batch_size = op->batch_size;
+    MessageHelper::AppendInlineData(&response, std::span<const uint64_t>(seqnums));
+    FinishLocalOpWithResponse(op, &response, result.metalog_progress);
+}
+
 void Engine::ProcessIndexFoundResult(const IndexQueryResult& query_result) {
     DCHECK(query_result.state == IndexQueryResult::kFound);
     const IndexQuery& query = query_result.original_query;
     bool local_request = (query.origin_node_id == my_node_id());
     uint64_t seqnum = query_result.found_result.seqnum;
-    if (auto cached_log_entry = LogCacheGet(seqnum); cached_log_entry.has_value()) {
+    LocalOp* op = nullptr;
+    bool range_read = false;
+    if (local_request && !onging_reads_.Visit(query.client_data, [&range_read] (LocalOp* op) {
+            range_read = (op->type == SharedLogOpType::READ_RANGE);
+        })) {
+        HLOG_F(WARNING, "Read op {} expired before its index result", query.client_data);
+        return;
+    }
+    if (local_request && query.direction == IndexQuery::kReadPrev
+            && seqnum < GetTrimSeqnum(query.user_logspace, query.user_tag)) {
+        // Indices may lag behind trims, the found entry is already trimmed
+        if (onging_reads_.Poll(query.client_data, &op)) {
+            FinishLocalOpWithFailure(op, SharedLogResultType::EMPTY, query_result.metalog_progress);
+        }
+        return;
+    }
+    if (local_request && range_read) {
+        if (onging_reads_.Poll(query.client_data, &op)) {
+            ProcessReadRangeFoundResult(op, query_result);
+        }
+        return;
+    }
+    if (auto cached_log_entry = LogCacheGet(seqnum); cached_log_entry != nullptr) {
         // Cache hits
         HVLOG_F(1, "Cache hits for log entry (seqnum {})", bits::HexStr0x(seqnum));
 #ifdef __FAAS_OP_STAT
         log_cache_hit_counter_.fetch_add(1, std::memory_order_acq_rel);
 #endif 
-        const LogEntry& log_entry = cached_log_entry.value();
+        const LogEntry& log_entry = *cached_log_entry;
         std::optional<std::string> cached_aux_data = LogCacheGetAuxData(seqnum);
         std::span<const char> aux_data;
         if (cached_aux_data.has_value()) {
@@ -1034,7 +1561,9 @@ void Engine::ProcessIndexFoundResult(const IndexQueryResult& query_result) {
             }
         }
         if (local_request) {
-            LocalOp* op = onging_reads_.PollChecked(query.client_data);
+            if (!onging_reads_.Poll(query.client_data, &op)) {
+                return;
+            }
 #ifdef __FAAS_OP_TRACING
     SaveTracePoint(op->id, "ProcessIndexFoundResult");
 #endif
@@ -1042,6 +1571,7 @@ void Engine::ProcessIndexFoundResult(const IndexQueryResult& query_result) {
             response.log_aux_data_size = gsl::narrow_cast<uint16_t>(aux_data.size());
             MessageHelper::AppendInlineData(&response, aux_data);
             FinishLocalOpWithResponse(op, &response, query_result.metalog_progress);
+            MaybeReadAhead(query_result, /* cache_hit= */ true);
         } else {
             HVLOG_F(1, "Send read response for log (seqnum {})", bits::HexStr0x(seqnum));
             SharedLogMessage response = SharedLogMessageHelper::NewReadOkResponse();
@@ -1059,10 +1589,8 @@ void Engine::ProcessIndexFoundResult(const IndexQueryResult& query_result) {
 #endif 
         const View::StorageShard* storage_shard = nullptr;
         {
-            absl::ReaderMutexLock view_lk(&view_mu_);
             uint16_t view_id = query_result.found_result.view_id;
-            if (view_id < views_.size()) {
-                const View* view = views_.at(view_id);
+            if (const View* view = FindView(view_id); view != nullptr) {
                 storage_shard = view->GetStorageShard(query_result.StorageShardId());
             } else {
                 HLOG_F(FATAL, "Cannot find view {}", view_id);
@@ -1072,13 +1600,363 @@ void Engine::ProcessIndexFoundResult(const IndexQueryResult& query_result) {
         if (!success) {
             HLOG_F(WARNING, "Failed to send read request for seqnum {} ", bits::HexStr0x(seqnum));
             if (local_request) {
-                LocalOp* op = onging_reads_.PollChecked(query.client_data);
-                FinishLocalOpWithFailure(op, SharedLogResultType::DATA_LOST);
+                if (onging_reads_.Poll(query.client_data, &op)) {
+                    FinishLocalOpWithFailure(op, SharedLogResultType::DATA_LOST);
+                }
             } else {
                 SendReadFailureResponse(query, SharedLogResultType::DATA_LOST);
             }
+        } else if (local_request) {
+            MaybeReadAhead(query_result, /* cache_hit= */ false);
+        }
+    }
+}
+
+void Engine::MaybeReadAhead(const IndexQueryResult& query_result, bool cache_hit) {
+    const IndexQuery& query = query_result.original_query;
+    if (read_ahead_depth_ == 0
+            || indexing_strategy_ != IndexingStrategy::DISTRIBUTED
+            || query.direction != IndexQuery::kReadNext
+            || query.user_tag == kEmptyLogTag) {
+        return;
+    }
+    uint64_t seqnum = query_result.found_result.seqnum;
+    uint64_t prefetched_seqnum;
+    {
+        absl::MutexLock lk(&read_ahead_mu_);
+        auto key = std::make_pair(query.user_logspace, query.user_tag);
+        if (!read_ahead_streams_.contains(key)
+                && read_ahead_streams_.size() >= kMaxReadAheadStreams) {
+            // Active streams will be detected again
+            HLOG_F(INFO, "Too many read-ahead streams, forget all {} of them",
+                   read_ahead_streams_.size());
+            read_ahead_streams_.clear();
+        }
+        ReadAheadStream& stream = read_ahead_streams_[key];
+        // A cursor is sequential if it continues right after the last found seqnum
+        if (stream.num_reads > 0 && stream.last_seqnum < query.query_seqnum
+                && query.query_seqnum <= seqnum) {
+            stream.num_sequential++;
+        } else {
+            stream.num_sequential = 1;
+            stream.prefetched_seqnum = 0;
+        }
+        stream.num_reads++;
+        if (cache_hit && seqnum <= stream.prefetched_seqnum) {
+            stream.num_prefetch_hits++;
+        }
+        stream.last_seqnum = seqnum;
+        if (stream.num_sequential < kReadAheadMinSequentialReads) {
+            return;
+        }
+        prefetched_seqnum = stream.prefetched_seqnum;
+    }
+    uint16_t sequencer_id = bits::LowHalf32(bits::HighHalf64(seqnum));
+    LockablePtr<TagCache> tag_cache_ptr;
+    {
+        utils::EpochGuard epoch_guard;
+        const ViewSnapshot* snapshot = view_snapshot_.Load();
+        if (snapshot == nullptr || !snapshot->tag_caches.contains(sequencer_id)) {
+            return;
+        }
+        tag_cache_ptr = snapshot->tag_caches.at(sequencer_id);
+    }
+    std::vector<IndexFoundResult> next_results;
+    {
+        auto locked_tag_cache = tag_cache_ptr.Lock();
+        locked_tag_cache->GetNextSeqnums(query.user_logspace, query.user_tag, seqnum,
+                                         read_ahead_depth_, &next_results);
+    }
+    IndexQueryResult prefetch_result = query_result;
+    prefetch_result.original_query.client_data = kReadAheadClientData;
+    uint64_t num_prefetched = 0;
+    for (const IndexFoundResult& found_result : next_results) {
+        if (found_result.seqnum <= prefetched_seqnum) {
+            continue;
+        }
+        prefetched_seqnum = found_result.seqnum;
+        if (LogCacheGet(found_result.seqnum) != nullptr) {
+            continue;
+        }
+        prefetch_result.found_result = found_result;
+        const View::StorageShard* storage_shard = nullptr;
+        if (const View* view = FindView(found_result.view_id); view != nullptr) {
+            storage_shard = view->GetStorageShard(prefetch_result.StorageShardId());
+        }
+        if (storage_shard == nullptr || !SendStorageReadRequest(prefetch_result, storage_shard)) {
+            HVLOG_F(1, "Failed to prefetch seqnum {}", bits::HexStr0x(found_result.seqnum));
+            break;
+        }
+        num_prefetched++;
+    }
+    HVLOG_F(1, "Prefetch {} log entries of tag {} after seqnum {}",
+            num_prefetched, query.user_tag, bits::HexStr0x(seqnum));
+    absl::MutexLock lk(&read_ahead_mu_);
+    auto iter = read_ahead_streams_.find(std::make_pair(query.user_logspace, query.user_tag));
+    if (iter != read_ahead_streams_.end()) {
+        ReadAheadStream& stream = iter->second;
+        stream.prefetched_seqnum = std::max(stream.prefetched_seqnum, prefetched_seqnum);
+        stream.num_prefetched += num_prefetched;
+    }
+}
+
+void Engine::OnRecvReadAheadResponse(const SharedLogMessage& message,
+                                     std::span<const char> payload) {
+    if (SharedLogMessageHelper::GetResultType(message) != SharedLogResultType::READ_OK) {
+        HVLOG_F(1, "Prefetch of seqnum {} failed",
+                bits::HexStr0x(bits::JoinTwo32(message.logspace_id, message.seqnum_lowhalf)));
+        return;
+    }
+    std::span<const uint64_t> user_tags;
+    std::span<const char> log_data;
+    std::span<const char> aux_data;
+    log_utils::SplitPayloadForMessage(message, payload, &user_tags, &log_data, &aux_data);
+    LogMetaData log_metadata = log_utils::GetMetaDataFromMessage(message);
+    LogCachePut(log_metadata, user_tags, log_data);
+    if (aux_data.size() > 0) {
+        LogCachePutAuxData(log_metadata.seqnum, aux_data);
+    }
+}
+
+void Engine::ProcessReadRangeFoundResult(LocalOp* op, const IndexQueryResult& query_result) {
+    DCHECK(op->type == SharedLogOpType::READ_RANGE);
+    const IndexQuery& query = query_result.original_query;
+    uint64_t seqnum = query_result.found_result.seqnum;
+    size_t max_count = kMaxReadRangeCount;
+    if (op->range_max_count > 0) {
+        max_count = std::min<size_t>(max_count, op->range_max_count);
+    }
+    auto range_read = std::make_unique<RangeRead>();
+    range_read->op = op;
+    range_read->metalog_progress = query_result.metalog_progress;
+    range_read->found_results.push_back(query_result.found_result);
+    // Only local indices of the distributed strategy can list following seqnums,
+    // other strategies return a single record
+    if (max_count > 1 && indexing_strategy_ == IndexingStrategy::DISTRIBUTED) {
+        uint16_t sequencer_id = bits::LowHalf32(bits::HighHalf64(seqnum));
+        LockablePtr<SeqnumSuffixChain> suffix_chain_ptr;
+        LockablePtr<TagCache> tag_cache_ptr;
+        {
+            utils::EpochGuard epoch_guard;
+            const ViewSnapshot* snapshot = view_snapshot_.Load();
+            if (snapshot != nullptr && query.user_tag == kEmptyLogTag) {
+                if (auto iter = snapshot->suffix_chains.find(sequencer_id);
+                        iter != snapshot->suffix_chains.end()) {
+                    suffix_chain_ptr = iter->second;
+                }
+            } else if (snapshot != nullptr) {
+                if (auto iter = snapshot->tag_caches.find(sequencer_id);
+                        iter != snapshot->tag_caches.end()) {
+                    tag_cache_ptr = iter->second;
+                }
+            }
+        }
+        if (suffix_chain_ptr != nullptr) {
+            auto locked_suffix_chain = suffix_chain_ptr.Lock();
+            locked_suffix_chain->GetNextSeqnums(seqnum, max_count - 1, &range_read->found_results);
+        } else if (tag_cache_ptr != nullptr) {
+            auto locked_tag_cache = tag_cache_ptr.Lock();
+            locked_tag_cache->GetNextSeqnums(query.user_logspace, query.user_tag, seqnum,
+                                             max_count - 1, &range_read->found_results);
+        }
+    }
+    size_t num_records = range_read->found_results.size();
+    range_read->log_entries.resize(num_records);
+    range_read->aux_data.resize(num_records);
+    // Cache misses are grouped by storage shard
+    absl::flat_hash_map<std::pair</* view_id */ uint16_t, /* shard_id */ uint32_t>,
+                        std::vector<size_t>> misses_by_shard;
+    for (size_t i = 0; i < num_records; i++) {
+        const IndexFoundResult& found_result = range_read->found_results[i];
+        if (auto log_entry = LogCacheGet(found_result.seqnum); log_entry != nullptr) {
+            range_read->log_entries[i] = std::move(log_entry);
+            range_read->aux_data[i] = LogCacheGetAuxData(found_result.seqnum);
+        } else {
+            uint32_t shard_id = bits::JoinTwo16(
+                bits::LowHalf32(bits::HighHalf64(found_result.seqnum)), found_result.storage_shard_id);
+            misses_by_shard[std::make_pair(found_result.view_id, shard_id)].push_back(i);
+        }
+    }
+    HVLOG_F(1, "Read range of {} records after seqnum {}: cache_misses={}, shards={}",
+            num_records, bits::HexStr0x(seqnum),
+            num_records - std::count(range_read->log_entries.begin(),
+                                     range_read->log_entries.end(), nullptr),
+            misses_by_shard.size());
+    if (misses_by_shard.empty()) {
+        FinishReadRange(std::move(range_read));
+        return;
+    }
+    size_t num_misses = 0;
+    for (const auto& [key, indices] : misses_by_shard) {
+        num_misses += indices.size();
+    }
+    range_read->num_pending_reads = num_misses;
+    // Keep copies for building requests, as responses may finish the range concurrently
+    std::vector<IndexFoundResult> found_results = range_read->found_results;
+    uint64_t op_id = op->id;
+    range_read->start_timestamp = GetMonotonicMicroTimestamp();
+    {
+        absl::MutexLock lk(&range_read_mu_);
+        range_reads_[op_id] = std::move(range_read);
+    }
+    size_t num_failed = 0;
+    std::vector<IndexFoundResult> shard_found_results;
+    std::vector<uint64_t> client_data;
+    for (const auto& [key, indices] : misses_by_shard) {
+        const View::StorageShard* storage_shard = nullptr;
+        if (const View* view = FindView(key.first); view != nullptr) {
+            storage_shard = view->GetStorageShard(key.second);
+        }
+        if (storage_shard == nullptr) {
+            HLOG_F(WARNING, "Cannot find storage shard {} of view {}", key.second, key.first);
+            num_failed += indices.size();
+            continue;
+        }
+        shard_found_results.clear();
+        client_data.clear();
+        for (size_t index : indices) {
+            shard_found_results.push_back(found_results[index]);
+            client_data.push_back(kReadRangeClientDataFlag | (op_id << kReadRangeIndexBits) | index);
+        }
+        size_t num_sent = SendStorageReadRequests(
+            query_result, shard_found_results, client_data, storage_shard);
+        if (num_sent < indices.size()) {
+            HLOG_F(WARNING, "Failed to send {} read requests to storage shard {}",
+                   indices.size() - num_sent, key.second);
+        }
+        num_failed += indices.size() - num_sent;
+    }
+    if (num_failed == 0) {
+        return;
+    }
+    std::unique_ptr<RangeRead> finished_range_read;
+    {
+        absl::MutexLock lk(&range_read_mu_);
+        auto iter = range_reads_.find(op_id);
+        if (iter == range_reads_.end()) {
+            // Expired meanwhile
+            return;
+        }
+        iter->second->num_pending_reads -= num_failed;
+        if (iter->second->num_pending_reads == 0) {
+            finished_range_read = std::move(iter->second);
+            range_reads_.erase(iter);
+        }
+    }
+    if (finished_range_read != nullptr) {
+        FinishReadRange(std::move(finished_range_read));
+    }
+}
+
+void Engine::OnRecvReadRangeResponse(const SharedLogMessage& message,
+                                     std::span<const char> payload) {
+    uint64_t op_id = (message.client_data & ~kReadRangeClientDataFlag) >> kReadRangeIndexBits;
+    size_t index = message.client_data & (kMaxReadRangeCount - 1);
+    std::shared_ptr<const LogEntry> log_entry;
+    std::optional<std::string> aux_data;
+    if (SharedLogMessageHelper::GetResultType(message) == SharedLogResultType::READ_OK) {
+        std::span<const uint64_t> user_tags;
+        std::span<const char> log_data;
+        std::span<const char> aux_data_span;
+        log_utils::SplitPayloadForMessage(message, payload, &user_tags, &log_data, &aux_data_span);
+        LogMetaData log_metadata = log_utils::GetMetaDataFromMessage(message);
+        LogCachePut(log_metadata, user_tags, log_data);
+        if (aux_data_span.size() > 0) {
+            LogCachePutAuxData(log_metadata.seqnum, aux_data_span);
+            aux_data.emplace(aux_data_span.data(), aux_data_span.size());
+        }
+        log_entry = std::make_shared<LogEntry>(LogEntry {
+            .metadata = log_metadata,
+            .user_tags = UserTagVec(user_tags.begin(), user_tags.end()),
+            .data = std::string(log_data.data(), log_data.size())
+        });
+    } else {
+        HLOG_F(WARNING, "Read of record {} in range of op {} failed", index, op_id);
+    }
+    std::unique_ptr<RangeRead> finished_range_read;
+    {
+        absl::MutexLock lk(&range_read_mu_);
+        auto iter = range_reads_.find(op_id);
+        if (iter == range_reads_.end()) {
+            HLOG_F(WARNING, "Cannot find range read op with id {}", op_id);
+            return;
+        }
+        RangeRead* range_read = iter->second.get();
+        DCHECK_LT(index, range_read->log_entries.size());
+        range_read->log_entries[index] = std::move(log_entry);
+        range_read->aux_data[index] = std::move(aux_data);
+        if (--range_read->num_pending_reads == 0) {
+            finished_range_read = std::move(iter->second);
+            range_reads_.erase(iter);
         }
     }
+    if (finished_range_read != nullptr) {
+        FinishReadRange(std::move(finished_range_read));
+    }
+}
+
+void Engine::FinishReadRange(std::unique_ptr<RangeRead> range_read) {
+    LocalOp* op = range_read->op;
+    // Only the prefix without missing records is returned, so that
+    // the next READ_RANGE can continue after the last returned seqnum
+    std::string records;
+    uint32_t num_records = 0;
+    uint64_t last_seqnum = kInvalidLogSeqNum;
+    for (size_t i = 0; i < range_read->log_entries.size(); i++) {
+        const LogEntry* log_entry = range_read->log_entries[i].get();
+        if (log_entry == nullptr) {
+            break;
+        }
+        const std::optional<std::string>& aux_data = range_read->aux_data[i];
+        size_t aux_data_size = aux_data.has_value() ? aux_data->size() : 0;
+        size_t record_size = sizeof(protocol::ReadRangeRecordHeader)
+                           + log_entry->user_tags.size() * sizeof(uint64_t)
+                           + log_entry->data.size() + aux_data_size;
+        if (num_records > 0 && op->range_max_bytes > 0
+                && records.size() + record_size > op->range_max_bytes) {
+            break;
+        }
+        protocol::ReadRangeRecordHeader header = {
+            .seqnum = log_entry->metadata.seqnum,
+            .data_size = gsl::narrow_cast<uint32_t>(log_entry->data.size()),
+            .num_tags = gsl::narrow_cast<uint16_t>(log_entry->user_tags.size()),
+            .aux_data_size = gsl::narrow_cast<uint16_t>(aux_data_size)
+        };
+        records.append(reinterpret_cast<const char*>(&header), sizeof(header));
+        records.append(reinterpret_cast<const char*>(log_entry->user_tags.data()),
+                       log_entry->user_tags.size() * sizeof(uint64_t));
+        records.append(log_entry->data);
+        if (aux_data.has_value()) {
+            records.append(*aux_data);
+        }
+        last_seqnum = log_entry->metadata.seqnum;
+        num_records++;
+    }
+    if (num_records == 0) {
+        HLOG_F(WARNING, "Failed to read the first record of range: seqnum={}, tag={}",
+               bits::HexStr0x(op->seqnum), op->query_tag);
+        FinishLocalOpWithFailure(op, SharedLogResultType::DATA_LOST);
+        return;
+    }
+    Message response = MessageHelper::NewSharedLogOpSucceeded(
+        SharedLogResultType::READ_OK, last_seqnum);
+    response.log_range_max_count = num_records;
+    if (records.size() <= MESSAGE_INLINE_DATA_SIZE) {
+        MessageHelper::AppendInlineData(&response, STRING_AS_SPAN(records));
+    } else {
+        auto region = ipc::ShmCreate(
+            ipc::GetSharedLogReadRangeShmName(op->func_call_id, op->client_data), records.size());
+        if (region == nullptr) {
+            HLOG(ERROR) << "ShmCreate failed";
+            FinishLocalOpWithFailure(op, SharedLogResultType::DATA_LOST);
+            return;
+        }
+        memcpy(region->base(), records.data(), records.size());
+        response.payload_size = -gsl::narrow_cast<int32_t>(records.size());
+    }
+    HVLOG_F(1, "Finish read range with {} records ({} bytes), last_seqnum={}",
+            num_records, records.size(), bits::HexStr0x(last_seqnum));
+    FinishLocalOpWithResponse(op, &response, range_read->metalog_progress);
 }
 
 void Engine::ProcessIndexContinueResult(const IndexQueryResult& query_result,
@@ -1130,9 +2008,9 @@ void Engine::ProcessIndexQueryResults(const IndexQueryResultVec& results, IndexQ
 #ifdef __FAAS_OP_STAT
             local_index_hit_counter_.fetch_add(1, std::memory_order_acq_rel);
 #endif
-            FinishLocalOpWithFailure(
-                onging_reads_.PollChecked(query.client_data),
-                SharedLogResultType::EMPTY, result.metalog_progress);
+            if (LocalOp* op; onging_reads_.Poll(query.client_data, &op)) {
+                FinishLocalOpWithFailure(op, SharedLogResultType::EMPTY, result.metalog_progress);
+            }
             break;
         default:
             UNREACHABLE();
@@ -1158,8 +2036,9 @@ void Engine::ProcessIndexQueryResultsComplete(const IndexQueryResultVec& results
 #ifdef __FAAS_OP_STAT
             local_index_hit_counter_.fetch_add(1, std::memory_order_acq_rel);
 #endif 
-            FinishLocalOpWithFailure(onging_reads_.PollChecked(query.client_data),
-                SharedLogResultType::EMPTY, result.metalog_progress);
+            if (LocalOp* op; onging_reads_.Poll(query.client_data, &op)) {
+                FinishLocalOpWithFailure(op, SharedLogResultType::EMPTY, result.metalog_progress);
+            }
             break;
         case IndexQueryResult::kContinue:
             ProcessIndexContinueResult(result, &more_results);
@@ -1186,8 +2065,11 @@ void Engine::ProcessRequests(const std::vector<SharedLogRequest>& requests) {
 SharedLogMessage Engine::BuildReadRequestMessage(LocalOp* op) {
     DCHECK(  op->type == SharedLogOpType::READ_NEXT
           || op->type == SharedLogOpType::READ_PREV
-          || op->type == SharedLogOpType::READ_NEXT_B);
-    SharedLogMessage request = SharedLogMessageHelper::NewReadMessage(op->type);
+          || op->type == SharedLogOpType::READ_NEXT_B
+          || op->type == SharedLogOpType::READ_RANGE);
+    // Remote indices only serve the first record of READ_RANGE
+    SharedLogMessage request = SharedLogMessageHelper::NewReadMessage(
+        op->type == SharedLogOpType::READ_RANGE ? SharedLogOpType::READ_NEXT : op->type);
     request.origin_node_id = my_node_id();
     request.hop_times = 1;
     request.client_data = op->id;
@@ -1353,9 +2235,27 @@ void Engine::StatisticsThreadMain() {
                 << std::to_string(local_index_miss_counter_.load())     << "," 
                 << std::to_string(log_cache_hit_counter_.load())        << "," 
                 << std::to_string(log_cache_miss_counter_.load())       << ","
-                << std::to_string(index_min_read_ops_counter_.load())   << "\n"
+                << std::to_string(index_min_read_ops_counter_.load())   << ","
+                << std::to_string(LogCacheNumEvictions())               << ","
+                << std::to_string(single_flight_hit_counter_.load())    << ","
+                << std::to_string(hedged_reads_counter_.load())         << ","
+                << std::to_string(hedge_wins_counter_.load())           << "\n"
             ;
             op_st_file.close();
+            {
+                std::ofstream read_ahead_file(fmt::format("/tmp/slog/stats/read-ahead-{}.csv", my_node_id()));
+                absl::MutexLock read_ahead_lk(&read_ahead_mu_);
+                for (const auto& [key, stream] : read_ahead_streams_) {
+                    read_ahead_file
+                        << std::to_string(key.first)                << ","
+                        << std::to_string(key.second)               << ","
+                        << std::to_string(stream.num_reads)         << ","
+                        << std::to_string(stream.num_prefetched)    << ","
+                        << std::to_string(stream.num_prefetch_hits) << "\n"
+                    ;
+                }
+                read_ahead_file.close();
+            }
 #endif
 #ifdef __FAAS_OP_TRACING
             absl::MutexLock trace_mu_lk(&trace_mu_);
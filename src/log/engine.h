@@ -8,6 +8,7 @@
 #include "log/index_local_tag_cache.h"
 #include "log/utils.h"
 #include "log/view_mutable.h"
+#include "common/stat.h"
 
 namespace faas {
 
@@ -42,6 +43,7 @@ private:
         index_complete_collection_      ABSL_GUARDED_BY(view_mu_);
 
     bool min_seqnum_tag_completion_;
+    bool index_partition_by_tag_;
 
     absl::Mutex min_tag_mu_;
     std::vector<PendingMinTag> pending_min_tags_ ABSL_GUARDED_BY(min_tag_mu_);
@@ -49,15 +51,137 @@ private:
     // distributed indexing
     PhysicalLogSpaceCollection<SeqnumSuffixChain> suffix_chain_collection_ ABSL_GUARDED_BY(view_mu_);
     PhysicalLogSpaceCollection<TagCache> tag_cache_collection_ ABSL_GUARDED_BY(view_mu_);
+
+    // Immutable copy of the view state used by append and read paths, so that
+    // they do not contend on view_mu_. Republished at the end of every writer
+    // section of view_mu_; requests of newer views fall back to view_mu_.
+    struct ViewSnapshot {
+        const View* view;
+        bool view_active;
+        std::vector<const View*> views;
+        absl::flat_hash_map</* logspace_id */ uint32_t, const View::StorageShard*> storage_shards;
+        absl::flat_hash_map</* logspace_id */ uint32_t, LockablePtr<LogProducer>> producers;
+        absl::flat_hash_map</* logspace_id */ uint32_t, LockablePtr<IndexComplete>> complete_indices;
+        absl::flat_hash_map</* sequencer_id */ uint16_t, LockablePtr<SeqnumSuffixChain>> suffix_chains;
+        absl::flat_hash_map</* sequencer_id */ uint16_t, LockablePtr<TagCache>> tag_caches;
+    };
+    utils::EpochPtr<ViewSnapshot> view_snapshot_;
+    void PublishViewSnapshot() ABSL_EXCLUSIVE_LOCKS_REQUIRED(view_mu_);
+    // Returns nullptr if view `view_id` is not created yet
+    const View* FindView(uint16_t view_id);
     std::optional<SeqnumCache> seqnum_cache_;
 
     log_utils::FutureRequests       future_requests_;
-    log_utils::ThreadedMap<LocalOp> onging_reads_;
+    log_utils::ShardedOpTable<LocalOp> onging_reads_;
 
     absl::flat_hash_map<uint32_t, uint32_t> max_metalog_position_;
     absl::flat_hash_map<uint32_t, uint32_t> max_index_metalog_position_;
     absl::flat_hash_map<uint16_t, uint64_t> suffix_chain_heads_;
 
+    log_utils::ThreadedMap<LocalOp> onging_trims_;
+    absl::Mutex trim_mu_;
+    absl::flat_hash_map<std::pair</* user_logspace */ uint32_t,
+                                  /* user_tag */      uint64_t>,
+                        /* trim_seqnum */ uint64_t> trim_seqnums_ ABSL_GUARDED_BY(trim_mu_);
+    // Lets reads skip trim_mu_ until the first trim
+    std::atomic<bool> has_trim_seqnums_;
+
+    // Read-ahead of sequential READ_NEXT cursors over tags. Prefetched log
+    // entries are read with kReadAheadClientData, and go into the log cache.
+    static constexpr uint64_t kReadAheadClientData = std::numeric_limits<uint64_t>::max();
+    static constexpr int kReadAheadMinSequentialReads = 2;
+    static constexpr size_t kMaxReadAheadStreams = 4096;
+    struct ReadAheadStream {
+        uint64_t last_seqnum;        // Seqnum found by the last read
+        int      num_sequential;     // Length of the current sequential run
+        uint64_t prefetched_seqnum;  // Seqnums up to this one are prefetched
+        uint64_t num_reads;
+        uint64_t num_prefetched;
+        uint64_t num_prefetch_hits;
+    };
+    size_t read_ahead_depth_;
+    absl::Mutex read_ahead_mu_;
+    absl::flat_hash_map<std::pair</* user_logspace */ uint32_t,
+                                  /* user_tag */      uint64_t>,
+                        ReadAheadStream> read_ahead_streams_ ABSL_GUARDED_BY(read_ahead_mu_);
+
+    // READ_RANGE ops with records being read from storage. Storage failure
+    // responses carry no seqnum, so the client data of each read identifies the
+    // op and the position of the record in the range.
+    static constexpr uint64_t kReadRangeClientDataFlag = uint64_t{1} << 62;
+    static constexpr int kReadRangeIndexBits = 10;
+    static constexpr size_t kMaxReadRangeCount = size_t{1} << kReadRangeIndexBits;
+    static_assert(kLocalOpIdBits + kReadRangeIndexBits <= 60,
+                  "Read range client data overlaps client data flags");
+    struct RangeRead {
+        LocalOp* op;
+        uint64_t metalog_progress;
+        std::vector<IndexFoundResult> found_results;
+        std::vector<std::shared_ptr<const LogEntry>> log_entries;
+        std::vector<std::optional<std::string>> aux_data;
+        size_t num_pending_reads;
+        int64_t start_timestamp;  // Set once reads are sent to storage
+    };
+    // Range reads waiting for storage expire like ongoing reads
+    int64_t range_read_timeout_us_;
+    absl::Mutex range_read_mu_;
+    absl::flat_hash_map</* op_id */ uint64_t, std::unique_ptr<RangeRead>>
+        range_reads_ ABSL_GUARDED_BY(range_read_mu_);
+
+    // Single-flight of identical local reads. The first read of a key leads,
+    // later ones wait for its response if they need no newer metalog progress.
+    using InflightReadKey = std::tuple</* op_type */ uint16_t, /* user_logspace */ uint32_t,
+                                       /* user_tag */ uint64_t, /* seqnum */ uint64_t>;
+    struct InflightRead {
+        uint64_t leader_op_id;
+        uint64_t metalog_progress;
+        std::vector<LocalOp*> waiters;
+    };
+    bool single_flight_reads_;
+    absl::Mutex inflight_read_mu_;
+    absl::flat_hash_map<InflightReadKey, InflightRead> inflight_reads_ ABSL_GUARDED_BY(inflight_read_mu_);
+
+    // Index tier reads answered by a single index replica are tracked for
+    // replica latency estimates, and hedged if enabled: if no response arrives
+    // before the p95 latency of the replica, a duplicate goes to another
+    // replica, and whichever response comes second is dropped.
+    // Both copies carry kHedgedReadClientDataFlag, the duplicate also carries
+    // kHedgeCopyClientDataFlag. Blocking reads are neither tracked nor hedged,
+    // as the index may hold them on purpose. Aggregated reads are answered by
+    // the aggregator on behalf of all index shards, so only tag reads under
+    // index partitioning are tracked.
+    static constexpr uint64_t kHedgedReadClientDataFlag = uint64_t{1} << 61;
+    static constexpr uint64_t kHedgeCopyClientDataFlag = uint64_t{1} << 60;
+    static_assert(kLocalOpIdBits <= 60, "Op ids overlap hedge flags");
+    struct HedgedRead {
+        protocol::SharedLogMessage request;
+        std::vector<uint16_t> replicas;
+        uint16_t index_node;
+        std::optional<uint16_t> hedge_index_node;
+        int64_t start_timestamp;
+        int64_t hedge_timestamp;
+    };
+    static constexpr size_t kNumHedgedReadShards = 16;
+    struct alignas(__FAAS_CACHE_LINE_SIZE) HedgedReadShard {
+        absl::Mutex mu;
+        absl::flat_hash_map</* op_id */ uint64_t, HedgedRead> reads ABSL_GUARDED_BY(mu);
+        // Min-heap of hedge deadlines, entries of finished reads are skipped lazily
+        std::priority_queue<std::pair</* deadline */ int64_t, /* op_id */ uint64_t>,
+                            std::vector<std::pair<int64_t, uint64_t>>,
+                            std::greater<std::pair<int64_t, uint64_t>>>
+            deadlines ABSL_GUARDED_BY(mu);
+    };
+    bool hedge_index_reads_;
+    int64_t hedge_min_delay_us_;
+    log_utils::IndexReplicaStats index_replica_stats_;
+    HedgedReadShard hedged_read_shards_[kNumHedgedReadShards];
+    HedgedReadShard& GetHedgedReadShard(uint64_t op_id) {
+        return hedged_read_shards_[op_id % kNumHedgedReadShards];
+    }
+    absl::Mutex read_delay_stat_mu_;
+    stat::StatisticsCollector<int32_t>
+        index_tier_read_delay_stat_ ABSL_GUARDED_BY(read_delay_stat_mu_);
+
 #ifdef __FAAS_STAT_THREAD
     base::Thread statistics_thread_;
     bool statistics_thread_started_;
@@ -75,6 +199,9 @@ private:
     std::atomic<uint64_t> index_min_read_ops_counter_;
     std::atomic<uint64_t> log_cache_hit_counter_;
     std::atomic<uint64_t> log_cache_miss_counter_;
+    std::atomic<uint64_t> single_flight_hit_counter_;
+    std::atomic<uint64_t> hedged_reads_counter_;
+    std::atomic<uint64_t> hedge_wins_counter_;
     void ResetOpStat(){
         append_ops_counter_.store(0);
         read_ops_counter_.store(0);
@@ -83,6 +210,9 @@ private:
         index_min_read_ops_counter_.store(0);
         log_cache_hit_counter_.store(0);
         log_cache_miss_counter_.store(0);
+        single_flight_hit_counter_.store(0);
+        hedged_reads_counter_.store(0);
+        hedge_wins_counter_.store(0);
     }
 #endif
 
@@ -96,8 +226,19 @@ private:
     void HandleLocalTrim(LocalOp* op) override;
     void HandleLocalRead(LocalOp* op) override;
     void HandleLocalSetAuxData(LocalOp* op) override;
+    void ExpireOngoingReads() override;
+    void HedgeIndexTierReads() override;
+    void OnLocalOpFinished(LocalOp* op, const protocol::Message& response,
+                           uint64_t metalog_progress, bool success) override;
 
+    // Returns true if `op` waits for an identical read in flight
+    bool JoinInflightRead(LocalOp* op);
+
+    // `op` must not be in onging_reads_, it is put there before requests are sent
     void HandleIndexTierRead(LocalOp* op, uint16_t view_id, const View::StorageShard* storage_shard);
+    // Returns false if `client_data` belongs to the second response of a hedged read
+    bool OnRecvHedgedReadResponse(uint64_t client_data);
+    void RemoveHedgedRead(uint64_t op_id);
     void HandleIndexTierMinSeqnumRead(LocalOp* op, uint64_t tag, uint16_t view_id, uint64_t log_tail_seqnum, const View::StorageShard* storage_shard);
     void ProcessLocalIndexMisses(const IndexQueryResultVec& miss_results, uint32_t logspace_id);
 
@@ -110,11 +251,23 @@ private:
     void OnRecvRegistrationResponse(const protocol::SharedLogMessage& message) override;
 
     void ProcessAppendResults(const LogProducer::AppendResultVec& results);
+    void FinishAppendBatch(LocalOp* op, const LogProducer::AppendResult& result);
     void ProcessIndexQueryResults(const IndexQueryResultVec& results, IndexQueryResultVec* not_found_results);
     void ProcessIndexQueryResultsComplete(const IndexQueryResultVec& results);
     void ProcessRequests(const std::vector<SharedLogRequest>& requests);
 
+    void UpdateTrimSeqnum(uint32_t user_logspace, uint64_t user_tag, uint64_t trim_seqnum);
+    // Reads of `user_tag` in `user_logspace` must not return seqnums below this
+    uint64_t GetTrimSeqnum(uint32_t user_logspace, uint64_t user_tag);
+
     void ProcessIndexFoundResult(const IndexQueryResult& query_result);
+    void MaybeReadAhead(const IndexQueryResult& query_result, bool cache_hit);
+    void OnRecvReadAheadResponse(const protocol::SharedLogMessage& message,
+                                 std::span<const char> payload);
+    void ProcessReadRangeFoundResult(LocalOp* op, const IndexQueryResult& query_result);
+    void OnRecvReadRangeResponse(const protocol::SharedLogMessage& message,
+                                 std::span<const char> payload);
+    void FinishReadRange(std::unique_ptr<RangeRead> range_read);
     void ProcessIndexContinueResult(const IndexQueryResult& query_result,
                                     IndexQueryResultVec* more_results);
 
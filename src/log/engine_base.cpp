@@ -5,7 +5,10 @@
 #include "log/utils.h"
 #include "server/constants.h"
 #include "engine/engine.h"
+#include "ipc/base.h"
+#include "ipc/shm_region.h"
 #include "utils/bits.h"
+#include "utils/fs.h"
 
 #define log_header_ "LogEngineBase: "
 
@@ -122,6 +125,31 @@ void EngineBase::SetupZKWatchers() {
 }
 
 void EngineBase::SetupTimers() {
+    int read_timeout_ms = absl::GetFlag(FLAGS_slog_engine_read_timeout_ms);
+    if (read_timeout_ms > 0) {
+        // The op table rounds expiry to 1/32 of the timeout, which this timer
+        // polls at 1/16, so reads expire at most 1/16 of the timeout late
+        engine_->CreatePeriodicTimer(
+            kExpireReadsTimerId,
+            absl::Milliseconds(read_timeout_ms) / 16,
+            [this] () { this->ExpireOngoingReads(); }
+        );
+    }
+    // Only reads answered by a single replica are hedged, which requires
+    // index partitioning by tag
+    if (absl::GetFlag(FLAGS_slog_engine_hedge_index_reads)
+            && absl::GetFlag(FLAGS_slog_index_partition_by_tag)) {
+        int hedge_min_delay_us = absl::GetFlag(FLAGS_slog_engine_hedge_min_delay_us);
+        if (hedge_min_delay_us <= 0) {
+            HLOG(FATAL) << "Invalid minimal hedge delay: " << hedge_min_delay_us;
+        }
+        // Hedging is late by at most 1/4 of the minimal delay
+        engine_->CreatePeriodicTimer(
+            kHedgeReadsTimerId,
+            absl::Microseconds(hedge_min_delay_us) / 4,
+            [this] () { this->HedgeIndexTierReads(); }
+        );
+    }
 }
 
 void EngineBase::OnNewExternalFuncCall(const FuncCall& func_call, uint32_t log_space) {
@@ -165,11 +193,13 @@ void EngineBase::OnFuncCallCompleted(const FuncCall& func_call) {
 void EngineBase::LocalOpHandler(LocalOp* op) {
     switch (op->type) {
     case SharedLogOpType::APPEND:
+    case SharedLogOpType::APPEND_BATCH:
         HandleLocalAppend(op);
         break;
     case SharedLogOpType::READ_NEXT:
     case SharedLogOpType::READ_PREV:
     case SharedLogOpType::READ_NEXT_B:
+    case SharedLogOpType::READ_RANGE:
         HandleLocalRead(op);
         break;
     case SharedLogOpType::TRIM:
@@ -215,6 +245,64 @@ void EngineBase::PopulateLogTagsAndData(const Message& message, LocalOp* op) {
     op->data.AppendData(data.subspan(num_tags * sizeof(uint64_t)));
 }
 
+bool EngineBase::PopulateAppendBatch(const Message& message, LocalOp* op) {
+    DCHECK(op->type == SharedLogOpType::APPEND_BATCH);
+    // Records are copied out of the shm region first, so that the region is
+    // removed on every path, including invalid batches
+    if (message.payload_size < 0) {
+        auto region = ipc::ShmOpen(
+            ipc::GetSharedLogAppendBatchShmName(op->func_call_id, op->client_data));
+        if (region == nullptr) {
+            HLOG(ERROR) << "ShmOpen failed";
+            return false;
+        }
+        region->EnableRemoveOnDestruction();
+        op->data.AppendData(region->to_span());
+    } else {
+        op->data.AppendData(MessageHelper::GetInlineData(message));
+    }
+    op->batch_size = message.log_batch_size;
+    if (op->batch_size == 0 || op->batch_size > MAX_APPEND_BATCH_SIZE) {
+        HLOG_F(ERROR, "Invalid size of append batch: {}", op->batch_size);
+        return false;
+    }
+    std::vector<std::span<const uint64_t>> user_tags;
+    std::vector<std::span<const char>> log_data;
+    if (!log_utils::SplitAppendBatchPayload(op->data.to_span(), op->batch_size,
+                                            &user_tags, &log_data)) {
+        HLOG_F(ERROR, "Malformed append batch of {} records", op->batch_size);
+        return false;
+    }
+    for (size_t i = 0; i < user_tags.size(); i++) {
+        // Each record must fit in a read response, same as a single APPEND
+        if (user_tags[i].size() * sizeof(uint64_t) + log_data[i].size() > MESSAGE_INLINE_DATA_SIZE) {
+            HLOG_F(ERROR, "Record too large in append batch: num_tags={}, size={}",
+                   user_tags[i].size(), log_data[i].size());
+            return false;
+        }
+        for (uint64_t tag : user_tags[i]) {
+            if (absl::c_find(op->user_tags, tag) == op->user_tags.end()) {
+                op->user_tags.push_back(tag);
+            }
+        }
+    }
+    return true;
+}
+
+void EngineBase::RemoveAppendBatchShm(const Message& message) {
+    if (MessageHelper::GetSharedLogOpType(message) != SharedLogOpType::APPEND_BATCH
+            || message.payload_size >= 0) {
+        return;
+    }
+    std::string full_path = fs_utils::JoinPath(
+        ipc::GetRootPathForShm(),
+        ipc::GetSharedLogAppendBatchShmName(MessageHelper::GetFuncCall(message).full_call_id,
+                                            message.log_client_data));
+    if (!fs_utils::Remove(full_path)) {
+        PLOG(ERROR) << "Failed to remove " << full_path;
+    }
+}
+
 void EngineBase::OnMessageFromFuncWorker(const Message& message) {
 #ifdef __FAAS_OP_TRACING
     int64_t func_ctx_ts = GetMonotonicMicroTimestamp();
@@ -226,6 +314,7 @@ void EngineBase::OnMessageFromFuncWorker(const Message& message) {
         if (!fn_call_ctx_.contains(func_call.full_call_id)) {
             HLOG(ERROR) << "Cannot find FuncCall: "
                         << FuncCallHelper::DebugString(func_call);
+            RemoveAppendBatchShm(message);
             return;
         }
         ctx = fn_call_ctx_.at(func_call.full_call_id);
@@ -234,11 +323,13 @@ void EngineBase::OnMessageFromFuncWorker(const Message& message) {
             SharedLogResultType result; 
             switch(MessageHelper::GetSharedLogOpType(message)){
                 case SharedLogOpType::APPEND:
+                case SharedLogOpType::APPEND_BATCH:
                     result = SharedLogResultType::APPEND_OK;
                     break;
                 case SharedLogOpType::READ_NEXT:
                 case SharedLogOpType::READ_PREV:
                 case SharedLogOpType::READ_NEXT_B:
+                case SharedLogOpType::READ_RANGE:
                     result = SharedLogResultType::READ_OK;
                     break;
                 case SharedLogOpType::TRIM:
@@ -255,12 +346,14 @@ void EngineBase::OnMessageFromFuncWorker(const Message& message) {
             );
             response.log_client_data = message.log_client_data;
             engine_->SendFuncWorkerMessage(message.log_client_id, &response);
+            RemoveAppendBatchShm(message);
             return;
         }
     }
 
     LocalOp* op = log_op_pool_.Get();
-    op->id = next_local_op_id_.fetch_add(1, std::memory_order_acq_rel);
+    op->id = next_local_op_id_.fetch_add(1, std::memory_order_acq_rel)
+           & ((uint64_t{1} << kLocalOpIdBits) - 1);
     op->start_timestamp = GetMonotonicMicroTimestamp();
     op->client_id = message.log_client_id;
     op->client_data = message.log_client_data;
@@ -271,6 +364,10 @@ void EngineBase::OnMessageFromFuncWorker(const Message& message) {
     op->seqnum = kInvalidLogSeqNum;
     op->query_tag = kInvalidLogTag;
     op->index_lookup_miss = false;
+    op->hedge_tracked = false;
+    op->range_max_count = 0;
+    op->range_max_bytes = 0;
+    op->batch_size = 0;
     op->user_tags.clear();
     op->data.Reset();
 
@@ -278,13 +375,26 @@ void EngineBase::OnMessageFromFuncWorker(const Message& message) {
     case SharedLogOpType::APPEND:
         PopulateLogTagsAndData(message, op);
         break;
+    case SharedLogOpType::APPEND_BATCH:
+        if (!PopulateAppendBatch(message, op)) {
+            FinishLocalOpWithFailure(op, SharedLogResultType::BAD_ARGS);
+            return;
+        }
+        break;
     case SharedLogOpType::READ_NEXT:
     case SharedLogOpType::READ_PREV:
     case SharedLogOpType::READ_NEXT_B:
         op->query_tag = message.log_tag;
         op->seqnum = message.log_seqnum;
         break;
+    case SharedLogOpType::READ_RANGE:
+        op->query_tag = message.log_tag;
+        op->seqnum = message.log_seqnum;
+        op->range_max_count = message.log_range_max_count;
+        op->range_max_bytes = message.log_range_max_bytes;
+        break;
     case SharedLogOpType::TRIM:
+        op->query_tag = message.log_tag;
         op->seqnum = message.log_seqnum;
         break;
     case SharedLogOpType::SET_AUXDATA:
@@ -325,10 +435,36 @@ void EngineBase::ReplicateLogEntry(const View* view, const View::StorageShard* s
     message.origin_node_id = node_id_;
     message.payload_size = gsl::narrow_cast<uint32_t>(
         user_tags.size() * sizeof(uint64_t) + log_data.size());
+    // Encode the message once, and share the buffer among all storage nodes
+    auto encoded_message = std::make_shared<std::string>();
+    encoded_message->reserve(sizeof(SharedLogMessage) + message.payload_size);
+    encoded_message->append(reinterpret_cast<const char*>(&message), sizeof(SharedLogMessage));
+    encoded_message->append(reinterpret_cast<const char*>(user_tags.data()),
+                            user_tags.size() * sizeof(uint64_t));
+    encoded_message->append(log_data.data(), log_data.size());
+    std::shared_ptr<const std::string> shared_message = std::move(encoded_message);
     for (uint16_t storage_id : storage_shard->GetStorageNodes()) {
         engine_->SendSharedLogMessage(protocol::ConnType::ENGINE_TO_STORAGE,
-                                      storage_id, message,
-                                      VECTOR_AS_CHAR_SPAN(user_tags), log_data);
+                                      storage_id, shared_message);
+    }
+}
+
+void EngineBase::ReplicateLogBatch(const View* view, const View::StorageShard* storage_shard,
+                                   const LogMetaData& start_log_metadata, size_t num_records,
+                                   std::span<const char> records) {
+    SharedLogMessage message = SharedLogMessageHelper::NewReplicateBatchMessage();
+    log_utils::PopulateMetaDataToMessage(start_log_metadata, &message);
+    message.num_records = num_records;
+    message.origin_node_id = node_id_;
+    message.payload_size = gsl::narrow_cast<uint32_t>(records.size());
+    auto encoded_message = std::make_shared<std::string>();
+    encoded_message->reserve(sizeof(SharedLogMessage) + records.size());
+    encoded_message->append(reinterpret_cast<const char*>(&message), sizeof(SharedLogMessage));
+    encoded_message->append(records.data(), records.size());
+    std::shared_ptr<const std::string> shared_message = std::move(encoded_message);
+    for (uint16_t storage_id : storage_shard->GetStorageNodes()) {
+        engine_->SendSharedLogMessage(protocol::ConnType::ENGINE_TO_STORAGE,
+                                      storage_id, shared_message);
     }
 }
 
@@ -367,6 +503,7 @@ void EngineBase::FinishLocalOpWithResponse(LocalOp* op, Message* response,
 #ifdef __FAAS_OP_TRACING
     CompleteTrace(op->id, "FinishedOpAndSentResponse");
 #endif
+    OnLocalOpFinished(op, *response, metalog_progress, success);
     log_op_pool_.Return(op);
 }
 
@@ -386,8 +523,8 @@ void EngineBase::LogCachePut(const LogMetaData& log_metadata,
     log_cache_->Put(log_metadata, user_tags, log_data);
 }
 
-std::optional<LogEntry> EngineBase::LogCacheGet(uint64_t seqnum) {
-    return log_cache_.has_value() ? log_cache_->Get(seqnum) : std::nullopt;
+std::shared_ptr<const LogEntry> EngineBase::LogCacheGet(uint64_t seqnum) {
+    return log_cache_.has_value() ? log_cache_->Get(seqnum) : nullptr;
 }
 
 void EngineBase::LogCachePutAuxData(uint64_t seqnum, std::span<const char> data) {
@@ -400,6 +537,10 @@ std::optional<std::string> EngineBase::LogCacheGetAuxData(uint64_t seqnum) {
     return log_cache_.has_value() ? log_cache_->GetAuxData(seqnum) : std::nullopt;
 }
 
+uint64_t EngineBase::LogCacheNumEvictions() const {
+    return log_cache_.has_value() ? log_cache_->num_evictions() : 0;
+}
+
 bool EngineBase::SendIndexTierReadRequest(uint16_t index_node_id, SharedLogMessage* request){
     static constexpr int kMaxRetries = 3;
     for (int i = 0; i < kMaxRetries; i++) {
@@ -436,6 +577,31 @@ bool EngineBase::SendStorageReadRequest(const IndexQueryResult& result,
     return false;
 }
 
+size_t EngineBase::SendStorageReadRequests(const IndexQueryResult& result,
+                                           std::span<const IndexFoundResult> found_results,
+                                           std::span<const uint64_t> client_data,
+                                           const View::StorageShard* storage_shard) {
+    DCHECK_EQ(found_results.size(), client_data.size());
+    uint16_t storage_id = storage_shard->PickStorageNode();
+    size_t num_sent = 0;
+    for (size_t i = 0; i < found_results.size(); i++) {
+        uint64_t seqnum = found_results[i].seqnum;
+        SharedLogMessage request = SharedLogMessageHelper::NewReadAtMessage(
+            bits::HighHalf64(seqnum), bits::LowHalf64(seqnum));
+        request.user_metalog_progress = result.metalog_progress;
+        request.storage_shard_id = storage_shard->local_shard_id();
+        request.origin_node_id = result.original_query.origin_node_id;
+        request.hop_times = result.original_query.hop_times + 1;
+        request.client_data = client_data[i];
+        if (!engine_->SendSharedLogMessage(
+                protocol::ConnType::ENGINE_TO_STORAGE, storage_id, request)) {
+            break;
+        }
+        num_sent++;
+    }
+    return num_sent;
+}
+
 void EngineBase::SendReadResponse(const IndexQuery& query,
                                   protocol::SharedLogMessage* response,
                                   std::span<const char> user_tags_payload,
@@ -551,11 +717,13 @@ void EngineBase::PrintOpLatencies(std::ostringstream* append_results, std::ostri
     for (OpLatency op : finished_operations_){
         switch(op.type){
         case SharedLogOpType::APPEND:
+        case SharedLogOpType::APPEND_BATCH:
             *append_results << std::to_string(op.duration) << (op.success? ",1\n" : ",0\n");
             break;
         case SharedLogOpType::READ_NEXT:
         case SharedLogOpType::READ_PREV:
         case SharedLogOpType::READ_NEXT_B:
+        case SharedLogOpType::READ_RANGE:
             *read_results << std::to_string(op.duration) << (op.success? ",1\n" : ",0\n");
             break;
         default:
@@ -656,6 +824,7 @@ void EngineBase::CompleteTrace(uint64_t function_call_id, const std::string func
 void EngineBase::PrintTrace(std::ostringstream* append_results, std::ostringstream* read_results, const OpTrace* op_trace){
     switch(op_trace->type){
     case SharedLogOpType::APPEND:
+    case SharedLogOpType::APPEND_BATCH:
         for (std::string func_desc : op_trace->func_desc){
             *append_results << func_desc << ", ";
         }
@@ -668,6 +837,7 @@ void EngineBase::PrintTrace(std::ostringstream* append_results, std::ostringstre
     case SharedLogOpType::READ_NEXT:
     case SharedLogOpType::READ_PREV:
     case SharedLogOpType::READ_NEXT_B:
+    case SharedLogOpType::READ_RANGE:
         for (std::string func_desc : op_trace->func_desc){
             *read_results << func_desc << ", ";
         }
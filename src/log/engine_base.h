@@ -54,6 +54,11 @@ protected:
     void MessageHandler(const protocol::SharedLogMessage& message,
                         std::span<const char> payload);
 
+    // Op ids are sent as client data, whose bits from kLocalOpIdBits up are
+    // left for flags of the engine. Ids wrap around long before an op
+    // still in flight would collide.
+    static constexpr int kLocalOpIdBits = 48;
+
     struct LocalOp {
         protocol::SharedLogOpType type;
         uint16_t client_id;
@@ -66,7 +71,11 @@ protected:
         uint64_t func_call_id;
         int64_t start_timestamp;
         bool index_lookup_miss;
-        UserTagVec user_tags;
+        bool hedge_tracked;        // Registered as a hedged index tier read
+        uint32_t range_max_count;  // Only used by READ_RANGE
+        uint32_t range_max_bytes;  // Only used by READ_RANGE
+        uint32_t batch_size;       // Only used by APPEND_BATCH
+        UserTagVec user_tags;      // For APPEND_BATCH, distinct tags of all records
         utils::AppendableBuffer data;
     };
 
@@ -74,12 +83,23 @@ protected:
     virtual void HandleLocalTrim(LocalOp* op) = 0;
     virtual void HandleLocalRead(LocalOp* op) = 0;
     virtual void HandleLocalSetAuxData(LocalOp* op) = 0;
+    // Called before a finished op returns to the pool
+    virtual void OnLocalOpFinished(LocalOp* op, const protocol::Message& response,
+                                   uint64_t metalog_progress, bool success) = 0;
+    // Called periodically to fail local reads exceeding their timeout
+    virtual void ExpireOngoingReads() = 0;
+    // Called periodically to hedge index tier reads exceeding their deadline
+    virtual void HedgeIndexTierReads() = 0;
 
     void LocalOpHandler(LocalOp* op);
 
     void ReplicateLogEntry(const View* view, const View::StorageShard* storage_shard, const LogMetaData& log_metadata,
                            std::span<const uint64_t> user_tags,
                            std::span<const char> log_data);
+    // Replicates a batch of log entries with contiguous localids in one message
+    void ReplicateLogBatch(const View* view, const View::StorageShard* storage_shard,
+                           const LogMetaData& start_log_metadata, size_t num_records,
+                           std::span<const char> records);
     void PropagateAuxData(const View* view, const View::StorageShard* storage_shard, const LogMetaData& log_metadata, 
                           std::span<const char> aux_data);
 
@@ -90,12 +110,19 @@ protected:
 
     void LogCachePut(const LogMetaData& log_metadata, std::span<const uint64_t> user_tags,
                      std::span<const char> log_data);
-    std::optional<LogEntry> LogCacheGet(uint64_t seqnum);
+    std::shared_ptr<const LogEntry> LogCacheGet(uint64_t seqnum);
     void LogCachePutAuxData(uint64_t seqnum, std::span<const char> data);
     std::optional<std::string> LogCacheGetAuxData(uint64_t seqnum);
+    uint64_t LogCacheNumEvictions() const;
 
     bool SendIndexTierReadRequest(uint16_t index_node_id, protocol::SharedLogMessage* request);
     bool SendStorageReadRequest(const IndexQueryResult& result, const View::StorageShard* storage_shard);
+    // Reads of all `found_results` go to the same storage node of `storage_shard`,
+    // returns the number of requests sent
+    size_t SendStorageReadRequests(const IndexQueryResult& result,
+                                   std::span<const IndexFoundResult> found_results,
+                                   std::span<const uint64_t> client_data,
+                                   const View::StorageShard* storage_shard);
     void SendReadResponse(const IndexQuery& query,
                           protocol::SharedLogMessage* response,
                           std::span<const char> user_tags_payload = EMPTY_CHAR_SPAN,
@@ -209,6 +236,9 @@ private:
     void SetupTimers();
 
     void PopulateLogTagsAndData(const protocol::Message& message, LocalOp* op);
+    bool PopulateAppendBatch(const protocol::Message& message, LocalOp* op);
+    // For APPEND_BATCH requests answered without populating an op
+    void RemoveAppendBatchShm(const protocol::Message& message);
 
     DISALLOW_COPY_AND_ASSIGN(EngineBase);
 };
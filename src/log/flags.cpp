@@ -2,6 +2,12 @@
 
 ABSL_FLAG(int, slog_local_cut_interval_us, 1000, "");
 ABSL_FLAG(int, slog_global_cut_interval_us, 1000, "");
+ABSL_FLAG(int, slog_global_cut_max_delay_us, 0,
+          "Max delay of cutting new logs, 0 cuts on every cut timer tick");
+ABSL_FLAG(size_t, slog_global_cut_max_entries, 1024,
+          "Cut before the max delay ends once so many entries are pending");
+ABSL_FLAG(int, slog_global_cut_max_inflight, 1,
+          "Max number of meta logs not yet replicated to backup sequencers");
 ABSL_FLAG(size_t, slog_log_space_hash_tokens, 128, "");
 ABSL_FLAG(size_t, slog_num_tail_metalog_entries, 32, "");
 
@@ -20,16 +26,49 @@ ABSL_FLAG(int, slog_engine_seqnum_cache_cap, 1000, "");
 ABSL_FLAG(int, slog_engine_seqnum_suffix_cap, 100000, "");
 ABSL_FLAG(int, slog_engine_tag_cache_cap, 1000000, "");
 ABSL_FLAG(int, slog_engine_per_tag_seqnums_limit, 10000, "");
+ABSL_FLAG(int, slog_engine_read_ahead_depth, 4,
+          "Seqnums prefetched ahead of sequential READ_NEXT cursors over tags, "
+          "0 disables read-ahead");
+ABSL_FLAG(bool, slog_engine_single_flight_reads, true,
+          "Identical concurrent local reads share a single in-flight read");
+ABSL_FLAG(int, slog_engine_read_timeout_ms, 30000,
+          "Local reads not completed within this timeout fail with DATA_LOST, "
+          "0 disables the timeout");
+ABSL_FLAG(bool, slog_engine_hedge_index_reads, true,
+          "Re-send index tier reads answered by a single replica to another "
+          "replica, if they exceed the p95 latency of the first one. Only "
+          "tag reads are answered by a single replica, so this takes effect "
+          "only with --slog_index_partition_by_tag");
+ABSL_FLAG(int, slog_engine_hedge_min_delay_us, 1000,
+          "Minimal delay before a hedged index tier read, also used for "
+          "replicas without latency estimates. Must be positive");
 
 ABSL_FLAG(std::string, slog_engine_postpone_registration, "", "");
 ABSL_FLAG(std::string, slog_engine_postpone_caching, "", "");
 
 ABSL_FLAG(int, slog_storage_cache_cap_mb, 1024, "");
 ABSL_FLAG(std::string, slog_storage_backend, "rocksdb",
-          "rocskdb, tkrzw_hash, tkrzw_tree, or tkrzw_skip");
+          "rocskdb, tkrzw_hash, tkrzw_tree, tkrzw_skip, or segment_file");
 ABSL_FLAG(int, slog_storage_bgthread_interval_ms, 1, "");
 ABSL_FLAG(size_t, slog_storage_max_live_entries, 65536, "");
+ABSL_FLAG(int, slog_storage_group_commit_window_us, 0,
+          "Max delay of persisting log entries, 0 flushes on every bgthread tick");
+ABSL_FLAG(size_t, slog_storage_group_commit_max_entries, 1024,
+          "Flush before the group commit window ends once so many entries are pending");
 
+ABSL_FLAG(int, slog_storage_db_read_threads, 2,
+          "Threads reading log entries from DB, 0 reads within IO workers");
 ABSL_FLAG(bool, slog_storage_index_tier_only, false, "");
+ABSL_FLAG(size_t, slog_storage_index_data_history, 4096,
+          "Recent index data packages kept per log space, resent to index "
+          "nodes restored from checkpoints. Checkpoints further behind "
+          "cannot catch up");
+
+ABSL_FLAG(int, slog_index_checkpoint_interval_sec, 10,
+          "Interval of checkpointing index shards, if index nodes have a checkpoint path");
+ABSL_FLAG(bool, slog_index_partition_by_tag, false,
+          "Partition tag indices across index shards by (user_logspace, tag), so that "
+          "tagged reads query a single shard. Must be the same on all nodes, and "
+          "the number of index shards must not change across views.");
 
 ABSL_FLAG(bool, slog_activate_min_seqnum_completion, false, "");
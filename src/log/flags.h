@@ -4,6 +4,9 @@
 
 ABSL_DECLARE_FLAG(int, slog_local_cut_interval_us);
 ABSL_DECLARE_FLAG(int, slog_global_cut_interval_us);
+ABSL_DECLARE_FLAG(int, slog_global_cut_max_delay_us);
+ABSL_DECLARE_FLAG(size_t, slog_global_cut_max_entries);
+ABSL_DECLARE_FLAG(int, slog_global_cut_max_inflight);
 ABSL_DECLARE_FLAG(size_t, slog_log_space_hash_tokens);
 ABSL_DECLARE_FLAG(size_t, slog_num_tail_metalog_entries);
 
@@ -22,6 +25,11 @@ ABSL_DECLARE_FLAG(int, slog_engine_seqnum_cache_cap);
 ABSL_DECLARE_FLAG(int, slog_engine_seqnum_suffix_cap);
 ABSL_DECLARE_FLAG(int, slog_engine_tag_cache_cap);
 ABSL_DECLARE_FLAG(int, slog_engine_per_tag_seqnums_limit);
+ABSL_DECLARE_FLAG(int, slog_engine_read_ahead_depth);
+ABSL_DECLARE_FLAG(bool, slog_engine_single_flight_reads);
+ABSL_DECLARE_FLAG(int, slog_engine_read_timeout_ms);
+ABSL_DECLARE_FLAG(bool, slog_engine_hedge_index_reads);
+ABSL_DECLARE_FLAG(int, slog_engine_hedge_min_delay_us);
 ABSL_DECLARE_FLAG(std::string, slog_engine_postpone_registration);
 ABSL_DECLARE_FLAG(std::string, slog_engine_postpone_caching);
 
@@ -29,7 +37,14 @@ ABSL_DECLARE_FLAG(int, slog_storage_cache_cap_mb);
 ABSL_DECLARE_FLAG(std::string, slog_storage_backend);
 ABSL_DECLARE_FLAG(int, slog_storage_bgthread_interval_ms);
 ABSL_DECLARE_FLAG(size_t, slog_storage_max_live_entries);
+ABSL_DECLARE_FLAG(int, slog_storage_group_commit_window_us);
+ABSL_DECLARE_FLAG(size_t, slog_storage_group_commit_max_entries);
+ABSL_DECLARE_FLAG(int, slog_storage_db_read_threads);
 
 ABSL_DECLARE_FLAG(bool, slog_storage_index_tier_only);
+ABSL_DECLARE_FLAG(size_t, slog_storage_index_data_history);
+
+ABSL_DECLARE_FLAG(int, slog_index_checkpoint_interval_sec);
+ABSL_DECLARE_FLAG(bool, slog_index_partition_by_tag);
 
 ABSL_DECLARE_FLAG(bool, slog_activate_min_seqnum_completion);
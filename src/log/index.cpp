@@ -22,13 +22,41 @@ PerSpaceIndex::PerSpaceIndex(uint32_t logspace_id, uint32_t user_logspace)
 
 void PerSpaceIndex::Add(uint32_t seqnum_lowhalf, uint16_t engine_id,
                                const UserTagVec& user_tags) {
-    DCHECK(!engine_ids_.contains(seqnum_lowhalf));
-    engine_ids_[seqnum_lowhalf] = engine_id;
     DCHECK(seqnums_.empty() || seqnum_lowhalf > seqnums_.back());
-    seqnums_.push_back(seqnum_lowhalf);
+    seqnums_.Append(seqnum_lowhalf, engine_id);
+    AddTags(seqnum_lowhalf, engine_id, user_tags);
+}
+
+void PerSpaceIndex::AddTags(uint32_t seqnum_lowhalf, uint16_t engine_id,
+                            const UserTagVec& user_tags) {
     for (uint64_t user_tag : user_tags) {
         DCHECK_NE(user_tag, kEmptyLogTag);
-        seqnums_by_tag_[user_tag].push_back(seqnum_lowhalf);
+        seqnums_by_tag_[user_tag].Append(seqnum_lowhalf, engine_id);
+    }
+}
+
+void PerSpaceIndex::Trim(uint64_t user_tag, uint64_t trim_seqnum) {
+    auto trim_prefix = [logspace_id = logspace_id_, trim_seqnum] (SeqnumList* seqnums) {
+        seqnums->RemovePrefix(seqnums->LowerBound(logspace_id, trim_seqnum));
+    };
+    if (user_tag != kEmptyLogTag) {
+        if (auto iter = seqnums_by_tag_.find(user_tag); iter != seqnums_by_tag_.end()) {
+            trim_prefix(&iter->second);
+            if (iter->second.empty()) {
+                seqnums_by_tag_.erase(iter);
+            }
+        }
+        return;
+    }
+    trim_prefix(&seqnums_);
+    auto iter = seqnums_by_tag_.begin();
+    while (iter != seqnums_by_tag_.end()) {
+        trim_prefix(&iter->second);
+        if (iter->second.empty()) {
+            seqnums_by_tag_.erase(iter++);
+        } else {
+            ++iter;
+        }
     }
 }
 
@@ -36,103 +64,141 @@ void PerSpaceIndex::Aggregate(size_t* num_seqnums, size_t* num_tags, size_t* num
     *num_seqnums += seqnums_.size();
     *num_tags += seqnums_by_tag_.size();
     size_t local_num_seqnums_of_tags = 0;
+    size_t seqnums_of_tags_size = 0;
     for (auto& [tag, seqnums] : seqnums_by_tag_){
         local_num_seqnums_of_tags += seqnums.size();
+        seqnums_of_tags_size += seqnums.memory_usage();
     }
     *num_seqnums_of_tags += local_num_seqnums_of_tags;
     *size += (
-          sizeof(uint32_t) * engine_ids_.size()         // seqnum keys for engine_ids
-        + sizeof(uint16_t) * engine_ids_.size()         // engine_ids
-        + sizeof(uint32_t) * seqnums_.size()            // seqnums
+          seqnums_.memory_usage()                       // seqnums and engine_ids
         + sizeof(uint64_t) * seqnums_by_tag_.size()     // tags
-        + sizeof(uint32_t) * local_num_seqnums_of_tags  // seqnums of tags
+        + seqnums_of_tags_size                          // seqnums of tags
     );
 }
 
-bool PerSpaceIndex::FindPrev(uint64_t query_seqnum, uint64_t user_tag,
-                                    uint64_t* seqnum, uint16_t* engine_id) const {
-    uint32_t seqnum_lowhalf;
-    if (user_tag == kEmptyLogTag) {
-        if (!FindPrev(seqnums_, query_seqnum, &seqnum_lowhalf)) {
-            return false;
-        }
-    } else {
-        if (!seqnums_by_tag_.contains(user_tag)) {
-            return false;
+std::unique_ptr<PerSpaceIndex> PerSpaceIndex::Clone() const {
+    auto index = std::make_unique<PerSpaceIndex>(logspace_id_, user_logspace_);
+    index->seqnums_ = seqnums_.Clone();
+    index->seqnums_by_tag_.reserve(seqnums_by_tag_.size());
+    for (const auto& [tag, seqnums] : seqnums_by_tag_) {
+        index->seqnums_by_tag_.emplace(tag, seqnums.Clone());
+    }
+    return index;
+}
+
+void PerSpaceIndex::EncodeTo(CheckpointWriter* writer) const {
+    writer->PutFixed32(user_logspace_);
+    EncodeSeqnums(seqnums_, writer);
+    writer->PutVarint(seqnums_by_tag_.size());
+    for (const auto& [tag, seqnums] : seqnums_by_tag_) {
+        writer->PutFixed64(tag);
+        EncodeSeqnums(seqnums, writer);
+    }
+}
+
+std::unique_ptr<PerSpaceIndex> PerSpaceIndex::DecodeFrom(uint32_t logspace_id,
+                                                         CheckpointReader* reader) {
+    uint32_t user_logspace;
+    if (!reader->GetFixed32(&user_logspace)) {
+        return nullptr;
+    }
+    auto index = std::make_unique<PerSpaceIndex>(logspace_id, user_logspace);
+    if (!DecodeSeqnums(reader, &index->seqnums_)) {
+        return nullptr;
+    }
+    size_t num_tags;
+    if (!reader->GetVarint(&num_tags)) {
+        return nullptr;
+    }
+    for (size_t i = 0; i < num_tags; i++) {
+        uint64_t tag;
+        if (!reader->GetFixed64(&tag) || tag == kEmptyLogTag
+                || index->seqnums_by_tag_.contains(tag)) {
+            return nullptr;
         }
-        if (!FindPrev(seqnums_by_tag_.at(user_tag), query_seqnum, &seqnum_lowhalf)) {
-            return false;
+        SeqnumList seqnums;
+        if (!DecodeSeqnums(reader, &seqnums) || seqnums.empty()) {
+            return nullptr;
         }
+        index->seqnums_by_tag_[tag] = std::move(seqnums);
     }
-    DCHECK(engine_ids_.contains(seqnum_lowhalf));
-    *seqnum = bits::JoinTwo32(logspace_id_, seqnum_lowhalf);
-    DCHECK_LE(*seqnum, query_seqnum);
-    *engine_id = engine_ids_.at(seqnum_lowhalf);
-    return true;
+    return index;
 }
 
-bool PerSpaceIndex::FindNext(uint64_t query_seqnum, uint64_t user_tag,
-                                    uint64_t* seqnum, uint16_t* engine_id) const {
-    uint32_t seqnum_lowhalf;
-    if (user_tag == kEmptyLogTag) {
-        if (!FindNext(seqnums_, query_seqnum, &seqnum_lowhalf)) {
-            return false;
-        }
-    } else {
-        if (!seqnums_by_tag_.contains(user_tag)) {
+// Seqnums are encoded as varint deltas, which are mostly 1 or 2 bytes,
+// each followed by its engine id
+void PerSpaceIndex::EncodeSeqnums(const SeqnumList& seqnums, CheckpointWriter* writer) {
+    writer->PutVarint(seqnums.size());
+    uint32_t prev_seqnum = 0;
+    for (size_t i = 0; i < seqnums.size(); i++) {
+        uint32_t seqnum = seqnums.at(i);
+        writer->PutVarint(seqnum - prev_seqnum);
+        prev_seqnum = seqnum;
+        writer->PutVarint(seqnums.payload_at(i));
+    }
+}
+
+bool PerSpaceIndex::DecodeSeqnums(CheckpointReader* reader, SeqnumList* seqnums) {
+    size_t num_seqnums;
+    if (!reader->GetVarint(&num_seqnums)) {
+        return false;
+    }
+    uint64_t seqnum = 0;
+    for (size_t i = 0; i < num_seqnums; i++) {
+        uint32_t delta;
+        uint16_t payload;
+        if (!reader->GetVarint(&delta) || (i > 0 && delta == 0)
+                || !reader->GetVarint(&payload)) {
             return false;
         }
-        if (!FindNext(seqnums_by_tag_.at(user_tag), query_seqnum, &seqnum_lowhalf)) {
+        seqnum += delta;
+        if (seqnum > std::numeric_limits<uint32_t>::max()) {
             return false;
         }
+        seqnums->Append(static_cast<uint32_t>(seqnum), payload);
     }
-    DCHECK(engine_ids_.contains(seqnum_lowhalf));
-    *seqnum = bits::JoinTwo32(logspace_id_, seqnum_lowhalf);
-    DCHECK_GE(*seqnum, query_seqnum);
-    *engine_id = engine_ids_.at(seqnum_lowhalf);
     return true;
 }
 
-bool PerSpaceIndex::FindPrev(const std::vector<uint32_t>& seqnums,
-                                    uint64_t query_seqnum, uint32_t* result_seqnum) const {
-    if (seqnums.empty() || bits::JoinTwo32(logspace_id_, seqnums.front()) > query_seqnum) {
+bool PerSpaceIndex::FindPrev(uint64_t query_seqnum, uint64_t user_tag,
+                             uint64_t* seqnum, uint16_t* engine_id) const {
+    const SeqnumList* seqnums = GetSeqnums(user_tag);
+    if (seqnums == nullptr) {
         return false;
     }
-    if (query_seqnum == kMaxLogSeqNum) {
-        *result_seqnum = seqnums.back();
-        return true;
-    }
-    auto iter = absl::c_upper_bound(
-        seqnums, query_seqnum,
-        [logspace_id = logspace_id_] (uint64_t lhs, uint32_t rhs) {
-            return lhs < bits::JoinTwo32(logspace_id, rhs);
-        }
-    );
-    if (iter == seqnums.begin()) {
+    size_t pos = seqnums->UpperBound(logspace_id_, query_seqnum);
+    if (pos == 0) {
         return false;
-    } else {
-        *result_seqnum = *(--iter);
-        return true;
     }
+    *seqnum = bits::JoinTwo32(logspace_id_, seqnums->at(pos - 1));
+    DCHECK_LE(*seqnum, query_seqnum);
+    *engine_id = seqnums->payload_at(pos - 1);
+    return true;
 }
 
-bool PerSpaceIndex::FindNext(const std::vector<uint32_t>& seqnums,
-                                    uint64_t query_seqnum, uint32_t* result_seqnum) const {
-    if (seqnums.empty() || bits::JoinTwo32(logspace_id_, seqnums.back()) < query_seqnum) {
+bool PerSpaceIndex::FindNext(uint64_t query_seqnum, uint64_t user_tag,
+                             uint64_t* seqnum, uint16_t* engine_id) const {
+    const SeqnumList* seqnums = GetSeqnums(user_tag);
+    if (seqnums == nullptr) {
         return false;
     }
-    auto iter = absl::c_lower_bound(
-        seqnums, query_seqnum,
-        [logspace_id = logspace_id_] (uint32_t lhs, uint64_t rhs) {
-            return bits::JoinTwo32(logspace_id, lhs) < rhs;
-        }
-    );
-    if (iter == seqnums.end()) {
+    size_t pos = seqnums->LowerBound(logspace_id_, query_seqnum);
+    if (pos == seqnums->size()) {
         return false;
-    } else {
-        *result_seqnum = *iter;
-        return true;
     }
+    *seqnum = bits::JoinTwo32(logspace_id_, seqnums->at(pos));
+    DCHECK_GE(*seqnum, query_seqnum);
+    *engine_id = seqnums->payload_at(pos);
+    return true;
+}
+
+const SeqnumList* PerSpaceIndex::GetSeqnums(uint64_t user_tag) const {
+    if (user_tag == kEmptyLogTag) {
+        return &seqnums_;
+    }
+    auto iter = seqnums_by_tag_.find(user_tag);
+    return iter != seqnums_by_tag_.end() ? &iter->second : nullptr;
 }
 
 void Index::MakeQuery(const IndexQuery& query) {
@@ -192,6 +258,17 @@ void Index::OnMetaLogApplied(const MetaLogProto& meta_log_proto) {
     }
 }
 
+void Index::OnTrim(uint32_t metalog_seqnum,
+                   uint32_t user_logspace, uint64_t user_tag,
+                   uint64_t trim_seqnum) {
+    if (!index_.contains(user_logspace)) {
+        return;
+    }
+    HVLOG_F(1, "Trim index of user logspace {} (tag {}) below seqnum {}",
+            user_logspace, user_tag, bits::HexStr0x(trim_seqnum));
+    index_.at(user_logspace)->Trim(user_tag, trim_seqnum);
+}
+
 void Index::OnFinalized(uint32_t metalog_position) {
     auto iter = pending_queries_.begin();
     while (iter != pending_queries_.end()) {
@@ -2,6 +2,8 @@
 
 #include "log/log_space_base.h"
 #include "log/index_dto.h"
+#include "log/seqnum_list.h"
+#include "log/index_checkpoint.h"
 
 namespace faas {
 namespace log {
@@ -11,7 +13,14 @@ public:
     PerSpaceIndex(uint32_t logspace_id, uint32_t user_logspace);
     ~PerSpaceIndex() {}
 
+    uint32_t user_logspace() const { return user_logspace_; }
+
     void Add(uint32_t seqnum_lowhalf, uint16_t engine_id, const UserTagVec& user_tags);
+    // Only adds the seqnum to lists of `user_tags`, for seqnums owned by
+    // another index shard
+    void AddTags(uint32_t seqnum_lowhalf, uint16_t engine_id, const UserTagVec& user_tags);
+    // Removes seqnums below `trim_seqnum`, of all tags if `user_tag` is empty
+    void Trim(uint64_t user_tag, uint64_t trim_seqnum);
 
     bool FindPrev(uint64_t query_seqnum, uint64_t user_tag,
                   uint64_t* seqnum, uint16_t* engine_id) const;
@@ -20,18 +29,26 @@ public:
 
     void Aggregate(size_t* num_seqnums, size_t* num_tags, size_t* num_seqnums_of_tags, size_t* size);
 
+    // Copy for encoding outside the lock of the index shard
+    std::unique_ptr<PerSpaceIndex> Clone() const;
+    void EncodeTo(CheckpointWriter* writer) const;
+    // Returns nullptr if the encoded index is malformed
+    static std::unique_ptr<PerSpaceIndex> DecodeFrom(uint32_t logspace_id,
+                                                     CheckpointReader* reader);
+
 private:
     uint32_t logspace_id_;
     uint32_t user_logspace_;
 
-    absl::flat_hash_map</* seqnum */ uint32_t, uint16_t> engine_ids_;
-    std::vector<uint32_t> seqnums_;
-    absl::flat_hash_map</* tag */ uint64_t, std::vector<uint32_t>> seqnums_by_tag_;
+    // Payloads of all lists are engine ids
+    SeqnumList seqnums_;
+    absl::flat_hash_map</* tag */ uint64_t, SeqnumList> seqnums_by_tag_;
 
-    bool FindPrev(const std::vector<uint32_t>& seqnums, uint64_t query_seqnum,
-                  uint32_t* result_seqnum) const;
-    bool FindNext(const std::vector<uint32_t>& seqnums, uint64_t query_seqnum,
-                  uint32_t* result_seqnum) const;
+    // Seqnums of `user_tag`, or all seqnums if `user_tag` is empty.
+    // Returns nullptr if there is none.
+    const SeqnumList* GetSeqnums(uint64_t user_tag) const;
+    static void EncodeSeqnums(const SeqnumList& seqnums, CheckpointWriter* writer);
+    static bool DecodeSeqnums(CheckpointReader* reader, SeqnumList* seqnums);
 
     DISALLOW_COPY_AND_ASSIGN(PerSpaceIndex);
 };
@@ -77,6 +94,9 @@ protected:
     virtual uint64_t index_metalog_progress() const = 0;
 
     void OnMetaLogApplied(const MetaLogProto& meta_log_proto) override;
+    void OnTrim(uint32_t metalog_seqnum,
+                uint32_t user_logspace, uint64_t user_tag,
+                uint64_t trim_seqnum) override;
     void OnFinalized(uint32_t metalog_position) override;
     PerSpaceIndex* GetOrCreateIndex(uint32_t user_logspace);
     void TryCreateIndex(uint32_t user_logspace);
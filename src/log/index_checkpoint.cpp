@@ -0,0 +1,119 @@
+#include "log/index_checkpoint.h"
+
+#include "utils/fs.h"
+#include "utils/io.h"
+#include "utils/hash.h"
+
+namespace faas {
+namespace log {
+
+namespace {
+static constexpr size_t kChecksumSize = sizeof(uint64_t);
+
+static uint64_t Checksum(const char* data, size_t size) {
+    return XXH64(data, size, hash::kDefaultHashSeed64);
+}
+}  // namespace
+
+CheckpointWriter::CheckpointWriter() {}
+
+CheckpointWriter::~CheckpointWriter() {}
+
+void CheckpointWriter::PutFixed32(uint32_t value) {
+    data_.append(reinterpret_cast<const char*>(&value), sizeof(uint32_t));
+}
+
+void CheckpointWriter::PutFixed64(uint64_t value) {
+    data_.append(reinterpret_cast<const char*>(&value), sizeof(uint64_t));
+}
+
+void CheckpointWriter::PutVarint(uint64_t value) {
+    while (value >= 0x80) {
+        data_.push_back(static_cast<char>((value & 0x7f) | 0x80));
+        value >>= 7;
+    }
+    data_.push_back(static_cast<char>(value));
+}
+
+std::string CheckpointWriter::Finish() {
+    PutFixed64(Checksum(data_.data(), data_.size()));
+    return std::move(data_);
+}
+
+CheckpointReader::CheckpointReader(std::span<const char> data)
+    : pos_(data.data()),
+      end_(data.data()),
+      valid_(false) {
+    if (data.size() < kChecksumSize) {
+        return;
+    }
+    end_ = data.data() + data.size() - kChecksumSize;
+    uint64_t checksum;
+    memcpy(&checksum, end_, kChecksumSize);
+    valid_ = (checksum == Checksum(pos_, data.size() - kChecksumSize));
+}
+
+CheckpointReader::~CheckpointReader() {}
+
+bool CheckpointReader::GetFixed32(uint32_t* value) {
+    if (end_ - pos_ < static_cast<ptrdiff_t>(sizeof(uint32_t))) {
+        return false;
+    }
+    memcpy(value, pos_, sizeof(uint32_t));
+    pos_ += sizeof(uint32_t);
+    return true;
+}
+
+bool CheckpointReader::GetFixed64(uint64_t* value) {
+    if (end_ - pos_ < static_cast<ptrdiff_t>(sizeof(uint64_t))) {
+        return false;
+    }
+    memcpy(value, pos_, sizeof(uint64_t));
+    pos_ += sizeof(uint64_t);
+    return true;
+}
+
+bool CheckpointReader::GetVarint(uint64_t* value) {
+    uint64_t result = 0;
+    for (int shift = 0; shift < 64 && pos_ < end_; shift += 7) {
+        uint8_t byte = static_cast<uint8_t>(*pos_++);
+        result |= uint64_t{byte & 0x7fU} << shift;
+        if ((byte & 0x80) == 0) {
+            *value = result;
+            return true;
+        }
+    }
+    return false;
+}
+
+std::string IndexCheckpointPath(std::string_view checkpoint_dir, uint32_t logspace_id) {
+    return fs_utils::JoinPath(checkpoint_dir, fmt::format("index_{:08x}.ckpt", logspace_id));
+}
+
+bool WriteIndexCheckpoint(std::string_view path, std::span<const char> data) {
+    std::string tmp_path = fmt::format("{}.tmp", path);
+    auto fd = fs_utils::Create(tmp_path);
+    if (!fd.has_value()) {
+        return false;
+    }
+    bool success = io_utils::WriteData(*fd, data) && fsync(*fd) == 0;
+    close(*fd);
+    if (!success) {
+        PLOG_F(ERROR, "Failed to write {}", tmp_path);
+        fs_utils::Remove(tmp_path);
+        return false;
+    }
+    if (rename(tmp_path.c_str(), std::string(path).c_str()) != 0) {
+        PLOG_F(ERROR, "Failed to rename {} to {}", tmp_path, path);
+        return false;
+    }
+    // The rename itself is durable only once the directory is synced
+    std::string_view dir = ".";
+    if (size_t pos = path.find_last_of('/'); pos != std::string_view::npos) {
+        dir = (pos == 0) ? "/" : path.substr(0, pos);
+    }
+    return fs_utils::SyncDirectory(dir);
+}
+
+}  // namespace log
+}  // namespace faas
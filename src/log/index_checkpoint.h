@@ -0,0 +1,67 @@
+#pragma once
+
+#include "log/common.h"
+
+namespace faas {
+namespace log {
+
+// Index checkpoints are a sequence of fixed-width little-endian integers and
+// varints, followed by an xxHash64 checksum of everything before it
+class CheckpointWriter {
+public:
+    CheckpointWriter();
+    ~CheckpointWriter();
+
+    void PutFixed32(uint32_t value);
+    void PutFixed64(uint64_t value);
+    void PutVarint(uint64_t value);
+
+    // Appends the checksum and returns the encoded checkpoint
+    std::string Finish();
+
+private:
+    std::string data_;
+
+    DISALLOW_COPY_AND_ASSIGN(CheckpointWriter);
+};
+
+class CheckpointReader {
+public:
+    // `data` should outlive the reader
+    explicit CheckpointReader(std::span<const char> data);
+    ~CheckpointReader();
+
+    // False if the checksum mismatches
+    bool valid() const { return valid_; }
+    // True if all data before the checksum is consumed
+    bool done() const { return pos_ == end_; }
+
+    // All getters return false on truncated data or out-of-range values
+    bool GetFixed32(uint32_t* value);
+    bool GetFixed64(uint64_t* value);
+    bool GetVarint(uint64_t* value);
+
+    template<class T>
+    bool GetVarint(T* value) {
+        uint64_t tmp;
+        if (!GetVarint(&tmp) || tmp > std::numeric_limits<T>::max()) {
+            return false;
+        }
+        *value = static_cast<T>(tmp);
+        return true;
+    }
+
+private:
+    const char* pos_;
+    const char* end_;
+    bool valid_;
+
+    DISALLOW_COPY_AND_ASSIGN(CheckpointReader);
+};
+
+std::string IndexCheckpointPath(std::string_view checkpoint_dir, uint32_t logspace_id);
+// Writes to a temporary file first, so a crash never leaves a partial checkpoint
+bool WriteIndexCheckpoint(std::string_view path, std::span<const char> data);
+
+}  // namespace log
+}  // namespace faas
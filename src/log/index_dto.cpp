@@ -7,6 +7,7 @@ IndexQuery::ReadDirection IndexQuery::DirectionFromOpType(protocol::SharedLogOpT
     switch (op_type) {
     case protocol::SharedLogOpType::READ_NEXT:
     case protocol::SharedLogOpType::READ_NEXT_INDEX_RESULT:
+    case protocol::SharedLogOpType::READ_RANGE:
         return IndexQuery::kReadNext;
     case protocol::SharedLogOpType::READ_PREV:
     case protocol::SharedLogOpType::READ_PREV_INDEX_RESULT:
@@ -1,54 +1,120 @@
 #include "log/index_local_seq_cache.h"
 
 #include "log/utils.h"
-
-__BEGIN_THIRD_PARTY_HEADERS
-#include <tkrzw_dbm_cache.h>
-__END_THIRD_PARTY_HEADERS
+#include "utils/hash.h"
 
 namespace faas {
 namespace log {
 
 SeqnumCache::SeqnumCache(int cap_num_rec)
-    {
-        dbm_.reset(new tkrzw::CacheDBM(int64_t{cap_num_rec}, -1));
-        log_header_ = "SeqnumCache: ";
+    : log_header_("SeqnumCache: "),
+      num_seqnums_(0) {
+    size_t num_groups = 1;
+    if (cap_num_rec > 0) {
+        num_groups = std::max<size_t>(
+            1, (static_cast<size_t>(cap_num_rec) + kSlotsPerGroup - 1) / kSlotsPerGroup);
+    }
+    absl::MutexLock lk(&mu_);
+    groups_.resize(num_groups);
+    for (Group& group : groups_) {
+        ClearGroup(&group);
     }
+}
 
 SeqnumCache::~SeqnumCache() {}
 
 void SeqnumCache::Put(uint64_t seqnum, uint16_t storage_shard_id){
-    std::string key_str = fmt::format("0_{:016x}", seqnum);
-    std::string data = fmt::format("{}", storage_shard_id);
+    DCHECK_NE(seqnum, kInvalidLogSeqNum);
     HVLOG_F(1, "Put seqnum={} in cache", bits::HexStr0x(seqnum));
-    dbm_->Set(key_str, data, false);
+    absl::MutexLock lk(&mu_);
+    size_t home = HomeGroup(seqnum);
+    Group* empty_group = nullptr;
+    size_t empty_slot = 0;
+    for (size_t i = 0; i < kProbeGroups; i++) {
+        Group* group = &groups_[(home + i) % groups_.size()];
+        for (size_t j = 0; j < kSlotsPerGroup; j++) {
+            if (group->seqnums[j] == seqnum) {
+                // Keep the existing record
+                return;
+            }
+            if (empty_group == nullptr && group->seqnums[j] == kInvalidLogSeqNum) {
+                empty_group = group;
+                empty_slot = j;
+            }
+        }
+    }
+    if (empty_group == nullptr) {
+        // CLOCK over the probe window, starting from the hand kept in the
+        // home group: clear referenced bits until finding an unreferenced
+        // slot, which must exist in the second round
+        constexpr size_t kWindowSlots = kProbeGroups * kSlotsPerGroup;
+        Group* home_group = &groups_[home];
+        size_t pos = home_group->clock_hand;
+        for (size_t step = 0; step < 2 * kWindowSlots; step++, pos = (pos + 1) % kWindowSlots) {
+            Group* group = &groups_[(home + pos / kSlotsPerGroup) % groups_.size()];
+            uint8_t mask = uint8_t{1} << (pos % kSlotsPerGroup);
+            if (group->referenced_bits & mask) {
+                group->referenced_bits &= ~mask;
+            } else {
+                empty_group = group;
+                empty_slot = pos % kSlotsPerGroup;
+                break;
+            }
+        }
+        home_group->clock_hand = gsl::narrow_cast<uint8_t>((pos + 1) % kWindowSlots);
+        DCHECK(empty_group != nullptr);
+        num_seqnums_--;
+    }
+    empty_group->seqnums[empty_slot] = seqnum;
+    empty_group->storage_shard_ids[empty_slot] = storage_shard_id;
+    empty_group->referenced_bits &= ~(uint8_t{1} << empty_slot);
+    num_seqnums_++;
 }
 
 bool SeqnumCache::Get(uint64_t seqnum, uint16_t* storage_shard_id){
-    std::string key_str = fmt::format("0_{:016x}", seqnum);
-    std::string data;
-    auto status = dbm_->Get(key_str, &data);
-    if (status.IsOK()){
-        int parsed_storage_shard_id;
-        if(!absl::SimpleAtoi(data.c_str(), &parsed_storage_shard_id)){
-            LOG(FATAL) << "Cannot parse storage shard id";
+    absl::MutexLock lk(&mu_);
+    size_t home = HomeGroup(seqnum);
+    for (size_t i = 0; i < kProbeGroups; i++) {
+        Group* group = &groups_[(home + i) % groups_.size()];
+        for (size_t j = 0; j < kSlotsPerGroup; j++) {
+            if (group->seqnums[j] == seqnum) {
+                group->referenced_bits |= uint8_t{1} << j;
+                *storage_shard_id = group->storage_shard_ids[j];
+                return true;
+            }
         }
-        *storage_shard_id = gsl::narrow_cast<uint16_t>(parsed_storage_shard_id);
-        return true;
-    } else {
-        return false;
     }
+    return false;
 }
 
 void SeqnumCache::Clear(){
-    dbm_->Clear();
+    absl::MutexLock lk(&mu_);
+    for (Group& group : groups_) {
+        ClearGroup(&group);
+    }
+    num_seqnums_ = 0;
 }
 
 void SeqnumCache::Aggregate(size_t* num_seqnums, size_t* size){
-    int64_t num_records = 0;
-    dbm_->Count(&num_records);
-    *num_seqnums = gsl::narrow_cast<size_t>(num_records);
-    *size = gsl::narrow_cast<size_t>(dbm_->GetEffectiveDataSize());
+    absl::MutexLock lk(&mu_);
+    *num_seqnums = num_seqnums_;
+    *size = groups_.size() * sizeof(Group);
+}
+
+size_t SeqnumCache::HomeGroup(uint64_t seqnum) const {
+    // Map the hash to [0, num_groups) without a division
+    uint64_t hash = hash::xxHash64(seqnum);
+    return static_cast<size_t>(
+        (static_cast<unsigned __int128>(hash) * groups_.size()) >> 64);
+}
+
+void SeqnumCache::ClearGroup(Group* group) {
+    for (size_t j = 0; j < kSlotsPerGroup; j++) {
+        group->seqnums[j] = kInvalidLogSeqNum;
+        group->storage_shard_ids[j] = 0;
+    }
+    group->referenced_bits = 0;
+    group->clock_hand = 0;
 }
 
 IndexQueryResult SeqnumCache::MakeQuery(const IndexQuery& query){
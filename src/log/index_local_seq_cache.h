@@ -2,12 +2,13 @@
 
 #include "log/index_dto.h"
 
-// Forward declarations
-namespace tkrzw { class CacheDBM; }
-
 namespace faas {
 namespace log {
 
+// Fixed-capacity map from seqnum to storage shard id. Entries are kept in an
+// open-addressing table, where each cache line holds a group of slots. A
+// seqnum may be stored in its home group or in the next (kProbeGroups - 1)
+// groups; when all of them are full, a victim is picked with CLOCK.
 class SeqnumCache {
 public:
     explicit SeqnumCache(int cap_num_rec);
@@ -20,9 +21,26 @@ public:
     IndexQueryResult MakeQuery(const IndexQuery& query);
 
 private:
-    std::unique_ptr<tkrzw::CacheDBM> dbm_;
+    static constexpr size_t kSlotsPerGroup = 5;
+    static constexpr size_t kProbeGroups = 2;
+
+    struct alignas(64) Group {
+        uint64_t seqnums[kSlotsPerGroup];
+        uint16_t storage_shard_ids[kSlotsPerGroup];
+        uint8_t  referenced_bits;
+        uint8_t  clock_hand;  // Next slot to check in the probe window from this group
+    };
+    static_assert(sizeof(Group) == 64, "Group should fit in one cache line");
+
     std::string log_header_;
 
+    absl::Mutex mu_;
+    std::vector<Group> groups_ ABSL_GUARDED_BY(mu_);
+    size_t num_seqnums_        ABSL_GUARDED_BY(mu_);
+
+    size_t HomeGroup(uint64_t seqnum) const ABSL_EXCLUSIVE_LOCKS_REQUIRED(mu_);
+    void ClearGroup(Group* group);
+
     IndexQueryResult BuildFoundResult(const IndexQuery& query, uint64_t seqnum, uint16_t storage_shard_id);
     IndexQueryResult BuildMissResult(const IndexQuery& query);
 
@@ -30,4 +48,4 @@ private:
 };
 
 }  // namespace log
-}  // namespace faas
\ No newline at end of file
+}  // namespace faas
@@ -18,16 +18,15 @@ SeqnumSuffixChain::~SeqnumSuffixChain() {}
 
 void SeqnumSuffixChain::Extend(const View* view, uint32_t metalog_position){
     uint16_t id = view->id();
-    DCHECK(suffix_chain_.count(id) == 0);
     if (!IsEmpty()){
-        DCHECK(suffix_chain_.begin()->first < id);
+        DCHECK(suffix_chain_.back()->view_id() < id);
     }
     HVLOG_F(1, "Extend chain with link for view {}", id);
-    suffix_chain_.emplace(id, std::make_unique<SeqnumSuffixLink>(view, sequence_number_id_, metalog_position));
+    suffix_chain_.push_back(std::make_unique<SeqnumSuffixLink>(view, sequence_number_id_, metalog_position));
 }
 
 void SeqnumSuffixChain::Clear(){
-    for (auto& [id, chain_member] : suffix_chain_) {
+    for (auto& chain_member : suffix_chain_) {
         chain_member->Clear();
     }
     current_entries_ = 0;
@@ -36,18 +35,17 @@ void SeqnumSuffixChain::Clear(){
 void SeqnumSuffixChain::Trim(size_t* counter){
     DCHECK(!suffix_chain_.empty());
     HVLOG_F(1, "Trim {} entries from chain", *counter);
-    auto it = suffix_chain_.begin();
-    while(it != suffix_chain_.end()){
-        size_t entries = it->second->NumEntries();
+    while(!suffix_chain_.empty()){
+        size_t entries = suffix_chain_.front()->NumEntries();
         if(*counter < entries){
             break;
         }
-        HVLOG_F(1, "Trim link {} completely", it->first);
-        it = suffix_chain_.erase(it);
+        HVLOG_F(1, "Trim link {} completely", suffix_chain_.front()->view_id());
+        suffix_chain_.pop_front();
         *counter -= entries;
     }
-    if(it != suffix_chain_.end()){
-        it->second->Trim(counter);
+    if(!suffix_chain_.empty()){
+        suffix_chain_.front()->Trim(counter);
     }
 }
 
@@ -56,7 +54,9 @@ uint64_t SeqnumSuffixChain::ProvideMetaLog(const MetaLogProto& metalog_proto){
         HLOG(WARNING) << "Chain has no links";
         return 0;
     }
-    if((--suffix_chain_.end())->second->ProvideMetaLog(metalog_proto)){
+    // TRIM meta logs advance the position, but create no link entry
+    if(suffix_chain_.back()->ProvideMetaLog(metalog_proto)
+            && metalog_proto.type() == MetaLogProto::NEW_LOGS){
         current_entries_++;
     }
     auto iter = pending_queries_.begin();
@@ -104,6 +104,38 @@ void SeqnumSuffixChain::MakeQuery(const IndexQuery& query) {
     pending_query_results_.push_back(ProcessQuery(query));
 }
 
+void SeqnumSuffixChain::GetNextSeqnums(uint64_t seqnum, size_t max_count,
+                                       std::vector<IndexFoundResult>* results) {
+    // Seqnums are dense within each link, so following seqnums are found one by one
+    uint64_t query_seqnum = seqnum + 1;
+    size_t count = 0;
+    for (auto it = LinkLowerBound(log_utils::GetViewId(seqnum));
+             it != suffix_chain_.end() && count < max_count; ++it) {
+        SeqnumSuffixLink* link = it->get();
+        if (link->IsEmpty()) {
+            continue;
+        }
+        uint64_t head, tail;
+        uint16_t storage_shard_id;
+        link->GetHead(&head, &storage_shard_id);
+        link->GetTail(&tail, &storage_shard_id);
+        for (query_seqnum = std::max(query_seqnum, head);
+                 query_seqnum <= tail && count < max_count; query_seqnum++) {
+            uint64_t found_seqnum;
+            if (!link->FindNext(query_seqnum, &found_seqnum, &storage_shard_id)) {
+                break;
+            }
+            results->push_back(IndexFoundResult {
+                .view_id = link->view_id(),
+                .storage_shard_id = storage_shard_id,
+                .seqnum = found_seqnum
+            });
+            count++;
+            query_seqnum = found_seqnum;
+        }
+    }
+}
+
 void SeqnumSuffixChain::PollQueryResults(QueryResultVec* results) {
     if (pending_query_results_.empty()) {
         return;
@@ -120,8 +152,8 @@ void SeqnumSuffixChain::PollQueryResults(QueryResultVec* results) {
 
 void SeqnumSuffixChain::Aggregate(size_t* link_entries, size_t* range_entries, size_t* size){
     for (const auto& chain_member : suffix_chain_){
-        chain_member.second->Aggregate(link_entries, range_entries, size);      // member
-        size += sizeof(uint16_t) * 1;                                           // key
+        chain_member->Aggregate(link_entries, range_entries, size);
+        *size += sizeof(chain_member);
     }
 }
 
@@ -144,8 +176,17 @@ bool SeqnumSuffixChain::IsEmpty(){
     return suffix_chain_.empty();
 }
 
+SeqnumSuffixChain::SuffixLinkVec::iterator SeqnumSuffixChain::LinkLowerBound(uint16_t view_id){
+    return std::lower_bound(
+        suffix_chain_.begin(), suffix_chain_.end(), view_id,
+        [] (const std::unique_ptr<SeqnumSuffixLink>& link, uint16_t view_id) {
+            return link->view_id() < view_id;
+        }
+    );
+}
+
 bool SeqnumSuffixChain::GetHead(uint64_t* seqnum, uint16_t* storage_shard_id){
-    for(auto& [view_id, entry] : suffix_chain_){
+    for(auto& entry : suffix_chain_){
         if(!entry->IsEmpty()){
             entry->GetHead(seqnum, storage_shard_id);
             HVLOG_F(1, "SuffixRead: Suffix chain head at {}", bits::HexStr0x(*seqnum));
@@ -157,8 +198,8 @@ bool SeqnumSuffixChain::GetHead(uint64_t* seqnum, uint16_t* storage_shard_id){
 
 bool SeqnumSuffixChain::GetTail(uint64_t* seqnum, uint16_t* storage_shard_id){
     for(auto it = suffix_chain_.rbegin(); it != suffix_chain_.rend(); ++it){
-        if(!it->second->IsEmpty()){
-            it->second->GetTail(seqnum, storage_shard_id);
+        if(!(*it)->IsEmpty()){
+            (*it)->GetTail(seqnum, storage_shard_id);
             HVLOG_F(1, "SuffixRead: Suffix chain tail at {}", bits::HexStr0x(*seqnum));
             return true;
         }
@@ -209,11 +250,11 @@ IndexQueryResult SeqnumSuffixChain::ProcessReadNext(const IndexQuery& query){
     // invariant: seqnum lies within suffix head and tail
     uint16_t query_view_id = log_utils::GetViewId(query.query_seqnum);
     SeqnumSuffixLink* suffix_seq_lower = nullptr;
-    auto it = suffix_chain_.lower_bound(query_view_id);
+    auto it = LinkLowerBound(query_view_id);
     // get lower
     while (it != suffix_chain_.end()){
-        if(!it->second->IsEmpty()){
-            suffix_seq_lower = it->second.get();
+        if(!(*it)->IsEmpty()){
+            suffix_seq_lower = it->get();
             ++it;
             break;
         }
@@ -236,9 +277,9 @@ IndexQueryResult SeqnumSuffixChain::ProcessReadNext(const IndexQuery& query){
     // get upper
     SeqnumSuffixLink* suffix_seq_upper = nullptr;
     while (it != suffix_chain_.end()){
-        if(!it->second->IsEmpty()){
+        if(!(*it)->IsEmpty()){
             HVLOG(1) << "SuffixRead: Assign upper link";
-            suffix_seq_upper = it->second.get();
+            suffix_seq_upper = it->get();
             break;
         }
         ++it;
@@ -283,18 +324,18 @@ IndexQueryResult SeqnumSuffixChain::ProcessReadPrev(const IndexQuery& query){
     // invariant: seqnum lies within suffix head and tail
     uint16_t query_view_id = log_utils::GetViewId(query.query_seqnum);
     SeqnumSuffixLink* suffix_link_upper = nullptr;
-    auto it = suffix_chain_.lower_bound(query_view_id);
+    auto it = LinkLowerBound(query_view_id);
     // get upper
     while (it != suffix_chain_.begin()){
-        if(!it->second->IsEmpty()){
-            suffix_link_upper = it->second.get();
+        if(it != suffix_chain_.end() && !(*it)->IsEmpty()){
+            suffix_link_upper = it->get();
             break;
         }
         --it;
     }
     if(suffix_link_upper == nullptr && it == suffix_chain_.begin()){
-        if(!it->second->IsEmpty()){
-            suffix_link_upper = it->second.get();
+        if(!(*it)->IsEmpty()){
+            suffix_link_upper = it->get();
         }
     }
     if(suffix_link_upper == nullptr) {
@@ -313,7 +354,7 @@ IndexQueryResult SeqnumSuffixChain::ProcessReadPrev(const IndexQuery& query){
     }
     // lower not necessary because trimmed and contigous
     HVLOG(1) << "SuffixRead: Not in upper and lower is trimmed -> Miss";
-    DCHECK_EQ(suffix_link_upper->view_id(), suffix_chain_.begin()->first);
+    DCHECK_EQ(suffix_link_upper->view_id(), suffix_chain_.front()->view_id());
     return BuildMissResult(query);
 }
 
@@ -376,7 +417,9 @@ IndexQueryResult SeqnumSuffixChain::BuildEmptyResult(const IndexQuery& query) {
 }
 
 SeqnumSuffixLink::SeqnumSuffixLink(const View* view, uint16_t sequencer_id, uint32_t metalog_position)
-    : LogSpaceBase(LogSpaceBase::kLogSuffix, view, sequencer_id)
+    : LogSpaceBase(LogSpaceBase::kLogSuffix, view, sequencer_id),
+      head_skip_(0),
+      num_entries_(0)
     {
     log_header_ = fmt::format("SeqnumSuffixLink[{}-{}]: ", view->id(), sequencer_id);
     state_ = kNormal;
@@ -385,54 +428,10 @@ SeqnumSuffixLink::SeqnumSuffixLink(const View* view, uint16_t sequencer_id, uint
 
 SeqnumSuffixLink::~SeqnumSuffixLink() {}
 
-namespace {
-static inline uint16_t FindStorageShardIdInLinkEntry(uint32_t key_seqnum, const LinkEntry entry, uint32_t query_seqnum) {
-    if (query_seqnum > key_seqnum) {
-        UNREACHABLE();
-    }
-    if (query_seqnum == key_seqnum) {
-        return entry.storage_shard_ids_.back();
-    }
-    uint16_t diff = gsl::narrow_cast<uint16_t>(key_seqnum-query_seqnum);
-    if (diff == 0) {
-        UNREACHABLE();
-    }
-//     size_t ix = entry.key_diffs_.size() - 1;
-//     for (auto it = entry.key_diffs_.rbegin(); it != entry.key_diffs_.rend(); ++it)
-//     {
-//         if (*it - diff == 0){
-//             return entry.storage_shard_ids_.at(ix);
-//         }
-//         if (*it >= diff) {
-//             ix++;
-//             return entry.storage_shard_ids_.at(ix);
-//         }
-//         ix--;
-//     }
-//    return entry.storage_shard_ids_.front();
-
-    auto it = std::lower_bound(entry.key_diffs_.rbegin(), entry.key_diffs_.rend(), diff);
-    if (it == entry.key_diffs_.rend()){
-        // this is ok otherwise we would be in previous LinkEntry
-        return entry.storage_shard_ids_.front();
-    }
-    if (*it - diff == 0){
-        size_t ix = gsl::narrow_cast<size_t>(std::distance(entry.key_diffs_.rbegin(), it));
-        return entry.storage_shard_ids_.at(entry.storage_shard_ids_.size()-1-ix);
-    }
-    if (1 < entry.storage_shard_ids_.size()){
-        it--;
-        size_t ix = gsl::narrow_cast<size_t>(std::distance(entry.key_diffs_.rbegin(), it));
-        return entry.storage_shard_ids_.at(entry.storage_shard_ids_.size()-1-ix);
-    } else {
-        UNREACHABLE();
-    }
-}
-} // namespace
-
 bool SeqnumSuffixLink::IsEmpty() {
-    return entries_.empty();
+    return num_entries_ == 0;
 }
+
 void SeqnumSuffixLink::OnNewLogs(std::vector<std::pair<uint16_t, uint32_t>> productive_shards) {
     DCHECK(!productive_shards.empty());
     uint32_t seqnum_key = productive_shards.back().second;
@@ -440,78 +439,127 @@ void SeqnumSuffixLink::OnNewLogs(std::vector<std::pair<uint16_t, uint32_t>> prod
     HVLOG_F(1, "New logs received. seqnum_key={}, prod_shards={}, highest_prod_shard={}", 
      bits::HexStr0x(seqnum_key), productive_shards.size(), highest_productive_shard
     );
-    DCHECK(1 <= productive_shards.size());
-    entries_.emplace_hint(
-        entries_.end(),
-        std::piecewise_construct,
-        std::forward_as_tuple(seqnum_key),
-        std::forward_as_tuple(productive_shards)
-    );
+    if (chunks_.empty() || chunks_.back().keys.size() == kChunkSize
+            || chunks_.back().storage_shard_ids.size() + productive_shards.size()
+                   > std::numeric_limits<uint16_t>::max()) {
+        if (!chunks_.empty()) {
+            chunks_.back().storage_shard_ids.shrink_to_fit();
+            chunks_.back().key_diffs.shrink_to_fit();
+        }
+        chunks_.emplace_back();
+        chunks_.back().keys.reserve(kChunkSize);
+        chunks_.back().ends.reserve(kChunkSize);
+        chunk_last_keys_.push_back(seqnum_key);
+    }
+    Chunk& chunk = chunks_.back();
+    DCHECK(chunk.keys.empty() || chunk.keys.back() < seqnum_key);
+    for (const auto& [storage_shard_id, seqnum] : productive_shards) {
+        DCHECK_LE(seqnum, seqnum_key);
+        chunk.storage_shard_ids.push_back(storage_shard_id);
+        chunk.key_diffs.push_back(gsl::narrow_cast<uint16_t>(seqnum_key - seqnum));
+    }
+    chunk.keys.push_back(seqnum_key);
+    chunk.ends.push_back(gsl::narrow_cast<uint16_t>(chunk.storage_shard_ids.size()));
+    chunk_last_keys_.back() = seqnum_key;
+    num_entries_++;
 }
 
 void SeqnumSuffixLink::Clear(){
-    entries_.clear();
+    chunks_.clear();
+    chunk_last_keys_.clear();
+    head_skip_ = 0;
+    num_entries_ = 0;
 }
 
 void SeqnumSuffixLink::Trim(size_t* counter){
-    if (entries_.empty()){
+    if (IsEmpty()){
         return;
     }
     HVLOG_F(1, "Trim at most {} entries", *counter);
-    auto it = entries_.begin();
-    size_t c = *counter;
-    size_t r = 0;
-    while(r != c && it != entries_.end()){
-        it = entries_.erase(it);
-        r++;
-    }
+    size_t r = std::min(*counter, num_entries_);
+    head_skip_ += r;
+    num_entries_ -= r;
     *counter -= r;
+    // Drop chunks of which all entries are trimmed
+    while (!chunks_.empty() && chunks_.front().keys.size() <= head_skip_) {
+        head_skip_ -= chunks_.front().keys.size();
+        chunks_.pop_front();
+        chunk_last_keys_.pop_front();
+    }
 }
 
 size_t SeqnumSuffixLink::NumEntries(){
-    return entries_.size();
+    return num_entries_;
 }
 
 void SeqnumSuffixLink::Aggregate(size_t* num_link_entries, size_t* num_range_entries, size_t* size){
-    *num_link_entries += entries_.size();
-    for(auto entry : entries_){
-        *num_range_entries += entry.second.storage_shard_ids_.size();
+    *num_link_entries += num_entries_;
+    *size += sizeof(uint32_t) * chunk_last_keys_.size();                    // chunk index
+    for (size_t i = 0; i < chunks_.size(); i++) {
+        const Chunk& chunk = chunks_[i];
+        size_t num_trimmed = (i == 0) ? EntryBegin(chunk, head_skip_) : 0;
+        *num_range_entries += chunk.storage_shard_ids.size() - num_trimmed;
         *size += (
-              sizeof(uint32_t) * 1                                          // key
-            + sizeof(uint16_t) * entry.second.storage_shard_ids_.size()     // productive shards
-            + sizeof(uint16_t) * entry.second.key_diffs_.size()              // relative seqnums
+              sizeof(Chunk)
+            + sizeof(uint32_t) * chunk.keys.capacity()                      // keys
+            + sizeof(uint16_t) * chunk.ends.capacity()                      // entry ends
+            + sizeof(uint16_t) * chunk.storage_shard_ids.capacity()         // productive shards
+            + sizeof(uint16_t) * chunk.key_diffs.capacity()                 // relative seqnums
         );
     }
 }
 
 void SeqnumSuffixLink::GetHead(uint64_t* seqnum, uint16_t* storage_shard_id){
     // the head is the bound of the lowest productive shard of the first entry
-    DCHECK(!entries_.empty());
-    uint32_t key = entries_.begin()->first;
-    LinkEntry entry = entries_.begin()->second;
-    if(0 < entry.key_diffs_.size()){
-        *seqnum = bits::JoinTwo32(identifier(), key - uint32_t(entry.key_diffs_.front()));
-        *storage_shard_id = entry.storage_shard_ids_.front();
-    } else {
-        *seqnum = bits::JoinTwo32(identifier(), key);
-        *storage_shard_id = entry.storage_shard_ids_.back();
-    }
+    DCHECK(!IsEmpty());
+    const Chunk& chunk = chunks_.front();
+    size_t begin = EntryBegin(chunk, head_skip_);
+    *seqnum = bits::JoinTwo32(identifier(), chunk.keys[head_skip_] - uint32_t{chunk.key_diffs[begin]});
+    *storage_shard_id = chunk.storage_shard_ids[begin];
 }
 
 void SeqnumSuffixLink::GetTail(uint64_t* seqnum, uint16_t* storage_shard_id){
-    DCHECK(!entries_.empty());
-    uint32_t key = (--entries_.end())->first;
-    LinkEntry entry = (--entries_.end())->second;
-    *seqnum = bits::JoinTwo32(identifier(), key);
-    *storage_shard_id = entry.storage_shard_ids_.back();
-    return;
+    DCHECK(!IsEmpty());
+    const Chunk& chunk = chunks_.back();
+    *seqnum = bits::JoinTwo32(identifier(), chunk.keys.back());
+    *storage_shard_id = chunk.storage_shard_ids.back();
+}
+
+bool SeqnumSuffixLink::LocateEntry(uint32_t local_seqnum, const Chunk** chunk, size_t* idx) const {
+    auto chunk_iter = absl::c_lower_bound(chunk_last_keys_, local_seqnum);
+    if (chunk_iter == chunk_last_keys_.end()) {
+        return false;
+    }
+    size_t chunk_idx = gsl::narrow_cast<size_t>(chunk_iter - chunk_last_keys_.begin());
+    const Chunk& target = chunks_[chunk_idx];
+    auto begin = target.keys.begin() + static_cast<ptrdiff_t>(chunk_idx == 0 ? head_skip_ : 0);
+    auto iter = std::lower_bound(begin, target.keys.end(), local_seqnum);
+    DCHECK(iter != target.keys.end());
+    *chunk = &target;
+    *idx = gsl::narrow_cast<size_t>(iter - target.keys.begin());
+    return true;
+}
+
+uint16_t SeqnumSuffixLink::FindStorageShardId(const Chunk& chunk, size_t idx, uint32_t local_seqnum) const {
+    uint32_t key = chunk.keys[idx];
+    DCHECK_LE(local_seqnum, key);
+    // Productive shards are ordered by their last seqnums, so key diffs descend.
+    // The seqnum belongs to the first shard whose last seqnum is not below it.
+    uint32_t diff = key - local_seqnum;
+    auto begin = chunk.key_diffs.begin() + static_cast<ptrdiff_t>(EntryBegin(chunk, idx));
+    auto end = chunk.key_diffs.begin() + static_cast<ptrdiff_t>(chunk.ends[idx]);
+    auto iter = std::lower_bound(begin, end, diff, [] (uint16_t lhs, uint32_t rhs) {
+        return lhs > rhs;
+    });
+    DCHECK(iter != end);
+    return chunk.storage_shard_ids[gsl::narrow_cast<size_t>(iter - chunk.key_diffs.begin())];
 }
 
 bool SeqnumSuffixLink::FindNext(uint64_t query_seqnum, uint64_t* seqnum, uint16_t* storage_shard_id)
 {
     DCHECK_EQ(view_id(), bits::HighHalf32(bits::HighHalf64(query_seqnum)));
     DCHECK_EQ(sequencer_id(), bits::LowHalf32(bits::HighHalf64(query_seqnum)));
-    if (entries_.empty()){
+    if (IsEmpty()){
         return false;
     }
     GetHead(seqnum, storage_shard_id);
@@ -534,27 +582,14 @@ bool SeqnumSuffixLink::FindNext(uint64_t query_seqnum, uint64_t* seqnum, uint16_
     }
     // invariant 1: seqnum lies between head and last element
     // invariant 2: seqnum has exact match (no closest to some other seqnum)
-    // we have a point it
     uint32_t local_seqnum = bits::LowHalf64(query_seqnum);
-    // uint32_t entry_lower_key;
-    // LinkEntry* entry_lower = nullptr;
-    // LinkEntry* entry_upper = nullptr;
-    auto it = entries_.upper_bound(local_seqnum);
-    DCHECK(it != entries_.end()); // because of invariant
-
-    // check key hit
-    if (it != entries_.begin()){
-        auto lower = it;
-        --lower;
-        if(lower->first == local_seqnum){
-            *seqnum = query_seqnum;
-            *storage_shard_id = lower->second.storage_shard_ids_.back();
-            return true;
-        }
+    const Chunk* chunk;
+    size_t idx;
+    if (!LocateEntry(local_seqnum, &chunk, &idx)) {
+        UNREACHABLE();  // because of invariant
     }
-
     *seqnum = query_seqnum;
-    *storage_shard_id = FindStorageShardIdInLinkEntry(it->first, it->second, local_seqnum);
+    *storage_shard_id = FindStorageShardId(*chunk, idx, local_seqnum);
     HVLOG(1) << ("SuffixRead: Query seqnum within my range -> found");
     return true;
 }
@@ -562,7 +597,7 @@ bool SeqnumSuffixLink::FindNext(uint64_t query_seqnum, uint64_t* seqnum, uint16_
 bool SeqnumSuffixLink::FindPrev(uint64_t query_seqnum, uint64_t* seqnum, uint16_t* storage_shard_id){
     DCHECK_EQ(view_id(), bits::HighHalf32(bits::HighHalf64(query_seqnum)));
     DCHECK_EQ(sequencer_id(), bits::LowHalf32(bits::HighHalf64(query_seqnum)));
-    if (entries_.empty()){
+    if (IsEmpty()){
         return false;
     }
     GetHead(seqnum, storage_shard_id);
@@ -577,28 +612,18 @@ bool SeqnumSuffixLink::FindPrev(uint64_t query_seqnum, uint64_t* seqnum, uint16_
     }
     // invariant 1: seqnum lies between head and last element
     // invariant 2: seqnum has exact match (no closest to some other seqnum)
-    // we have a point hit
     uint32_t local_seqnum = bits::LowHalf64(query_seqnum);
-    auto it = entries_.upper_bound(local_seqnum);
-    DCHECK(it != entries_.end()); // because of invariant
-
-    // check key hit
-    if (it != entries_.begin()){
-        auto lower = it;
-        --lower;
-        if(lower->first == local_seqnum){
-            *seqnum = query_seqnum;
-            *storage_shard_id = lower->second.storage_shard_ids_.back();
-            return true;
-        }
+    const Chunk* chunk;
+    size_t idx;
+    if (!LocateEntry(local_seqnum, &chunk, &idx)) {
+        UNREACHABLE();  // because of invariant
     }
-
     *seqnum = query_seqnum;
-    *storage_shard_id = FindStorageShardIdInLinkEntry(it->first, it->second, local_seqnum);
+    *storage_shard_id = FindStorageShardId(*chunk, idx, local_seqnum);
     HVLOG(1) << ("SuffixRead: Query seqnum within my range -> found");
     return true;
 }
 
 
 }
-}
\ No newline at end of file
+}
@@ -26,24 +26,6 @@ struct LinkEntryCompressed {
     absl::FixedArray<uint32_t> seqnum_upper_bounds_;
 };
 
-struct LinkEntry{
-    LinkEntry(std::vector<std::pair<uint16_t, uint32_t>> productive_shards)
-    : storage_shard_ids_(absl::FixedArray<uint16_t>(productive_shards.size(), 0)),
-      key_diffs_(absl::FixedArray<uint16_t>(productive_shards.size(), 0))
-    {
-        DCHECK(0 < productive_shards.size());
-        auto& [key_shard, key_seqnum] = productive_shards.back();
-        for(size_t i = 0; i < productive_shards.size(); i++) {
-            auto& [shard, seqnum] = productive_shards.at(i);
-            DCHECK(key_seqnum > seqnum);
-            key_diffs_.at(i) = gsl::narrow_cast<uint16_t>(key_seqnum - seqnum);
-            storage_shard_ids_.at(i) = shard;
-        }
-    }
-    absl::FixedArray<uint16_t> storage_shard_ids_;
-    absl::FixedArray<uint16_t> key_diffs_;
-};
-
 class SeqnumSuffixLink final : public LogSpaceBase {
 public:
     SeqnumSuffixLink(const View* view, uint16_t sequencer_id, uint32_t metalog_position);
@@ -67,7 +49,34 @@ public:
     }
 
 private:
-    std::map<uint32_t, LinkEntry> entries_;
+    // Entries, one per NEW_LOGS meta log, are kept in an append-only chunked
+    // layout. Each chunk holds up to kChunkSize sorted entry keys (the highest
+    // seqnum of the entry), and the productive storage shards of its entries
+    // packed into parallel arrays. Lookups search the last keys of chunks
+    // first, then the keys within a single chunk.
+    static constexpr size_t kChunkSize = 256;
+
+    struct Chunk {
+        std::vector<uint32_t> keys;
+        // Entry i owns packed elements in [ends[i-1], ends[i])
+        std::vector<uint16_t> ends;
+        std::vector<uint16_t> storage_shard_ids;
+        // Distance of each productive shard's last seqnum to the entry key
+        std::vector<uint16_t> key_diffs;
+    };
+
+    std::deque<Chunk> chunks_;
+    std::deque<uint32_t> chunk_last_keys_;
+    // Trimmed entries at the front of the first chunk
+    size_t head_skip_;
+    size_t num_entries_;
+
+    size_t EntryBegin(const Chunk& chunk, size_t idx) const {
+        return idx == 0 ? 0 : chunk.ends[idx - 1];
+    }
+    // Locates the first entry with key not less than `local_seqnum`
+    bool LocateEntry(uint32_t local_seqnum, const Chunk** chunk, size_t* idx) const;
+    uint16_t FindStorageShardId(const Chunk& chunk, size_t idx, uint32_t local_seqnum) const;
 
     void OnNewLogs(std::vector<std::pair<uint16_t, uint32_t>> productive_cuts) override;
     
@@ -91,13 +100,13 @@ public:
 
     // call only when chain is not empty
     uint64_t metalog_progress(){
-        return (--suffix_chain_.end())->second->metalog_progress();
+        return suffix_chain_.back()->metalog_progress();
     }
     uint32_t metalog_position(){
-        return (--suffix_chain_.end())->second->metalog_position();
+        return suffix_chain_.back()->metalog_position();
     }
     uint16_t view_id(){
-        return (--suffix_chain_.end())->second->view_id();
+        return suffix_chain_.back()->view_id();
     }
 
     void Extend(const View* view, uint32_t metalog_position);
@@ -108,6 +117,8 @@ public:
     uint64_t ProvideMetaLog(const MetaLogProto& metalog_proto);
     void MakeQuery(const IndexQuery& query);
     void PollQueryResults(QueryResultVec* results);
+    // Appends up to `max_count` seqnums following `seqnum` in the chain
+    void GetNextSeqnums(uint64_t seqnum, size_t max_count, std::vector<IndexFoundResult>* results);
     void Aggregate(size_t* num_link_entries, size_t* num_range_entries, size_t* size);
     bool Finalize(uint32_t final_metalog_position, 
                   const std::vector<MetaLogProto>& tail_metalogs);
@@ -118,13 +129,17 @@ private:
     std::string log_header_;
     float trim_level_;
     size_t current_entries_;
-    std::map<uint16_t, std::unique_ptr<SeqnumSuffixLink>> suffix_chain_;
+    // Links ordered by view id
+    using SuffixLinkVec = std::deque<std::unique_ptr<SeqnumSuffixLink>>;
+    SuffixLinkVec suffix_chain_;
 
     std::multimap</* metalog_position */ uint32_t,
                   IndexQuery> pending_queries_;
     QueryResultVec pending_query_results_;
 
     bool IsEmpty();
+    // First link with view id not less than `view_id`
+    SuffixLinkVec::iterator LinkLowerBound(uint16_t view_id);
     bool GetHead(uint64_t* head, uint16_t* storage_shard_id);
     bool GetTail(uint64_t* tail, uint16_t* storage_shard_id);
     bool GetHead(uint64_t* head);
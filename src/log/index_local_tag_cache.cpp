@@ -6,69 +6,66 @@ namespace faas {
 namespace log {
 
 TagSuffixLink::TagSuffixLink(uint32_t seqnum, uint16_t storage_shard_id){
-    seqnums_.push_back(seqnum);
-    storage_shard_ids_.push_back(storage_shard_id);
+    seqnums_.Append(seqnum, storage_shard_id);
 }
 
 bool TagSuffixLink::FindPrev(uint32_t identifier, uint64_t query_seqnum, uint64_t* seqnum, uint16_t* shard_id) const{
     DCHECK(!seqnums_.empty());
-    uint32_t local_seqnum = bits::LowHalf64(query_seqnum);
-
-    auto it = absl::c_upper_bound(
-        seqnums_, local_seqnum, [] (uint32_t lhs, uint32_t rhs) {
-            return lhs < rhs;
-        }
-    );
-
-    if (it == seqnums_.begin()){
+    size_t pos = seqnums_.UpperBound(bits::LowHalf64(query_seqnum));
+    if (pos == 0){
         return false;
-    } else {
-        --it;
-        *seqnum = bits::JoinTwo32(identifier, *it);
-        *shard_id = storage_shard_ids_.at(gsl::narrow_cast<size_t>(it - seqnums_.begin()));
-        return true;
     }
+    *seqnum = bits::JoinTwo32(identifier, seqnums_.at(pos - 1));
+    *shard_id = seqnums_.payload_at(pos - 1);
+    return true;
 }
 
 void TagSuffixLink::GetTail(uint32_t identifier, uint64_t* seqnum, uint16_t* shard_id) const {
     DCHECK(!seqnums_.empty());
     *seqnum = bits::JoinTwo32(identifier, seqnums_.back());
-    *shard_id = storage_shard_ids_.back();
+    *shard_id = seqnums_.payload_at(seqnums_.size() - 1);
 }
 
 bool TagSuffixLink::FindNext(uint32_t identifier, uint64_t query_seqnum, uint64_t* seqnum, uint16_t* shard_id) const {
     DCHECK(!seqnums_.empty());
-    uint32_t local_seqnum = bits::LowHalf64(query_seqnum);
-    auto it = absl::c_lower_bound(
-        seqnums_, local_seqnum, [] (uint32_t lhs, uint32_t rhs) {
-            return lhs < rhs;
-        }
-    );
-    if(it == seqnums_.end()){
+    size_t pos = seqnums_.LowerBound(bits::LowHalf64(query_seqnum));
+    if(pos == seqnums_.size()){
         return false;
     }
-    *seqnum = bits::JoinTwo32(identifier, *it);
-    *shard_id = storage_shard_ids_.at(gsl::narrow_cast<size_t>(it - seqnums_.begin()));       //it->second;
+    *seqnum = bits::JoinTwo32(identifier, seqnums_.at(pos));
+    *shard_id = seqnums_.payload_at(pos);
     return true;
 }
 
 void TagSuffixLink::GetHead(uint32_t identifier, uint64_t* seqnum, uint16_t* shard_id) const {
     DCHECK(!seqnums_.empty());
     *seqnum = bits::JoinTwo32(identifier, seqnums_.front());
-    *shard_id = storage_shard_ids_.front();
+    *shard_id = seqnums_.payload_at(0);
 }
 
 TagEntry::TagEntry(uint64_t seqnum_min, uint16_t storage_shard_id_min, uint64_t popularity, bool complete)
     : seqnum_min_(seqnum_min),
       shard_id_min_(storage_shard_id_min),
       popularity_(popularity),
-      complete_(complete)
+      complete_(complete),
+      num_seqnums_(0),
+      user_logspace_(0),
+      tag_(kEmptyLogTag),
+      referenced_(false),
+      clock_prev_(nullptr),
+      clock_next_(nullptr)
     {}
 TagEntry::TagEntry(uint16_t view_id, uint32_t seqnum, uint16_t storage_shard_id, uint64_t popularity)
     : seqnum_min_(kInvalidLogSeqNum),
       shard_id_min_(0),
       popularity_(popularity),
-      complete_(false)
+      complete_(false),
+      num_seqnums_(1),
+      user_logspace_(0),
+      tag_(kEmptyLogTag),
+      referenced_(false),
+      clock_prev_(nullptr),
+      clock_next_(nullptr)
     {
         TagSuffixLink* link = new TagSuffixLink(seqnum, storage_shard_id);
         tag_suffix_[view_id].reset(link);
@@ -83,10 +80,10 @@ TagEntry::~TagEntry(){}
         tag_suffix_[view_id].reset(link);
     } else {
         TagSuffixLink* link = tag_suffix_.at(view_id).get();
-        link->seqnums_.push_back(seqnum);
-        link->storage_shard_ids_.push_back(storage_shard_id);
+        link->seqnums_.Append(seqnum, storage_shard_id);
     }
-    popularity_ = popularity;
+    num_seqnums_++;
+    Touch(popularity);
 }
 
 void TagEntry::Evict(uint32_t per_tag_seqnums_limit, size_t* num_evicted_seqnums){
@@ -99,8 +96,8 @@ void TagEntry::Evict(uint32_t per_tag_seqnums_limit, size_t* num_evicted_seqnums
     while (0 < erase_counter && it != tag_suffix_.end()) {
         TagSuffixLink* link = it->second.get();
         size_t seqnums_to_evict = std::min(erase_counter, link->seqnums_.size());
-        link->seqnums_.erase(link->seqnums_.begin(), link->seqnums_.begin() + gsl::narrow_cast<int>(seqnums_to_evict));
-        link->storage_shard_ids_.erase(link->storage_shard_ids_.begin(), link->storage_shard_ids_.begin() + gsl::narrow_cast<int>(seqnums_to_evict));
+        link->seqnums_.RemovePrefix(seqnums_to_evict);
+        num_seqnums_ -= seqnums_to_evict;
         complete_ = false;
         if (link->seqnums_.empty()){
             // link is empty
@@ -113,13 +110,67 @@ void TagEntry::Evict(uint32_t per_tag_seqnums_limit, size_t* num_evicted_seqnums
     }
 }
 
+bool TagEntry::Trim(uint16_t sequencer_id, uint64_t trim_seqnum, size_t* num_trimmed_seqnums){
+    auto it = tag_suffix_.begin();
+    while (it != tag_suffix_.end()) {
+        uint32_t logspace_id = bits::JoinTwo16(it->first, sequencer_id);
+        TagSuffixLink* link = it->second.get();
+        size_t num_trimmed = link->seqnums_.LowerBound(logspace_id, trim_seqnum);
+        if (num_trimmed == 0) {
+            break;
+        }
+        link->seqnums_.RemovePrefix(num_trimmed);
+        num_seqnums_ -= num_trimmed;
+        *num_trimmed_seqnums += num_trimmed;
+        if (!link->seqnums_.empty()) {
+            break;
+        }
+        it = tag_suffix_.erase(it);
+    }
+    if (tag_suffix_.empty()) {
+        return false;
+    }
+    if (seqnum_min_ != kInvalidLogSeqNum && seqnum_min_ < trim_seqnum) {
+        if (!complete_) {
+            // Entries between the trim seqnum and the suffix are unknown
+            return false;
+        }
+        GetSuffixHead(sequencer_id, &seqnum_min_, &shard_id_min_);
+    }
+    return true;
+}
+
 void TagEntry::GetSuffixHead(uint16_t sequencer_id, uint64_t* seqnum, uint16_t* shard_id) const {
     DCHECK(!tag_suffix_.empty());
     uint16_t view_id = tag_suffix_.begin()->first;
     TagSuffixLink* link = tag_suffix_.begin()->second.get();
     DCHECK(!link->seqnums_.empty());
     *seqnum = bits::JoinTwo32(bits::JoinTwo16(view_id, sequencer_id), link->seqnums_.front());
-    *shard_id = link->storage_shard_ids_.front();
+    *shard_id = link->seqnums_.payload_at(0);
+}
+
+void TagEntry::GetNextSeqnums(uint16_t sequencer_id, uint64_t seqnum, size_t max_count,
+                              std::vector<IndexFoundResult>* results) const {
+    uint16_t seqnum_view_id = log_utils::GetViewId(seqnum);
+    size_t count = 0;
+    for (auto it = tag_suffix_.lower_bound(seqnum_view_id);
+             it != tag_suffix_.end() && count < max_count; ++it) {
+        uint16_t view_id = it->first;
+        const TagSuffixLink* link = it->second.get();
+        size_t pos = 0;
+        if (view_id == seqnum_view_id) {
+            pos = link->seqnums_.UpperBound(bits::LowHalf64(seqnum));
+        }
+        uint32_t identifier = bits::JoinTwo16(view_id, sequencer_id);
+        for (; pos < link->seqnums_.size() && count < max_count; pos++) {
+            results->push_back(IndexFoundResult {
+                .view_id = view_id,
+                .storage_shard_id = link->seqnums_.payload_at(pos),
+                .seqnum = bits::JoinTwo32(identifier, link->seqnums_.at(pos))
+            });
+            count++;
+        }
+    }
 }
 
 void TagEntry::GetSuffixTail(uint16_t sequencer_id, uint64_t* seqnum, uint16_t* shard_id) const {
@@ -128,19 +179,57 @@ void TagEntry::GetSuffixTail(uint16_t sequencer_id, uint64_t* seqnum, uint16_t*
     TagSuffixLink *link = (--tag_suffix_.end())->second.get();
     DCHECK(!link->seqnums_.empty());
     *seqnum = bits::JoinTwo32(bits::JoinTwo16(view_id, sequencer_id), link->seqnums_.back());
-    *shard_id = link->storage_shard_ids_.back();
+    *shard_id = link->seqnums_.payload_at(link->seqnums_.size() - 1);
 }
 
-size_t TagEntry::NumSeqnumsInSuffix() {
-    size_t size = 0;
-    for (auto& [view_id, suffix_link] : tag_suffix_){
-        size += suffix_link->seqnums_.size();
+TagClock::TagClock()
+    : hand_(nullptr) {}
+
+TagClock::~TagClock() {}
+
+void TagClock::Insert(TagEntry* entry) {
+    DCHECK(entry->clock_next_ == nullptr);
+    if (hand_ == nullptr) {
+        entry->clock_prev_ = entry;
+        entry->clock_next_ = entry;
+        hand_ = entry;
+        return;
     }
-    return size;
+    TagEntry* prev = hand_->clock_prev_;
+    entry->clock_prev_ = prev;
+    entry->clock_next_ = hand_;
+    prev->clock_next_ = entry;
+    hand_->clock_prev_ = entry;
 }
 
-PerSpaceTagCache::PerSpaceTagCache(uint32_t user_logspace)
-    : user_logspace_(user_logspace)
+void TagClock::Remove(TagEntry* entry) {
+    DCHECK(entry->clock_next_ != nullptr);
+    if (entry->clock_next_ == entry) {
+        DCHECK_EQ(hand_, entry);
+        hand_ = nullptr;
+    } else {
+        if (hand_ == entry) {
+            hand_ = entry->clock_next_;
+        }
+        entry->clock_prev_->clock_next_ = entry->clock_next_;
+        entry->clock_next_->clock_prev_ = entry->clock_prev_;
+    }
+    entry->clock_prev_ = nullptr;
+    entry->clock_next_ = nullptr;
+}
+
+TagEntry* TagClock::Advance() {
+    if (hand_ == nullptr) {
+        return nullptr;
+    }
+    TagEntry* entry = hand_;
+    hand_ = hand_->clock_next_;
+    return entry;
+}
+
+PerSpaceTagCache::PerSpaceTagCache(uint32_t user_logspace, TagClock* clock)
+    : user_logspace_(user_logspace),
+      clock_(clock)
     {
         log_header_ = fmt::format("PerSpaceTagCache[{}]: ", user_logspace % 1000);
     }
@@ -153,7 +242,10 @@ void PerSpaceTagCache::AddOrUpdate(uint64_t tag, uint16_t view_id, uint16_t sequ
         tags_.at(tag)->Add(view_id, seqnum, storage_shard_id, popularity);
     } else {
         TagEntry* tag_entry = new TagEntry(view_id, seqnum, storage_shard_id, popularity);
+        tag_entry->user_logspace_ = user_logspace_;
+        tag_entry->tag_ = tag;
         tags_[tag].reset(tag_entry);
+        clock_->Insert(tag_entry);
     }
     if (pending_min_tags_.contains(tag)){
         TagEntry* stored_tag = tags_.at(tag).get();
@@ -221,25 +313,51 @@ bool PerSpaceTagCache::TagExists(uint64_t tag){
     return tags_.contains(tag);
 }
 
+void PerSpaceTagCache::GetNextSeqnums(uint64_t tag, uint16_t sequencer_id, uint64_t seqnum,
+                                      size_t max_count, std::vector<IndexFoundResult>* results){
+    if (!tags_.contains(tag)) {
+        return;
+    }
+    tags_.at(tag)->GetNextSeqnums(sequencer_id, seqnum, max_count, results);
+}
+
 void PerSpaceTagCache::Clear(){
+    for (auto& [tag, tag_entry] : tags_){
+        clock_->Remove(tag_entry.get());
+    }
     tags_.clear();
     pending_min_tags_.clear();
 }
 
-void PerSpaceTagCache::Evict(uint64_t popularity, uint32_t pet_tag_seqnums_limit, size_t* evicted_seqnums){
-    auto it = tags_.begin();
-    while (it != tags_.end()){
-        if (it->second->popularity_ <= popularity){
-            *evicted_seqnums += it->second->NumSeqnumsInSuffix();
+size_t PerSpaceTagCache::Remove(uint64_t tag){
+    auto it = tags_.find(tag);
+    DCHECK(it != tags_.end());
+    size_t num_seqnums = it->second->NumSeqnumsInSuffix();
+    clock_->Remove(it->second.get());
+    tags_.erase(it);
+    pending_min_tags_.erase(tag);
+    return num_seqnums;
+}
+
+void PerSpaceTagCache::Trim(uint64_t user_tag, uint16_t sequencer_id, uint64_t trim_seqnum, size_t* trimmed_seqnums){
+    if (user_tag != kEmptyLogTag) {
+        auto it = tags_.find(user_tag);
+        if (it != tags_.end() && !it->second->Trim(sequencer_id, trim_seqnum, trimmed_seqnums)) {
+            *trimmed_seqnums += it->second->NumSeqnumsInSuffix();
+            clock_->Remove(it->second.get());
             tags_.erase(it);
-            if(pending_min_tags_.contains(it->first)) {
-                pending_min_tags_.erase(it->first);
-            }
+        }
+        return;
+    }
+    auto it = tags_.begin();
+    while (it != tags_.end()) {
+        if (!it->second->Trim(sequencer_id, trim_seqnum, trimmed_seqnums)) {
+            *trimmed_seqnums += it->second->NumSeqnumsInSuffix();
+            clock_->Remove(it->second.get());
+            tags_.erase(it++);
         } else {
-            // evict suffix at front if tag reached limit
-            it->second->Evict(pet_tag_seqnums_limit, evicted_seqnums);
+            ++it;
         }
-        ++it;
     }
 }
 
@@ -251,6 +369,7 @@ void PerSpaceTagCache::Aggregate(size_t* num_tags, size_t* num_seqnums, size_t*
     size_t num_min_seqnums = 0;
     size_t num_tag_suffix = 0;
     size_t num_suffix_seqnums = 0;
+    size_t suffix_links_size = 0;
     for (auto& [key, tag_entry] : tags_){
         if (tag_entry->seqnum_min_ != kInvalidLogSeqNum){
             num_min_seqnums += 1;
@@ -258,6 +377,7 @@ void PerSpaceTagCache::Aggregate(size_t* num_tags, size_t* num_seqnums, size_t*
         num_tag_suffix += tag_entry->tag_suffix_.size();
         for (auto& [view_id, suffix_link] : tag_entry->tag_suffix_){
             num_suffix_seqnums += suffix_link->seqnums_.size();
+            suffix_links_size += suffix_link->seqnums_.memory_usage();
         }
     }
     *num_tags += tags_.size();
@@ -269,8 +389,7 @@ void PerSpaceTagCache::Aggregate(size_t* num_tags, size_t* num_seqnums, size_t*
         + sizeof(bool)                          // complete flag
         ) * tags_.size()
         + sizeof(uint16_t) * num_tag_suffix     // all keys of suffix entries
-        + sizeof(uint32_t) * num_suffix_seqnums // all keys of suffix links
-        + sizeof(uint16_t) * num_suffix_seqnums // all storage shard values of suffix links
+        + suffix_links_size                     // seqnums and storage shards of suffix links
     );
 }
 
@@ -288,7 +407,7 @@ IndexQueryResult::State PerSpaceTagCache::FindPrev(uint64_t query_seqnum, uint64
     HVLOG_F(1, "FindPrev(query_tag={}, query_seqnum={}): Tail at {}", user_tag, bits::HexStr0x(query_seqnum), bits::HexStr0x(*seqnum));
     if (*seqnum <= query_seqnum) {
         HVLOG_F(1, "FindPrev(query_tag={}, query_seqnum={}): Query seqnum is at tail or after -> found", user_tag, bits::HexStr0x(query_seqnum));
-        tag_entry->popularity_ = popularity;
+        tag_entry->Touch(popularity);
         return IndexQueryResult::kFound;
     }
     // check before|at suffix head or at min seqnum
@@ -296,7 +415,7 @@ IndexQueryResult::State PerSpaceTagCache::FindPrev(uint64_t query_seqnum, uint64
     HVLOG_F(1, "FindPrev(query_tag={}, query_seqnum={}): Head at {}", user_tag, bits::HexStr0x(query_seqnum), bits::HexStr0x(*seqnum));
     if (query_seqnum == *seqnum) {
         HVLOG_F(1, "FindPrev(query_tag={}, query_seqnum={}): Query seqnum lies on head -> found", user_tag, bits::HexStr0x(query_seqnum));
-        tag_entry->popularity_ = popularity;
+        tag_entry->Touch(popularity);
         return IndexQueryResult::kFound;
     }
     else if (query_seqnum < *seqnum) {
@@ -308,7 +427,7 @@ IndexQueryResult::State PerSpaceTagCache::FindPrev(uint64_t query_seqnum, uint64
             *seqnum = tag_entry->seqnum_min_;
             *storage_shard_id = tag_entry->shard_id_min_;
             HVLOG_F(1, "FindPrev(query_tag={}, query_seqnum={}): seqnum lies on min seqnum -> found", user_tag, bits::HexStr0x(query_seqnum));
-            tag_entry->popularity_ = popularity;
+            tag_entry->Touch(popularity);
             return IndexQueryResult::kFound;
         } else {
             HVLOG_F(1, "FindPrev(query_tag={}, query_seqnum={}): Query seqnum is in gap -> miss", user_tag, bits::HexStr0x(query_seqnum));
@@ -333,7 +452,7 @@ IndexQueryResult::State PerSpaceTagCache::FindPrev(uint64_t query_seqnum, uint64
     id = bits::JoinTwo16(upper_view_id, space_id);
     if(tag_suffix_link_upper->FindPrev(id, query_seqnum, seqnum, storage_shard_id)){
         HVLOG_F(1, "FindPrev(query_tag={}, query_seqnum={}): Seqnum in upper link suffix -> found", user_tag, bits::HexStr0x(query_seqnum));
-        tag_entry->popularity_ = popularity;
+        tag_entry->Touch(popularity);
         return IndexQueryResult::kFound;
     }
     if (it == tag_entry->tag_suffix_.rbegin()){
@@ -352,7 +471,7 @@ IndexQueryResult::State PerSpaceTagCache::FindPrev(uint64_t query_seqnum, uint64
     id = bits::JoinTwo16(lower_view_id, space_id);
     tag_suffix_link_lower->GetTail(id, seqnum, storage_shard_id);
     HVLOG_F(1, "FindPrev(query_tag={}, query_seqnum={}): Seqnum at lower link suffix tail -> found", user_tag, bits::HexStr0x(query_seqnum));
-    tag_entry->popularity_ = popularity;
+    tag_entry->Touch(popularity);
     return IndexQueryResult::kFound;
 }
 
@@ -371,13 +490,13 @@ IndexQueryResult::State PerSpaceTagCache::FindNext(uint64_t query_seqnum, uint64
     if (query_seqnum + 1 < *seqnum) {
         if (tag_entry->complete_){
             HVLOG_F(1, "FindNext(query_tag={}, query_seqnum={}): Seqnum lies between min seqnum and head for complete tag -> found", user_tag, bits::HexStr0x(query_seqnum));
-            tag_entry->popularity_ = popularity;
+            tag_entry->Touch(popularity);
             return IndexQueryResult::kFound;
         } else if (tag_entry->seqnum_min_ != kInvalidLogSeqNum && query_seqnum <= tag_entry->seqnum_min_) {
             *seqnum = tag_entry->seqnum_min_;
             *storage_shard_id = tag_entry->shard_id_min_;
             HVLOG_F(1, "FindNext(query_tag={}, query_seqnum={}): seqnum equal|lower than min -> found", user_tag, bits::HexStr0x(query_seqnum));
-            tag_entry->popularity_ = popularity;
+            tag_entry->Touch(popularity);
             return IndexQueryResult::kFound;
         }
         else {
@@ -387,7 +506,7 @@ IndexQueryResult::State PerSpaceTagCache::FindNext(uint64_t query_seqnum, uint64
         }
     } else if (query_seqnum == *seqnum) {
         HVLOG_F(1, "FindNext(query_tag={}, query_seqnum={}): Seqnum is on head -> found", user_tag, bits::HexStr0x(query_seqnum));
-        tag_entry->popularity_ = popularity;
+        tag_entry->Touch(popularity);
         return IndexQueryResult::kFound;
     }
     // check after tail
@@ -395,7 +514,7 @@ IndexQueryResult::State PerSpaceTagCache::FindNext(uint64_t query_seqnum, uint64
     HVLOG_F(1, "FindNext(query_tag={}, query_seqnum={}): Tail at {}", user_tag, bits::HexStr0x(query_seqnum), bits::HexStr0x(*seqnum));
     if (*seqnum == query_seqnum) {
         HVLOG_F(1, "FindNext(query_tag={}, query_seqnum={}): Query seqnum is at tail -> found", user_tag, bits::HexStr0x(query_seqnum));
-        tag_entry->popularity_ = popularity;
+        tag_entry->Touch(popularity);
         return IndexQueryResult::kFound;
     }
     if (*seqnum < query_seqnum) {
@@ -418,7 +537,7 @@ IndexQueryResult::State PerSpaceTagCache::FindNext(uint64_t query_seqnum, uint64
     identifier = bits::JoinTwo16(view_id, space_id);
     if(tag_suffix_link->FindNext(identifier, query_seqnum, seqnum, storage_shard_id)){
         HVLOG_F(1, "FindNext(query_tag={}, query_seqnum={}): Seqnum in lower link suffix -> found", user_tag, bits::HexStr0x(query_seqnum), view_id);
-        tag_entry->popularity_ = popularity;
+        tag_entry->Touch(popularity);
         return IndexQueryResult::kFound;
     }
     // get upper
@@ -434,7 +553,7 @@ IndexQueryResult::State PerSpaceTagCache::FindNext(uint64_t query_seqnum, uint64
     identifier = bits::JoinTwo16(view_id, space_id);
     tag_suffix_link->GetHead(identifier, seqnum, storage_shard_id);
     HVLOG_F(1, "FindNext(query_tag={}, query_seqnum={}): Seqnum at upper link suffix head -> found", user_tag, bits::HexStr0x(query_seqnum));
-    tag_entry->popularity_ = popularity;
+    tag_entry->Touch(popularity);
     return IndexQueryResult::kFound;
 }
 
@@ -577,28 +696,57 @@ void TagCache::ProvideIndexData(uint16_t view_id, const IndexDataProto& index_da
 // }
 
 void TagCache::Evict(){
+    if (cache_size_ <= max_cache_size_) {
+        return;
+    }
+    HVLOG_F(1, "Evict because cache size too high. cache_size={}, max_cache_size={}", cache_size_, max_cache_size_);
+    // Each step of the hand either evicts a tag, or clears a reference bit set
+    // by an earlier access, so eviction work is amortized O(1) per access
+    size_t evicted_seqnums = 0;
     while(cache_size_ > max_cache_size_){
-        HVLOG_F(1, "Evict because cache size too high. cache_size={}, max_cache_size={}", cache_size_, max_cache_size_);
-        if (popularity_sequence_.empty()) {
-            LOG(FATAL) << "Popularity sequence cannot be empty when cache gets evicted";
+        TagEntry* tag_entry = clock_.Advance();
+        if (tag_entry == nullptr) {
+            LOG(FATAL) << "Tag clock cannot be empty when cache gets evicted";
         }
-        size_t evicted_seqnums = 0;
-        size_t ix = gsl::narrow_cast<size_t>(std::ceil(popularity_sequence_.size() * 0.2));
-        uint64_t popularity = popularity_sequence_.at(ix);
-        for(auto& [user_logspace, per_space_tag_cache] : per_space_cache_) {
-            per_space_tag_cache->Evict(popularity, per_tag_seqnums_limit_, &evicted_seqnums);
+        size_t num_seqnums = 0;
+        if (tag_entry->referenced_) {
+            // Second chance, but evict suffix at front if tag reached limit
+            tag_entry->referenced_ = false;
+            tag_entry->Evict(per_tag_seqnums_limit_, &num_seqnums);
+        } else {
+            num_seqnums = per_space_cache_.at(tag_entry->user_logspace_)->Remove(tag_entry->tag_);
         }
-        popularity_sequence_.erase(popularity_sequence_.begin(), popularity_sequence_.begin()+gsl::narrow_cast<int>(ix)+1);
-        DCHECK(cache_size_ >= evicted_seqnums);
-        cache_size_ -= evicted_seqnums;
-        HVLOG_F(1, "Evicted {} seqnums. cache_size={}", evicted_seqnums, cache_size_);
+        DCHECK(cache_size_ >= num_seqnums);
+        cache_size_ -= num_seqnums;
+        evicted_seqnums += num_seqnums;
     }
+    HVLOG_F(1, "Evicted {} seqnums. cache_size={}", evicted_seqnums, cache_size_);
 }
 
 bool TagCache::TagExists(uint32_t user_logspace, uint64_t tag){
     return GetOrCreatePerSpaceTagCache(user_logspace)->TagExists(tag);
 }
 
+void TagCache::GetNextSeqnums(uint32_t user_logspace, uint64_t tag, uint64_t seqnum,
+                              size_t max_count, std::vector<IndexFoundResult>* results){
+    if (!per_space_cache_.contains(user_logspace)) {
+        return;
+    }
+    per_space_cache_.at(user_logspace)->GetNextSeqnums(tag, sequencer_id_, seqnum, max_count, results);
+}
+
+void TagCache::Trim(uint32_t user_logspace, uint64_t user_tag, uint64_t trim_seqnum){
+    if (!per_space_cache_.contains(user_logspace)) {
+        return;
+    }
+    size_t trimmed_seqnums = 0;
+    per_space_cache_.at(user_logspace)->Trim(user_tag, sequencer_id_, trim_seqnum, &trimmed_seqnums);
+    DCHECK(cache_size_ >= trimmed_seqnums);
+    cache_size_ -= trimmed_seqnums;
+    HVLOG_F(1, "Trimmed {} seqnums of user_logspace={}, tag={}. cache_size={}",
+            trimmed_seqnums, user_logspace, user_tag, cache_size_);
+}
+
 void TagCache::InstallView(uint16_t view_id, uint32_t metalog_position){
     DCHECK(!views_.contains(view_id));
     TagCacheView* tag_cache_view = new TagCacheView(view_id, metalog_position);
@@ -610,7 +758,7 @@ void TagCache::Clear(){
     for (auto& [id, per_space_tag_cache] : per_space_cache_){
         per_space_tag_cache->Clear();
     }
-    popularity_sequence_.clear();
+    DCHECK(clock_.empty());
     cache_size_ = 0;
 }
 
@@ -665,7 +813,6 @@ bool TagCache::AdvanceIndexProgress(uint16_t view_id){
         }
         advanced = true;
         cache_size_ += new_seqnums;
-        popularity_sequence_.push_back(popularity);
         HVLOG_F(1, "Advanced metalog to {}", views_.at(view_id)->metalog_position());
     }
     if (advanced) {
@@ -687,7 +834,7 @@ PerSpaceTagCache* TagCache::GetOrCreatePerSpaceTagCache(uint32_t user_logspace){
     if (per_space_cache_.contains(user_logspace)) {
         return per_space_cache_.at(user_logspace).get();
     }
-    PerSpaceTagCache* cache = new PerSpaceTagCache(user_logspace);
+    PerSpaceTagCache* cache = new PerSpaceTagCache(user_logspace, &clock_);
     per_space_cache_[user_logspace].reset(cache);
     return cache;
 }
@@ -1,6 +1,7 @@
 #pragma once
 
 #include "log/index_dto.h"
+#include "log/seqnum_list.h"
 
 namespace faas {
 namespace log {
@@ -21,8 +22,8 @@ public:
     void GetTail(uint32_t identifier, uint64_t* seqnum, uint16_t* shard_id) const;
     bool FindNext(uint32_t identifier, uint64_t query_seqnum, uint64_t* seqnum, uint16_t* shard_id) const;
     void GetHead(uint32_t identifier, uint64_t* seqnum, uint16_t* shard_id) const;
-    std::vector<uint32_t> seqnums_;
-    std::vector<uint16_t> storage_shard_ids_;
+    // Payloads are storage shard ids
+    SeqnumList seqnums_;
 private:
 };
 
@@ -38,32 +39,73 @@ public:
 
     void Add(uint16_t view_id, uint32_t seqnum, uint16_t storage_shard_id, uint64_t popularity);
     void Evict(uint32_t per_tag_seqnums_limit, size_t* num_evicted_seqnums);
+    // Returns false if the entry cannot be kept after trimming
+    bool Trim(uint16_t sequencer_id, uint64_t trim_seqnum, size_t* num_trimmed_seqnums);
     void GetSuffixHead(uint16_t sequencer_id, uint64_t* seqnum, uint16_t* shard_id) const;
     void GetSuffixTail(uint16_t sequencer_id, uint64_t* seqnum, uint16_t* shard_id) const;
-    size_t NumSeqnumsInSuffix();
+    // Appends up to `max_count` seqnums in the suffix following `seqnum`
+    void GetNextSeqnums(uint16_t sequencer_id, uint64_t seqnum, size_t max_count,
+                        std::vector<IndexFoundResult>* results) const;
+    size_t NumSeqnumsInSuffix() const { return num_seqnums_; }
+    void Touch(uint64_t popularity) {
+        popularity_ = popularity;
+        referenced_ = true;
+    }
 
     TagSuffix tag_suffix_;
     uint64_t seqnum_min_;
     uint16_t shard_id_min_;
     uint64_t popularity_;
     bool complete_;
+    size_t num_seqnums_;
+
+    // Linkage in TagClock, for entries cached in PerSpaceTagCache::tags_
+    uint32_t user_logspace_;
+    uint64_t tag_;
+    bool referenced_;
+    TagEntry* clock_prev_;
+    TagEntry* clock_next_;
+private:
+};
+
+// CLOCK replacement over cached tag entries of all user log spaces. Entries
+// form a ring, accesses set their reference bits, and the hand gives entries
+// with set bits a second chance while sweeping for victims.
+class TagClock {
+public:
+    TagClock();
+    ~TagClock();
+
+    bool empty() const { return hand_ == nullptr; }
+    // Links `entry` right behind the hand, so it is swept last
+    void Insert(TagEntry* entry);
+    void Remove(TagEntry* entry);
+    // Returns the entry under the hand and moves the hand forward
+    TagEntry* Advance();
+    void Clear() { hand_ = nullptr; }
+
 private:
+    TagEntry* hand_;
+
+    DISALLOW_COPY_AND_ASSIGN(TagClock);
 };
 
 
 
 class PerSpaceTagCache {
 public:
-    PerSpaceTagCache(uint32_t user_logspace);
+    PerSpaceTagCache(uint32_t user_logspace, TagClock* clock);
     ~PerSpaceTagCache();
 
     void AddOrUpdate(uint64_t tag, uint16_t view_id, uint16_t sequencer_id, uint32_t seqnum, uint16_t storage_shard_id, uint64_t popularity);
     void HandleMinSeqnum(uint64_t tag, uint64_t min_seqnum, uint16_t min_storage_shard_id, uint64_t timestamp, uint16_t sequencer_id, uint64_t popularity);
-    void Remove(uint64_t tag, uint64_t popularity);
-    void Remove(uint64_t popularity);
-    void Evict(uint64_t popularity, uint32_t per_tag_seqnums_limit, size_t* evicted_seqnums);
+    // Drops the tag and returns its number of cached seqnums
+    size_t Remove(uint64_t tag);
+    void Trim(uint64_t user_tag, uint16_t sequencer_id, uint64_t trim_seqnum, size_t* trimmed_seqnums);
     void Clear();
     bool TagExists(uint64_t tag);
+    void GetNextSeqnums(uint64_t tag, uint16_t sequencer_id, uint64_t seqnum, size_t max_count,
+                        std::vector<IndexFoundResult>* results);
     void Aggregate(size_t* num_tags, size_t* num_seqnums, size_t* size);
 
     IndexQueryResult::State FindPrev(uint64_t query_seqnum, uint64_t user_tag, uint16_t space_id, uint64_t popularity,
@@ -74,6 +116,7 @@ public:
 private:
     uint32_t user_logspace_;
     std::string log_header_;
+    TagClock* clock_;
     // tag-key : tag-entry
     absl::flat_hash_map<uint64_t, std::unique_ptr<TagEntry>> tags_;
     absl::flat_hash_map<uint64_t, std::unique_ptr<TagEntry>> pending_min_tags_;
@@ -116,6 +159,11 @@ public:
     void MakeQuery(const IndexQuery& query);
     void PollQueryResults(QueryResultVec* results);
     bool TagExists(uint32_t user_logspace, uint64_t tag);
+    // Cached seqnums of `tag` following `seqnum`, used for read-ahead
+    void GetNextSeqnums(uint32_t user_logspace, uint64_t tag, uint64_t seqnum, size_t max_count,
+                        std::vector<IndexFoundResult>* results);
+    // Drops cached seqnums below `trim_seqnum`, of all tags if `user_tag` is empty
+    void Trim(uint32_t user_logspace, uint64_t user_tag, uint64_t trim_seqnum);
     void InstallView(uint16_t view_id, uint32_t metalog_position);
     void Clear();
     void Aggregate(size_t* num_tags, size_t* num_seqnums, size_t* size);
@@ -151,7 +199,7 @@ private:
     uint32_t per_tag_seqnums_limit_;
     size_t cache_size_;
 
-    std::vector<uint64_t> popularity_sequence_;
+    TagClock clock_;
 
     static constexpr uint32_t kMaxMetalogPosition = std::numeric_limits<uint32_t>::max();
 
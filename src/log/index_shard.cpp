@@ -3,10 +3,19 @@
 namespace faas {
 namespace log {
 
-IndexShard::IndexShard(const View* view, uint16_t sequencer_id, uint16_t index_shard_id, size_t num_shards)
+namespace {
+static constexpr uint32_t kCheckpointMagic   = 0x58444946;  // "FIDX"
+static constexpr uint32_t kCheckpointVersion = 2;
+}  // namespace
+
+IndexShard::IndexShard(const View* view, uint16_t sequencer_id, uint16_t index_shard_id,
+                       size_t num_shards, bool partition_by_tag)
     : Index(view, sequencer_id),
-      num_shards_(num_shards) {
-    indexed_metalog_position_ = uint32_t(index_shard_id);
+      index_shard_id_(index_shard_id),
+      num_shards_(num_shards),
+      partition_by_tag_(partition_by_tag && num_shards > 1),
+      metalog_stride_(partition_by_tag_ ? 1 : uint32_t(num_shards)) {
+    indexed_metalog_position_ = partition_by_tag_ ? 0 : uint32_t(index_shard_id);
 }
 
 IndexShard::~IndexShard() {}
@@ -16,6 +25,7 @@ void IndexShard::ProvideIndexData(const IndexDataProto& index_data) {
     DCHECK_EQ(n, index_data.engine_ids_size());
     DCHECK_EQ(n, index_data.user_logspaces_size());
     DCHECK_EQ(n, index_data.user_tag_sizes_size());
+    bool owns_position = OwnsMetalogPosition(index_data.metalog_position());
     auto tag_iter = index_data.user_tags().begin();
     for (int i = 0; i < n; i++) {
         size_t num_tags = index_data.user_tag_sizes(i);
@@ -25,12 +35,21 @@ void IndexShard::ProvideIndexData(const IndexDataProto& index_data) {
             tag_iter += num_tags;
             continue;
         }
+        uint32_t user_logspace = index_data.user_logspaces(i);
         if (received_data_.count(seqnum) == 0) {
-           received_data_[seqnum] = IndexData {
-                .engine_id     = gsl::narrow_cast<uint16_t>(index_data.engine_ids(i)),
-                .user_logspace = index_data.user_logspaces(i),
-                .user_tags     = UserTagVec(tag_iter, tag_iter + num_tags)
-            };
+            UserTagVec user_tags;
+            for (auto iter = tag_iter; iter != tag_iter + num_tags; iter++) {
+                if (OwnsTag(user_logspace, *iter)) {
+                    user_tags.push_back(*iter);
+                }
+            }
+            if (owns_position || !user_tags.empty()) {
+                received_data_[seqnum] = IndexData {
+                    .engine_id     = gsl::narrow_cast<uint16_t>(index_data.engine_ids(i)),
+                    .user_logspace = user_logspace,
+                    .user_tags     = std::move(user_tags)
+                };
+            }
         }
         tag_iter += num_tags;
     }
@@ -42,7 +61,10 @@ bool IndexShard::AdvanceIndexProgress(const IndexDataProto& index_data) {
     }
     bool advanced = false;
     uint32_t end_seqnum_position;
+    uint32_t metalog_position = indexed_metalog_position_ + 1;
     while(TryCompleteIndexUpdates(&end_seqnum_position)){
+        // Remaining received data below end_seqnum_position all belongs to metalog_position
+        bool owns_position = OwnsMetalogPosition(metalog_position);
         {
             auto iter = received_data_.begin();
             while (iter != received_data_.end()) {
@@ -51,8 +73,12 @@ bool IndexShard::AdvanceIndexProgress(const IndexDataProto& index_data) {
                     break;
                 }
                 const IndexData& index_data = iter->second;
-                GetOrCreateIndex(index_data.user_logspace)->Add(
-                    seqnum, index_data.engine_id, index_data.user_tags);
+                PerSpaceIndex* index = GetOrCreateIndex(index_data.user_logspace);
+                if (owns_position) {
+                    index->Add(seqnum, index_data.engine_id, index_data.user_tags);
+                } else {
+                    index->AddTags(seqnum, index_data.engine_id, index_data.user_tags);
+                }
                 iter = received_data_.erase(iter);
             }
         }
@@ -82,6 +108,7 @@ bool IndexShard::AdvanceIndexProgress(const IndexDataProto& index_data) {
             iter = pending_queries_.erase(iter);
         }
         advanced = true;
+        metalog_position = indexed_metalog_position_ + 1;
     }
     return advanced;
 }
@@ -140,8 +167,8 @@ bool IndexShard::TryCompleteIndexUpdates(uint32_t* end_seqnum_position){
         return false;
     }
     if (entry.first == entry.second.size()){
-        // updates from all active storage shards received -> jump to next metalog based on number of shards
-        indexed_metalog_position_ = indexed_metalog_position_ + uint32_t(num_shards_);
+        // updates from all active storage shards received -> jump to next metalog of this shard
+        indexed_metalog_position_ = indexed_metalog_position_ + metalog_stride_;
         *end_seqnum_position = end_seqnum_positions_.at(next_index_metalog_position);
         storage_shards_index_updates_.erase(next_index_metalog_position);
         end_seqnum_positions_.erase(next_index_metalog_position);
@@ -152,11 +179,190 @@ bool IndexShard::TryCompleteIndexUpdates(uint32_t* end_seqnum_position){
     return false;
 }
 
+std::unique_ptr<IndexShard::CheckpointSnapshot> IndexShard::TakeCheckpointSnapshot() const {
+    auto snapshot = std::make_unique<CheckpointSnapshot>();
+    snapshot->logspace_id = identifier();
+    snapshot->num_shards = gsl::narrow_cast<uint32_t>(num_shards_);
+    snapshot->partition_by_tag = partition_by_tag_;
+    snapshot->indexed_metalog_position = indexed_metalog_position_;
+    snapshot->indexed_seqnum_position = indexed_seqnum_position_;
+    snapshot->data_received_seqnum_position = data_received_seqnum_position_;
+    snapshot->indices.reserve(index_.size());
+    for (const auto& [user_logspace, index] : index_) {
+        snapshot->indices.push_back(index->Clone());
+    }
+    snapshot->received_data = received_data_;
+    snapshot->index_updates = storage_shards_index_updates_;
+    snapshot->end_seqnum_positions = end_seqnum_positions_;
+    return snapshot;
+}
+
+std::string IndexShard::EncodeCheckpoint(const CheckpointSnapshot& snapshot) {
+    CheckpointWriter writer;
+    writer.PutFixed32(kCheckpointMagic);
+    writer.PutFixed32(kCheckpointVersion);
+    writer.PutFixed32(snapshot.logspace_id);
+    writer.PutFixed32(snapshot.num_shards);
+    writer.PutFixed32(snapshot.partition_by_tag ? 1 : 0);
+    writer.PutFixed32(snapshot.indexed_metalog_position);
+    writer.PutFixed32(snapshot.indexed_seqnum_position);
+    writer.PutFixed32(snapshot.data_received_seqnum_position);
+    writer.PutVarint(snapshot.indices.size());
+    for (const auto& index : snapshot.indices) {
+        index->EncodeTo(&writer);
+    }
+    writer.PutVarint(snapshot.received_data.size());
+    for (const auto& [seqnum, index_data] : snapshot.received_data) {
+        writer.PutFixed32(seqnum);
+        writer.PutVarint(index_data.engine_id);
+        writer.PutFixed32(index_data.user_logspace);
+        writer.PutVarint(index_data.user_tags.size());
+        for (uint64_t user_tag : index_data.user_tags) {
+            writer.PutFixed64(user_tag);
+        }
+    }
+    writer.PutVarint(snapshot.index_updates.size());
+    for (const auto& [metalog_position, updates] : snapshot.index_updates) {
+        writer.PutFixed32(metalog_position);
+        writer.PutFixed32(snapshot.end_seqnum_positions.at(metalog_position));
+        writer.PutVarint(updates.first);
+        writer.PutVarint(updates.second.size());
+        for (uint16_t storage_shard_id : updates.second) {
+            writer.PutVarint(storage_shard_id);
+        }
+    }
+    return writer.Finish();
+}
+
+bool IndexShard::LoadCheckpoint(std::span<const char> data) {
+    DCHECK(index_.empty() && received_data_.empty() && storage_shards_index_updates_.empty());
+    CheckpointReader reader(data);
+    if (!reader.valid()) {
+        HLOG(WARNING) << "Checksum mismatch of index checkpoint";
+        return false;
+    }
+    uint32_t magic, version, logspace_id, num_shards, partition_by_tag;
+    uint32_t metalog_position, indexed_seqnum_position, data_received_seqnum_position;
+    if (!reader.GetFixed32(&magic) || magic != kCheckpointMagic
+            || !reader.GetFixed32(&version) || version != kCheckpointVersion) {
+        HLOG(WARNING) << "Unknown index checkpoint format";
+        return false;
+    }
+    if (!reader.GetFixed32(&logspace_id) || !reader.GetFixed32(&num_shards)
+            || !reader.GetFixed32(&partition_by_tag)
+            || !reader.GetFixed32(&metalog_position)
+            || !reader.GetFixed32(&indexed_seqnum_position)
+            || !reader.GetFixed32(&data_received_seqnum_position)) {
+        HLOG(WARNING) << "Truncated index checkpoint";
+        return false;
+    }
+    // A fresh shard is at its first position, which fixes positions modulo the stride
+    if (logspace_id != identifier() || num_shards != num_shards_
+            || (partition_by_tag != 0) != partition_by_tag_
+            || metalog_position < indexed_metalog_position_
+            || metalog_position % metalog_stride_ != indexed_metalog_position_ % metalog_stride_) {
+        HLOG_F(WARNING, "Index checkpoint of another shard: logspace_id={}, num_shards={}, "
+                        "metalog_position={}", bits::HexStr0x(logspace_id), num_shards,
+               metalog_position);
+        return false;
+    }
+
+    absl::flat_hash_map<uint32_t, std::unique_ptr<PerSpaceIndex>> index;
+    std::map<uint32_t, IndexData> received_data;
+    absl::flat_hash_map<uint32_t, std::pair<size_t, absl::flat_hash_set<uint16_t>>> index_updates;
+    absl::flat_hash_map<uint32_t, uint32_t> end_seqnum_positions;
+    auto decode_body = [&] () -> bool {
+        size_t num_indices;
+        if (!reader.GetVarint(&num_indices)) {
+            return false;
+        }
+        for (size_t i = 0; i < num_indices; i++) {
+            auto per_space_index = PerSpaceIndex::DecodeFrom(identifier(), &reader);
+            if (per_space_index == nullptr) {
+                return false;
+            }
+            uint32_t user_logspace = per_space_index->user_logspace();
+            if (!index.emplace(user_logspace, std::move(per_space_index)).second) {
+                return false;
+            }
+        }
+        size_t num_received;
+        if (!reader.GetVarint(&num_received)) {
+            return false;
+        }
+        for (size_t i = 0; i < num_received; i++) {
+            uint32_t seqnum;
+            IndexData index_data;
+            size_t num_tags;
+            if (!reader.GetFixed32(&seqnum) || !reader.GetVarint(&index_data.engine_id)
+                    || !reader.GetFixed32(&index_data.user_logspace)
+                    || !reader.GetVarint(&num_tags)) {
+                return false;
+            }
+            for (size_t j = 0; j < num_tags; j++) {
+                uint64_t user_tag;
+                if (!reader.GetFixed64(&user_tag)) {
+                    return false;
+                }
+                index_data.user_tags.push_back(user_tag);
+            }
+            received_data[seqnum] = std::move(index_data);
+        }
+        size_t num_updates;
+        if (!reader.GetVarint(&num_updates)) {
+            return false;
+        }
+        for (size_t i = 0; i < num_updates; i++) {
+            uint32_t position, end_seqnum_position;
+            size_t num_productive_shards, num_shards_received;
+            if (!reader.GetFixed32(&position) || !reader.GetFixed32(&end_seqnum_position)
+                    || !reader.GetVarint(&num_productive_shards)
+                    || !reader.GetVarint(&num_shards_received)) {
+                return false;
+            }
+            auto& updates = index_updates[position];
+            updates.first = num_productive_shards;
+            for (size_t j = 0; j < num_shards_received; j++) {
+                uint16_t storage_shard_id;
+                if (!reader.GetVarint(&storage_shard_id)) {
+                    return false;
+                }
+                updates.second.insert(storage_shard_id);
+            }
+            end_seqnum_positions[position] = end_seqnum_position;
+        }
+        return reader.done();
+    };
+    if (!decode_body()) {
+        HLOG(WARNING) << "Malformed index checkpoint";
+        return false;
+    }
+
+    index_ = std::move(index);
+    received_data_ = std::move(received_data);
+    storage_shards_index_updates_ = std::move(index_updates);
+    end_seqnum_positions_ = std::move(end_seqnum_positions);
+    indexed_metalog_position_ = metalog_position;
+    indexed_seqnum_position_ = indexed_seqnum_position;
+    data_received_seqnum_position_ = data_received_seqnum_position;
+    HLOG_F(INFO, "Loaded index checkpoint: metalog_position={}, user_logspaces={}",
+           indexed_metalog_position_, index_.size());
+    return true;
+}
+
+bool IndexShard::OwnsMetalogPosition(uint32_t metalog_position) const {
+    return !partition_by_tag_ || (metalog_position - 1) % num_shards_ == index_shard_id_;
+}
+
+bool IndexShard::OwnsTag(uint32_t user_logspace, uint64_t user_tag) const {
+    return !partition_by_tag_ || view_->TagIndexShard(user_logspace, user_tag) == index_shard_id_;
+}
+
 uint64_t IndexShard::index_metalog_progress() const {
     uint32_t real_index_metalog_progress = indexed_metalog_position_;
     uint32_t num_other_shards = 0;
-    if (0 < num_shards_) {
-        num_other_shards = uint32_t(num_shards_) - 1;
+    if (0 < metalog_stride_) {
+        num_other_shards = metalog_stride_ - 1;
     }
     if (real_index_metalog_progress <= num_other_shards) {
         real_index_metalog_progress = 0;
@@ -9,17 +9,54 @@ class IndexShard final : public Index {
     
 public:
 
-    IndexShard(const View* view, uint16_t sequencer_id, uint16_t index_shard_id, size_t num_shards);
+    // If `partition_by_tag`, the shard receives index data of all metalog
+    // positions, keeps seqnums of its own positions, and tag indices of the
+    // tags it owns (see View::TagIndexShard). Otherwise it keeps all index
+    // data of its own positions.
+    IndexShard(const View* view, uint16_t sequencer_id, uint16_t index_shard_id,
+               size_t num_shards, bool partition_by_tag);
     ~IndexShard();
 
     void ProvideIndexData(const IndexDataProto& index_data);
     bool AdvanceIndexProgress(const IndexDataProto& index_data);
 
+    uint32_t indexed_metalog_position() const { return indexed_metalog_position_; }
+
+    // Index contents and progress, including received index data of
+    // metalog positions not yet complete. Full seqnum blocks are shared
+    // with the shard, so a snapshot is cheap to take under the shard lock,
+    // and is encoded outside of it.
+    struct CheckpointSnapshot {
+        uint32_t logspace_id;
+        uint32_t num_shards;
+        bool     partition_by_tag;
+        uint32_t indexed_metalog_position;
+        uint32_t indexed_seqnum_position;
+        uint32_t data_received_seqnum_position;
+        std::vector<std::unique_ptr<PerSpaceIndex>> indices;
+        std::map</* seqnum */ uint32_t, IndexData> received_data;
+        absl::flat_hash_map</* metalog_position */ uint32_t,
+                            std::pair<size_t, absl::flat_hash_set<uint16_t>>> index_updates;
+        absl::flat_hash_map</* metalog_position */ uint32_t, uint32_t> end_seqnum_positions;
+    };
+    std::unique_ptr<CheckpointSnapshot> TakeCheckpointSnapshot() const;
+    static std::string EncodeCheckpoint(const CheckpointSnapshot& snapshot);
+    // Only for a newly created shard. Returns false and keeps the shard
+    // empty if the checkpoint is malformed or of another shard
+    bool LoadCheckpoint(std::span<const char> data);
+
 private:
 
     absl::flat_hash_map<uint32_t /* metalog_position */, std::pair<size_t, absl::flat_hash_set<uint16_t>>> storage_shards_index_updates_;
     absl::flat_hash_map<uint32_t /* metalog_position */, uint32_t> end_seqnum_positions_;
+    uint16_t index_shard_id_;
     size_t num_shards_;
+    bool partition_by_tag_;
+    // Distance between consecutive metalog positions indexed by this shard
+    uint32_t metalog_stride_;
+
+    bool OwnsMetalogPosition(uint32_t metalog_position) const;
+    bool OwnsTag(uint32_t user_logspace, uint64_t user_tag) const;
 
     bool TryCompleteIndexUpdates(uint32_t* seqnum_position);
     bool CheckIfNewIndexData(const IndexDataProto& index_data);
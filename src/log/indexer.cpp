@@ -2,9 +2,12 @@
 
 #include "log/flags.h"
 #include "utils/bits.h"
+#include "utils/fs.h"
 #include "utils/io.h"
 #include "utils/timerfd.h"
 
+#include <poll.h>
+
 namespace faas {
 namespace log {
 
@@ -18,7 +21,8 @@ Indexer::Indexer(uint16_t node_id)
       log_header_(fmt::format("Indexer[{}-N]: ", node_id)),
       current_view_(nullptr),
       current_view_active_(false),
-      per_tag_seqnum_min_completion_(absl::GetFlag(FLAGS_slog_activate_min_seqnum_completion)) {}
+      per_tag_seqnum_min_completion_(absl::GetFlag(FLAGS_slog_activate_min_seqnum_completion)),
+      index_partition_by_tag_(absl::GetFlag(FLAGS_slog_index_partition_by_tag)) {}
 
 Indexer::~Indexer() {}
 
@@ -30,8 +34,21 @@ void Indexer::OnViewCreated(const View* view) {
         HLOG_F(WARNING, "View {} does not include myself", view->id());
     }
     std::vector<SharedLogRequest> ready_requests;
+    std::vector<std::pair</* logspace_id */ uint32_t,
+                          /* metalog_position */ uint32_t>> restored_shards;
     {
         absl::MutexLock view_lk(&view_mu_);
+        if (index_partition_by_tag_ && !views_.empty()) {
+            // Reads continued into older views query the local shard, which
+            // owns the same tags only if the shard count never changes
+            const View* previous_view = views_.back();
+            if (view->num_index_shards() != previous_view->num_index_shards()) {
+                HLOG_F(FATAL, "View {} has {} index shards, while view {} has {}, "
+                              "which tag partitioning does not support",
+                       view->id(), view->num_index_shards(),
+                       previous_view->id(), previous_view->num_index_shards());
+            }
+        }
         if (contains_myself) {
             for (uint16_t sequencer_id : view->GetSequencerNodes()) {
                 if (!view->is_active_phylog(sequencer_id)) {
@@ -39,7 +56,14 @@ void Indexer::OnViewCreated(const View* view) {
                 }
                 //TODO: currently all index nodes have indexes for active sequencers
                 HLOG_F(INFO, "Create logspace for view {} and sequencer {}", view->id(), sequencer_id);
-                index_collection_.InstallLogSpace(std::make_unique<IndexShard>(view, sequencer_id, my_node_id() % view->num_index_shards(), view->num_index_shards()));
+                auto index = std::make_unique<IndexShard>(
+                    view, sequencer_id, my_node_id() % view->num_index_shards(),
+                    view->num_index_shards(), index_partition_by_tag_);
+                if (!checkpoint_path().empty() && LoadIndexCheckpoint(index.get())) {
+                    restored_shards.push_back(std::make_pair(
+                        index->identifier(), index->indexed_metalog_position()));
+                }
+                index_collection_.InstallLogSpace(std::move(index));
                 view_mutable_.InitializeCurrentEngineNodeIds(sequencer_id);
             }
         }
@@ -50,6 +74,18 @@ void Indexer::OnViewCreated(const View* view) {
         }
         views_.push_back(view);
         log_header_ = fmt::format("Index[{}-{}]: ", my_node_id(), view->id());
+        PublishViewSnapshot();
+    }
+    if (!restored_shards.empty()) {
+        // Index data sent while this node was down is missing after the
+        // restored positions
+        SomeIOWorker()->ScheduleFunction(
+            nullptr, [this, view, restored_shards = std::move(restored_shards)] () {
+                for (const auto& [logspace_id, metalog_position] : restored_shards) {
+                    SendIndexCatchupRequests(view, logspace_id, metalog_position);
+                }
+            }
+        );
     }
     if (!ready_requests.empty()) {
         HLOG_F(INFO, "{} requests for the new view", ready_requests.size());
@@ -61,6 +97,31 @@ void Indexer::OnViewCreated(const View* view) {
     }
 }
 
+// Index shards are finalized in place, so only view creation changes the snapshot
+void Indexer::PublishViewSnapshot() {
+    auto snapshot = std::make_unique<ViewSnapshot>();
+    snapshot->view = current_view_;
+    snapshot->views = views_;
+    auto add_index = [&snapshot] (uint32_t logspace_id, LockablePtr<IndexShard> index_ptr) {
+        snapshot->index_shards[logspace_id] = index_ptr;
+    };
+    index_collection_.ForEachActiveLogSpace(add_index);
+    index_collection_.ForEachFinalizedLogSpace(add_index);
+    view_snapshot_.Publish(std::move(snapshot));
+}
+
+const View* Indexer::FindView(uint16_t view_id) {
+    {
+        utils::EpochGuard epoch_guard;
+        const ViewSnapshot* snapshot = view_snapshot_.Load();
+        if (snapshot != nullptr && view_id < snapshot->views.size()) {
+            return snapshot->views.at(view_id);
+        }
+    }
+    absl::ReaderMutexLock view_lk(&view_mu_);
+    return view_id < views_.size() ? views_.at(view_id) : nullptr;
+}
+
 void Indexer::OnViewFinalized(const FinalizedView* finalized_view) {
     DCHECK(zk_session()->WithinMyEventLoopThread());
     HLOG_F(INFO, "View {} finalized", finalized_view->view()->id());
@@ -128,6 +189,16 @@ void Indexer::HandleReadRequest(const SharedLogMessage& request) {
           || request.aggregator_type == protocol::kUseAggregator);
     LockablePtr<IndexShard> index_ptr;
     {
+        utils::EpochGuard epoch_guard;
+        const ViewSnapshot* snapshot = view_snapshot_.Load();
+        if (snapshot != nullptr && request.view_id <= snapshot->view->id()) {
+            if (auto iter = snapshot->index_shards.find(request.logspace_id);
+                    iter != snapshot->index_shards.end()) {
+                index_ptr = iter->second;
+            }
+        }
+    }
+    if (index_ptr == nullptr) {
         absl::ReaderMutexLock view_lk(&view_mu_);
         ONHOLD_IF_FROM_FUTURE_VIEW(request, EMPTY_CHAR_SPAN);
         // TODO: index nodes have all physical log spaces?
@@ -191,7 +262,9 @@ void Indexer::OnRecvNewIndexData(const SharedLogMessage& message,
         uint16_t shard_id = my_node_id() % view->num_index_shards();
         std::vector<int> relevant_packages;
         for (int i = 0; i < index_data_packages.index_data_proto_size(); i++) {
-            if ((index_data_packages.index_data_proto().at(i).metalog_position() - 1) % view->num_index_shards() == shard_id) {
+            // With tag partitioning, every shard tracks all metalog positions
+            if (index_partition_by_tag_
+                  || (index_data_packages.index_data_proto().at(i).metalog_position() - 1) % view->num_index_shards() == shard_id) {
                 relevant_packages.push_back(i);
             }
         }
@@ -301,6 +374,15 @@ void Indexer::ProcessIndexResult(const IndexQueryResult& my_query_result) {
     if (my_query_result.IsPointHit()){
         ForwardReadRequest(my_query_result);
     }
+    if (index_partition_by_tag_ && my_query_result.original_query.user_tag != kEmptyLogTag) {
+        // Only this shard indexes the tag, there is nothing to aggregate
+        if (my_query_result.IsFound() && !my_query_result.IsPointHit()) {
+            ForwardReadRequest(my_query_result);
+        } else if (!my_query_result.IsFound()) {
+            SendIndexReadFailureResponse(my_query_result.original_query, protocol::SharedLogResultType::EMPTY);
+        }
+        return;
+    }
     if (my_query_result.original_query.aggregate_type == protocol::kUseAggregator || my_query_result.original_query.master_node_id != my_node_id()){
         SendMasterIndexResult(my_query_result);
         return;
@@ -364,6 +446,8 @@ void Indexer::ProcessIndexContinueResult(const IndexQueryResult& query_result,
         }
         const View* view = views_.at(view_id);
         uint32_t logspace_id = view->LogSpaceIdentifier(query.user_logspace);
+        // With tag partitioning, the local shard of the older view owns the
+        // same tags, as OnViewCreated keeps the shard count across views
         // TODO: index node has index for all sequencers?
         index_ptr = index_collection_.GetLogSpaceChecked(logspace_id);
     }
@@ -382,10 +466,8 @@ void Indexer::ForwardReadRequest(const IndexQueryResult& query_result){
     const View::StorageShard* storage_shard = nullptr;
     uint32_t logspace_id;
     {
-        absl::ReaderMutexLock view_lk(&view_mu_);
         uint16_t view_id = query_result.found_result.view_id;
-        if (view_id < views_.size()) {
-            const View* view = views_.at(view_id);
+        if (const View* view = FindView(view_id); view != nullptr) {
             storage_shard = view->GetStorageShard(query_result.StorageShardId());
             logspace_id = view->LogSpaceIdentifier(query_result.original_query.user_logspace);
         } else {
@@ -515,8 +597,88 @@ IndexQueryResult Indexer::BuildIndexResult(protocol::SharedLogMessage message){
     };
 }
 
+void Indexer::BackgroundThreadMain() {
+    int timerfd = io_utils::CreateTimerFd();
+    CHECK(timerfd != -1) << "Failed to create timerfd";
+    absl::Duration interval = absl::Seconds(
+        absl::GetFlag(FLAGS_slog_index_checkpoint_interval_sec));
+    CHECK(io_utils::SetupTimerFdPeriodic(timerfd, interval, interval))
+        << "Failed to setup timerfd with interval " << interval;
+    struct pollfd pollfds[2] = {
+        { .fd = timerfd, .events = POLLIN, .revents = 0 },
+        { .fd = background_stop_fd(), .events = POLLIN, .revents = 0 }
+    };
+    bool running = true;
+    while (running) {
+        int ret = poll(pollfds, 2, /* timeout= */ -1);
+        if (ret < 0 && errno == EINTR) {
+            continue;
+        }
+        PCHECK(ret >= 0) << "poll failed";
+        if (pollfds[0].revents & POLLIN) {
+            uint64_t exp;
+            PCHECK(read(timerfd, &exp, sizeof(uint64_t)) == sizeof(uint64_t))
+                << "Failed to read on timerfd";
+        }
+        // Checkpoint the latest progress before stopping as well
+        FlushIndexEntries();
+        running = (pollfds[1].revents & POLLIN) == 0;
+    }
+    close(timerfd);
+}
+
+// Checkpoints index shards that advanced since their last checkpoint. A
+// restarted index node loads them, and asks storage nodes for index data
+// beyond. Shards are only locked to take snapshots, which are encoded and
+// written outside of the lock.
 void Indexer::FlushIndexEntries() {
-    //TODO: persist index data
+    std::vector<std::pair<uint32_t, LockablePtr<IndexShard>>> index_shards;
+    {
+        utils::EpochGuard epoch_guard;
+        const ViewSnapshot* snapshot = view_snapshot_.Load();
+        if (snapshot == nullptr) {
+            return;
+        }
+        index_shards.assign(snapshot->index_shards.begin(), snapshot->index_shards.end());
+    }
+    for (auto& [logspace_id, index_ptr] : index_shards) {
+        std::unique_ptr<IndexShard::CheckpointSnapshot> snapshot;
+        {
+            auto locked_index = index_ptr.Lock();
+            uint32_t position = locked_index->indexed_metalog_position();
+            if (auto iter = checkpointed_positions_.find(logspace_id);
+                    iter != checkpointed_positions_.end() && iter->second == position) {
+                continue;
+            }
+            snapshot = locked_index->TakeCheckpointSnapshot();
+        }
+        uint32_t position = snapshot->indexed_metalog_position;
+        std::string data = IndexShard::EncodeCheckpoint(*snapshot);
+        snapshot.reset();
+        std::string path = IndexCheckpointPath(checkpoint_path(), logspace_id);
+        if (!WriteIndexCheckpoint(path, STRING_AS_SPAN(data))) {
+            HLOG_F(ERROR, "Failed to checkpoint index of logspace {}", bits::HexStr0x(logspace_id));
+            continue;
+        }
+        checkpointed_positions_[logspace_id] = position;
+        HVLOG_F(1, "Checkpoint index of logspace {}: metalog_position={}, size={}",
+                bits::HexStr0x(logspace_id), position, data.size());
+    }
+}
+
+bool Indexer::LoadIndexCheckpoint(IndexShard* index) {
+    std::string path = IndexCheckpointPath(checkpoint_path(), index->identifier());
+    if (!fs_utils::IsFile(path)) {
+        return false;
+    }
+    std::string data;
+    if (!fs_utils::ReadContents(path, &data) || !index->LoadCheckpoint(STRING_AS_SPAN(data))) {
+        HLOG_F(WARNING, "Ignore index checkpoint {}", path);
+        return false;
+    }
+    HLOG_F(INFO, "Restored index of logspace {} from checkpoint",
+           bits::HexStr0x(index->identifier()));
+    return true;
 }
 
 }  // namespace log
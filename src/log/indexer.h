@@ -33,11 +33,24 @@ private:
     LogSpaceCollection<IndexShard>
         index_collection_            ABSL_GUARDED_BY(view_mu_);
 
+    // Immutable copy of the views and index shards, republished under
+    // view_mu_. Requests of future views go through view_mu_.
+    struct ViewSnapshot {
+        const View* view;
+        std::vector<const View*> views;
+        absl::flat_hash_map</* logspace_id */ uint32_t, LockablePtr<IndexShard>> index_shards;
+    };
+    utils::EpochPtr<ViewSnapshot> view_snapshot_;
+    void PublishViewSnapshot() ABSL_EXCLUSIVE_LOCKS_REQUIRED(view_mu_);
+    // Returns nullptr if view `view_id` is not created yet
+    const View* FindView(uint16_t view_id);
+
     log_utils::FutureRequests future_requests_;
 
     absl::flat_hash_map</*engine_id*/uint16_t, std::unique_ptr<EngineIndexReadOp>> ongoing_engine_index_reads_ ABSL_GUARDED_BY(view_mu_);
 
     bool per_tag_seqnum_min_completion_;
+    bool index_partition_by_tag_;
     PerTagMinSeqnumTable per_tag_min_seqnum_table_;
 
     void OnViewCreated(const View* view) override;
@@ -64,7 +77,14 @@ private:
 
     void ForwardReadRequest(const IndexQueryResult& query_result);
    
+    // Last checkpointed metalog position of each index shard, only
+    // accessed by the background thread
+    absl::flat_hash_map</* logspace_id */ uint32_t, uint32_t> checkpointed_positions_;
+
+    void BackgroundThreadMain() override;
     void FlushIndexEntries();
+    // Returns true if `index` is restored
+    bool LoadIndexCheckpoint(IndexShard* index);
 
     protocol::SharedLogMessage BuildReadRequestMessage(const IndexQueryResult& result);
 
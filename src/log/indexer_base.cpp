@@ -4,6 +4,8 @@
 #include "server/constants.h"
 #include "utils/fs.h"
 
+#include <sys/eventfd.h>
+
 #define log_header_ "IndexerBase: "
 
 namespace faas {
@@ -23,15 +25,33 @@ using server::NodeWatcher;
 
 IndexerBase::IndexerBase(uint16_t node_id)
     : ServerBase(node_id, fmt::format("index_{}", node_id), NodeType::kIndexNode),
-      node_id_(node_id) {}
+      node_id_(node_id),
+      background_thread_("BG", [this] { this->BackgroundThreadMain(); }),
+      background_stop_fd_(eventfd(0, EFD_CLOEXEC)) {
+    PCHECK(background_stop_fd_ >= 0) << "Failed to create eventfd";
+}
 
-IndexerBase::~IndexerBase() {}
+IndexerBase::~IndexerBase() {
+    PCHECK(close(background_stop_fd_) == 0) << "Failed to close eventfd";
+}
 
 void IndexerBase::StartInternal() {
+    if (!checkpoint_path_.empty()) {
+        CHECK(fs_utils::IsDirectory(checkpoint_path_) || fs_utils::MakeDirectory(checkpoint_path_))
+            << "Failed to create checkpoint directory " << checkpoint_path_;
+    }
     SetupZKWatchers();
+    if (!checkpoint_path_.empty()) {
+        background_thread_.Start();
+    }
 }
 
-void IndexerBase::StopInternal() {}
+void IndexerBase::StopInternal() {
+    if (!checkpoint_path_.empty()) {
+        PCHECK(eventfd_write(background_stop_fd_, 1) == 0) << "eventfd_write failed";
+        background_thread_.Join();
+    }
+}
 
 void IndexerBase::SetupZKWatchers() {
     view_watcher_.SetViewCreatedCallback(
@@ -195,6 +215,18 @@ bool IndexerBase::SendStorageReadRequest(const IndexQueryResult& result,
     return false;
 }
 
+void IndexerBase::SendIndexCatchupRequests(const View* view, uint32_t logspace_id,
+                                           uint32_t metalog_position) {
+    SharedLogMessage request = SharedLogMessageHelper::NewIndexCatchupMessage(
+        logspace_id, metalog_position);
+    request.origin_node_id = node_id_;
+    for (uint16_t storage_id : view->GetStorageNodes()) {
+        if (!SendSharedLogMessage(protocol::ConnType::INDEX_TO_STORAGE, storage_id, request)) {
+            HLOG_F(ERROR, "Failed to send index catch-up request to storage node {}", storage_id);
+        }
+    }
+}
+
 void IndexerBase::SendRegistrationResponse(const SharedLogMessage& request, SharedLogMessage* response) {
     response->origin_node_id = node_id_;
     response->hop_times = request.hop_times + 1;
@@ -22,8 +22,14 @@ public:
     void StartInternal() override;
     void StopInternal() override;
 
+    // Index checkpoints are disabled if not set
+    void set_checkpoint_path(std::string_view path) { checkpoint_path_ = std::string(path); }
+
 protected:
     uint16_t my_node_id() const { return node_id_; }
+    const std::string& checkpoint_path() const { return checkpoint_path_; }
+    // Readable once the background thread should stop
+    int background_stop_fd() const { return background_stop_fd_; }
 
     virtual void OnViewCreated(const View* view) = 0;
     virtual void OnViewFinalized(const FinalizedView* finalized_view) = 0;
@@ -35,6 +41,7 @@ protected:
     virtual void HandleSlaveResult(const protocol::SharedLogMessage& message) = 0;
     virtual void OnRecvRegistration(const protocol::SharedLogMessage& message) = 0;
     virtual void RemoveEngineNode(uint16_t engine_node_id) = 0;
+    virtual void BackgroundThreadMain() = 0;
 
     void MessageHandler(const protocol::SharedLogMessage& message,
                         std::span<const char> payload);
@@ -45,10 +52,17 @@ protected:
     void BroadcastIndexReadResponse(const IndexQueryResult& result, const std::vector<uint16_t>& engine_ids, uint32_t logspace_id);
     void SendIndexReadFailureResponse(const IndexQuery& query,  protocol::SharedLogResultType result);
     bool SendStorageReadRequest(const IndexQueryResult& result, const View::StorageShard* storage_shard_node);
+    // Asks all storage nodes of `view` to resend index data of `logspace_id`
+    // after `metalog_position`
+    void SendIndexCatchupRequests(const View* view, uint32_t logspace_id, uint32_t metalog_position);
     void SendRegistrationResponse(const protocol::SharedLogMessage& request, protocol::SharedLogMessage* response);
 
 private:
     const uint16_t node_id_;
+    std::string checkpoint_path_;
+
+    base::Thread background_thread_;
+    int background_stop_fd_;
 
     ViewWatcher view_watcher_;
 
@@ -0,0 +1,89 @@
+#include "log/log_record.h"
+
+namespace faas {
+namespace log {
+
+void EncodeLogRecordTo(const LogMetaData& metadata, std::span<const uint64_t> user_tags,
+                       std::span<const char> data, char* buf) {
+    DCHECK_EQ(metadata.num_tags, user_tags.size());
+    DCHECK_EQ(metadata.data_size, data.size());
+    LogRecordHeader header = {
+        .magic         = kLogRecordMagic,
+        .version       = kLogRecordVersion,
+        .num_tags      = gsl::narrow_cast<uint16_t>(user_tags.size()),
+        .user_logspace = metadata.user_logspace,
+        .seqnum        = metadata.seqnum,
+        .localid       = metadata.localid,
+        .data_size     = gsl::narrow_cast<uint32_t>(data.size()),
+        .reserved      = 0
+    };
+    size_t tags_size = user_tags.size() * sizeof(uint64_t);
+    char* ptr = buf;
+    memcpy(ptr, &header, sizeof(LogRecordHeader));
+    ptr += sizeof(LogRecordHeader);
+    if (tags_size > 0) {
+        memcpy(ptr, user_tags.data(), tags_size);
+        ptr += tags_size;
+    }
+    if (!data.empty()) {
+        memcpy(ptr, data.data(), data.size());
+    }
+}
+
+std::optional<LogRecord> LogRecord::Decode(std::string buffer) {
+    if (buffer.empty() || static_cast<uint8_t>(buffer[0]) != kLogRecordMagic) {
+        return DecodeLegacy(buffer);
+    }
+    if (buffer.size() < sizeof(LogRecordHeader)) {
+        LOG_F(ERROR, "Truncated log record: size={}", buffer.size());
+        return std::nullopt;
+    }
+    LogRecordHeader header;
+    memcpy(&header, buffer.data(), sizeof(LogRecordHeader));
+    if (header.version != kLogRecordVersion) {
+        LOG_F(ERROR, "Unknown log record version: {}", header.version);
+        return std::nullopt;
+    }
+    size_t expected_size = sizeof(LogRecordHeader)
+                         + size_t{header.num_tags} * sizeof(uint64_t)
+                         + size_t{header.data_size};
+    if (buffer.size() != expected_size) {
+        LOG_F(ERROR, "Log record size mismatch: expected={}, actual={}",
+              expected_size, buffer.size());
+        return std::nullopt;
+    }
+    LogRecord record;
+    record.metadata_ = LogMetaData {
+        .user_logspace = header.user_logspace,
+        .seqnum        = header.seqnum,
+        .localid       = header.localid,
+        .num_tags      = header.num_tags,
+        .data_size     = header.data_size
+    };
+    record.buffer_ = std::move(buffer);
+    return record;
+}
+
+std::optional<LogRecord> LogRecord::DecodeLegacy(const std::string& buffer) {
+    LogEntryProto log_entry_proto;
+    if (!log_entry_proto.ParseFromString(buffer)) {
+        LOG(ERROR) << "Failed to parse LogEntryProto";
+        return std::nullopt;
+    }
+    LogMetaData metadata = {
+        .user_logspace = log_entry_proto.user_logspace(),
+        .seqnum        = log_entry_proto.seqnum(),
+        .localid       = log_entry_proto.localid(),
+        .num_tags      = static_cast<size_t>(log_entry_proto.user_tags_size()),
+        .data_size     = log_entry_proto.data().size()
+    };
+    std::span<const uint64_t> user_tags(log_entry_proto.user_tags().data(),
+                                        metadata.num_tags);
+    std::string record;
+    record.resize(LogRecordSize(metadata.num_tags, metadata.data_size));
+    EncodeLogRecordTo(metadata, user_tags, STRING_AS_SPAN(log_entry_proto.data()), record.data());
+    return Decode(std::move(record));
+}
+
+}  // namespace log
+}  // namespace faas
@@ -0,0 +1,122 @@
+#pragma once
+
+#include "log/common.h"
+
+namespace faas {
+namespace log {
+
+// Binary layout of log entries persisted in DB:
+//   LogRecordHeader | user_tags (uint64_t[num_tags]) | data (char[data_size])
+// Integers are stored in host (little-endian) byte order.
+struct LogRecordHeader {
+    uint8_t  magic;
+    uint8_t  version;
+    uint16_t num_tags;
+    uint32_t user_logspace;
+    uint64_t seqnum;
+    uint64_t localid;
+    uint32_t data_size;
+    uint32_t reserved;
+};
+
+static_assert(sizeof(LogRecordHeader) == 32, "Unexpected LogRecordHeader size");
+
+// The first byte of a serialized LogEntryProto is a field tag, whose wire
+// type is never 6. So the magic byte tells the two encodings apart.
+constexpr uint8_t kLogRecordMagic   = 0xfe;
+constexpr uint8_t kLogRecordVersion = 1;
+
+inline size_t LogRecordSize(size_t num_tags, size_t data_size) {
+    return sizeof(LogRecordHeader) + num_tags * sizeof(uint64_t) + data_size;
+}
+
+// buf should have LogRecordSize(user_tags.size(), data.size()) bytes
+void EncodeLogRecordTo(const LogMetaData& metadata, std::span<const uint64_t> user_tags,
+                       std::span<const char> data, char* buf);
+
+// Read-only view of a persisted log entry. It owns the buffer read from DB,
+// and user tags and data point into it without further copies.
+class LogRecord {
+public:
+    // Accepts both the binary layout and the legacy LogEntryProto encoding
+    static std::optional<LogRecord> Decode(std::string buffer);
+
+    LogRecord(LogRecord&& other) = default;
+    LogRecord& operator=(LogRecord&& other) = default;
+
+    const LogMetaData& metadata() const { return metadata_; }
+    std::span<const uint64_t> user_tags() const {
+        return std::span<const uint64_t>(
+            reinterpret_cast<const uint64_t*>(buffer_.data() + sizeof(LogRecordHeader)),
+            metadata_.num_tags);
+    }
+    std::span<const char> user_tags_data() const {
+        return std::span<const char>(buffer_.data() + sizeof(LogRecordHeader),
+                                     metadata_.num_tags * sizeof(uint64_t));
+    }
+    std::span<const char> data() const {
+        return std::span<const char>(
+            buffer_.data() + sizeof(LogRecordHeader) + metadata_.num_tags * sizeof(uint64_t),
+            metadata_.data_size);
+    }
+
+private:
+    LogMetaData metadata_;
+    std::string buffer_;
+
+    LogRecord() = default;
+
+    static std::optional<LogRecord> DecodeLegacy(const std::string& buffer);
+
+    DISALLOW_COPY_AND_ASSIGN(LogRecord);
+};
+
+// Shared reference to an encoded log record in memory owned by someone else,
+// e.g. the slab of LogStorage. The memory stays alive with the reference.
+class LogRecordRef {
+public:
+    LogRecordRef() = default;
+    explicit LogRecordRef(std::shared_ptr<const char> record)
+        : record_(std::move(record)) {}
+
+    bool empty() const { return record_ == nullptr; }
+
+    const LogRecordHeader& header() const {
+        return *reinterpret_cast<const LogRecordHeader*>(record_.get());
+    }
+    LogMetaData metadata() const {
+        const LogRecordHeader& hdr = header();
+        return LogMetaData {
+            .user_logspace = hdr.user_logspace,
+            .seqnum        = hdr.seqnum,
+            .localid       = hdr.localid,
+            .num_tags      = hdr.num_tags,
+            .data_size     = hdr.data_size
+        };
+    }
+    std::span<const uint64_t> user_tags() const {
+        return std::span<const uint64_t>(
+            reinterpret_cast<const uint64_t*>(record_.get() + sizeof(LogRecordHeader)),
+            header().num_tags);
+    }
+    std::span<const char> user_tags_data() const {
+        return std::span<const char>(record_.get() + sizeof(LogRecordHeader),
+                                     header().num_tags * sizeof(uint64_t));
+    }
+    std::span<const char> data() const {
+        return std::span<const char>(
+            record_.get() + sizeof(LogRecordHeader) + header().num_tags * sizeof(uint64_t),
+            header().data_size);
+    }
+    // The whole record, which can be written to DB as is
+    std::span<const char> encoded() const {
+        return std::span<const char>(record_.get(),
+                                     LogRecordSize(header().num_tags, header().data_size));
+    }
+
+private:
+    std::shared_ptr<const char> record_;
+};
+
+}  // namespace log
+}  // namespace faas
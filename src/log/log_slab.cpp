@@ -0,0 +1,138 @@
+#include "log/log_slab.h"
+
+namespace faas {
+namespace log {
+
+struct LogRecordSlab::Chunk : public std::enable_shared_from_this<Chunk> {
+    std::unique_ptr<char[]> buf;
+    size_t size;
+    size_t used;
+    size_t num_records;
+};
+
+LogRecordSlab::LogRecordSlab()
+    : num_empty_chunks_(0) {}
+
+LogRecordSlab::~LogRecordSlab() {}
+
+LogRecordSlab::Record LogRecordSlab::Allocate(size_t size) {
+    size = (size + 7) & ~size_t{7};
+    if (chunks_.empty() || chunks_.back()->used + size > chunks_.back()->size) {
+        auto chunk = std::make_shared<Chunk>();
+        chunk->size = std::max(kChunkSize, size);
+        chunk->buf.reset(new char[chunk->size]);
+        chunk->used = 0;
+        chunk->num_records = 0;
+        if (!chunks_.empty() && chunks_.back()->num_records == 0) {
+            num_empty_chunks_++;
+        }
+        chunks_.push_back(std::move(chunk));
+    }
+    Chunk* chunk = chunks_.back().get();
+    Record record = {
+        .data  = chunk->buf.get() + chunk->used,
+        .chunk = chunk
+    };
+    chunk->used += size;
+    chunk->num_records++;
+    return record;
+}
+
+void LogRecordSlab::Release(Record record) {
+    DCHECK(record.data != nullptr);
+    Chunk* chunk = DCHECK_NOTNULL(record.chunk);
+    DCHECK_GT(chunk->num_records, 0U);
+    chunk->num_records--;
+    if (chunk->num_records == 0 && chunk != chunks_.back().get()) {
+        num_empty_chunks_++;
+        ReclaimChunks();
+    }
+}
+
+LogRecordRef LogRecordSlab::Ref(Record record) const {
+    DCHECK(record.data != nullptr);
+    // Aliasing constructor, which shares the reference count of the chunk
+    return LogRecordRef(std::shared_ptr<const char>(
+        DCHECK_NOTNULL(record.chunk)->shared_from_this(), record.data));
+}
+
+void LogRecordSlab::ReclaimChunks() {
+    if (num_empty_chunks_ == 0) {
+        return;
+    }
+    size_t n = chunks_.size() - 1;
+    auto iter = std::remove_if(chunks_.begin(), chunks_.begin() + n,
+                               [] (const std::shared_ptr<Chunk>& chunk) {
+                                   return chunk->num_records == 0;
+                               });
+    chunks_.erase(iter, chunks_.begin() + n);
+    num_empty_chunks_ = 0;
+}
+
+LogRecordRing::LogRecordRing()
+    : slots_(16, Record { nullptr, nullptr }),
+      mask_(15),
+      begin_(0),
+      end_(0),
+      size_(0) {}
+
+LogRecordRing::~LogRecordRing() {}
+
+LogRecordRing::Record LogRecordRing::Put(uint64_t id, Record record) {
+    DCHECK(record.data != nullptr);
+    if (size_ == 0) {
+        begin_ = id;
+        end_ = id + 1;
+    } else if (id < begin_ || id >= end_) {
+        uint64_t new_begin = std::min(begin_, id);
+        uint64_t new_end = std::max(end_, id + 1);
+        if (new_end - new_begin > slots_.size()) {
+            Grow(new_begin, new_end);
+        }
+        begin_ = new_begin;
+        end_ = new_end;
+    }
+    Record old_record = slots_[id & mask_];
+    slots_[id & mask_] = record;
+    if (old_record.data == nullptr) {
+        size_++;
+    }
+    return old_record;
+}
+
+LogRecordRing::Record LogRecordRing::Take(uint64_t id) {
+    if (!Contains(id)) {
+        return Record { nullptr, nullptr };
+    }
+    Record record = slots_[id & mask_];
+    slots_[id & mask_] = Record { nullptr, nullptr };
+    size_--;
+    if (size_ == 0) {
+        begin_ = end_;
+        return record;
+    }
+    while (slots_[begin_ & mask_].data == nullptr) {
+        begin_++;
+    }
+    while (slots_[(end_ - 1) & mask_].data == nullptr) {
+        end_--;
+    }
+    return record;
+}
+
+void LogRecordRing::Grow(uint64_t new_begin, uint64_t new_end) {
+    size_t capacity = slots_.size();
+    while (capacity < new_end - new_begin) {
+        capacity *= 2;
+    }
+    std::vector<Record> new_slots(capacity, Record { nullptr, nullptr });
+    uint64_t new_mask = capacity - 1;
+    for (uint64_t id = begin_; id < end_; id++) {
+        new_slots[id & new_mask] = slots_[id & mask_];
+    }
+    slots_.swap(new_slots);
+    mask_ = new_mask;
+}
+
+}  // namespace log
+}  // namespace faas
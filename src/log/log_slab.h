@@ -0,0 +1,95 @@
+#pragma once
+
+#include "log/log_record.h"
+
+namespace faas {
+namespace log {
+
+// Arena for encoded log records held by LogStorage. Records are carved from
+// large chunks, and a chunk is freed in bulk once all records in it are
+// released and no reader holds a LogRecordRef into it.
+class LogRecordSlab {
+public:
+    static constexpr size_t kChunkSize = 1 << 20;
+
+    LogRecordSlab();
+    ~LogRecordSlab();
+
+    struct Chunk;
+    struct Record {
+        char*  data;
+        Chunk* chunk;
+    };
+
+    // Returned memory is aligned to 8 bytes
+    Record Allocate(size_t size);
+    void Release(Record record);
+    LogRecordRef Ref(Record record) const;
+
+    size_t num_chunks() const { return chunks_.size(); }
+
+private:
+    std::vector<std::shared_ptr<Chunk>> chunks_;  // The last one is current
+    size_t num_empty_chunks_;
+
+    void ReclaimChunks();
+
+    DISALLOW_COPY_AND_ASSIGN(LogRecordSlab);
+};
+
+// Ring of slab records indexed by a growing id, i.e. seqnum or localid.
+// Ids within [begin(), end()) may have holes. The ring grows in power of 2,
+// and lookups are plain index arithmetic.
+class LogRecordRing {
+public:
+    LogRecordRing();
+    ~LogRecordRing();
+
+    using Record = LogRecordSlab::Record;
+
+    size_t size() const { return size_; }
+    bool empty() const { return size_ == 0; }
+    uint64_t begin() const { return begin_; }
+    uint64_t end() const { return end_; }
+
+    bool Contains(uint64_t id) const {
+        return id >= begin_ && id < end_ && slots_[id & mask_].data != nullptr;
+    }
+    // Record with nullptr data if not found
+    Record Get(uint64_t id) const {
+        return Contains(id) ? slots_[id & mask_] : Record { nullptr, nullptr };
+    }
+
+    // Returns the record previously stored with id, if any
+    Record Put(uint64_t id, Record record);
+    Record Take(uint64_t id);
+
+    template<class T>
+    void ForEach(uint64_t start_id, uint64_t end_id, T fn) const;
+
+private:
+    std::vector<Record> slots_;
+    uint64_t mask_;
+    uint64_t begin_;
+    uint64_t end_;
+    size_t size_;
+
+    void Grow(uint64_t new_begin, uint64_t new_end);
+
+    DISALLOW_COPY_AND_ASSIGN(LogRecordRing);
+};
+
+template<class T>
+void LogRecordRing::ForEach(uint64_t start_id, uint64_t end_id, T fn) const {
+    start_id = std::max(start_id, begin_);
+    end_id = std::min(end_id, end_);
+    for (uint64_t id = start_id; id < end_id; id++) {
+        const Record& record = slots_[id & mask_];
+        if (record.data != nullptr) {
+            fn(id, record);
+        }
+    }
+}
+
+}  // namespace log
+}  // namespace faas
@@ -1,12 +1,14 @@
 #include "log/log_space.h"
 
 #include "log/flags.h"
+#include "common/time.h"
 
 namespace faas {
 namespace log {
 
 MetaLogPrimary::MetaLogPrimary(const View* view, uint16_t sequencer_id)
     : LogSpaceBase(LogSpaceBase::kFullMode, view, sequencer_id),
+      first_dirty_timestamp_(0),
       replicated_metalog_position_(0) {
     for (uint16_t storage_shard_id : sequencer_node_->GetStorageShardIds()) {
         const View::StorageShard* storage_shard = view_->GetStorageShard(bits::JoinTwo16(sequencer_id, storage_shard_id));
@@ -94,6 +96,9 @@ void MetaLogPrimary::UpdateStorageProgress(uint16_t storage_id,
             if (current_position > last_cut_.at(storage_shard_id)) {
                 HVLOG_F(1, "Store progress from storage {} for storage_shard {}: {}",
                         storage_id, storage_shard_id, bits::HexStr0x(current_position));
+                if (dirty_shards_.empty()) {
+                    first_dirty_timestamp_ = GetMonotonicMicroTimestamp();
+                }
                 dirty_shards_.insert(storage_shard_id);
             }
         }
@@ -149,6 +154,37 @@ std::optional<MetaLogProto> MetaLogPrimary::MarkNextCut() {
     return meta_log_proto;
 }
 
+std::optional<MetaLogProto> MetaLogPrimary::AppendTrim(uint32_t user_logspace, uint64_t user_tag,
+                                                       uint64_t trim_seqnum) {
+    if (trim_seqnum > seqnum_position()) {
+        HLOG_F(WARNING, "Trim seqnum {} is beyond current seqnum position {}",
+               bits::HexStr0x(trim_seqnum), bits::HexStr0x(seqnum_position()));
+        return std::nullopt;
+    }
+    MetaLogProto meta_log_proto;
+    meta_log_proto.set_logspace_id(identifier());
+    meta_log_proto.set_metalog_seqnum(metalog_position());
+    meta_log_proto.set_type(MetaLogProto::TRIM);
+    auto* trim_proto = meta_log_proto.mutable_trim_proto();
+    trim_proto->set_user_logspace(user_logspace);
+    trim_proto->set_user_tag(user_tag);
+    trim_proto->set_trim_seqnum(trim_seqnum);
+    HVLOG_F(1, "Generate new TRIM meta log: user_logspace={}, user_tag={}, trim_seqnum={}",
+            user_logspace, user_tag, bits::HexStr0x(trim_seqnum));
+    if (!ProvideMetaLog(meta_log_proto)) {
+        HLOG(FATAL) << "Failed to advance metalog position";
+    }
+    return meta_log_proto;
+}
+
+uint32_t MetaLogPrimary::NumPendingEntries() const {
+    uint32_t total = 0;
+    for (uint16_t shard_id : dirty_shards_) {
+        total += GetShardReplicatedPosition(shard_id) - last_cut_.at(shard_id);
+    }
+    return total;
+}
+
 void MetaLogPrimary::UpdateMetaLogReplicatedPosition() {
     if (replicated_metalog_position_ == metalog_position_) {
         return;
@@ -207,6 +243,58 @@ void LogProducer::LocalAppend(void* caller_data, uint64_t* localid, uint64_t* ne
     *next_seqnum = seqnum_position();
 }
 
+void LogProducer::LocalAppendBatch(void* caller_data, size_t num_records,
+                                   uint64_t* start_localid, uint64_t* next_seqnum) {
+    DCHECK_GT(num_records, 0U);
+    DCHECK(!pending_batches_.contains(caller_data));
+    HVLOG_F(1, "LocalAppendBatch of {} log entries with start localid {}",
+            num_records, bits::HexStr0x(next_localid_));
+    for (size_t i = 0; i < num_records; i++) {
+        DCHECK(!pending_appends_.contains(next_localid_ + i));
+        pending_appends_[next_localid_ + i] = caller_data;
+    }
+    pending_batches_[caller_data] = PendingBatch {
+        .start_localid = next_localid_,
+        .num_pending = num_records,
+        .metalog_progress = 0,
+        .seqnums = std::vector<uint64_t>(num_records, kInvalidLogSeqNum)
+    };
+    *start_localid = next_localid_;
+    next_localid_ += num_records;
+    *next_seqnum = seqnum_position();
+}
+
+bool LogProducer::OnBatchedLogSequenced(void* caller_data, uint64_t localid,
+                                        uint64_t seqnum, uint64_t metalog_progress) {
+    if (pending_batches_.empty()) {
+        return false;
+    }
+    auto iter = pending_batches_.find(caller_data);
+    if (iter == pending_batches_.end()) {
+        return false;
+    }
+    PendingBatch& batch = iter->second;
+    DCHECK_LT(localid - batch.start_localid, batch.seqnums.size());
+    batch.seqnums[localid - batch.start_localid] = seqnum;
+    batch.metalog_progress = std::max(batch.metalog_progress, metalog_progress);
+    if (--batch.num_pending == 0) {
+        // Discarded records keep kInvalidLogSeqNum
+        auto first_valid = absl::c_find_if(batch.seqnums, [] (uint64_t seqnum) {
+            return seqnum != kInvalidLogSeqNum;
+        });
+        pending_append_results_.push_back(AppendResult {
+            .seqnum = first_valid != batch.seqnums.end() ? *first_valid : kInvalidLogSeqNum,
+            .localid = batch.start_localid,
+            .metalog_progress = batch.metalog_progress,
+            .caller_data = caller_data,
+            .batch_seqnums = std::make_shared<const std::vector<uint64_t>>(
+                std::move(batch.seqnums))
+        });
+        pending_batches_.erase(iter);
+    }
+    return true;
+}
+
 void LogProducer::PollAppendResults(AppendResultVec* results) {
     *results = std::move(pending_append_results_);
     pending_append_results_.clear();
@@ -222,37 +310,55 @@ void LogProducer::OnNewLogs(uint32_t metalog_seqnum,
             HLOG_F(FATAL, "Cannot find pending log entry for localid {}",
                    bits::HexStr0x(localid));
         }
-        pending_append_results_.push_back(AppendResult {
-            .seqnum = seqnum,
-            .localid = localid,
-            .metalog_progress = bits::JoinTwo32(identifier(), metalog_seqnum + 1),
-            .caller_data = pending_appends_[localid]
-        });
+        void* caller_data = pending_appends_[localid];
+        uint64_t metalog_progress = bits::JoinTwo32(identifier(), metalog_seqnum + 1);
+        if (!OnBatchedLogSequenced(caller_data, localid, seqnum, metalog_progress)) {
+            pending_append_results_.push_back(AppendResult {
+                .seqnum = seqnum,
+                .localid = localid,
+                .metalog_progress = metalog_progress,
+                .caller_data = caller_data,
+                .batch_seqnums = nullptr
+            });
+        }
         pending_appends_.erase(localid);
     }
 }
 
 void LogProducer::OnFinalized(uint32_t metalog_position) {
     for (const auto& [localid, caller_data] : pending_appends_) {
+        if (OnBatchedLogSequenced(caller_data, localid, kInvalidLogSeqNum,
+                                  /* metalog_progress= */ 0)) {
+            continue;
+        }
         pending_append_results_.push_back(AppendResult {
             .seqnum = kInvalidLogSeqNum,
             .localid = localid,
             .metalog_progress = 0,
-            .caller_data = caller_data
+            .caller_data = caller_data,
+            .batch_seqnums = nullptr
         });
     }
     pending_appends_.clear();
+    DCHECK(pending_batches_.empty());
 }
 
 LogStorage::LogStorage(uint16_t storage_id, const View* view, uint16_t sequencer_id)
     : LogSpaceBase(LogSpaceBase::kLogStorage, view, sequencer_id),
       storage_node_(view_->GetStorageNode(storage_id)),
       shard_progress_dirty_(false),
-      persisted_seqnum_position_(0) {
+      persisted_seqnum_position_(0),
+      num_entries_to_persist_(0),
+      num_pending_entries_(0),
+      trim_seqnum_position_(0),
+      db_trim_position_(0),
+      db_trimmed_position_(0) {
     for (uint32_t global_storage_shard_id : storage_node_->GetStorageShardIds()){
         // we only consider the local shard ids
-        shard_progresses_[bits::LowHalf32(global_storage_shard_id)] = 0;
-        AddInterestedShard(bits::LowHalf32(global_storage_shard_id));
+        uint16_t storage_shard_id = bits::LowHalf32(global_storage_shard_id);
+        shard_progresses_[storage_shard_id] = 0;
+        pending_log_entries_[storage_shard_id] = std::make_unique<LogRecordRing>();
+        AddInterestedShard(storage_shard_id);
     }
     index_data_packages_.set_logspace_id(identifier());
     log_header_ = fmt::format("LogStorage[{}-{}]: ", view->id(), sequencer_id);
@@ -269,11 +375,19 @@ bool LogStorage::Store(const LogMetaData& log_metadata, std::span<const uint64_t
     HVLOG_F(1, "Store log from storage_shard {} with localid {}",
             storage_shard_id, bits::HexStr0x(localid));
     //TODO: add ismember of storage node check
-    pending_log_entries_[localid].reset(new LogEntry {
-        .metadata = log_metadata,
-        .user_tags = UserTagVec(user_tags.begin(), user_tags.end()),
-        .data = std::string(log_data.data(), log_data.size()),
-    });
+    std::unique_ptr<LogRecordRing>& ring = pending_log_entries_[storage_shard_id];
+    if (ring == nullptr) {
+        ring = std::make_unique<LogRecordRing>();
+    }
+    LogRecordSlab::Record record = slab_.Allocate(
+        LogRecordSize(user_tags.size(), log_data.size()));
+    EncodeLogRecordTo(log_metadata, user_tags, log_data, record.data);
+    LogRecordSlab::Record old_record = ring->Put(localid, record);
+    if (old_record.data != nullptr) {
+        slab_.Release(old_record);
+    } else {
+        num_pending_entries_++;
+    }
     AdvanceShardProgress(storage_shard_id);
     return true;
 }
@@ -287,12 +401,18 @@ void LogStorage::ReadAt(const protocol::SharedLogMessage& request) {
     }
     ReadResult result = {
         .status = ReadResult::kFailed,
-        .log_entry = nullptr,
+        .log_record = LogRecordRef(),
         .original_request = request
     };
-    if (live_log_entries_.contains(seqnum)) {
+    if (seqnum < trim_seqnum_position_) {
+        HLOG_F(WARNING, "ReadRecord: Seqnum {} is trimmed", bits::HexStr0x(seqnum));
+        pending_read_results_.push_back(std::move(result));
+        return;
+    }
+    LogRecordSlab::Record record = live_log_entries_.Get(seqnum);
+    if (record.data != nullptr) {
         result.status = ReadResult::kOK;
-        result.log_entry = live_log_entries_[seqnum];
+        result.log_record = slab_.Ref(record);
     } else if (seqnum < persisted_seqnum_position_) {
         result.status = ReadResult::kLookupDB;
     } else {
@@ -301,31 +421,62 @@ void LogStorage::ReadAt(const protocol::SharedLogMessage& request) {
     pending_read_results_.push_back(std::move(result));
 }
 
-bool LogStorage::GrabLogEntriesForPersistence(
-        std::vector<std::shared_ptr<const LogEntry>>* log_entries,
-        uint64_t* new_position) const {
-    if (live_seqnums_.empty() || live_seqnums_.back() < persisted_seqnum_position_) {
+bool LogStorage::GrabLogEntriesForPersistence(std::vector<LogRecordRef>* log_records,
+                                              uint64_t* new_position) const {
+    if (num_entries_to_persist_ == 0) {
         return false;
     }
-    auto iter = absl::c_lower_bound(live_seqnums_, persisted_seqnum_position_);
-    DCHECK(iter != live_seqnums_.end());
-    DCHECK_GE(*iter, persisted_seqnum_position_);
-    log_entries->clear();
-    while (iter != live_seqnums_.end()) {
-        uint64_t seqnum = *(iter++);
-        DCHECK(live_log_entries_.contains(seqnum));
-        log_entries->push_back(live_log_entries_.at(seqnum));
-    }
-    DCHECK(!log_entries->empty());
-    *new_position = live_seqnums_.back() + 1;
+    log_records->clear();
+    log_records->reserve(num_entries_to_persist_);
+    live_log_entries_.ForEach(
+        persisted_seqnum_position_, live_log_entries_.end(),
+        [this, log_records] (uint64_t seqnum, LogRecordSlab::Record record) {
+            log_records->push_back(slab_.Ref(record));
+        }
+    );
+    DCHECK_EQ(log_records->size(), num_entries_to_persist_);
+    *new_position = live_log_entries_.end();
     return true;
 }
 
 void LogStorage::LogEntriesPersisted(uint64_t new_position) {
+    // Entries trimmed while being flushed have reached DB nevertheless
+    db_trim_position_ = std::max(db_trim_position_,
+                                 std::min(new_position, trim_seqnum_position_));
+    if (new_position <= persisted_seqnum_position_) {
+        return;
+    }
+    size_t num_persisted = 0;
+    live_log_entries_.ForEach(
+        persisted_seqnum_position_, new_position,
+        [&num_persisted] (uint64_t seqnum, LogRecordSlab::Record record) {
+            num_persisted++;
+        }
+    );
+    DCHECK_LE(num_persisted, num_entries_to_persist_);
+    num_entries_to_persist_ -= num_persisted;
     persisted_seqnum_position_ = new_position;
     ShrinkLiveEntriesIfNeeded();
 }
 
+size_t LogStorage::NumEntriesToPersist() const {
+    return num_entries_to_persist_;
+}
+
+bool LogStorage::GrabTrimmedRangeForDeletion(uint64_t* start_seqnum,
+                                             uint64_t* end_seqnum) const {
+    if (db_trim_position_ <= db_trimmed_position_) {
+        return false;
+    }
+    *start_seqnum = std::max(db_trimmed_position_, bits::JoinTwo32(identifier(), 0));
+    *end_seqnum = db_trim_position_;
+    return true;
+}
+
+void LogStorage::TrimmedRangeDeleted(uint64_t end_seqnum) {
+    db_trimmed_position_ = std::max(db_trimmed_position_, end_seqnum);
+}
+
 void LogStorage::PollReadResults(ReadResultVec* results) {
     *results = std::move(pending_read_results_);
     pending_read_results_.clear();
@@ -366,44 +517,52 @@ void LogStorage::OnNewLogs(uint32_t metalog_seqnum,
         HLOG_F(WARNING, "Read request for seqnum {} has past", bits::HexStr0x(iter->first));
         pending_read_results_.push_back(ReadResult {
             .status = ReadResult::kFailed,
-            .log_entry = nullptr,
+            .log_record = LogRecordRef(),
             .original_request = iter->second
         });
         iter = pending_read_requests_.erase(iter);
     }
+    LogRecordRing* pending_ring = nullptr;
+    uint16_t localid_shard_id = gsl::narrow_cast<uint16_t>(bits::HighHalf64(start_localid));
+    if (pending_log_entries_.contains(localid_shard_id)) {
+        pending_ring = pending_log_entries_.at(localid_shard_id).get();
+    }
     for (size_t i = 0; i < delta; i++) {
         uint64_t seqnum = start_seqnum + i;
         uint64_t localid = start_localid + i;
-        if (!pending_log_entries_.contains(localid)) {
+        LogRecordSlab::Record record = { nullptr, nullptr };
+        if (pending_ring != nullptr) {
+            record = pending_ring->Take(localid);
+        }
+        if (record.data == nullptr) {
             HLOG_F(FATAL, "MetalogUpdate: Cannot find pending log entry for localid {}",
                    bits::HexStr0x(localid));
         }
-        // Build the log entry for live_log_entries_
-        LogEntry* log_entry = pending_log_entries_[localid].release();
-        pending_log_entries_.erase(localid);
+        num_pending_entries_--;
         HVLOG_F(1, "MetalogUpdate: Finalize the log entry (seqnum={}, localid={})",
                 bits::HexStr0x(seqnum), bits::HexStr0x(localid));
-        log_entry->metadata.seqnum = seqnum;
-        std::shared_ptr<const LogEntry> log_entry_ptr(log_entry);
+        // Seqnum is assigned in place, so the record can be persisted as is
+        LogRecordHeader* header = reinterpret_cast<LogRecordHeader*>(record.data);
+        header->seqnum = seqnum;
+        const uint64_t* user_tags = reinterpret_cast<const uint64_t*>(
+            record.data + sizeof(LogRecordHeader));
         // Add the new entry to index data
         index_data_.add_seqnum_halves(bits::LowHalf64(seqnum));
         index_data_.add_engine_ids(bits::HighHalf64(localid));
-        index_data_.add_user_logspaces(log_entry->metadata.user_logspace);
-        index_data_.add_user_tag_sizes(
-            gsl::narrow_cast<uint32_t>(log_entry->user_tags.size()));
-        index_data_.mutable_user_tags()->Add(
-            log_entry->user_tags.begin(), log_entry->user_tags.end());
-        // Update live_seqnums_ and live_log_entries_
-        DCHECK(live_seqnums_.empty() || seqnum > live_seqnums_.back());
-        live_seqnums_.push_back(seqnum);
-        live_log_entries_[seqnum] = log_entry_ptr;
-        DCHECK_EQ(live_seqnums_.size(), live_log_entries_.size());
+        index_data_.add_user_logspaces(header->user_logspace);
+        trim_seqnums_.try_emplace(header->user_logspace, 0);
+        index_data_.add_user_tag_sizes(uint32_t{header->num_tags});
+        index_data_.mutable_user_tags()->Add(user_tags, user_tags + header->num_tags);
+        // Update live_log_entries_
+        DCHECK(live_log_entries_.empty() || seqnum >= live_log_entries_.end());
+        live_log_entries_.Put(seqnum, record);
+        num_entries_to_persist_++;
         ShrinkLiveEntriesIfNeeded();
         // Check if we have read request on it
         while (iter != pending_read_requests_.end() && iter->first == seqnum) {
             pending_read_results_.push_back(ReadResult {
                 .status = ReadResult::kOK,
-                .log_entry = log_entry_ptr,
+                .log_record = slab_.Ref(record),
                 .original_request = iter->second
             });
             iter = pending_read_requests_.erase(iter);
@@ -431,10 +590,57 @@ void LogStorage::OnMetaLogApplied(const MetaLogProto& meta_log_proto){
     }
 }
 
+void LogStorage::OnTrim(uint32_t metalog_seqnum,
+                        uint32_t user_logspace, uint64_t user_tag,
+                        uint64_t trim_seqnum) {
+    if (user_tag != kEmptyLogTag) {
+        // Tagged entries may carry other tags as well, only indices are trimmed
+        return;
+    }
+    trim_seqnum = std::min(trim_seqnum, seqnum_position());
+    uint64_t& current = trim_seqnums_[user_logspace];
+    if (trim_seqnum <= current) {
+        return;
+    }
+    current = trim_seqnum;
+    uint64_t new_position = trim_seqnum;
+    for (const auto& [space, seqnum] : trim_seqnums_) {
+        new_position = std::min(new_position, seqnum);
+    }
+    if (new_position > trim_seqnum_position_) {
+        AdvanceTrimPosition(new_position);
+    }
+}
+
+void LogStorage::AdvanceTrimPosition(uint64_t new_position) {
+    HVLOG_F(1, "Advance trim position from {} to {}",
+            bits::HexStr0x(trim_seqnum_position_), bits::HexStr0x(new_position));
+    // Trimmed entries not yet persisted will never be written to DB
+    size_t num_trimmed = 0;
+    live_log_entries_.ForEach(
+        persisted_seqnum_position_, new_position,
+        [&num_trimmed] (uint64_t seqnum, LogRecordSlab::Record record) {
+            num_trimmed++;
+        }
+    );
+    DCHECK_LE(num_trimmed, num_entries_to_persist_);
+    num_entries_to_persist_ -= num_trimmed;
+    db_trim_position_ = std::max(db_trim_position_,
+                                 std::min(new_position, persisted_seqnum_position_));
+    persisted_seqnum_position_ = std::max(persisted_seqnum_position_, new_position);
+    while (!live_log_entries_.empty() && live_log_entries_.begin() < new_position) {
+        slab_.Release(live_log_entries_.Take(live_log_entries_.begin()));
+    }
+    trim_seqnum_position_ = new_position;
+}
+
 void LogStorage::OnFinalized(uint32_t metalog_position) {
-    if (!pending_log_entries_.empty()) {
-        HLOG_F(WARNING, "{} pending log entries discarded", pending_log_entries_.size());
-        pending_log_entries_.clear();
+    if (num_pending_entries_ > 0) {
+        HLOG_F(WARNING, "{} pending log entries discarded", num_pending_entries_);
+        for (auto& [storage_shard_id, ring] : pending_log_entries_) {
+            ClearPendingEntries(ring.get());
+        }
+        DCHECK_EQ(num_pending_entries_, 0U);
     }
     if (!pending_read_requests_.empty()) {
         HLOG_F(FATAL, "There are {} pending reads", pending_read_requests_.size());
@@ -443,7 +649,8 @@ void LogStorage::OnFinalized(uint32_t metalog_position) {
 
 void LogStorage::AdvanceShardProgress(uint16_t storage_shard_id) {
     uint32_t current = shard_progresses_[storage_shard_id];
-    while (pending_log_entries_.contains(bits::JoinTwo32(storage_shard_id, current))) {
+    const LogRecordRing& ring = *pending_log_entries_.at(storage_shard_id);
+    while (ring.Contains(bits::JoinTwo32(storage_shard_id, current))) {
         current++;
     }
     if (current > shard_progresses_[storage_shard_id]) {
@@ -458,21 +665,27 @@ void LogStorage::AdvanceShardProgress(uint16_t storage_shard_id) {
 
 void LogStorage::ShrinkLiveEntriesIfNeeded() {
     size_t max_size = absl::GetFlag(FLAGS_slog_storage_max_live_entries);
-    while (live_seqnums_.size() > max_size
-             && live_seqnums_.front() < persisted_seqnum_position_) {
-        live_log_entries_.erase(live_seqnums_.front());
-        live_seqnums_.pop_front();
-        DCHECK_EQ(live_seqnums_.size(), live_log_entries_.size());
+    while (live_log_entries_.size() > max_size
+             && live_log_entries_.begin() < persisted_seqnum_position_) {
+        slab_.Release(live_log_entries_.Take(live_log_entries_.begin()));
+    }
+}
+
+void LogStorage::ClearPendingEntries(LogRecordRing* ring) {
+    while (!ring->empty()) {
+        uint64_t localid = ring->begin();
+        HVLOG_F(1, "Remove entry {}", bits::HexStr0x(localid));
+        slab_.Release(ring->Take(localid));
+        num_pending_entries_--;
     }
 }
 
 void LogStorage::RemovePendingEntries(uint16_t storage_shard_id) {
-    auto iter = pending_log_entries_.begin();
-    while (iter != pending_log_entries_.end()) {
-        if (gsl::narrow_cast<uint16_t>(bits::HighHalf64(iter->first) == storage_shard_id)){
-            HLOG_F(INFO, "Remove entry {}", bits::HexStr0x(iter->first));
-            pending_log_entries_.erase(iter);
-        }
+    if (pending_log_entries_.contains(storage_shard_id)) {
+        LogRecordRing* ring = pending_log_entries_.at(storage_shard_id).get();
+        HLOG_F(INFO, "Remove {} pending entries of storage_shard {}",
+               ring->size(), storage_shard_id);
+        ClearPendingEntries(ring);
     }
 }
 
@@ -1,6 +1,7 @@
 #pragma once
 
 #include "log/log_space_base.h"
+#include "log/log_slab.h"
 
 namespace faas {
 namespace log {
@@ -17,15 +18,29 @@ public:
     bool all_metalog_replicated() const {
         return replicated_metalog_position_ == metalog_position();
     }
+    uint32_t num_inflight_metalogs() const {
+        return metalog_position() - replicated_metalog_position_;
+    }
+    bool has_dirty_shards() const { return !dirty_shards_.empty(); }
+    // Monotonic timestamp in microseconds when the oldest uncut progress arrived
+    int64_t first_dirty_timestamp() const { return first_dirty_timestamp_; }
 
     bool BlockShard(uint16_t shard_id, uint32_t* last_cut);
     bool UnblockShard(uint16_t shard_id, uint32_t* last_cut);
     void UpdateStorageProgress(uint16_t storage_id, const std::vector<uint32_t>& progress);
     void UpdateReplicaProgress(uint16_t sequencer_id, uint32_t metalog_position);
     std::optional<MetaLogProto> MarkNextCut();
+    // Entries of `user_logspace` (with `user_tag`, if not empty) below
+    // `trim_seqnum` are trimmed once the returned meta log is applied
+    std::optional<MetaLogProto> AppendTrim(uint32_t user_logspace, uint64_t user_tag,
+                                           uint64_t trim_seqnum);
+
+    // Number of log entries that the next cut would include
+    uint32_t NumPendingEntries() const;
 
 private:
     absl::flat_hash_set</* shard_id */ uint16_t> dirty_shards_;
+    int64_t first_dirty_timestamp_;
     absl::flat_hash_map</* shard_id */ uint16_t, uint32_t> last_cut_;
     absl::flat_hash_map<std::pair</* shard_id */  uint16_t,
                                   /* storage_id */ uint16_t>,
@@ -61,12 +76,18 @@ public:
     ~LogProducer();
 
     void LocalAppend(void* caller_data, uint64_t* localid, uint64_t* next_seqnum);
+    // Log entries of a batch take contiguous localids starting from `start_localid`,
+    // and the batch has a single AppendResult once all of them are sequenced
+    void LocalAppendBatch(void* caller_data, size_t num_records,
+                          uint64_t* start_localid, uint64_t* next_seqnum);
 
     struct AppendResult {
         uint64_t seqnum;   // seqnum == kInvalidLogSeqNum indicates failure
         uint64_t localid;
         uint64_t metalog_progress;
         void*    caller_data;
+        // Seqnums of all log entries in a batch, kInvalidLogSeqNum for discarded ones
+        std::shared_ptr<const std::vector<uint64_t>> batch_seqnums;
     };
     using AppendResultVec = absl::InlinedVector<AppendResult, 4>;
     void PollAppendResults(AppendResultVec* results);
@@ -83,6 +104,18 @@ private:
                         /* caller_data */ void*> pending_appends_;
     AppendResultVec pending_append_results_;
 
+    struct PendingBatch {
+        uint64_t start_localid;
+        size_t   num_pending;
+        uint64_t metalog_progress;
+        std::vector<uint64_t> seqnums;
+    };
+    absl::flat_hash_map</* caller_data */ void*, PendingBatch> pending_batches_;
+
+    // Returns true if `localid` belongs to a batch
+    bool OnBatchedLogSequenced(void* caller_data, uint64_t localid,
+                               uint64_t seqnum, uint64_t metalog_progress);
+
     void OnNewLogs(uint32_t metalog_seqnum,
                    uint64_t start_seqnum, uint64_t start_localid,
                    uint32_t delta, uint16_t storage_shard_id) override;
@@ -101,17 +134,22 @@ public:
                std::span<const char> log_data);
     void ReadAt(const protocol::SharedLogMessage& request);
 
-    bool GrabLogEntriesForPersistence(
-            std::vector<std::shared_ptr<const LogEntry>>* log_entries,
-            uint64_t* new_position) const;
+    bool GrabLogEntriesForPersistence(std::vector<LogRecordRef>* log_records,
+                                      uint64_t* new_position) const;
     void LogEntriesPersisted(uint64_t new_position);
+    size_t NumEntriesToPersist() const;
+
+    // Persisted entries in [start_seqnum, end_seqnum) are trimmed, and should
+    // be deleted from DB
+    bool GrabTrimmedRangeForDeletion(uint64_t* start_seqnum, uint64_t* end_seqnum) const;
+    void TrimmedRangeDeleted(uint64_t end_seqnum);
 
     void RemovePendingEntries(uint16_t storage_shard_id);
 
     struct ReadResult {
         enum Status { kOK, kLookupDB, kFailed };
         Status status;
-        std::shared_ptr<const LogEntry> log_entry;
+        LogRecordRef log_record;
         protocol::SharedLogMessage original_request;
     };
     using ReadResultVec = absl::InlinedVector<ReadResult, 4>;
@@ -128,14 +166,24 @@ private:
                         /* localid          */ uint32_t> shard_progresses_;
 
     uint64_t persisted_seqnum_position_;
-    std::deque<uint64_t> live_seqnums_;
-    absl::flat_hash_map</* seqnum */ uint64_t,
-                        std::shared_ptr<const LogEntry>>
-        live_log_entries_;
+    size_t num_entries_to_persist_;
 
-    absl::flat_hash_map</* localid */ uint64_t,
-                        std::unique_ptr<LogEntry>>
-        pending_log_entries_;
+    // Records of both live and pending entries are allocated from slab_
+    LogRecordSlab slab_;
+    LogRecordRing live_log_entries_;  // Indexed by seqnum
+    absl::flat_hash_map</* storage_shard_id */ uint16_t,
+                        std::unique_ptr<LogRecordRing>>
+        pending_log_entries_;         // Indexed by localid
+    size_t num_pending_entries_;
+
+    // Entries of a user logspace can be trimmed by its own trim seqnum, but
+    // as user logspaces are interleaved, storage space is only reclaimed below
+    // the minimum trim seqnum of all user logspaces seen
+    absl::flat_hash_map</* user_logspace */ uint32_t,
+                        /* trim_seqnum */   uint64_t> trim_seqnums_;
+    uint64_t trim_seqnum_position_;
+    uint64_t db_trim_position_;     // Target of deletion from DB
+    uint64_t db_trimmed_position_;  // Entries below are deleted from DB
 
     std::multimap</* seqnum */ uint64_t,
                   protocol::SharedLogMessage> pending_read_requests_;
@@ -148,10 +196,15 @@ private:
                    uint64_t start_seqnum, uint64_t start_localid,
                    uint32_t delta, uint16_t storage_shard_id) override;
     void OnMetaLogApplied(const MetaLogProto& meta_log_proto) override;
+    void OnTrim(uint32_t metalog_seqnum,
+                uint32_t user_logspace, uint64_t user_tag,
+                uint64_t trim_seqnum) override;
     void OnFinalized(uint32_t metalog_position) override;
 
     void AdvanceShardProgress(uint16_t engine_id);
+    void AdvanceTrimPosition(uint64_t new_position);
     void ShrinkLiveEntriesIfNeeded();
+    void ClearPendingEntries(LogRecordRing* ring);
 
     DISALLOW_COPY_AND_ASSIGN(LogStorage);
 };
@@ -39,11 +39,6 @@ std::optional<MetaLogProto> LogSpaceBase::GetMetaLog(uint32_t pos) const {
 
 bool LogSpaceBase::ProvideMetaLog(const MetaLogProto& meta_log) {
     DCHECK(state_ == kNormal || state_ == kFrozen);
-    if (meta_log.type() == MetaLogProto::TRIM && (mode_ == kLogStorage || mode_ == kLogProducer || mode_ == kLogSuffix)) {
-        HLOG_F(WARNING, "Trim log (seqnum={}) is simply ignore in lite mode",
-               meta_log.metalog_seqnum());
-        return false;
-    }
     uint32_t seqnum = meta_log.metalog_seqnum();
     if (seqnum < metalog_position_) {
         HVLOG_F(1, "MetalogUpdate: metalog_seqnum={} lower than my position={}", seqnum, metalog_position_);
@@ -192,7 +187,8 @@ void LogSpaceBase::ApplyMetaLog(const MetaLogProto& meta_log) {
         }
         break;
     case MetaLogProto::TRIM:
-        DCHECK(mode_ == kFullMode);
+        // Applied in all modes, so that TRIM meta logs also advance the
+        // metalog position of lite mode log spaces
         {
             const auto& trim = meta_log.trim_proto();
             OnTrim(meta_log.metalog_seqnum(),
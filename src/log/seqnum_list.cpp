@@ -0,0 +1,351 @@
+#include "log/seqnum_list.h"
+
+#include "utils/bits.h"
+
+#ifdef __AVX2__
+#include <immintrin.h>
+#endif
+
+namespace faas {
+namespace log {
+
+namespace {
+static constexpr size_t kBlockSize = SeqnumList::kBlockSize;
+
+// Kernels below count values less than `key` in a full block of sorted
+// values. Given the block is sorted, the count is also the lower bound.
+#ifdef __AVX2__
+// AVX2 only has signed comparisons, so sign bits of both sides are flipped
+static size_t CountLess8(const uint8_t* data, uint32_t key) {
+    const __m256i sign = _mm256_set1_epi8(std::numeric_limits<int8_t>::min());
+    const __m256i k = _mm256_xor_si256(
+        _mm256_set1_epi8(static_cast<char>(key)), sign);
+    size_t count = 0;
+    for (size_t i = 0; i < kBlockSize; i += 32) {
+        __m256i v = _mm256_xor_si256(
+            _mm256_loadu_si256(reinterpret_cast<const __m256i*>(data + i)), sign);
+        uint32_t mask = static_cast<uint32_t>(
+            _mm256_movemask_epi8(_mm256_cmpgt_epi8(k, v)));
+        count += static_cast<size_t>(__builtin_popcount(mask));
+    }
+    return count;
+}
+
+static size_t CountLess16(const uint8_t* data, uint32_t key) {
+    const uint16_t* values = reinterpret_cast<const uint16_t*>(data);
+    const __m256i sign = _mm256_set1_epi16(std::numeric_limits<int16_t>::min());
+    const __m256i k = _mm256_xor_si256(
+        _mm256_set1_epi16(static_cast<int16_t>(key)), sign);
+    size_t count = 0;
+    for (size_t i = 0; i < kBlockSize; i += 16) {
+        __m256i v = _mm256_xor_si256(
+            _mm256_loadu_si256(reinterpret_cast<const __m256i*>(values + i)), sign);
+        uint32_t mask = static_cast<uint32_t>(
+            _mm256_movemask_epi8(_mm256_cmpgt_epi16(k, v)));
+        // Two mask bits per 16-bit lane
+        count += static_cast<size_t>(__builtin_popcount(mask)) / 2;
+    }
+    return count;
+}
+
+static size_t CountLess32(const uint8_t* data, uint32_t key) {
+    const uint32_t* values = reinterpret_cast<const uint32_t*>(data);
+    const __m256i sign = _mm256_set1_epi32(std::numeric_limits<int32_t>::min());
+    const __m256i k = _mm256_xor_si256(
+        _mm256_set1_epi32(static_cast<int32_t>(key)), sign);
+    size_t count = 0;
+    for (size_t i = 0; i < kBlockSize; i += 8) {
+        __m256i v = _mm256_xor_si256(
+            _mm256_loadu_si256(reinterpret_cast<const __m256i*>(values + i)), sign);
+        uint32_t mask = static_cast<uint32_t>(_mm256_movemask_ps(
+            _mm256_castsi256_ps(_mm256_cmpgt_epi32(k, v))));
+        count += static_cast<size_t>(__builtin_popcount(mask));
+    }
+    return count;
+}
+#else
+template<class T>
+static size_t CountLessScalar(const uint8_t* data, uint32_t key) {
+    const T* values = reinterpret_cast<const T*>(data);
+    return gsl::narrow_cast<size_t>(std::lower_bound(values, values + kBlockSize, key) - values);
+}
+
+static size_t CountLess8(const uint8_t* data, uint32_t key) {
+    return CountLessScalar<uint8_t>(data, key);
+}
+
+static size_t CountLess16(const uint8_t* data, uint32_t key) {
+    return CountLessScalar<uint16_t>(data, key);
+}
+
+static size_t CountLess32(const uint8_t* data, uint32_t key) {
+    return CountLessScalar<uint32_t>(data, key);
+}
+#endif
+
+static uint8_t WidthOf(uint32_t max_value) {
+    if (max_value <= std::numeric_limits<uint8_t>::max()) {
+        return 1;
+    } else if (max_value <= std::numeric_limits<uint16_t>::max()) {
+        return 2;
+    } else {
+        return 4;
+    }
+}
+
+static uint32_t ReadValue(const uint8_t* data, uint8_t width, size_t idx) {
+    switch (width) {
+    case 1:
+        return data[idx];
+    case 2:
+        return reinterpret_cast<const uint16_t*>(data)[idx];
+    case 4:
+        return reinterpret_cast<const uint32_t*>(data)[idx];
+    default:
+        UNREACHABLE();
+    }
+}
+
+static void WriteValue(uint8_t* data, uint8_t width, size_t idx, uint32_t value) {
+    switch (width) {
+    case 1:
+        data[idx] = gsl::narrow_cast<uint8_t>(value);
+        break;
+    case 2:
+        reinterpret_cast<uint16_t*>(data)[idx] = gsl::narrow_cast<uint16_t>(value);
+        break;
+    case 4:
+        reinterpret_cast<uint32_t*>(data)[idx] = value;
+        break;
+    default:
+        UNREACHABLE();
+    }
+}
+}  // namespace
+
+SeqnumList::SeqnumList()
+    : tail_payload_(0) {}
+
+SeqnumList::~SeqnumList() {}
+
+SeqnumList SeqnumList::Clone() const {
+    SeqnumList list;
+    if (blocks_ != nullptr) {
+        list.blocks_ = std::make_unique<BlockIndex>(*blocks_);
+    }
+    list.tail_seqnums_ = tail_seqnums_;
+    if (tail_payloads_ != nullptr) {
+        list.tail_payloads_ = std::make_unique<std::vector<uint16_t>>(*tail_payloads_);
+    }
+    list.tail_payload_ = tail_payload_;
+    return list;
+}
+
+void SeqnumList::Append(uint32_t seqnum, uint16_t payload) {
+    DCHECK(empty() || seqnum > back());
+    tail_seqnums_.push_back(seqnum);
+    if (tail_payloads_ != nullptr) {
+        tail_payloads_->push_back(payload);
+    } else if (tail_seqnums_.size() == 1) {
+        tail_payload_ = payload;
+    } else if (payload != tail_payload_) {
+        tail_payloads_ = std::make_unique<std::vector<uint16_t>>(
+            tail_seqnums_.size() - 1, tail_payload_);
+        tail_payloads_->push_back(payload);
+    }
+    if (tail_seqnums_.size() == kBlockSize) {
+        SealTail();
+    }
+}
+
+void SeqnumList::RemovePrefix(size_t n) {
+    DCHECK_LE(n, size());
+    size_t skip = head_skip() + n;
+    if (blocks_ != nullptr) {
+        size_t num_blocks = std::min(skip / kBlockSize, blocks_->blocks.size());
+        blocks_->blocks.erase(blocks_->blocks.begin(),
+                              blocks_->blocks.begin() + static_cast<ptrdiff_t>(num_blocks));
+        blocks_->heads.erase(blocks_->heads.begin(),
+                             blocks_->heads.begin() + static_cast<ptrdiff_t>(num_blocks));
+        skip -= num_blocks * kBlockSize;
+        if (!blocks_->blocks.empty()) {
+            DCHECK_LT(skip, kBlockSize);
+            blocks_->head_skip = skip;
+            return;
+        }
+        blocks_.reset();
+    }
+    if (skip > 0) {
+        tail_seqnums_.erase(tail_seqnums_.begin(),
+                            tail_seqnums_.begin() + static_cast<ptrdiff_t>(skip));
+        if (tail_payloads_ != nullptr) {
+            tail_payloads_->erase(tail_payloads_->begin(),
+                                  tail_payloads_->begin() + static_cast<ptrdiff_t>(skip));
+        }
+    }
+}
+
+uint32_t SeqnumList::at(size_t pos) const {
+    DCHECK_LT(pos, size());
+    size_t idx = pos + head_skip();
+    size_t block_idx = idx / kBlockSize;
+    if (block_idx < num_blocks()) {
+        return DecodeSeqnum(blocks_->blocks[block_idx], idx % kBlockSize);
+    }
+    return tail_seqnums_[idx - num_blocks() * kBlockSize];
+}
+
+uint16_t SeqnumList::payload_at(size_t pos) const {
+    DCHECK_LT(pos, size());
+    size_t idx = pos + head_skip();
+    size_t block_idx = idx / kBlockSize;
+    if (block_idx < num_blocks()) {
+        return DecodePayload(blocks_->blocks[block_idx], idx % kBlockSize);
+    }
+    return tail_payload_at(idx - num_blocks() * kBlockSize);
+}
+
+size_t SeqnumList::LowerBound(uint32_t seqnum) const {
+    // Removed entries are all below the remaining ones
+    size_t skip = head_skip();
+    return std::max(CountLess(seqnum), skip) - skip;
+}
+
+size_t SeqnumList::UpperBound(uint32_t seqnum) const {
+    if (seqnum == std::numeric_limits<uint32_t>::max()) {
+        return size();
+    }
+    return LowerBound(seqnum + 1);
+}
+
+size_t SeqnumList::LowerBound(uint32_t logspace_id, uint64_t seqnum) const {
+    uint32_t seqnum_logspace_id = bits::HighHalf64(seqnum);
+    if (seqnum_logspace_id < logspace_id) {
+        return 0;
+    } else if (seqnum_logspace_id > logspace_id) {
+        return size();
+    }
+    return LowerBound(bits::LowHalf64(seqnum));
+}
+
+size_t SeqnumList::UpperBound(uint32_t logspace_id, uint64_t seqnum) const {
+    uint32_t seqnum_logspace_id = bits::HighHalf64(seqnum);
+    if (seqnum_logspace_id < logspace_id) {
+        return 0;
+    } else if (seqnum_logspace_id > logspace_id) {
+        return size();
+    }
+    return UpperBound(bits::LowHalf64(seqnum));
+}
+
+size_t SeqnumList::memory_usage() const {
+    size_t usage = sizeof(SeqnumList) + sizeof(uint32_t) * tail_seqnums_.capacity();
+    if (tail_payloads_ != nullptr) {
+        usage += sizeof(std::vector<uint16_t>) + sizeof(uint16_t) * tail_payloads_->capacity();
+    }
+    if (blocks_ != nullptr) {
+        usage += sizeof(BlockIndex)
+               + sizeof(uint32_t) * blocks_->heads.capacity()
+               + sizeof(Block) * blocks_->blocks.capacity();
+        for (const Block& block : blocks_->blocks) {
+            usage += kBlockSize * (block.seqnum_width + block.payload_width);
+        }
+    }
+    return usage;
+}
+
+size_t SeqnumList::CountLess(uint32_t seqnum) const {
+    size_t count = 0;
+    if (blocks_ != nullptr) {
+        const std::vector<uint32_t>& heads = blocks_->heads;
+        const std::vector<Block>& blocks = blocks_->blocks;
+        // Blocks before `idx` start below `seqnum`
+        size_t idx = gsl::narrow_cast<size_t>(absl::c_lower_bound(heads, seqnum)
+                                              - heads.begin());
+        if (idx == 0) {
+            return 0;
+        }
+        if (idx < blocks.size()) {
+            return (idx - 1) * kBlockSize + CountLessInBlock(blocks[idx - 1], seqnum);
+        }
+        size_t last_count = CountLessInBlock(blocks.back(), seqnum);
+        if (last_count < kBlockSize) {
+            return (blocks.size() - 1) * kBlockSize + last_count;
+        }
+        count = blocks.size() * kBlockSize;
+    }
+    return count + gsl::narrow_cast<size_t>(
+        absl::c_lower_bound(tail_seqnums_, seqnum) - tail_seqnums_.begin());
+}
+
+void SeqnumList::SealTail() {
+    DCHECK_EQ(tail_seqnums_.size(), kBlockSize);
+    Block block;
+    block.base_seqnum = tail_seqnums_.front();
+    block.seqnum_width = WidthOf(tail_seqnums_.back() - block.base_seqnum);
+    if (tail_payloads_ != nullptr) {
+        auto [min_payload, max_payload] = absl::c_minmax_element(*tail_payloads_);
+        block.base_payload = *min_payload;
+        uint32_t payload_range = uint32_t{*max_payload} - uint32_t{*min_payload};
+        block.payload_width = payload_range == 0 ? 0 : WidthOf(payload_range);
+    } else {
+        block.base_payload = tail_payload_;
+        block.payload_width = 0;
+    }
+    std::unique_ptr<uint8_t[]> data(
+        new uint8_t[kBlockSize * (block.seqnum_width + block.payload_width)]);
+    uint8_t* payload_data = data.get() + kBlockSize * block.seqnum_width;
+    for (size_t i = 0; i < kBlockSize; i++) {
+        WriteValue(data.get(), block.seqnum_width, i,
+                   tail_seqnums_[i] - block.base_seqnum);
+        if (block.payload_width > 0) {
+            WriteValue(payload_data, block.payload_width, i,
+                       uint32_t{(*tail_payloads_)[i]} - uint32_t{block.base_payload});
+        }
+    }
+    block.data = std::move(data);
+    if (blocks_ == nullptr) {
+        blocks_ = std::make_unique<BlockIndex>();
+        blocks_->head_skip = 0;
+    }
+    blocks_->heads.push_back(block.base_seqnum);
+    blocks_->blocks.push_back(std::move(block));
+    tail_seqnums_.clear();
+    tail_payloads_.reset();
+}
+
+uint32_t SeqnumList::DecodeSeqnum(const Block& block, size_t idx) {
+    return block.base_seqnum + ReadValue(block.data.get(), block.seqnum_width, idx);
+}
+
+uint16_t SeqnumList::DecodePayload(const Block& block, size_t idx) {
+    if (block.payload_width == 0) {
+        return block.base_payload;
+    }
+    const uint8_t* payload_data = block.data.get() + kBlockSize * block.seqnum_width;
+    return gsl::narrow_cast<uint16_t>(
+        block.base_payload + ReadValue(payload_data, block.payload_width, idx));
+}
+
+size_t SeqnumList::CountLessInBlock(const Block& block, uint32_t seqnum) {
+    if (seqnum <= block.base_seqnum) {
+        return 0;
+    }
+    uint32_t offset = seqnum - block.base_seqnum;
+    const uint8_t* data = block.data.get();
+    switch (block.seqnum_width) {
+    case 1:
+        return offset > std::numeric_limits<uint8_t>::max()
+                   ? kBlockSize : CountLess8(data, offset);
+    case 2:
+        return offset > std::numeric_limits<uint16_t>::max()
+                   ? kBlockSize : CountLess16(data, offset);
+    case 4:
+        return CountLess32(data, offset);
+    default:
+        UNREACHABLE();
+    }
+}
+
+}  // namespace log
+}  // namespace faas
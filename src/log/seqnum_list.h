@@ -0,0 +1,105 @@
+#pragma once
+
+#include "log/common.h"
+
+namespace faas {
+namespace log {
+
+// Sorted list of seqnum low halves, each with an optional 16-bit payload
+// (e.g. storage shard id or engine id). Seqnums are appended in increasing
+// order, and only removed from the front.
+//
+// Full blocks of kBlockSize entries are stored in frame-of-reference form:
+// seqnums as 1, 2 or 4-byte offsets from the first seqnum of the block, and
+// payloads as 0, 1 or 2-byte offsets from the smallest payload of the block.
+// A skip index of block heads leads searches to a single block, which is
+// scanned with AVX2 when available. The last partial block is uncompressed.
+//
+// Most lists (e.g. of tags) never fill a block, so they only hold a vector of
+// seqnums. Payloads of the partial block are kept as a single value until
+// they differ, and blocks are allocated with the first full one.
+class SeqnumList {
+public:
+    static constexpr size_t kBlockSize = 128;
+
+    SeqnumList();
+    ~SeqnumList();
+
+    SeqnumList(SeqnumList&& other) = default;
+    SeqnumList& operator=(SeqnumList&& other) = default;
+
+    // Copy sharing the immutable full blocks with this list, so its cost
+    // is linear in the number of blocks, not entries
+    SeqnumList Clone() const;
+
+    size_t size() const {
+        return num_blocks() * kBlockSize + tail_seqnums_.size() - head_skip();
+    }
+    bool empty() const { return size() == 0; }
+
+    void Append(uint32_t seqnum, uint16_t payload = 0);
+    // Removes the first `n` entries
+    void RemovePrefix(size_t n);
+
+    uint32_t at(size_t pos) const;
+    uint16_t payload_at(size_t pos) const;
+    uint32_t front() const { return at(0); }
+    uint32_t back() const { return at(size() - 1); }
+
+    // Position of the first seqnum not less than (LowerBound) or greater than
+    // (UpperBound) `seqnum`, size() if there is none
+    size_t LowerBound(uint32_t seqnum) const;
+    size_t UpperBound(uint32_t seqnum) const;
+    // Same as above, comparing full seqnums of entries in `logspace_id`
+    size_t LowerBound(uint32_t logspace_id, uint64_t seqnum) const;
+    size_t UpperBound(uint32_t logspace_id, uint64_t seqnum) const;
+
+    // Bytes held by the list, its encoded blocks, the skip index and the tail
+    size_t memory_usage() const;
+
+private:
+    struct Block {
+        uint32_t base_seqnum;
+        uint16_t base_payload;
+        uint8_t  seqnum_width;   // 1, 2 or 4 bytes
+        uint8_t  payload_width;  // 0, 1 or 2 bytes
+        // kBlockSize seqnum offsets, followed by kBlockSize payload offsets.
+        // Shared by clones of the list.
+        std::shared_ptr<const uint8_t[]> data;
+    };
+
+    struct BlockIndex {
+        std::vector<uint32_t> heads;
+        std::vector<Block>    blocks;
+        // Removed entries at the front of the first block
+        size_t                head_skip;
+    };
+    // Not allocated before the first full block
+    std::unique_ptr<BlockIndex> blocks_;
+
+    std::vector<uint32_t> tail_seqnums_;
+    // Only allocated once payloads of the tail differ, otherwise all of them
+    // are tail_payload_
+    std::unique_ptr<std::vector<uint16_t>> tail_payloads_;
+    uint16_t tail_payload_;
+
+    size_t num_blocks() const { return blocks_ == nullptr ? 0 : blocks_->blocks.size(); }
+    size_t head_skip() const { return blocks_ == nullptr ? 0 : blocks_->head_skip; }
+    uint16_t tail_payload_at(size_t idx) const {
+        return tail_payloads_ == nullptr ? tail_payload_ : (*tail_payloads_)[idx];
+    }
+
+    // Number of entries below `seqnum`, including removed ones of the first block
+    size_t CountLess(uint32_t seqnum) const;
+    void SealTail();
+
+    static uint32_t DecodeSeqnum(const Block& block, size_t idx);
+    static uint16_t DecodePayload(const Block& block, size_t idx);
+    static size_t CountLessInBlock(const Block& block, uint32_t seqnum);
+
+    SeqnumList(const SeqnumList&) = delete;
+    SeqnumList& operator=(const SeqnumList&) = delete;
+};
+
+}  // namespace log
+}  // namespace faas
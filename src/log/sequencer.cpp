@@ -1,6 +1,7 @@
 #include "log/sequencer.h"
 
 #include "log/flags.h"
+#include "common/time.h"
 #include "utils/bits.h"
 
 namespace faas {
@@ -14,6 +15,11 @@ using protocol::SharedLogResultType;
 Sequencer::Sequencer(uint16_t node_id)
     : SequencerBase(node_id),
       log_header_(fmt::format("Sequencer[{}-N]: ", node_id)),
+      cut_max_delay_us_(absl::GetFlag(FLAGS_slog_global_cut_max_delay_us)),
+      cut_max_entries_(gsl::narrow_cast<uint32_t>(
+          absl::GetFlag(FLAGS_slog_global_cut_max_entries))),
+      cut_max_inflight_(gsl::narrow_cast<uint32_t>(
+          std::max(1, absl::GetFlag(FLAGS_slog_global_cut_max_inflight)))),
       current_view_(nullptr) {}
 
 Sequencer::~Sequencer() {}
@@ -48,6 +54,7 @@ void Sequencer::OnViewCreated(const View* view) {
         future_requests_.OnNewView(view, contains_myself ? &ready_requests : nullptr);
         current_view_ = view;
         log_header_ = fmt::format("Sequencer[{}-{}]: ", my_node_id(), view->id());
+        PublishViewSnapshot();
     }
     if (!ready_requests.empty()) {
         HLOG_F(INFO, "{} requests for the new view", ready_requests.size());
@@ -80,6 +87,7 @@ void FreezeLogSpace(LockablePtr<T> logspace_ptr, MetaLogsProto* tail_metalogs) {
 void Sequencer::OnViewFrozen(const View* view) {
     DCHECK(zk_session()->WithinMyEventLoopThread());
     HLOG_F(INFO, "View {} frozen", view->id());
+    FailPendingTrims();
     FrozenSequencerProto frozen_proto;
     frozen_proto.set_view_id(view->id());
     frozen_proto.set_sequencer_id(my_node_id());
@@ -117,6 +125,7 @@ void Sequencer::OnViewFrozen(const View* view) {
 void Sequencer::OnViewFinalized(const FinalizedView* finalized_view) {
     DCHECK(zk_session()->WithinMyEventLoopThread());
     HLOG_F(INFO, "View {} finalized", finalized_view->view()->id());
+    FailPendingTrims();
     absl::MutexLock view_lk(&view_mu_);
     DCHECK_EQ(finalized_view->view()->id(), current_view_->id());
     if (current_primary_ != nullptr) {
@@ -130,6 +139,24 @@ void Sequencer::OnViewFinalized(const FinalizedView* finalized_view) {
     );
 }
 
+// Log spaces are never removed, so only view creation changes the snapshot
+void Sequencer::PublishViewSnapshot() {
+    auto snapshot = std::make_unique<ViewSnapshot>();
+    snapshot->view = current_view_;
+    snapshot->current_primary = current_primary_;
+    auto add_primary = [&snapshot] (uint32_t logspace_id, LockablePtr<MetaLogPrimary> logspace_ptr) {
+        snapshot->primaries[logspace_id] = logspace_ptr;
+    };
+    primary_collection_.ForEachActiveLogSpace(add_primary);
+    primary_collection_.ForEachFinalizedLogSpace(add_primary);
+    auto add_backup = [&snapshot] (uint32_t logspace_id, LockablePtr<MetaLogBackup> logspace_ptr) {
+        snapshot->backups[logspace_id] = logspace_ptr;
+    };
+    backup_collection_.ForEachActiveLogSpace(add_backup);
+    backup_collection_.ForEachFinalizedLogSpace(add_backup);
+    view_snapshot_.Publish(std::move(snapshot));
+}
+
 #define ONHOLD_IF_FROM_FUTURE_VIEW(MESSAGE_VAR, PAYLOAD_VAR)        \
     do {                                                            \
         if (current_view_ == nullptr                                \
@@ -178,7 +205,82 @@ void Sequencer::OnViewFinalized(const FinalizedView* finalized_view) {
 
 void Sequencer::HandleTrimRequest(const SharedLogMessage& request) {
     DCHECK(SharedLogMessageHelper::GetOpType(request) == SharedLogOpType::TRIM);
-    NOT_IMPLEMENTED();
+    const View* view = nullptr;
+    std::optional<MetaLogProto> meta_log_proto;
+    {
+        absl::ReaderMutexLock view_lk(&view_mu_);
+        ONHOLD_IF_FROM_FUTURE_VIEW(request, EMPTY_CHAR_SPAN);
+        view = current_view_;
+        if (current_primary_ == nullptr
+                || request.logspace_id != bits::JoinTwo16(view->id(), my_node_id())) {
+            HLOG_F(WARNING, "Receive trim request for inactive log space {}",
+                   bits::HexStr0x(request.logspace_id));
+        } else {
+            auto locked_logspace = current_primary_.Lock();
+            if (!locked_logspace->frozen() && !locked_logspace->finalized()) {
+                meta_log_proto = locked_logspace->AppendTrim(
+                    request.user_logspace, request.query_tag, request.trim_seqnum);
+            }
+        }
+    }
+    if (!meta_log_proto.has_value()) {
+        SharedLogMessage response = SharedLogMessageHelper::NewResponse(
+            SharedLogResultType::TRIM_FAILED);
+        SendEngineResponse(request, &response);
+        return;
+    }
+    {
+        // The engine is answered once the TRIM meta log is replicated
+        absl::MutexLock trim_lk(&trim_mu_);
+        pending_trims_[bits::JoinTwo32(meta_log_proto->logspace_id(),
+                                       meta_log_proto->metalog_seqnum())] = request;
+    }
+    ReplicateMetaLog(DCHECK_NOTNULL(view), *meta_log_proto);
+}
+
+void Sequencer::FinishReplicatedTrims(std::span<const MetaLogProto> metalogs) {
+    absl::InlinedVector<SharedLogMessage, 4> requests;
+    {
+        absl::MutexLock trim_lk(&trim_mu_);
+        for (const MetaLogProto& metalog : metalogs) {
+            if (metalog.type() != MetaLogProto::TRIM) {
+                continue;
+            }
+            auto iter = pending_trims_.find(
+                bits::JoinTwo32(metalog.logspace_id(), metalog.metalog_seqnum()));
+            if (iter != pending_trims_.end()) {
+                requests.push_back(iter->second);
+                pending_trims_.erase(iter);
+            }
+        }
+    }
+    for (const SharedLogMessage& request : requests) {
+        SharedLogMessage response = SharedLogMessageHelper::NewResponse(
+            SharedLogResultType::TRIM_OK);
+        if (!SendEngineResponse(request, &response)) {
+            HLOG_F(ERROR, "Failed to send trim response to engine {}",
+                   request.origin_node_id);
+        }
+    }
+}
+
+void Sequencer::FailPendingTrims() {
+    absl::flat_hash_map<uint64_t, SharedLogMessage> requests;
+    {
+        absl::MutexLock trim_lk(&trim_mu_);
+        requests.swap(pending_trims_);
+    }
+    if (!requests.empty()) {
+        HLOG_F(WARNING, "Fail {} trims not replicated in the current view", requests.size());
+    }
+    for (const auto& [key, request] : requests) {
+        SharedLogMessage response = SharedLogMessageHelper::NewResponse(
+            SharedLogResultType::TRIM_FAILED);
+        if (!SendEngineResponse(request, &response)) {
+            HLOG_F(ERROR, "Failed to send trim response to engine {}",
+                   request.origin_node_id);
+        }
+    }
 }
 
 void Sequencer::OnRecvMetaLogProgress(const SharedLogMessage& message) {
@@ -211,26 +313,37 @@ void Sequencer::OnRecvMetaLogProgress(const SharedLogMessage& message) {
             }
         }
     }
-    for (const MetaLogProto& metalog_proto : replicated_metalogs) {
-        PropagateMetaLog(DCHECK_NOTNULL(view), DCHECK_NOTNULL(view_mutable), metalog_proto);
-    }
+    PropagateMetaLogs(DCHECK_NOTNULL(view), DCHECK_NOTNULL(view_mutable),
+                      VECTOR_AS_SPAN(replicated_metalogs));
+    FinishReplicatedTrims(VECTOR_AS_SPAN(replicated_metalogs));
 }
 
 void Sequencer::OnRecvShardProgress(const SharedLogMessage& message,
                                     std::span<const char> payload) {
     DCHECK(SharedLogMessageHelper::GetOpType(message) == SharedLogOpType::SHARD_PROG);
+    LockablePtr<MetaLogPrimary> logspace_ptr;
     {
+        utils::EpochGuard epoch_guard;
+        const ViewSnapshot* snapshot = view_snapshot_.Load();
+        if (snapshot != nullptr && message.view_id == snapshot->view->id()) {
+            if (auto iter = snapshot->primaries.find(message.logspace_id);
+                    iter != snapshot->primaries.end()) {
+                logspace_ptr = iter->second;
+            }
+        }
+    }
+    if (logspace_ptr == nullptr) {
         absl::ReaderMutexLock view_lk(&view_mu_);
         ONHOLD_IF_FROM_FUTURE_VIEW(message, payload);
         IGNORE_IF_FROM_PAST_VIEW(message);
-        auto logspace_ptr = primary_collection_.GetLogSpaceChecked(message.logspace_id);
-        {
-            auto locked_logspace = logspace_ptr.Lock();
-            RETURN_IF_LOGSPACE_INACTIVE(locked_logspace);
-            std::vector<uint32_t> progress(payload.size() / sizeof(uint32_t), 0);
-            memcpy(progress.data(), payload.data(), payload.size());
-            locked_logspace->UpdateStorageProgress(message.origin_node_id, progress);
-        }
+        logspace_ptr = primary_collection_.GetLogSpaceChecked(message.logspace_id);
+    }
+    {
+        auto locked_logspace = logspace_ptr.Lock();
+        RETURN_IF_LOGSPACE_INACTIVE(locked_logspace);
+        std::vector<uint32_t> progress(payload.size() / sizeof(uint32_t), 0);
+        memcpy(progress.data(), payload.data(), payload.size());
+        locked_logspace->UpdateStorageProgress(message.origin_node_id, progress);
     }
 }
 
@@ -243,20 +356,31 @@ void Sequencer::OnRecvNewMetaLogs(const SharedLogMessage& message,
     DCHECK_EQ(metalogs_proto.logspace_id(), logspace_id);
     uint32_t old_metalog_position;
     uint32_t new_metalog_position;
+    LockablePtr<MetaLogBackup> logspace_ptr;
     {
+        utils::EpochGuard epoch_guard;
+        const ViewSnapshot* snapshot = view_snapshot_.Load();
+        if (snapshot != nullptr && message.view_id == snapshot->view->id()) {
+            if (auto iter = snapshot->backups.find(logspace_id);
+                    iter != snapshot->backups.end()) {
+                logspace_ptr = iter->second;
+            }
+        }
+    }
+    if (logspace_ptr == nullptr) {
         absl::ReaderMutexLock view_lk(&view_mu_);
         ONHOLD_IF_FROM_FUTURE_VIEW(message, payload);
         IGNORE_IF_FROM_PAST_VIEW(message);
-        auto logspace_ptr = backup_collection_.GetLogSpaceChecked(logspace_id);
-        {
-            auto locked_logspace = logspace_ptr.Lock();
-            RETURN_IF_LOGSPACE_INACTIVE(locked_logspace);
-            old_metalog_position = locked_logspace->metalog_position();
-            for (const MetaLogProto& metalog_proto : metalogs_proto.metalogs()) {
-                locked_logspace->ProvideMetaLog(metalog_proto);
-            }
-            new_metalog_position = locked_logspace->metalog_position();
+        logspace_ptr = backup_collection_.GetLogSpaceChecked(logspace_id);
+    }
+    {
+        auto locked_logspace = logspace_ptr.Lock();
+        RETURN_IF_LOGSPACE_INACTIVE(locked_logspace);
+        old_metalog_position = locked_logspace->metalog_position();
+        for (const MetaLogProto& metalog_proto : metalogs_proto.metalogs()) {
+            locked_logspace->ProvideMetaLog(metalog_proto);
         }
+        new_metalog_position = locked_logspace->metalog_position();
     }
     if (new_metalog_position > old_metalog_position) {
         SharedLogMessage response = SharedLogMessageHelper::NewMetaLogProgressMessage(
@@ -366,27 +490,47 @@ void Sequencer::ProcessRequests(const std::vector<SharedLogRequest>& requests) {
 void Sequencer::MarkNextCutIfDoable() {
     const View* view = nullptr;
     std::optional<MetaLogProto> meta_log_proto;
+    LockablePtr<MetaLogPrimary> logspace_ptr;
     {
-        absl::ReaderMutexLock view_lk(&view_mu_);
-        if (current_primary_ == nullptr || current_view_ == nullptr) {
+        utils::EpochGuard epoch_guard;
+        const ViewSnapshot* snapshot = view_snapshot_.Load();
+        if (snapshot == nullptr || snapshot->current_primary == nullptr) {
             return;
         }
-        view = current_view_;
-        {
-            auto locked_logspace = current_primary_.Lock();
-            RETURN_IF_LOGSPACE_INACTIVE(locked_logspace);
-            if (!locked_logspace->all_metalog_replicated()) {
-                HLOG(INFO) << "Not all meta log replicated, will not mark new cut";
-                return;
-            }
-            meta_log_proto = locked_logspace->MarkNextCut();
+        view = snapshot->view;
+        logspace_ptr = snapshot->current_primary;
+    }
+    {
+        auto locked_logspace = logspace_ptr.Lock();
+        RETURN_IF_LOGSPACE_INACTIVE(locked_logspace);
+        if (locked_logspace->num_inflight_metalogs() >= cut_max_inflight_) {
+            HLOG(INFO) << "Not all meta log replicated, will not mark new cut";
+            return;
+        }
+        if (!ShouldMarkNextCut(*locked_logspace, GetMonotonicMicroTimestamp())) {
+            return;
         }
+        meta_log_proto = locked_logspace->MarkNextCut();
     }
     if (meta_log_proto.has_value()) {
         ReplicateMetaLog(view, *meta_log_proto);
     }
 }
 
+// With a max delay configured, cuts are coalesced: a cut timer tick only marks
+// a new cut once enough entries are pending, or the oldest uncut progress has
+// waited for the max delay. So the effective cut interval shrinks under high
+// append rates and stretches up to the max delay under low ones.
+bool Sequencer::ShouldMarkNextCut(const MetaLogPrimary& logspace, int64_t current_timestamp) {
+    if (cut_max_delay_us_ <= 0 || !logspace.has_dirty_shards()) {
+        return true;
+    }
+    if (current_timestamp - logspace.first_dirty_timestamp() >= cut_max_delay_us_) {
+        return true;
+    }
+    return cut_max_entries_ > 0 && logspace.NumPendingEntries() >= cut_max_entries_;
+}
+
 #undef RETURN_IF_LOGSPACE_INACTIVE
 
 }  // namespace log
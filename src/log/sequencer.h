@@ -16,6 +16,10 @@ public:
 private:
     std::string log_header_;
 
+    int64_t cut_max_delay_us_;
+    uint32_t cut_max_entries_;
+    uint32_t cut_max_inflight_;
+
     absl::Mutex view_mu_;
     const View* current_view_          ABSL_GUARDED_BY(view_mu_);
     ViewMutable view_mutable_          ABSL_GUARDED_BY(view_mu_);
@@ -26,8 +30,24 @@ private:
     LogSpaceCollection<MetaLogBackup>
         backup_collection_             ABSL_GUARDED_BY(view_mu_);
 
+    // Immutable copy of the current view and its log spaces, republished
+    // under view_mu_. Messages of other views go through view_mu_.
+    struct ViewSnapshot {
+        const View* view;
+        LockablePtr<MetaLogPrimary> current_primary;
+        absl::flat_hash_map</* logspace_id */ uint32_t, LockablePtr<MetaLogPrimary>> primaries;
+        absl::flat_hash_map</* logspace_id */ uint32_t, LockablePtr<MetaLogBackup>> backups;
+    };
+    utils::EpochPtr<ViewSnapshot> view_snapshot_;
+    void PublishViewSnapshot() ABSL_EXCLUSIVE_LOCKS_REQUIRED(view_mu_);
+
     log_utils::FutureRequests future_requests_;
 
+    absl::Mutex trim_mu_;
+    absl::flat_hash_map</* (logspace_id, metalog_seqnum) */ uint64_t,
+                        protocol::SharedLogMessage>
+        pending_trims_                 ABSL_GUARDED_BY(trim_mu_);
+
     void OnViewCreated(const View* view) override;
     void OnViewFrozen(const View* view) override;
     void OnViewFinalized(const FinalizedView* finalized_view) override;
@@ -41,8 +61,12 @@ private:
     void OnRecvRegistration(const protocol::SharedLogMessage& message) override;
 
     void ProcessRequests(const std::vector<SharedLogRequest>& requests);
+    void FinishReplicatedTrims(std::span<const MetaLogProto> metalogs);
+    // Trims not replicated before the view is frozen are never answered otherwise
+    void FailPendingTrims();
 
     void MarkNextCutIfDoable() override;
+    bool ShouldMarkNextCut(const MetaLogPrimary& logspace, int64_t current_timestamp);
 
     DISALLOW_COPY_AND_ASSIGN(Sequencer);
 };
@@ -86,10 +86,14 @@ void SequencerBase::MessageHandler(const SharedLogMessage& message,
 }
 
 namespace {
-static std::string SerializedMetaLogs(const MetaLogProto& metalog) {
+static std::string SerializedMetaLogs(std::span<const MetaLogProto> metalogs) {
+    DCHECK(!metalogs.empty());
     MetaLogsProto metalogs_proto;
-    metalogs_proto.set_logspace_id(metalog.logspace_id());
-    metalogs_proto.add_metalogs()->CopyFrom(metalog);
+    metalogs_proto.set_logspace_id(metalogs[0].logspace_id());
+    for (const MetaLogProto& metalog : metalogs) {
+        DCHECK_EQ(metalog.logspace_id(), metalogs_proto.logspace_id());
+        metalogs_proto.add_metalogs()->CopyFrom(metalog);
+    }
     std::string serialized;
     CHECK(metalogs_proto.SerializeToString(&serialized));
     return serialized;
@@ -100,7 +104,7 @@ void SequencerBase::ReplicateMetaLog(const View* view, const MetaLogProto& metal
     uint32_t logspace_id = metalog.logspace_id();
     DCHECK_EQ(bits::LowHalf32(logspace_id), my_node_id());
     SharedLogMessage message = SharedLogMessageHelper::NewMetaLogsMessage(logspace_id);
-    std::string payload = SerializedMetaLogs(metalog);
+    std::string payload = SerializedMetaLogs(std::span<const MetaLogProto>(&metalog, 1));
     message.origin_node_id = node_id_;
     message.payload_size = gsl::narrow_cast<uint32_t>(payload.size());
     const View::Sequencer* sequencer_node = view->GetSequencerNode(my_node_id());
@@ -114,29 +118,37 @@ void SequencerBase::ReplicateMetaLog(const View* view, const MetaLogProto& metal
     }
 }
 
-void SequencerBase::PropagateMetaLog(const View* view, const ViewMutable* view_mutable, const MetaLogProto& metalog) {
-    uint32_t logspace_id = metalog.logspace_id();
+void SequencerBase::PropagateMetaLogs(const View* view, const ViewMutable* view_mutable,
+                                      std::span<const MetaLogProto> metalogs) {
+    if (metalogs.empty()) {
+        return;
+    }
+    uint32_t logspace_id = metalogs[0].logspace_id();
     DCHECK_EQ(bits::LowHalf32(logspace_id), my_node_id());
     absl::flat_hash_set<uint16_t> engine_nodes;
     absl::flat_hash_set<uint16_t> storage_nodes;
-    switch (metalog.type()) {
-    case MetaLogProto::NEW_LOGS:
-        for (const auto& [storage_shard_id, engine_node_id] : view_mutable->storage_shard_occupation()){
-            engine_nodes.insert(engine_node_id);
-        }
-        for (uint16_t storage_id : view->GetStorageNodes()) {
-            storage_nodes.insert(storage_id);
+    for (const MetaLogProto& metalog : metalogs) {
+        switch (metalog.type()) {
+        case MetaLogProto::NEW_LOGS:
+        case MetaLogProto::TRIM:
+            // Storage nodes reclaim space of trimmed entries, while engines
+            // drop them from their indices
+            for (const auto& [storage_shard_id, engine_node_id] : view_mutable->storage_shard_occupation()){
+                engine_nodes.insert(engine_node_id);
+            }
+            for (uint16_t storage_id : view->GetStorageNodes()) {
+                storage_nodes.insert(storage_id);
+            }
+            break;
+        default:
+            UNREACHABLE();
         }
-        break;
-    case MetaLogProto::TRIM:
-        NOT_IMPLEMENTED();
-        break;
-    default:
-        UNREACHABLE();
     }
-    HVLOG_F(1, "Propagate metalog to {} engines and {} storage nodes", engine_nodes.size(), storage_nodes.size());
-    SharedLogMessage message = SharedLogMessageHelper::NewMetaLogsMessage(metalog.logspace_id());
-    std::string payload = SerializedMetaLogs(metalog);
+    // All meta logs are packed into a single METALOGS message per destination
+    HVLOG_F(1, "Propagate {} metalogs to {} engines and {} storage nodes",
+            metalogs.size(), engine_nodes.size(), storage_nodes.size());
+    SharedLogMessage message = SharedLogMessageHelper::NewMetaLogsMessage(logspace_id);
+    std::string payload = SerializedMetaLogs(metalogs);
     message.origin_node_id = node_id_;
     message.payload_size = gsl::narrow_cast<uint32_t>(payload.size());
     for (uint16_t engine_id : engine_nodes) {
@@ -37,7 +37,8 @@ protected:
                         std::span<const char> payload);
 
     void ReplicateMetaLog(const View* view, const MetaLogProto& metalog);
-    void PropagateMetaLog(const View* view, const ViewMutable* view_mutable, const MetaLogProto& metalog);
+    void PropagateMetaLogs(const View* view, const ViewMutable* view_mutable,
+                           std::span<const MetaLogProto> metalogs);
 
     bool SendSequencerMessage(uint16_t sequencer_id,
                               protocol::SharedLogMessage* message,
@@ -1,5 +1,6 @@
 #include "log/storage.h"
 
+#include "common/time.h"
 #include "log/flags.h"
 #include "log/utils.h"
 #include "utils/bits.h"
@@ -18,7 +19,11 @@ Storage::Storage(uint16_t node_id)
     : StorageBase(node_id),
       log_header_(fmt::format("Storage[{}-N]: ", node_id)),
       current_view_(nullptr),
-      view_finalized_(false) {}
+      view_finalized_(false),
+      group_commit_window_us_(absl::GetFlag(FLAGS_slog_storage_group_commit_window_us)),
+      group_commit_max_entries_(absl::GetFlag(FLAGS_slog_storage_group_commit_max_entries)),
+      flush_batch_size_stat_(stat::StatisticsCollector<int>::StandardReportCallback(
+          "flush_batch_size")) {}
 
 Storage::~Storage() {}
 
@@ -45,6 +50,7 @@ void Storage::OnViewCreated(const View* view) {
         current_view_ = view;
         view_finalized_ = false;
         log_header_ = fmt::format("Storage[{}-{}]: ", my_node_id(), view->id());
+        PublishViewSnapshot();
     }
     if (!ready_requests.empty()) {
         HLOG_F(INFO, "{} requests for the new view", ready_requests.size());
@@ -101,6 +107,29 @@ void Storage::OnViewFinalized(const FinalizedView* finalized_view) {
     }
 }
 
+// Finalizing a log space keeps it in storage_collection_, so only view
+// creation changes the snapshot
+void Storage::PublishViewSnapshot() {
+    auto snapshot = std::make_unique<ViewSnapshot>();
+    snapshot->view = current_view_;
+    auto add_storage = [&snapshot] (uint32_t logspace_id, LockablePtr<LogStorage> storage_ptr) {
+        snapshot->storages[logspace_id] = storage_ptr;
+    };
+    storage_collection_.ForEachActiveLogSpace(add_storage);
+    storage_collection_.ForEachFinalizedLogSpace(add_storage);
+    view_snapshot_.Publish(std::move(snapshot));
+}
+
+LockablePtr<LogStorage> Storage::GetStorageFromSnapshot(const SharedLogMessage& message) {
+    utils::EpochGuard epoch_guard;
+    const ViewSnapshot* snapshot = view_snapshot_.Load();
+    if (snapshot == nullptr || message.view_id != snapshot->view->id()) {
+        return LockablePtr<LogStorage>();
+    }
+    auto iter = snapshot->storages.find(message.logspace_id);
+    return iter != snapshot->storages.end() ? iter->second : LockablePtr<LogStorage>();
+}
+
 #define ONHOLD_IF_FROM_FUTURE_VIEW(MESSAGE_VAR, PAYLOAD_VAR)        \
     do {                                                            \
         if (current_view_ == nullptr                                \
@@ -138,14 +167,26 @@ void Storage::HandleReadAtRequest(const SharedLogMessage& request) {
         request.origin_node_id, bits::HexStr0x(request.client_data)
     );
     LockablePtr<LogStorage> storage_ptr;
+    bool from_future_view = true;
     {
+        utils::EpochGuard epoch_guard;
+        const ViewSnapshot* snapshot = view_snapshot_.Load();
+        if (snapshot != nullptr && request.view_id <= snapshot->view->id()) {
+            from_future_view = false;
+            if (auto iter = snapshot->storages.find(request.logspace_id);
+                    iter != snapshot->storages.end()) {
+                storage_ptr = iter->second;
+            }
+        }
+    }
+    if (from_future_view) {
         absl::ReaderMutexLock view_lk(&view_mu_);
         ONHOLD_IF_FROM_FUTURE_VIEW(request, EMPTY_CHAR_SPAN);
         storage_ptr = storage_collection_.GetLogSpace(request.logspace_id);
     }
     if (storage_ptr == nullptr) {
         HVLOG(1) << "ReadRecord: Read from DB";
-        ProcessReadFromDB(request);
+        ScheduleReadFromDB(request);
         return;
     }
     LogStorage::ReadResultVec results;
@@ -165,15 +206,49 @@ void Storage::HandleReplicateRequest(const SharedLogMessage& message,
     std::span<const char> log_data;
     log_utils::SplitPayloadForMessage(message, payload, &user_tags, &log_data,
                                       /* aux_data= */ nullptr);
+    auto storage_ptr = GetStorageFromSnapshot(message);
+    if (storage_ptr == nullptr) {
+        absl::ReaderMutexLock view_lk(&view_mu_);
+        ONHOLD_IF_FROM_FUTURE_VIEW(message, payload);
+        IGNORE_IF_FROM_PAST_VIEW(message);
+        storage_ptr = storage_collection_.GetLogSpaceChecked(message.logspace_id);
+    }
     {
+        auto locked_storage = storage_ptr.Lock();
+        RETURN_IF_LOGSPACE_FINALIZED(locked_storage);
+        if (!locked_storage->Store(metadata, user_tags, log_data)) {
+            HLOG(ERROR) << "Failed to store log entry";
+        }
+    }
+}
+
+void Storage::HandleReplicateBatchRequest(const SharedLogMessage& message,
+                                          std::span<const char> payload) {
+    DCHECK(SharedLogMessageHelper::GetOpType(message) == SharedLogOpType::REPLICATE_BATCH);
+    std::vector<std::span<const uint64_t>> user_tags;
+    std::vector<std::span<const char>> log_data;
+    if (!log_utils::SplitAppendBatchPayload(payload, message.num_records,
+                                            &user_tags, &log_data)) {
+        HLOG_F(ERROR, "Malformed batch of {} log entries", message.num_records);
+        return;
+    }
+    LogMetaData metadata = log_utils::GetMetaDataFromMessage(message);
+    uint64_t start_localid = message.localid;
+    auto storage_ptr = GetStorageFromSnapshot(message);
+    if (storage_ptr == nullptr) {
         absl::ReaderMutexLock view_lk(&view_mu_);
         ONHOLD_IF_FROM_FUTURE_VIEW(message, payload);
         IGNORE_IF_FROM_PAST_VIEW(message);
-        auto storage_ptr = storage_collection_.GetLogSpaceChecked(message.logspace_id);
-        {
-            auto locked_storage = storage_ptr.Lock();
-            RETURN_IF_LOGSPACE_FINALIZED(locked_storage);
-            if (!locked_storage->Store(metadata, user_tags, log_data)) {
+        storage_ptr = storage_collection_.GetLogSpaceChecked(message.logspace_id);
+    }
+    {
+        auto locked_storage = storage_ptr.Lock();
+        RETURN_IF_LOGSPACE_FINALIZED(locked_storage);
+        for (size_t i = 0; i < user_tags.size(); i++) {
+            metadata.localid = start_localid + i;
+            metadata.num_tags = user_tags[i].size();
+            metadata.data_size = log_data[i].size();
+            if (!locked_storage->Store(metadata, user_tags[i], log_data[i])) {
                 HLOG(ERROR) << "Failed to store log entry";
             }
         }
@@ -283,17 +358,17 @@ void Storage::ProcessReadResults(const LogStorage::ReadResultVec& results) {
         switch (result.status) {
         case LogStorage::ReadResult::kOK:
             response = SharedLogMessageHelper::NewReadOkResponse();
-            log_utils::PopulateMetaDataToMessage(result.log_entry->metadata, &response);
+            log_utils::PopulateMetaDataToMessage(result.log_record.metadata(), &response);
             DCHECK_EQ(response.logspace_id, request.logspace_id);
             DCHECK_EQ(response.seqnum_lowhalf, request.seqnum_lowhalf);
             response.user_metalog_progress = request.user_metalog_progress;
             response.storage_shard_id = request.storage_shard_id;
             SendEngineLogResult(request, &response,
-                                VECTOR_AS_CHAR_SPAN(result.log_entry->user_tags),
-                                STRING_AS_SPAN(result.log_entry->data));
+                                result.log_record.user_tags_data(),
+                                result.log_record.data());
             break;
         case LogStorage::ReadResult::kLookupDB:
-            ProcessReadFromDB(request);
+            ScheduleReadFromDB(request);
             break;
         case LogStorage::ReadResult::kFailed:
             HLOG_F(ERROR, "ReadRecord: Failed to read log data (seqnum={})",
@@ -307,28 +382,27 @@ void Storage::ProcessReadResults(const LogStorage::ReadResultVec& results) {
     }
 }
 
-void Storage::ProcessReadFromDB(const SharedLogMessage& request) {
-    uint64_t seqnum = bits::JoinTwo32(request.logspace_id, request.seqnum_lowhalf);
-    LogEntryProto log_entry;
-    if (auto tmp = GetLogEntryFromDB(seqnum); tmp.has_value()) {
-        log_entry = std::move(*tmp);
-    } else {
-        HLOG_F(ERROR, "Failed to read log data (seqnum={})", bits::HexStr0x(seqnum));
-        SharedLogMessage response = SharedLogMessageHelper::NewDataLostResponse();
-        SendEngineResponse(request, &response);
-        return;
+void Storage::OnRecvDBReadResults(std::span<const SharedLogMessage> requests,
+                                  std::span<const std::optional<LogRecord>> records) {
+    DCHECK_EQ(requests.size(), records.size());
+    for (size_t i = 0; i < requests.size(); i++) {
+        const SharedLogMessage& request = requests[i];
+        const std::optional<LogRecord>& record = records[i];
+        if (!record.has_value()) {
+            HLOG_F(ERROR, "Failed to read log data (seqnum={})",
+                   bits::HexStr0x(bits::JoinTwo32(request.logspace_id, request.seqnum_lowhalf)));
+            SharedLogMessage response = SharedLogMessageHelper::NewDataLostResponse();
+            SendEngineResponse(request, &response);
+            continue;
+        }
+        SharedLogMessage response = SharedLogMessageHelper::NewReadOkResponse();
+        log_utils::PopulateMetaDataToMessage(record->metadata(), &response);
+        DCHECK_EQ(response.logspace_id, request.logspace_id);
+        DCHECK_EQ(response.seqnum_lowhalf, request.seqnum_lowhalf);
+        response.user_metalog_progress = request.user_metalog_progress;
+        response.storage_shard_id = request.storage_shard_id;
+        SendEngineLogResult(request, &response, record->user_tags_data(), record->data());
     }
-    SharedLogMessage response = SharedLogMessageHelper::NewReadOkResponse();
-    log_utils::PopulateMetaDataToMessage(log_entry, &response);
-    DCHECK_EQ(response.logspace_id, request.logspace_id);
-    DCHECK_EQ(response.seqnum_lowhalf, request.seqnum_lowhalf);
-    response.user_metalog_progress = request.user_metalog_progress;
-    response.storage_shard_id = request.storage_shard_id;
-    std::span<const char> user_tags_data(
-        reinterpret_cast<const char*>(log_entry.user_tags().data()),
-        static_cast<size_t>(log_entry.user_tags().size()) * sizeof(uint64_t));
-    SendEngineLogResult(request, &response, user_tags_data,
-                        STRING_AS_SPAN(log_entry.data()));
 }
 
 void Storage::ProcessRequests(const std::vector<SharedLogRequest>& requests) {
@@ -413,39 +487,86 @@ void Storage::SendShardProgressIfNeeded() {
     }
 }
 
+bool Storage::ShouldFlushLogSpace(uint32_t logspace_id, const LogStorage& storage,
+                                  int64_t current_timestamp) {
+    if (group_commit_window_us_ <= 0 || storage.finalized()) {
+        return true;
+    }
+    if (!last_flush_timestamps_.contains(logspace_id)) {
+        last_flush_timestamps_[logspace_id] = current_timestamp;
+    }
+    if (current_timestamp - last_flush_timestamps_.at(logspace_id) >= group_commit_window_us_) {
+        return true;
+    }
+    return group_commit_max_entries_ > 0
+             && storage.NumEntriesToPersist() >= group_commit_max_entries_;
+}
+
 void Storage::FlushLogEntries() {
-    std::vector<std::shared_ptr<const LogEntry>> log_entires;
-    std::vector<std::pair<LockablePtr<LogStorage>, uint64_t>> storages;
+    struct FlushBatch {
+        uint32_t logspace_id;
+        LockablePtr<LogStorage> storage_ptr;
+        uint64_t new_position;
+        std::vector<LogRecordRef> log_records;
+    };
+    struct TrimmedRange {
+        uint32_t logspace_id;
+        LockablePtr<LogStorage> storage_ptr;
+        uint64_t start_seqnum;
+        uint64_t end_seqnum;
+    };
+    std::vector<FlushBatch> batches;
+    std::vector<TrimmedRange> trimmed_ranges;
+    int64_t current_timestamp = GetMonotonicMicroTimestamp();
     {
         absl::ReaderMutexLock view_lk(&view_mu_);
         storage_collection_.ForEachActiveLogSpace(
-            [&log_entires, &storages] (uint32_t logspace_id,
-                                       LockablePtr<LogStorage> storage_ptr) {
+            [this, &batches, &trimmed_ranges, current_timestamp] (
+                    uint32_t logspace_id, LockablePtr<LogStorage> storage_ptr) {
                 auto locked_storage = storage_ptr.ReaderLock();
-                std::vector<std::shared_ptr<const LogEntry>> tmp;
-                uint64_t new_position;
-                if (locked_storage->GrabLogEntriesForPersistence(&tmp, &new_position)) {
-                    storages.emplace_back(storage_ptr, new_position);
-                    log_entires.insert(log_entires.end(), tmp.begin(), tmp.end());
+                TrimmedRange range;
+                if (locked_storage->GrabTrimmedRangeForDeletion(&range.start_seqnum,
+                                                                &range.end_seqnum)) {
+                    range.logspace_id = logspace_id;
+                    range.storage_ptr = storage_ptr;
+                    trimmed_ranges.push_back(std::move(range));
+                }
+                if (!ShouldFlushLogSpace(logspace_id, *locked_storage, current_timestamp)) {
+                    return;
+                }
+                FlushBatch batch;
+                if (locked_storage->GrabLogEntriesForPersistence(&batch.log_records,
+                                                                 &batch.new_position)) {
+                    batch.logspace_id = logspace_id;
+                    batch.storage_ptr = storage_ptr;
+                    batches.push_back(std::move(batch));
                 }
             }
         );
     }
 
-    if (log_entires.empty()) {
+    for (TrimmedRange& range : trimmed_ranges) {
+        DeleteLogRecordsFromDB(range.logspace_id, range.start_seqnum, range.end_seqnum);
+        range.storage_ptr.Lock()->TrimmedRangeDeleted(range.end_seqnum);
+    }
+
+    if (batches.empty()) {
         return;
     }
-    HVLOG_F(1, "Will flush {} log entries", log_entires.size());
-    for (size_t i = 0; i < log_entires.size(); i++) {
-        PutLogEntryToDB(*log_entires[i]);
+    for (const FlushBatch& batch : batches) {
+        HVLOG_F(1, "Will flush {} log entries of log space {}",
+                batch.log_records.size(), bits::HexStr0x(batch.logspace_id));
+        PutLogRecordsToDB(batch.logspace_id, batch.log_records);
+        last_flush_timestamps_[batch.logspace_id] = current_timestamp;
+        flush_batch_size_stat_.AddSample(gsl::narrow_cast<int>(batch.log_records.size()));
     }
 
     std::vector<uint32_t> finalized_logspaces;
-    for (auto& [storage_ptr, new_position] : storages) {
-        auto locked_storage = storage_ptr.Lock();
-        locked_storage->LogEntriesPersisted(new_position);
+    for (FlushBatch& batch : batches) {
+        auto locked_storage = batch.storage_ptr.Lock();
+        locked_storage->LogEntriesPersisted(batch.new_position);
         if (locked_storage->finalized()
-                && new_position >= locked_storage->seqnum_position()) {
+                && batch.new_position >= locked_storage->seqnum_position()) {
             finalized_logspaces.push_back(locked_storage->identifier());
         }
     }
@@ -453,6 +574,8 @@ void Storage::FlushLogEntries() {
     if (!finalized_logspaces.empty()) {
         absl::MutexLock view_lk(&view_mu_);
         for (uint32_t logspace_id : finalized_logspaces) {
+            // Finalized log spaces are no longer flushed
+            last_flush_timestamps_.erase(logspace_id);
             if (storage_collection_.FinalizeLogSpace(logspace_id)) {
                 HLOG_F(INFO, "Finalize storage log space {}", bits::HexStr0x(logspace_id));
             } else {
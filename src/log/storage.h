@@ -1,5 +1,6 @@
 #pragma once
 
+#include "common/stat.h"
 #include "log/storage_base.h"
 #include "log/log_space.h"
 #include "log/utils.h"
@@ -23,22 +24,44 @@ private:
     LogSpaceCollection<LogStorage>
         storage_collection_        ABSL_GUARDED_BY(view_mu_);
 
+    // Immutable copy of the current view and its log spaces, republished
+    // under view_mu_. Requests of other views go through view_mu_.
+    struct ViewSnapshot {
+        const View* view;
+        absl::flat_hash_map</* logspace_id */ uint32_t, LockablePtr<LogStorage>> storages;
+    };
+    utils::EpochPtr<ViewSnapshot> view_snapshot_;
+    void PublishViewSnapshot() ABSL_EXCLUSIVE_LOCKS_REQUIRED(view_mu_);
+    // Returns nullptr if `message` is not from the published view
+    LockablePtr<LogStorage> GetStorageFromSnapshot(const protocol::SharedLogMessage& message);
+
     log_utils::FutureRequests future_requests_;
 
+    // Accessed only by the background thread
+    int64_t group_commit_window_us_;
+    size_t group_commit_max_entries_;
+    absl::flat_hash_map</* logspace_id */ uint32_t,
+                        /* timestamp */ int64_t> last_flush_timestamps_;
+    stat::StatisticsCollector<int> flush_batch_size_stat_;
+
     void OnViewCreated(const View* view) override;
     void OnViewFinalized(const FinalizedView* finalized_view) override;
 
     void HandleReadAtRequest(const protocol::SharedLogMessage& request) override;
     void HandleReplicateRequest(const protocol::SharedLogMessage& message,
                                 std::span<const char> payload) override;
+    void HandleReplicateBatchRequest(const protocol::SharedLogMessage& message,
+                                     std::span<const char> payload) override;
     void OnRecvNewMetaLogs(const protocol::SharedLogMessage& message,
                            std::span<const char> payload) override;
     void OnRecvLogAuxData(const protocol::SharedLogMessage& message,
                           std::span<const char> payload) override;
     void OnRecvRegistration(const protocol::SharedLogMessage& message) override;
+    void OnRecvDBReadResults(
+        std::span<const protocol::SharedLogMessage> requests,
+        std::span<const std::optional<LogRecord>> records) override;
 
     void ProcessReadResults(const LogStorage::ReadResultVec& results);
-    void ProcessReadFromDB(const protocol::SharedLogMessage& request);
     void ProcessRequests(const std::vector<SharedLogRequest>& requests);
 
     void SendEngineLogResult(const protocol::SharedLogMessage& request,
@@ -49,6 +72,8 @@ private:
     void BackgroundThreadMain() override;
     void SendShardProgressIfNeeded() override;
     void FlushLogEntries();
+    bool ShouldFlushLogSpace(uint32_t logspace_id, const LogStorage& storage,
+                             int64_t current_timestamp);
 
     DISALLOW_COPY_AND_ASSIGN(Storage);
 };
@@ -9,6 +9,12 @@
 namespace faas {
 namespace log {
 
+namespace {
+// READ_AT requests pending DB lookup, collected within the current event
+// loop iteration of each IO worker
+thread_local std::vector<protocol::SharedLogMessage> pending_db_reads;
+}  // namespace
+
 using node::NodeType;
 
 using protocol::SharedLogMessage;
@@ -27,7 +33,17 @@ StorageBase::StorageBase(uint16_t node_id)
       db_(nullptr),
       index_tier_only_(absl::GetFlag(FLAGS_slog_storage_index_tier_only)),
       per_tag_seqnum_min_completion_(absl::GetFlag(FLAGS_slog_activate_min_seqnum_completion)),
-      background_thread_("BG", [this] { this->BackgroundThreadMain(); }) {}
+      index_partition_by_tag_(absl::GetFlag(FLAGS_slog_index_partition_by_tag)),
+      background_thread_("BG", [this] { this->BackgroundThreadMain(); }),
+      index_data_history_cap_(absl::GetFlag(FLAGS_slog_storage_index_data_history)),
+      index_history_min_view_id_(0),
+      db_read_stopped_(false) {
+    int num_db_read_threads = absl::GetFlag(FLAGS_slog_storage_db_read_threads);
+    for (int i = 0; i < num_db_read_threads; i++) {
+        db_read_threads_.push_back(std::make_unique<base::Thread>(
+            fmt::format("DBRead-{}", i), [this] { this->DBReadThreadMain(); }));
+    }
+}
 
 StorageBase::~StorageBase() {}
 
@@ -37,10 +53,20 @@ void StorageBase::StartInternal() {
     SetupTimers();
     log_cache_.emplace(absl::GetFlag(FLAGS_slog_storage_cache_cap_mb));
     background_thread_.Start();
+    for (auto& thread : db_read_threads_) {
+        thread->Start();
+    }
 }
 
 void StorageBase::StopInternal() {
     background_thread_.Join();
+    {
+        absl::MutexLock lk(&db_read_mu_);
+        db_read_stopped_ = true;
+    }
+    for (auto& thread : db_read_threads_) {
+        thread->Join();
+    }
 }
 
 void StorageBase::SetupDB() {
@@ -53,6 +79,8 @@ void StorageBase::SetupDB() {
         db_.reset(new TkrzwDBMBackend(TkrzwDBMBackend::kTreeDBM, db_path_));
     } else if (db_backend == "tkrzw_skip") {
         db_.reset(new TkrzwDBMBackend(TkrzwDBMBackend::kSkipDBM, db_path_));
+    } else if (db_backend == "segment_file") {
+        db_.reset(new SegmentFileBackend(db_path_));
     } else {
         HLOG(FATAL) << "Unknown storage backend: " << db_backend;
     }
@@ -62,6 +90,7 @@ void StorageBase::SetupZKWatchers() {
     view_watcher_.SetViewCreatedCallback(
         [this] (const View* view) {
             this->OnViewCreated(view);
+            this->DropIndexDataHistory(view->id());
             // TODO: This is not always safe, try fix it
             for (uint16_t sequencer_id : view->GetSequencerNodes()) {
                 if (view->is_active_phylog(sequencer_id)) {
@@ -95,6 +124,9 @@ void StorageBase::MessageHandler(const SharedLogMessage& message,
     case SharedLogOpType::REPLICATE:
         HandleReplicateRequest(message, payload);
         break;
+    case SharedLogOpType::REPLICATE_BATCH:
+        HandleReplicateBatchRequest(message, payload);
+        break;
     case SharedLogOpType::METALOGS:
         OnRecvNewMetaLogs(message, payload);
         break;
@@ -104,42 +136,125 @@ void StorageBase::MessageHandler(const SharedLogMessage& message,
     case SharedLogOpType::REGISTER:
         OnRecvRegistration(message);
         break;
+    case SharedLogOpType::INDEX_CATCHUP:
+        HandleIndexCatchupRequest(message);
+        break;
     default:
         UNREACHABLE();
     }
 }
 
-namespace {
-static inline std::string SerializedLogEntry(const LogEntry& log_entry) {
-    LogEntryProto log_entry_proto;
-    log_entry_proto.set_user_logspace(log_entry.metadata.user_logspace);
-    log_entry_proto.set_seqnum(log_entry.metadata.seqnum);
-    log_entry_proto.set_localid(log_entry.metadata.localid);
-    log_entry_proto.mutable_user_tags()->Add(
-        log_entry.user_tags.begin(), log_entry.user_tags.end());
-    log_entry_proto.set_data(log_entry.data);
-    std::string data;
-    CHECK(log_entry_proto.SerializeToString(&data));
-    return data;
+void StorageBase::ScheduleReadFromDB(const SharedLogMessage& request) {
+    IOWorker* io_worker = IOWorker::current();
+    DCHECK(io_worker != nullptr);
+    if (pending_db_reads.empty()) {
+        io_worker->ScheduleIdleFunction(
+            nullptr, absl::bind_front(&StorageBase::FlushPendingDBReads, this));
+    }
+    pending_db_reads.push_back(request);
+}
+
+void StorageBase::FlushPendingDBReads() {
+    if (pending_db_reads.empty()) {
+        return;
+    }
+    auto batch = std::make_shared<DBReadBatch>();
+    batch->requests = std::move(pending_db_reads);
+    pending_db_reads.clear();
+    if (db_read_threads_.empty()) {
+        ReadBatchFromDB(batch.get());
+        OnRecvDBReadResults(VECTOR_AS_SPAN(batch->requests),
+                            VECTOR_AS_SPAN(batch->records));
+        return;
+    }
+    absl::MutexLock lk(&db_read_mu_);
+    db_read_queue_.push_back(std::move(batch));
 }
-}  // namespace
 
-std::optional<LogEntryProto> StorageBase::GetLogEntryFromDB(uint64_t seqnum) {
-    auto data = db_->Get(bits::HighHalf64(seqnum), bits::LowHalf64(seqnum));
-    if (!data.has_value()) {
-        return std::nullopt;
+void StorageBase::ReadBatchFromDB(DBReadBatch* batch) {
+    // Requests of the same log space are looked up with a single MultiGet
+    absl::flat_hash_map</* logspace_id */ uint32_t,
+                        /* request indices */ std::vector<size_t>> requests_by_logspace;
+    for (size_t i = 0; i < batch->requests.size(); i++) {
+        requests_by_logspace[batch->requests[i].logspace_id].push_back(i);
     }
-    LogEntryProto log_entry_proto;
-    if (!log_entry_proto.ParseFromString(*data)) {
-        HLOG(FATAL) << "Failed to parse LogEntryProto";
+    batch->records.clear();
+    batch->records.resize(batch->requests.size());
+    std::vector<uint32_t> keys;
+    std::vector<std::optional<std::string>> values;
+    for (const auto& [logspace_id, indices] : requests_by_logspace) {
+        keys.clear();
+        for (size_t index : indices) {
+            keys.push_back(batch->requests[index].seqnum_lowhalf);
+        }
+        db_->MultiGet(logspace_id, VECTOR_AS_SPAN(keys), &values);
+        DCHECK_EQ(values.size(), indices.size());
+        for (size_t i = 0; i < indices.size(); i++) {
+            if (!values[i].has_value()) {
+                continue;
+            }
+            uint64_t seqnum = bits::JoinTwo32(logspace_id, keys[i]);
+            auto record = LogRecord::Decode(std::move(*values[i]));
+            if (!record.has_value()) {
+                HLOG_F(FATAL, "Failed to decode log record (seqnum={})", bits::HexStr0x(seqnum));
+            }
+            DCHECK_EQ(record->metadata().seqnum, seqnum);
+            batch->records[indices[i]] = std::move(record);
+        }
+    }
+}
+
+void StorageBase::DBReadThreadMain() {
+    auto has_work = [this] () ABSL_EXCLUSIVE_LOCKS_REQUIRED(db_read_mu_) {
+        return db_read_stopped_ || !db_read_queue_.empty();
+    };
+    while (true) {
+        std::shared_ptr<DBReadBatch> batch;
+        {
+            absl::MutexLock lk(&db_read_mu_);
+            db_read_mu_.Await(absl::Condition(&has_work));
+            if (db_read_queue_.empty()) {
+                break;
+            }
+            batch = std::move(db_read_queue_.front());
+            db_read_queue_.pop_front();
+        }
+        HVLOG_F(1, "Read {} log entries from DB", batch->requests.size());
+        ReadBatchFromDB(batch.get());
+        SomeIOWorker()->ScheduleFunction(
+            nullptr, [this, batch = std::move(batch)] {
+                OnRecvDBReadResults(VECTOR_AS_SPAN(batch->requests),
+                                    VECTOR_AS_SPAN(batch->records));
+            }
+        );
     }
-    return log_entry_proto;
 }
 
-void StorageBase::PutLogEntryToDB(const LogEntry& log_entry) {
-    uint64_t seqnum = log_entry.metadata.seqnum;
-    std::string data = SerializedLogEntry(log_entry);
-    db_->Put(bits::HighHalf64(seqnum), bits::LowHalf64(seqnum), STRING_AS_SPAN(data));
+void StorageBase::PutLogRecordsToDB(uint32_t logspace_id,
+                                    const std::vector<LogRecordRef>& log_records) {
+    std::vector<DBInterface::KeyValue> batch;
+    batch.reserve(log_records.size());
+    for (const LogRecordRef& log_record : log_records) {
+        uint64_t seqnum = log_record.header().seqnum;
+        DCHECK_EQ(bits::HighHalf64(seqnum), logspace_id);
+        batch.push_back(DBInterface::KeyValue {
+            .key = bits::LowHalf64(seqnum),
+            .data = log_record.encoded()
+        });
+    }
+    db_->PutBatch(logspace_id, VECTOR_AS_SPAN(batch));
+}
+
+void StorageBase::DeleteLogRecordsFromDB(uint32_t logspace_id,
+                                         uint64_t start_seqnum, uint64_t end_seqnum) {
+    DCHECK_EQ(bits::HighHalf64(start_seqnum), logspace_id);
+    DCHECK_LE(start_seqnum, end_seqnum);
+    if (start_seqnum == end_seqnum) {
+        return;
+    }
+    HVLOG_F(1, "Delete log entries [{}, {}) from DB",
+            bits::HexStr0x(start_seqnum), bits::HexStr0x(end_seqnum));
+    db_->DeleteRange(logspace_id, bits::LowHalf64(start_seqnum), bits::LowHalf64(end_seqnum));
 }
 
 void StorageBase::LogCachePutAuxData(uint64_t seqnum, std::span<const char> data) {
@@ -156,6 +271,7 @@ void StorageBase::SendIndexData(const View* view, const ViewMutable* view_mutabl
                                 const IndexDataPackagesProto& index_data_packages) {
     uint32_t logspace_id = index_data_packages.logspace_id();
     DCHECK_EQ(view->id(), bits::HighHalf32(logspace_id));
+    RecordIndexDataHistory(view, index_data_packages);
     std::string serialized_data;
     CHECK(index_data_packages.SerializeToString(&serialized_data));
     SharedLogMessage message = SharedLogMessageHelper::NewIndexDataMessage(
@@ -171,6 +287,11 @@ void StorageBase::SendIndexData(const View* view, const ViewMutable* view_mutabl
             }
         }
     }
+    // Min seqnum completion needs all tags on all index nodes
+    if (index_partition_by_tag_ && !per_tag_seqnum_min_completion_) {
+        SendPartitionedIndexData(view, index_data_packages, view->GetIndexNodes());
+        return;
+    }
     for(uint16_t index_id : view->GetIndexNodes()){
         bool send = per_tag_seqnum_min_completion_;
         if (!send) {
@@ -187,6 +308,169 @@ void StorageBase::SendIndexData(const View* view, const ViewMutable* view_mutabl
     }
 }
 
+// Every index shard gets all metalog positions, for tracking index progress,
+// but only the entries it indexes: all entries of its own positions, and
+// entries with tags it owns of other positions
+void StorageBase::SendPartitionedIndexData(const View* view,
+                                           const IndexDataPackagesProto& index_data_packages,
+                                           std::span<const uint16_t> index_nodes) {
+    uint32_t logspace_id = index_data_packages.logspace_id();
+    size_t num_shards = view->num_index_shards();
+    std::vector<IndexDataPackagesProto> shard_packages(num_shards);
+    std::vector<IndexDataProto*> shard_data(num_shards);
+    std::vector<UserTagVec> shard_tags(num_shards);
+    for (size_t shard = 0; shard < num_shards; shard++) {
+        shard_packages[shard].set_logspace_id(logspace_id);
+    }
+    for (const IndexDataProto& index_data : index_data_packages.index_data_proto()) {
+        for (size_t shard = 0; shard < num_shards; shard++) {
+            IndexDataProto* data = shard_packages[shard].add_index_data_proto();
+            data->set_metalog_position(index_data.metalog_position());
+            data->set_end_seqnum_position(index_data.end_seqnum_position());
+            data->set_num_productive_storage_shards(index_data.num_productive_storage_shards());
+            data->mutable_my_productive_storage_shards()->CopyFrom(
+                index_data.my_productive_storage_shards());
+            shard_data[shard] = data;
+        }
+        size_t position_shard = (index_data.metalog_position() - 1) % num_shards;
+        auto tag_iter = index_data.user_tags().begin();
+        for (int i = 0; i < index_data.seqnum_halves_size(); i++) {
+            uint32_t user_logspace = index_data.user_logspaces(i);
+            size_t num_tags = index_data.user_tag_sizes(i);
+            for (size_t shard = 0; shard < num_shards; shard++) {
+                shard_tags[shard].clear();
+            }
+            for (size_t j = 0; j < num_tags; j++, tag_iter++) {
+                shard_tags[view->TagIndexShard(user_logspace, *tag_iter)].push_back(*tag_iter);
+            }
+            for (size_t shard = 0; shard < num_shards; shard++) {
+                if (shard != position_shard && shard_tags[shard].empty()) {
+                    continue;
+                }
+                IndexDataProto* data = shard_data[shard];
+                data->add_seqnum_halves(index_data.seqnum_halves(i));
+                data->add_engine_ids(index_data.engine_ids(i));
+                data->add_user_logspaces(user_logspace);
+                data->add_user_tag_sizes(gsl::narrow_cast<uint32_t>(shard_tags[shard].size()));
+                data->mutable_user_tags()->Add(shard_tags[shard].begin(), shard_tags[shard].end());
+            }
+        }
+    }
+    std::vector<std::string> serialized_data(num_shards);
+    for (size_t shard = 0; shard < num_shards; shard++) {
+        CHECK(shard_packages[shard].SerializeToString(&serialized_data[shard]));
+    }
+    for (uint16_t index_id : index_nodes) {
+        size_t shard = index_id % num_shards;
+        SharedLogMessage message = SharedLogMessageHelper::NewIndexDataMessage(logspace_id);
+        message.origin_node_id = node_id_;
+        message.payload_size = gsl::narrow_cast<uint32_t>(serialized_data[shard].size());
+        HVLOG_F(1, "MetalogUpdate: Send index data to index node {} of shard {}", index_id, shard);
+        SendSharedLogMessage(protocol::ConnType::STORAGE_TO_INDEX,
+                             index_id, message, STRING_AS_SPAN(serialized_data[shard]));
+    }
+}
+
+void StorageBase::RecordIndexDataHistory(const View* view,
+                                         const IndexDataPackagesProto& index_data_packages) {
+    if (index_data_history_cap_ == 0) {
+        return;
+    }
+    absl::MutexLock lk(&index_history_mu_);
+    if (view->id() < index_history_min_view_id_) {
+        return;
+    }
+    auto [iter, inserted] = index_data_history_.try_emplace(index_data_packages.logspace_id());
+    IndexDataHistory& history = iter->second;
+    if (inserted) {
+        history.view = view;
+        history.dropped_position = 0;
+    }
+    for (const IndexDataProto& index_data : index_data_packages.index_data_proto()) {
+        history.index_data.push_back(index_data);
+    }
+    while (history.index_data.size() > index_data_history_cap_) {
+        // Packages of different IO workers may be recorded out of order
+        history.dropped_position = std::max(history.dropped_position,
+                                            history.index_data.front().metalog_position());
+        history.index_data.pop_front();
+    }
+}
+
+void StorageBase::DropIndexDataHistory(uint16_t view_id) {
+    if (view_id == 0) {
+        return;
+    }
+    absl::MutexLock lk(&index_history_mu_);
+    index_history_min_view_id_ = gsl::narrow_cast<uint16_t>(view_id - 1);
+    auto iter = index_data_history_.begin();
+    while (iter != index_data_history_.end()) {
+        if (bits::HighHalf32(iter->first) < index_history_min_view_id_) {
+            index_data_history_.erase(iter++);
+        } else {
+            ++iter;
+        }
+    }
+}
+
+// Index data after the restored metalog position is resent only to the
+// requesting index node, partitioned the same way as by SendIndexData
+void StorageBase::HandleIndexCatchupRequest(const SharedLogMessage& request) {
+    static constexpr int kMaxIndexDataPerMessage = 64;
+    uint32_t logspace_id = request.logspace_id;
+    uint16_t index_id = request.origin_node_id;
+    const View* view = nullptr;
+    std::vector<IndexDataPackagesProto> packages_vec;
+    {
+        absl::MutexLock lk(&index_history_mu_);
+        auto iter = index_data_history_.find(logspace_id);
+        if (iter == index_data_history_.end()) {
+            if (bits::HighHalf32(logspace_id) < index_history_min_view_id_) {
+                HLOG_F(WARNING, "Index data history of logspace {} is dropped, "
+                                "index node {} may not catch up",
+                       bits::HexStr0x(logspace_id), index_id);
+            }
+            return;
+        }
+        const IndexDataHistory& history = iter->second;
+        if (request.metalog_position < history.dropped_position) {
+            HLOG_F(ERROR, "Index node {} restored logspace {} at metalog position {}, "
+                          "while index data up to position {} is dropped",
+                   index_id, bits::HexStr0x(logspace_id), request.metalog_position,
+                   history.dropped_position);
+            return;
+        }
+        view = history.view;
+        for (const IndexDataProto& index_data : history.index_data) {
+            if (index_data.metalog_position() <= request.metalog_position) {
+                continue;
+            }
+            if (packages_vec.empty()
+                    || packages_vec.back().index_data_proto_size() == kMaxIndexDataPerMessage) {
+                packages_vec.emplace_back();
+                packages_vec.back().set_logspace_id(logspace_id);
+            }
+            packages_vec.back().add_index_data_proto()->CopyFrom(index_data);
+        }
+    }
+    HLOG_F(INFO, "Resend index data of logspace {} after metalog position {} to index node {}",
+           bits::HexStr0x(logspace_id), request.metalog_position, index_id);
+    for (const IndexDataPackagesProto& index_data_packages : packages_vec) {
+        if (index_partition_by_tag_ && !per_tag_seqnum_min_completion_) {
+            SendPartitionedIndexData(view, index_data_packages,
+                                     std::span<const uint16_t>(&index_id, 1));
+            continue;
+        }
+        std::string serialized_data;
+        CHECK(index_data_packages.SerializeToString(&serialized_data));
+        SharedLogMessage message = SharedLogMessageHelper::NewIndexDataMessage(logspace_id);
+        message.origin_node_id = node_id_;
+        message.payload_size = gsl::narrow_cast<uint32_t>(serialized_data.size());
+        SendSharedLogMessage(protocol::ConnType::STORAGE_TO_INDEX,
+                             index_id, message, STRING_AS_SPAN(serialized_data));
+    }
+}
+
 bool StorageBase::SendSequencerMessage(uint16_t sequencer_id,
                                        SharedLogMessage* message,
                                        std::span<const char> payload) {
@@ -226,8 +510,10 @@ void StorageBase::OnRecvSharedLogMessage(int conn_type, uint16_t src_node_id,
         (conn_type == kSequencerIngressTypeId && op_type == SharedLogOpType::METALOGS)
      || (conn_type == kEngineIngressTypeId && op_type == SharedLogOpType::READ_AT)
      || (conn_type == kEngineIngressTypeId && op_type == SharedLogOpType::REPLICATE)
+     || (conn_type == kEngineIngressTypeId && op_type == SharedLogOpType::REPLICATE_BATCH)
      || (conn_type == kEngineIngressTypeId && op_type == SharedLogOpType::SET_AUXDATA)
      || (conn_type == kIndexIngressTypeId && op_type == SharedLogOpType::READ_AT)
+     || (conn_type == kIndexIngressTypeId && op_type == SharedLogOpType::INDEX_CATCHUP)
      || (conn_type == kAggregatorIngressTypeId && op_type == SharedLogOpType::READ_AT)
     ) << fmt::format("Invalid combination: conn_type={:#x}, op_type={:#x}",
                      conn_type, message.op_type);
@@ -7,6 +7,7 @@
 #include "log/view_mutable.h"
 #include "log/db.h"
 #include "log/cache.h"
+#include "log/log_record.h"
 #include "server/server_base.h"
 #include "server/ingress_connection.h"
 #include "server/egress_hub.h"
@@ -30,6 +31,8 @@ protected:
     virtual void HandleReadAtRequest(const protocol::SharedLogMessage& request) = 0;
     virtual void HandleReplicateRequest(const protocol::SharedLogMessage& message,
                                         std::span<const char> payload) = 0;
+    virtual void HandleReplicateBatchRequest(const protocol::SharedLogMessage& message,
+                                             std::span<const char> payload) = 0;
     virtual void OnRecvNewMetaLogs(const protocol::SharedLogMessage& message,
                                    std::span<const char> payload) = 0;
     virtual void OnRecvLogAuxData(const protocol::SharedLogMessage& message,
@@ -44,10 +47,22 @@ protected:
 
     void MessageHandler(const protocol::SharedLogMessage& message,
                         std::span<const char> payload);
-    std::optional<LogEntryProto> GetLogEntryFromDB(uint64_t seqnum);
-    void PutLogEntryToDB(const LogEntry& log_entry);
+    // READ_AT requests to look up from DB. Requests are collected within
+    // each event loop iteration of the calling IO worker, and read together
+    // by DB read threads. Results are delivered to OnRecvDBReadResults on
+    // some IO worker.
+    void ScheduleReadFromDB(const protocol::SharedLogMessage& request);
+    virtual void OnRecvDBReadResults(
+        std::span<const protocol::SharedLogMessage> requests,
+        std::span<const std::optional<LogRecord>> records) = 0;
+    // All entries must belong to the log space `logspace_id`
+    void PutLogRecordsToDB(uint32_t logspace_id, const std::vector<LogRecordRef>& log_records);
+    // Delete entries with seqnums in [start_seqnum, end_seqnum) of `logspace_id`
+    void DeleteLogRecordsFromDB(uint32_t logspace_id, uint64_t start_seqnum, uint64_t end_seqnum);
 
     void SendIndexData(const View* view, const ViewMutable* view_mutable, const IndexDataPackagesProto& index_data_proto);
+    void SendPartitionedIndexData(const View* view, const IndexDataPackagesProto& index_data_packages,
+                                  std::span<const uint16_t> index_nodes);
     bool SendSequencerMessage(uint16_t sequencer_id,
                               protocol::SharedLogMessage* message,
                               std::span<const char> payload);
@@ -68,6 +83,7 @@ private:
 
     bool index_tier_only_;
     bool per_tag_seqnum_min_completion_;
+    bool index_partition_by_tag_;
 
     base::Thread background_thread_;
 
@@ -80,6 +96,31 @@ private:
 
     std::optional<LRUCache> log_cache_;
 
+    // Recent index data of each log space, resent to index nodes restored
+    // from checkpoints
+    struct IndexDataHistory {
+        const View* view;
+        std::deque<IndexDataProto> index_data;
+        // Index data of metalog positions up to this one is dropped
+        uint32_t dropped_position;
+    };
+    size_t index_data_history_cap_;
+    absl::Mutex index_history_mu_;
+    absl::flat_hash_map</* logspace_id */ uint32_t, IndexDataHistory>
+        index_data_history_ ABSL_GUARDED_BY(index_history_mu_);
+    // Histories of log spaces of earlier views are dropped
+    uint16_t index_history_min_view_id_ ABSL_GUARDED_BY(index_history_mu_);
+
+    struct DBReadBatch {
+        std::vector<protocol::SharedLogMessage> requests;
+        std::vector<std::optional<LogRecord>>   records;
+    };
+    absl::Mutex db_read_mu_;
+    std::deque<std::shared_ptr<DBReadBatch>>
+        db_read_queue_ ABSL_GUARDED_BY(db_read_mu_);
+    bool db_read_stopped_ ABSL_GUARDED_BY(db_read_mu_);
+    std::vector<std::unique_ptr<base::Thread>> db_read_threads_;
+
     void SetupDB();
     void SetupZKWatchers();
     void SetupTimers();
@@ -99,6 +140,15 @@ private:
                               std::span<const char> payload2 = EMPTY_CHAR_SPAN,
                               std::span<const char> payload3 = EMPTY_CHAR_SPAN);
 
+    void RecordIndexDataHistory(const View* view, const IndexDataPackagesProto& index_data_packages);
+    // Keeps histories of view `view_id` and its previous view
+    void DropIndexDataHistory(uint16_t view_id);
+    void HandleIndexCatchupRequest(const protocol::SharedLogMessage& request);
+
+    void FlushPendingDBReads();
+    void ReadBatchFromDB(DBReadBatch* batch);
+    void DBReadThreadMain();
+
     server::EgressHub* CreateEgressHub(protocol::ConnType conn_type,
                                        uint16_t dst_node_id,
                                        server::IOWorker* io_worker);
@@ -53,6 +53,76 @@ void FutureRequests::OnHoldRequest(uint16_t view_id, SharedLogRequest request) {
     onhold_requests_[view_id].push_back(std::move(request));
 }
 
+IndexReplicaStats::NodeStat::NodeStat()
+    : latency(kTauMs, /* alpha= */ 0, /* p= */ 1.0, kMinSamples),
+      latency_sq(kTauMs, /* alpha= */ 0, /* p= */ 1.0, kMinSamples),
+      mean_latency(0),
+      p95_latency(0) {}
+
+IndexReplicaStats::IndexReplicaStats()
+    : next_replica_(0) {}
+
+IndexReplicaStats::~IndexReplicaStats() {}
+
+void IndexReplicaStats::AddSample(uint16_t index_node, int64_t latency_us) {
+    NodeStat* stat = GetNodeStat(index_node, /* create= */ true);
+    int64_t now = GetMonotonicMicroTimestamp();
+    absl::MutexLock lk(&stat->mu);
+    stat->latency.AddSample(now, latency_us);
+    stat->latency_sq.AddSample(now, static_cast<double>(latency_us) * static_cast<double>(latency_us));
+    double mean = stat->latency.GetValue();
+    if (mean == 0) {
+        return;
+    }
+    double variance = std::max(0.0, stat->latency_sq.GetValue() - mean * mean);
+    stat->mean_latency.store(mean, std::memory_order_relaxed);
+    stat->p95_latency.store(static_cast<int64_t>(mean + 1.645 * std::sqrt(variance)),
+                            std::memory_order_relaxed);
+}
+
+uint16_t IndexReplicaStats::PickReplica(std::span<const uint16_t> replicas) {
+    DCHECK(!replicas.empty());
+    size_t idx = next_replica_.fetch_add(1, std::memory_order_relaxed);
+    uint16_t first = replicas[idx % replicas.size()];
+    if (replicas.size() == 1 || idx % kProbeInterval == 0) {
+        return first;
+    }
+    uint16_t second = replicas[(idx + 1) % replicas.size()];
+    return GetMeanLatency(second) < GetMeanLatency(first) ? second : first;
+}
+
+std::optional<int64_t> IndexReplicaStats::GetP95Latency(uint16_t index_node) {
+    NodeStat* stat = GetNodeStat(index_node, /* create= */ false);
+    int64_t p95_latency = stat != nullptr ? stat->p95_latency.load(std::memory_order_relaxed) : 0;
+    if (p95_latency == 0) {
+        return std::nullopt;
+    }
+    return p95_latency;
+}
+
+IndexReplicaStats::NodeStat* IndexReplicaStats::GetNodeStat(uint16_t index_node, bool create) {
+    {
+        absl::ReaderMutexLock lk(&mu_);
+        if (auto iter = stats_.find(index_node); iter != stats_.end()) {
+            return iter->second.get();
+        }
+    }
+    if (!create) {
+        return nullptr;
+    }
+    absl::MutexLock lk(&mu_);
+    std::unique_ptr<NodeStat>& stat = stats_[index_node];
+    if (stat == nullptr) {
+        stat = std::make_unique<NodeStat>();
+    }
+    return stat.get();
+}
+
+double IndexReplicaStats::GetMeanLatency(uint16_t index_node) {
+    NodeStat* stat = GetNodeStat(index_node, /* create= */ false);
+    return stat != nullptr ? stat->mean_latency.load(std::memory_order_relaxed) : 0;
+}
+
 MetaLogsProto MetaLogsFromPayload(std::span<const char> payload) {
     MetaLogsProto metalogs_proto;
     if (!metalogs_proto.ParseFromArray(payload.data(),
@@ -120,6 +190,34 @@ void SplitPayloadForMessage(const protocol::SharedLogMessage& message,
     }
 }
 
+bool SplitAppendBatchPayload(std::span<const char> payload, size_t num_records,
+                             std::vector<std::span<const uint64_t>>* user_tags,
+                             std::vector<std::span<const char>>* log_data) {
+    size_t pos = 0;
+    for (size_t i = 0; i < num_records; i++) {
+        if (pos + sizeof(protocol::AppendBatchRecordHeader) > payload.size()) {
+            return false;
+        }
+        protocol::AppendBatchRecordHeader header;
+        memcpy(&header, payload.data() + pos, sizeof(header));
+        pos += sizeof(header);
+        size_t tags_size = size_t{header.num_tags} * sizeof(uint64_t);
+        if (header.data_size == 0 || pos + tags_size + header.data_size > payload.size()) {
+            return false;
+        }
+        if (user_tags != nullptr) {
+            user_tags->push_back(std::span<const uint64_t>(
+                reinterpret_cast<const uint64_t*>(payload.data() + pos), header.num_tags));
+        }
+        pos += tags_size;
+        if (log_data != nullptr) {
+            log_data->push_back(payload.subspan(pos, header.data_size));
+        }
+        pos += header.data_size;
+    }
+    return pos == payload.size();
+}
+
 void PopulateMetaDataToMessage(const LogMetaData& metadata, SharedLogMessage* message) {
     message->logspace_id = bits::HighHalf64(metadata.seqnum);
     message->user_logspace = metadata.user_logspace;
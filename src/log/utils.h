@@ -4,6 +4,8 @@
 #include "log/view.h"
 #include "log/view_watcher.h"
 #include "utils/lockable_ptr.h"
+#include "utils/epoch.h"
+#include "utils/exp_moving_avg.h"
 
 namespace faas {
 namespace log_utils {
@@ -57,6 +59,101 @@ private:
     DISALLOW_COPY_AND_ASSIGN(ThreadedMap);
 };
 
+// Table of ongoing ops keyed by op id. Keys are spread over shards with their
+// own mutexes, so concurrent puts and polls of different ops rarely contend.
+// With a non-zero timeout, ops not removed in time are returned by PollExpired,
+// which the owner should call periodically.
+template<class T>
+class ShardedOpTable {
+public:
+    explicit ShardedOpTable(absl::Duration timeout = absl::ZeroDuration());
+    ~ShardedOpTable();
+
+    // All these APIs are thread safe
+    // Runs `fn` on the value under the lock, so that the value cannot be
+    // polled meanwhile. Values must not be used outside `fn` without polling.
+    template<class Fn>
+    bool Visit(uint64_t key, Fn&& fn);
+    bool Poll(uint64_t key, T** value);       // Remove the given key if it is found
+    void PutChecked(uint64_t key, T* value);  // Panic if key exists
+    T*   PollChecked(uint64_t key);           // Panic if key does not exist
+    void RemoveChecked(uint64_t key);         // Panic if key does not exist
+    // Remove ops put more than `timeout` ago
+    void PollExpired(std::vector<std::pair<uint64_t, T*>>* values);
+
+private:
+    static constexpr size_t kNumShards = 64;
+    // Each shard has an expiry wheel, whose slot holds keys expiring at ticks
+    // of the same residue. Polled keys are dropped from the wheel lazily.
+    static constexpr int64_t kNumWheelSlots = 64;
+    static constexpr int64_t kTimeoutTicks = kNumWheelSlots / 2;
+
+    struct Entry {
+        T*      value;
+        int64_t expiry_tick;
+    };
+    struct alignas(__FAAS_CACHE_LINE_SIZE) Shard {
+        absl::Mutex mu;
+        absl::flat_hash_map<uint64_t, Entry> rep ABSL_GUARDED_BY(mu);
+        std::vector<uint64_t> wheel[kNumWheelSlots] ABSL_GUARDED_BY(mu);
+        int64_t last_tick ABSL_GUARDED_BY(mu);
+    };
+
+    int64_t tick_us_;  // Zero if ops never expire
+    Shard shards_[kNumShards];
+
+    Shard& GetShard(uint64_t key) { return shards_[key % kNumShards]; }
+    int64_t CurrentTick() const { return GetMonotonicMicroTimestamp() / tick_us_; }
+
+    DISALLOW_COPY_AND_ASSIGN(ShardedOpTable);
+};
+
+// Latency estimates of index replicas, from the response times of reads
+// served by a single replica
+class IndexReplicaStats {
+public:
+    IndexReplicaStats();
+    ~IndexReplicaStats();
+
+    // All these APIs are thread safe
+    void AddSample(uint16_t index_node, int64_t latency_us);
+    // Picks the faster of the next two replicas in round robin order.
+    // Replicas without enough samples count as the fastest. One in
+    // kProbeInterval picks ignores latencies, so that estimates of replicas
+    // once found slow are refreshed.
+    uint16_t PickReplica(std::span<const uint16_t> replicas);
+    // Assumes normally distributed latencies. Empty if `index_node` does not
+    // have enough samples yet.
+    std::optional<int64_t> GetP95Latency(uint16_t index_node);
+
+private:
+    // Samples older than about kTauMs fade out
+    static constexpr double kTauMs = 1000;
+    static constexpr size_t kMinSamples = 16;
+    static constexpr size_t kProbeInterval = 64;
+
+    struct NodeStat {
+        absl::Mutex mu;
+        utils::ExpMovingAvgExt latency ABSL_GUARDED_BY(mu);
+        utils::ExpMovingAvgExt latency_sq ABSL_GUARDED_BY(mu);
+        // Published for picks without locking, zero without enough samples
+        std::atomic<double> mean_latency;
+        std::atomic<int64_t> p95_latency;
+
+        NodeStat();
+    };
+
+    // Index nodes are never removed, so NodeStat pointers stay valid
+    absl::Mutex mu_;
+    absl::flat_hash_map</* index_node */ uint16_t, std::unique_ptr<NodeStat>> stats_ ABSL_GUARDED_BY(mu_);
+    std::atomic<size_t> next_replica_;
+
+    NodeStat* GetNodeStat(uint16_t index_node, bool create);
+    double GetMeanLatency(uint16_t index_node);
+
+    DISALLOW_COPY_AND_ASSIGN(IndexReplicaStats);
+};
+
 log::MetaLogsProto MetaLogsFromPayload(std::span<const char> payload);
 
 log::LogMetaData GetMetaDataFromMessage(const protocol::SharedLogMessage& message);
@@ -65,6 +162,11 @@ void SplitPayloadForMessage(const protocol::SharedLogMessage& message,
                             std::span<const uint64_t>* user_tags,
                             std::span<const char>* log_data,
                             std::span<const char>* aux_data);
+// Splits records of APPEND_BATCH and REPLICATE_BATCH payloads,
+// returns false if the payload does not hold exactly `num_records` records
+bool SplitAppendBatchPayload(std::span<const char> payload, size_t num_records,
+                             std::vector<std::span<const uint64_t>>* user_tags,
+                             std::vector<std::span<const char>>* log_data);
 
 void PopulateMetaDataToMessage(const log::LogMetaData& metadata,
                                protocol::SharedLogMessage* message);
@@ -162,6 +264,125 @@ void ThreadedMap<T>::PollAllSorted(std::vector<std::pair<uint64_t, T*>>* values)
     );
 }
 
+// Start implementation of ShardedOpTable
+
+template<class T>
+ShardedOpTable<T>::ShardedOpTable(absl::Duration timeout)
+    : tick_us_(std::max<int64_t>(absl::ToInt64Microseconds(timeout) / kTimeoutTicks, 0)) {
+    if (timeout > absl::ZeroDuration() && tick_us_ == 0) {
+        tick_us_ = 1;
+    }
+    int64_t current_tick = tick_us_ > 0 ? CurrentTick() : 0;
+    for (Shard& shard : shards_) {
+        absl::MutexLock lk(&shard.mu);
+        shard.last_tick = current_tick;
+    }
+}
+
+template<class T>
+ShardedOpTable<T>::~ShardedOpTable() {
+#if DCHECK_IS_ON()
+    size_t num_left = 0;
+    for (Shard& shard : shards_) {
+        absl::MutexLock lk(&shard.mu);
+        num_left += shard.rep.size();
+    }
+    if (num_left > 0) {
+        LOG_F(WARNING, "There are {} elements left", num_left);
+    }
+#endif
+}
+
+template<class T>
+template<class Fn>
+bool ShardedOpTable<T>::Visit(uint64_t key, Fn&& fn) {
+    Shard& shard = GetShard(key);
+    absl::MutexLock lk(&shard.mu);
+    if (auto iter = shard.rep.find(key); iter != shard.rep.end()) {
+        fn(iter->second.value);
+        return true;
+    } else {
+        return false;
+    }
+}
+
+template<class T>
+bool ShardedOpTable<T>::Poll(uint64_t key, T** value) {
+    Shard& shard = GetShard(key);
+    absl::MutexLock lk(&shard.mu);
+    if (auto iter = shard.rep.find(key); iter != shard.rep.end()) {
+        *value = iter->second.value;
+        shard.rep.erase(iter);
+        return true;
+    } else {
+        return false;
+    }
+}
+
+template<class T>
+void ShardedOpTable<T>::PutChecked(uint64_t key, T* value) {
+    int64_t expiry_tick = tick_us_ > 0 ? CurrentTick() + kTimeoutTicks : 0;
+    Shard& shard = GetShard(key);
+    absl::MutexLock lk(&shard.mu);
+    DCHECK(!shard.rep.contains(key));
+    shard.rep[key] = Entry {
+        .value = value,
+        .expiry_tick = expiry_tick
+    };
+    if (tick_us_ > 0) {
+        shard.wheel[expiry_tick % kNumWheelSlots].push_back(key);
+    }
+}
+
+template<class T>
+T* ShardedOpTable<T>::PollChecked(uint64_t key) {
+    Shard& shard = GetShard(key);
+    absl::MutexLock lk(&shard.mu);
+    DCHECK(shard.rep.contains(key));
+    T* value = shard.rep.at(key).value;
+    shard.rep.erase(key);
+    return value;
+}
+
+template<class T>
+void ShardedOpTable<T>::RemoveChecked(uint64_t key) {
+    Shard& shard = GetShard(key);
+    absl::MutexLock lk(&shard.mu);
+    DCHECK(shard.rep.contains(key));
+    shard.rep.erase(key);
+}
+
+template<class T>
+void ShardedOpTable<T>::PollExpired(std::vector<std::pair<uint64_t, T*>>* values) {
+    if (tick_us_ == 0) {
+        return;
+    }
+    int64_t current_tick = CurrentTick();
+    for (Shard& shard : shards_) {
+        absl::MutexLock lk(&shard.mu);
+        // Visiting more than kNumWheelSlots ticks would revisit slots
+        int64_t end_tick = std::min(current_tick, shard.last_tick + kNumWheelSlots);
+        for (int64_t tick = shard.last_tick + 1; tick <= end_tick; tick++) {
+            std::vector<uint64_t>& slot = shard.wheel[tick % kNumWheelSlots];
+            size_t num_kept = 0;
+            for (uint64_t key : slot) {
+                auto iter = shard.rep.find(key);
+                if (iter == shard.rep.end()) {
+                    continue;
+                }
+                if (iter->second.expiry_tick <= current_tick) {
+                    values->push_back(std::make_pair(key, iter->second.value));
+                    shard.rep.erase(iter);
+                } else {
+                    slot[num_kept++] = key;
+                }
+            }
+            slot.resize(num_kept);
+        }
+        shard.last_tick = std::max(shard.last_tick, current_tick);
+    }
+}
+
 template<class T>
 void FinalizedLogSpace(LockablePtr<T> logspace_ptr,
                        const log::FinalizedView* finalized_view) {
@@ -80,6 +80,13 @@ public:
         return bits::JoinTwo16(id_, node_id);
     }
 
+    // Index shard holding the seqnums of `user_tag`, if the index tier is
+    // partitioned by tag
+    size_t TagIndexShard(uint32_t user_logspace, uint64_t user_tag) const {
+        uint64_t h = hash::xxHash64(user_tag, /* seed= */ log_space_hash_seed_ ^ user_logspace);
+        return h % num_index_shards_;
+    }
+
     uint64_t log_space_hash_seed() const { return log_space_hash_seed_; }
     const NodeIdVec& log_space_hash_tokens() const { return log_space_hash_tokens_; }
 
@@ -125,17 +132,21 @@ public:
             return index_nodes.at(idx % index_nodes.size());
         }
 
-        uint16_t PickIndexNodeByTag(uint64_t tag) const {
-            size_t shard = tag % view_->num_index_shards_;
-            View::NodeIdVec index_nodes = index_shard_nodes_.at(shard);
-            return index_nodes.at(static_cast<size_t>(std::rand()) % index_nodes.size());
+        size_t num_index_shards() const { return view_->num_index_shards_; }
+
+        const View::NodeIdVec& GetIndexNodes(size_t shard) const {
+            return index_shard_nodes_.at(shard);
+        }
+
+        size_t TagIndexShard(uint32_t user_logspace, uint64_t user_tag) const {
+            return view_->TagIndexShard(user_logspace, user_tag);
         }
 
         uint16_t PickAggregatorNode(const std::vector<uint16_t>& sharded_index_nodes) const {
+            size_t idx = __atomic_fetch_add(&next_aggregator_node_, 1, __ATOMIC_RELAXED);
             if (aggregator_nodes_.empty()) {
-                return sharded_index_nodes.at(static_cast<size_t>(std::rand()) % sharded_index_nodes.size());
+                return sharded_index_nodes.at(idx % sharded_index_nodes.size());
             }
-            size_t idx = __atomic_fetch_add(&next_aggregator_node_, 1, __ATOMIC_RELAXED);
             return aggregator_nodes_.at(idx % aggregator_nodes_.size());
         }
 
@@ -27,6 +27,8 @@ constexpr int kSendShardProgressTimerId     = kTimerTypeId + 3;
 constexpr int kMetaLogCutTimerId            = kTimerTypeId + 3;
 constexpr int kRegistrationTimerId          = kTimerTypeId + 4;
 constexpr int kGracePeriodTimerId           = kTimerTypeId + 5;
+constexpr int kExpireReadsTimerId           = kTimerTypeId + 6;
+constexpr int kHedgeReadsTimerId            = kTimerTypeId + 7;
 
 // Used by Gateway
 constexpr int kHttpConnectionTypeId         = 0x20 << 16;
@@ -12,12 +12,15 @@ EgressHub::EgressHub(int type, const struct sockaddr_in* addr, size_t num_conn)
       state_(kCreated),
       sockfds_(num_conn, -1),
       log_header_(GetLogHeader(type)),
-      send_fn_scheduled_(false) {
+      send_fn_scheduled_(false),
+      vectored_send_(absl::GetFlag(FLAGS_egress_hub_vectored_send)),
+      arena_used_(0) {
     memcpy(&addr_, addr, sizeof(struct sockaddr_in));
 }
 
 EgressHub::~EgressHub() {
     DCHECK(state_ == kCreated || state_ == kClosed);
+    DCHECK(pending_batch_ == nullptr);
 }
 
 void EgressHub::Start(IOWorker* io_worker) {
@@ -65,6 +68,14 @@ void EgressHub::SendMessage(std::span<const char> part1, std::span<const char> p
     if (part1.size() + part2.size() + part3.size() + part4.size() == 0) {
         return;
     }
+    if (vectored_send_) {
+        AppendToBatch(part1);
+        AppendToBatch(part2);
+        AppendToBatch(part3);
+        AppendToBatch(part4);
+        ScheduleSendFunction();
+        return;
+    }
     write_buffer_.AppendData(part1);
     write_buffer_.AppendData(part2);
     write_buffer_.AppendData(part3);
@@ -72,6 +83,54 @@ void EgressHub::SendMessage(std::span<const char> part1, std::span<const char> p
     ScheduleSendFunction();
 }
 
+void EgressHub::SendSharedMessage(std::shared_ptr<const std::string> message) {
+    DCHECK(io_worker_->WithinMyEventLoopThread());
+    if (state_ != kRunning) {
+        HLOG(ERROR) << "Connection is closing or has closed, will not send this message";
+        return;
+    }
+    if (message == nullptr || message->empty()) {
+        return;
+    }
+    if (vectored_send_) {
+        if (pending_batch_ == nullptr) {
+            pending_batch_ = std::make_unique<PendingSendBatch>();
+        }
+        pending_batch_->data_vec.push_back(STRING_AS_SPAN(*message));
+        pending_batch_->shared_messages.push_back(std::move(message));
+        ScheduleSendFunction();
+        return;
+    }
+    pending_shared_messages_.push_back(std::move(message));
+    ScheduleSendFunction();
+}
+
+void EgressHub::AppendToBatch(std::span<const char> data) {
+    if (pending_batch_ == nullptr) {
+        pending_batch_ = std::make_unique<PendingSendBatch>();
+    }
+    while (!data.empty()) {
+        if (arena_used_ == arena_buf_.size()) {
+            io_worker_->NewWriteBuffer(&arena_buf_);
+            arena_used_ = 0;
+            pending_batch_->write_bufs.push_back(arena_buf_);
+        }
+        size_t copy_size = std::min(data.size(), arena_buf_.size() - arena_used_);
+        char* dst = arena_buf_.data() + arena_used_;
+        memcpy(dst, data.data(), copy_size);
+        std::vector<std::span<const char>>& data_vec = pending_batch_->data_vec;
+        if (!data_vec.empty() && data_vec.back().data() + data_vec.back().size() == dst) {
+            // Contiguous with the last span, so extend it
+            data_vec.back() = std::span<const char>(data_vec.back().data(),
+                                                    data_vec.back().size() + copy_size);
+        } else {
+            data_vec.push_back(std::span<const char>(dst, copy_size));
+        }
+        arena_used_ += copy_size;
+        data = data.subspan(copy_size);
+    }
+}
+
 namespace {
 static std::span<const char> CopyToBuffer(std::span<char> buf,
                                           std::span<const char> data) {
@@ -142,7 +201,7 @@ void EgressHub::SocketReady(int sockfd) {
     DCHECK(io_worker_->WithinMyEventLoopThread());
     HLOG_F(INFO, "Socket {} is ready", sockfd);
     connections_for_pick_.Add(sockfd);
-    if (!write_buffer_.empty()) {
+    if (has_pending_messages()) {
         ScheduleSendFunction();
     }
 }
@@ -162,6 +221,7 @@ void EgressHub::RemoveSocket(int sockfd) {
         }
         if (valid_socks == 0) {
             state_ = kClosed;
+            DiscardPendingBatch();
             io_worker_->OnConnectionClose(this);
         }
     }));
@@ -169,7 +229,7 @@ void EgressHub::RemoveSocket(int sockfd) {
 
 void EgressHub::ScheduleSendFunction() {
     DCHECK(io_worker_->WithinMyEventLoopThread());
-    DCHECK(!write_buffer_.empty());
+    DCHECK(has_pending_messages());
     if (!send_fn_scheduled_) {
         io_worker_->ScheduleIdleFunction(
             this, absl::bind_front(&EgressHub::SendPendingMessages, this));
@@ -185,7 +245,7 @@ void EgressHub::SendPendingMessages() {
     }
     DCHECK(send_fn_scheduled_);
     send_fn_scheduled_ = false;
-    DCHECK(!write_buffer_.empty());
+    DCHECK(has_pending_messages());
 
     int sockfd = -1;
     if (!connections_for_pick_.PickNext(&sockfd)) {
@@ -211,6 +271,65 @@ void EgressHub::SendPendingMessages() {
         ));
         write_buffer_.ConsumeFront(copy_size);
     }
+    if (!pending_shared_messages_.empty()) {
+        SendPendingSharedMessages(sockfd);
+    }
+    if (pending_batch_ != nullptr) {
+        SendPendingBatch(sockfd);
+    }
+}
+
+void EgressHub::SendPendingBatch(int sockfd) {
+    std::shared_ptr<PendingSendBatch> batch(std::move(pending_batch_));
+    // The partially used arena buffer now belongs to this batch
+    arena_buf_ = std::span<char>();
+    arena_used_ = 0;
+    URING_DCHECK_OK(current_io_uring()->SendAll(
+        sockfd, batch->data_vec,
+        [this, batch, sockfd] (int status) {
+            for (std::span<char> buf : batch->write_bufs) {
+                io_worker_->ReturnWriteBuffer(buf);
+            }
+            if (status != 0) {
+                HPLOG(ERROR) << "Failed to send data";
+                RemoveSocket(sockfd);
+            }
+        }
+    ));
+}
+
+void EgressHub::DiscardPendingBatch() {
+    // Write buffers can only be returned within the event loop thread,
+    // so do it here rather than in the destructor
+    if (pending_batch_ == nullptr) {
+        return;
+    }
+    for (std::span<char> buf : pending_batch_->write_bufs) {
+        io_worker_->ReturnWriteBuffer(buf);
+    }
+    pending_batch_.reset();
+    arena_buf_ = std::span<char>();
+    arena_used_ = 0;
+}
+
+void EgressHub::SendPendingSharedMessages(int sockfd) {
+    // Messages stay referenced by the callback until sendmsg completes
+    auto messages = std::make_shared<std::vector<std::shared_ptr<const std::string>>>();
+    messages->swap(pending_shared_messages_);
+    std::vector<std::span<const char>> data_vec;
+    data_vec.reserve(messages->size());
+    for (const auto& message : *messages) {
+        data_vec.push_back(STRING_AS_SPAN(*message));
+    }
+    URING_DCHECK_OK(current_io_uring()->SendAll(
+        sockfd, data_vec,
+        [this, messages, sockfd] (int status) {
+            if (status != 0) {
+                HPLOG(ERROR) << "Failed to send data";
+                RemoveSocket(sockfd);
+            }
+        }
+    ));
 }
 
 std::string EgressHub::GetLogHeader(int type) {
@@ -25,6 +25,10 @@ public:
                      std::span<const char> part3 = EMPTY_CHAR_SPAN,
                      std::span<const char> part4 = EMPTY_CHAR_SPAN);
 
+    // The message is immutable and can be shared by multiple EgressHubs.
+    // It is sent with sendmsg directly from its buffer, without copying.
+    void SendSharedMessage(std::shared_ptr<const std::string> message);
+
 private:
     enum State { kCreated, kRunning, kClosing, kClosed };
 
@@ -39,13 +43,35 @@ private:
 
     std::string log_header_;
     utils::AppendableBuffer write_buffer_;
+    std::vector<std::shared_ptr<const std::string>> pending_shared_messages_;
     bool send_fn_scheduled_;
 
+    // Used in vectored mode, where messages are copied once into IOWorker
+    // write buffers, and shared messages are referenced in place. All of
+    // them are sent in order with a single sendmsg.
+    bool vectored_send_;
+    struct PendingSendBatch {
+        std::vector<std::span<const char>> data_vec;
+        std::vector<std::span<char>> write_bufs;
+        std::vector<std::shared_ptr<const std::string>> shared_messages;
+    };
+    std::unique_ptr<PendingSendBatch> pending_batch_;
+    std::span<char> arena_buf_;  // Last buffer in pending_batch_->write_bufs
+    size_t arena_used_;
+
     void OnSocketConnected(int sockfd, int status);
     void SocketReady(int sockfd);
     void RemoveSocket(int sockfd);
     void ScheduleSendFunction();
     void SendPendingMessages();
+    void SendPendingSharedMessages(int sockfd);
+    void AppendToBatch(std::span<const char> data);
+    void SendPendingBatch(int sockfd);
+    void DiscardPendingBatch();
+    bool has_pending_messages() const {
+        return !write_buffer_.empty() || !pending_shared_messages_.empty()
+            || pending_batch_ != nullptr;
+    }
 
     static std::string GetLogHeader(int type);
 
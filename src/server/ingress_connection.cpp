@@ -25,7 +25,9 @@ void IngressConnection::Start(IOWorker* io_worker) {
     DCHECK(state_ == kCreated);
     DCHECK(io_worker->WithinMyEventLoopThread());
     io_worker_ = io_worker;
-    current_io_uring()->PrepareBuffers(buf_group_, buf_size_);
+    if (!current_io_uring()->PrepareBufferRing(buf_group_, buf_size_)) {
+        current_io_uring()->PrepareBuffers(buf_group_, buf_size_);
+    }
     if (absl::GetFlag(FLAGS_tcp_enable_nodelay)) {
         CHECK(utils::SetTcpSocketNoDelay(sockfd_));
     }
@@ -62,18 +64,52 @@ void IngressConnection::SetNewMessageCallback(NewMessageCallback cb) {
     new_message_cb_ = cb;
 }
 
-void IngressConnection::ProcessMessages() {
+std::span<const char> IngressConnection::CompletePendingMessage(std::span<const char> data) {
+    DCHECK_GT(read_buffer_.length(), 0U);
+    if (read_buffer_.length() < msghdr_size_) {
+        size_t copy_size = std::min(msghdr_size_ - read_buffer_.length(), data.size());
+        read_buffer_.AppendData(data.first(copy_size));
+        data = data.subspan(copy_size);
+        if (read_buffer_.length() < msghdr_size_) {
+            return data;
+        }
+    }
+    std::span<const char> header(read_buffer_.data(), msghdr_size_);
+    size_t full_size = message_full_size_cb_(header);
+    DCHECK_GE(full_size, msghdr_size_);
+    DCHECK_LE(read_buffer_.length(), full_size);
+    size_t copy_size = std::min(full_size - read_buffer_.length(), data.size());
+    read_buffer_.AppendData(data.first(copy_size));
+    data = data.subspan(copy_size);
+    if (read_buffer_.length() == full_size) {
+        new_message_cb_(read_buffer_.to_span());
+        read_buffer_.Reset();
+    }
+    return data;
+}
+
+void IngressConnection::ProcessMessages(std::span<const char> data) {
     DCHECK(io_worker_->WithinMyEventLoopThread());
-    while (read_buffer_.length() >= msghdr_size_) {
-        std::span<const char> header(read_buffer_.data(), msghdr_size_);
-        size_t full_size = message_full_size_cb_(header);
+    if (read_buffer_.length() > 0) {
+        data = CompletePendingMessage(data);
+        if (read_buffer_.length() > 0) {
+            DCHECK(data.empty());
+            return;
+        }
+    }
+    // Dispatch complete messages directly from the receive buffer, and only
+    // copy the trailing partial message
+    while (data.size() >= msghdr_size_) {
+        size_t full_size = message_full_size_cb_(data.first(msghdr_size_));
         DCHECK_GE(full_size, msghdr_size_);
-        if (read_buffer_.length() >= full_size) {
-            new_message_cb_(std::span<const char>(read_buffer_.data(), full_size));
-            read_buffer_.ConsumeFront(full_size);
-        } else {
+        if (data.size() < full_size) {
             break;
         }
+        new_message_cb_(data.first(full_size));
+        data = data.subspan(full_size);
+    }
+    if (!data.empty()) {
+        read_buffer_.AppendData(data);
     }
 }
 
@@ -88,8 +124,7 @@ bool IngressConnection::OnRecvData(int status, std::span<const char> data) {
         ScheduleClose();
         return false;
     } else {
-        read_buffer_.AppendData(data);
-        ProcessMessages();
+        ProcessMessages(data);
         return true;
     }
 }
@@ -56,7 +56,8 @@ private:
     std::string log_header_;
     utils::AppendableBuffer read_buffer_;
 
-    void ProcessMessages();
+    void ProcessMessages(std::span<const char> data);
+    std::span<const char> CompletePendingMessage(std::span<const char> data);
     bool OnRecvData(int status, std::span<const char> data);
 
     static std::string GetLogHeader(int type, int sockfd);
@@ -7,8 +7,15 @@ ABSL_FLAG(size_t, io_uring_entries, 2048, "");
 ABSL_FLAG(size_t, io_uring_fd_slots, 1024, "");
 ABSL_FLAG(bool, io_uring_sqpoll, false, "");
 ABSL_FLAG(uint32_t, io_uring_sq_thread_idle_ms, 1, "");
+ABSL_FLAG(int, io_uring_sqpoll_cpu, -1, "Pin the SQPOLL kernel thread to this CPU");
+ABSL_FLAG(bool, io_uring_link_sends, false,
+          "Submit SendAll ops on the same socket as IOSQE_IO_LINK chains");
 ABSL_FLAG(uint32_t, io_uring_cq_nr_wait, 1, "");
 ABSL_FLAG(uint32_t, io_uring_cq_wait_timeout_us, 0, "");
+ABSL_FLAG(bool, io_uring_enable_buf_ring, false,
+          "Use kernel-provided buffer rings and multishot recv for ingress connections");
+ABSL_FLAG(uint32_t, io_uring_buf_ring_entries, 256,
+          "Number of buffers in each buffer ring, must be a power of 2");
 
 #define ERRNO_LOGSTR(errno) fmt::format("{} [{}]", strerror(errno), errno)
 
@@ -19,6 +26,8 @@ std::atomic<int> IOUring::next_uring_id_{0};
 
 IOUring::IOUring()
     : uring_id_(next_uring_id_.fetch_add(1, std::memory_order_relaxed)),
+      sqpoll_(absl::GetFlag(FLAGS_io_uring_sqpoll)),
+      link_sends_(absl::GetFlag(FLAGS_io_uring_link_sends)),
       log_header_(fmt::format("io_uring[{}]: ", uring_id_)),
       next_op_id_(1),
       ev_loop_counter_(stat::Counter::VerboseLogReportCallback<2>(
@@ -27,6 +36,8 @@ IOUring::IOUring()
           fmt::format("io_uring[{}] wait_timeout", uring_id_))),
       completed_ops_counter_(stat::Counter::VerboseLogReportCallback<2>(
           fmt::format("io_uring[{}] completed_ops", uring_id_))),
+      io_uring_enter_counter_(stat::Counter::VerboseLogReportCallback<2>(
+          fmt::format("io_uring[{}] io_uring_enter", uring_id_))),
       io_uring_enter_time_stat_(stat::StatisticsCollector<int>::VerboseLogReportCallback<2>(
           fmt::format("io_uring[{}] io_uring_enter_time", uring_id_))),
       completed_ops_stat_(stat::StatisticsCollector<int>::VerboseLogReportCallback<2>(
@@ -34,13 +45,22 @@ IOUring::IOUring()
       ev_loop_time_stat_(stat::StatisticsCollector<int>::VerboseLogReportCallback<2>(
           fmt::format("io_uring[{}] ev_loop_time", uring_id_))),
       average_op_time_stat_(stat::StatisticsCollector<int>::VerboseLogReportCallback<2>(
-          fmt::format("io_uring[{}] average_op_time", uring_id_))) {
+          fmt::format("io_uring[{}] average_op_time", uring_id_))),
+      syscalls_per_kop_stat_(stat::StatisticsCollector<int>::VerboseLogReportCallback<2>(
+          fmt::format("io_uring[{}] syscalls_per_1k_ops", uring_id_))),
+      num_enter_syscalls_(0) {
     struct io_uring_params params;
     memset(&params, 0, sizeof(params));
-    if (absl::GetFlag(FLAGS_io_uring_sqpoll)) {
+    if (sqpoll_) {
         LOG(INFO) << "Enable IORING_SETUP_SQPOLL";
         params.flags |= IORING_SETUP_SQPOLL;
         params.sq_thread_idle = absl::GetFlag(FLAGS_io_uring_sq_thread_idle_ms);
+        int sqpoll_cpu = absl::GetFlag(FLAGS_io_uring_sqpoll_cpu);
+        if (sqpoll_cpu >= 0) {
+            LOG(INFO) << "Pin SQPOLL thread to CPU " << sqpoll_cpu;
+            params.flags |= IORING_SETUP_SQ_AFF;
+            params.sq_thread_cpu = gsl::narrow_cast<uint32_t>(sqpoll_cpu);
+        }
     }
     int ret = io_uring_queue_init_params(
         gsl::narrow_cast<uint32_t>(absl::GetFlag(FLAGS_io_uring_entries)),
@@ -80,6 +100,9 @@ IOUring::IOUring()
 
 IOUring::~IOUring() {
     CHECK(ops_.empty()) << "There are still inflight Ops";
+    for (const auto& [gid, buf_ring] : buf_rings_) {
+        io_uring_free_buf_ring(&ring_, buf_ring->ring, buf_ring->num_bufs, gid);
+    }
     io_uring_queue_exit(&ring_);
 }
 
@@ -104,6 +127,42 @@ void IOUring::PrepareBuffers(uint16_t gid, size_t buf_size) {
         fmt::format("IOUring[{}]-{}", uring_id_, gid), buf_size);
 }
 
+bool IOUring::PrepareBufferRing(uint16_t gid, size_t buf_size) {
+    if (!absl::GetFlag(FLAGS_io_uring_enable_buf_ring)) {
+        return false;
+    }
+    if (buf_rings_.contains(gid)) {
+        DCHECK_EQ(buf_rings_.at(gid)->buf_size, buf_size);
+        return true;
+    }
+    uint32_t num_bufs = absl::GetFlag(FLAGS_io_uring_buf_ring_entries);
+    CHECK(num_bufs > 0 && (num_bufs & (num_bufs - 1)) == 0)
+        << "io_uring_buf_ring_entries should be a power of 2";
+    int ret = 0;
+    struct io_uring_buf_ring* ring = io_uring_setup_buf_ring(&ring_, num_bufs, gid, 0, &ret);
+    if (ring == nullptr) {
+        HLOG_F(WARNING, "Failed to setup buffer ring for group {}: {}",
+               gid, ERRNO_LOGSTR(-ret));
+        return false;
+    }
+    auto buf_ring = std::make_unique<BufferRing>();
+    buf_ring->ring = ring;
+    buf_ring->buffers.reset(new char[buf_size * num_bufs]);
+    buf_ring->buf_size = buf_size;
+    buf_ring->num_bufs = num_bufs;
+    int mask = io_uring_buf_ring_mask(num_bufs);
+    for (uint32_t i = 0; i < num_bufs; i++) {
+        io_uring_buf_ring_add(ring, buf_ring->buffers.get() + buf_size * i,
+                              gsl::narrow_cast<uint32_t>(buf_size),
+                              gsl::narrow_cast<uint16_t>(i), mask, static_cast<int>(i));
+    }
+    io_uring_buf_ring_advance(ring, static_cast<int>(num_bufs));
+    HLOG_F(INFO, "Setup buffer ring for group {}: {} buffers of size {}",
+           gid, num_bufs, buf_size);
+    buf_rings_[gid] = std::move(buf_ring);
+    return true;
+}
+
 bool IOUring::RegisterFd(int fd) {
     if (fd_indices_.contains(fd)) {
         HLOG_F(ERROR, "fd {} already registered", fd);
@@ -128,6 +187,8 @@ bool IOUring::RegisterFd(int fd) {
     desc->active_read_op = nullptr;
     desc->last_send_op = nullptr;
     desc->close_op = nullptr;
+    desc->pending_sends.clear();
+    desc->inflight_sends = 0;
     return true;
 }
 
@@ -157,6 +218,12 @@ bool IOUring::StartReadInternal(int fd, uint16_t buf_gid, uint16_t flags, ReadCa
         HLOG_F(ERROR, "fd {} already registered read callback", fd);
         return false;
     }
+    if ((flags & kOpFlagUseRecv) != 0 && buf_rings_.contains(buf_gid)) {
+        Op* op = AllocReadOp(desc, buf_gid, std::span<char>(), flags | kOpFlagMultishot);
+        read_cbs_[op->id] = cb;
+        EnqueueOp(op);
+        return true;
+    }
     if (!buf_pools_.contains(buf_gid)) {
         HLOG_F(ERROR, "Invalid buf_gid {}", buf_gid);
         return false;
@@ -192,11 +259,16 @@ bool IOUring::StopReadOrRecv(int fd) {
 }
 
 bool IOUring::Write(int fd, std::span<const char> data, WriteCallback cb) {
+    return WriteAt(fd, data, /* offset= */ 0, cb);
+}
+
+bool IOUring::WriteAt(int fd, std::span<const char> data, uint64_t offset, WriteCallback cb) {
     if (data.size() == 0) {
         return false;
     }
     GET_AND_CHECK_DESC(fd, desc);
     Op* op = AllocWriteOp(desc, data);
+    op->offset = offset;
     write_cbs_[op->id] = cb;
     EnqueueOp(op);
     return true;
@@ -209,56 +281,94 @@ bool IOUring::SendAll(int fd, std::span<const char> data, SendAllCallback cb) {
     GET_AND_CHECK_DESC(fd, desc);
     Op* op = AllocSendAllOp(desc, data);
     sendall_cbs_[op->id] = cb;
-    if (desc->last_send_op != nullptr) {
-        Op* last_op = desc->last_send_op;
-        DCHECK_EQ(op_type(last_op), kSendAll);
-        DCHECK_EQ(last_op->next_op, kInvalidOpId);
-        last_op->next_op = op->id;
-    } else {
-        EnqueueOp(op);
-    }
-    desc->last_send_op = op;
+    QueueSendOp(desc, op);
     return true;
 }
 
 bool IOUring::SendAll(int fd, const std::vector<std::span<const char>>& data_vec,
                       SendAllCallback cb) {
     GET_AND_CHECK_DESC(fd, desc);
-    Op* first_op = nullptr;
-    Op* last_op = desc->last_send_op;
+    auto ctx = std::make_unique<SendMsgContext>();
+    ctx->iovecs.reserve(data_vec.size());
     for (std::span<const char> data : data_vec) {
         if (data.size() > 0) {
-            Op* op = AllocSendAllOp(desc, data);
-            if (first_op == nullptr) {
-                first_op = op;
-            }
-            if (last_op != nullptr) {
-                DCHECK_EQ(op_type(last_op), kSendAll);
-                DCHECK_EQ(last_op->next_op, kInvalidOpId);
-                last_op->next_op = op->id;
-            }
-            last_op = op;
+            ctx->iovecs.push_back(iovec {
+                .iov_base = const_cast<char*>(data.data()),
+                .iov_len  = data.size()
+            });
         }
     }
-    if (first_op == nullptr) {
+    if (ctx->iovecs.empty()) {
         return false;
     }
-    DCHECK(last_op != desc->last_send_op);
-    Op* op = first_op;
-    while (op != last_op) {
-        op->root_op = last_op->id;
-        DCHECK_NE(op->next_op, kInvalidOpId);
-        DCHECK(ops_.contains(op->next_op));
-        op = ops_[op->next_op];
-    }
-    sendall_cbs_[first_op->id] = cb;
-    if (desc->last_send_op == nullptr) {
-        EnqueueOp(first_op);
+    ctx->iov_offset = 0;
+    if (link_sends_) {
+        // Linked sends cannot be resubmitted after partial writes, so split
+        // iovecs into sendmsg ops of at most IOV_MAX entries. Only the last
+        // op invokes the callback.
+        constexpr size_t kMaxIovecs = IOV_MAX;
+        while (ctx->iovecs.size() > kMaxIovecs) {
+            auto chunk = std::make_unique<SendMsgContext>();
+            chunk->iovecs.assign(ctx->iovecs.begin(), ctx->iovecs.begin() + kMaxIovecs);
+            chunk->iov_offset = 0;
+            ctx->iovecs.erase(ctx->iovecs.begin(), ctx->iovecs.begin() + kMaxIovecs);
+            QueueSendOp(desc, AllocSendMsgOp(desc, std::move(chunk)));
+        }
     }
-    desc->last_send_op = last_op;
+    Op* op = AllocSendMsgOp(desc, std::move(ctx));
+    sendall_cbs_[op->id] = cb;
+    QueueSendOp(desc, op);
     return true;
 }
 
+void IOUring::QueueSendOp(Descriptor* desc, Op* op) {
+    if (link_sends_) {
+        op->flags |= kOpFlagLinked;
+        if (desc->pending_sends.empty()) {
+            descs_with_pending_sends_.push_back(desc);
+        }
+        desc->pending_sends.push_back(op);
+        return;
+    }
+    if (desc->last_send_op != nullptr) {
+        Op* last_op = desc->last_send_op;
+        DCHECK(op_type(last_op) == kSendAll || op_type(last_op) == kSendMsg);
+        DCHECK_EQ(last_op->next_op, kInvalidOpId);
+        last_op->next_op = op->id;
+    } else {
+        EnqueueOp(op);
+    }
+    desc->last_send_op = op;
+}
+
+void IOUring::FlushPendingSends() {
+    size_t num_remaining = 0;
+    for (Descriptor* desc : descs_with_pending_sends_) {
+        // A new chain is started only after the previous one on this fd
+        // finishes, otherwise sends from two chains may interleave
+        if (desc->inflight_sends == 0) {
+            size_t num_ops = desc->pending_sends.size();
+            if (io_uring_sq_space_left(&ring_) < num_ops) {
+                SubmitSqes();
+            }
+            num_ops = std::min<size_t>(num_ops, io_uring_sq_space_left(&ring_));
+            for (size_t i = 0; i < num_ops; i++) {
+                struct io_uring_sqe* sqe = EnqueueOp(desc->pending_sends[i]);
+                if (i + 1 < num_ops) {
+                    sqe->flags |= IOSQE_IO_LINK;
+                }
+            }
+            desc->inflight_sends = num_ops;
+            desc->pending_sends.erase(desc->pending_sends.begin(),
+                                      desc->pending_sends.begin() + num_ops);
+        }
+        if (!desc->pending_sends.empty()) {
+            descs_with_pending_sends_[num_remaining++] = desc;
+        }
+    }
+    descs_with_pending_sends_.resize(num_remaining);
+}
+
 bool IOUring::Close(int fd, CloseCallback cb) {
     GET_AND_CHECK_DESC(fd, desc);
     if (desc->active_read_op != nullptr) {
@@ -276,10 +386,38 @@ bool IOUring::Close(int fd, CloseCallback cb) {
 
 #undef GET_AND_CHECK_DESC
 
+bool IOUring::SubmitNeedsEnter() {
+    if (io_uring_sq_ready(&ring_) == 0) {
+        return false;
+    }
+    if (!sqpoll_) {
+        return true;
+    }
+    return (IO_URING_READ_ONCE(*ring_.sq.kflags) & IORING_SQ_NEED_WAKEUP) != 0;
+}
+
+void IOUring::SubmitSqes() {
+    if (SubmitNeedsEnter()) {
+        num_enter_syscalls_++;
+        io_uring_enter_counter_.Tick();
+    }
+    int ret = io_uring_submit(&ring_);
+    if (ret < 0) {
+        LOG(FATAL) << "io_uring_submit failed: " << ERRNO_LOGSTR(-ret);
+    }
+}
+
 void IOUring::EventLoopRunOnce(size_t* inflight_ops) {
     struct io_uring_cqe* cqe = nullptr;
     uint32_t nr_wait = absl::GetFlag(FLAGS_io_uring_cq_nr_wait);
-    if (absl::GetFlag(FLAGS_io_uring_cq_wait_timeout_us) == 0) {
+    FlushPendingSends();
+    if (io_uring_cq_ready(&ring_) > 0) {
+        // Completions are already available, so skip waiting. With SQPOLL,
+        // this usually avoids io_uring_enter entirely.
+        SubmitSqes();
+    } else if (absl::GetFlag(FLAGS_io_uring_cq_wait_timeout_us) == 0) {
+        num_enter_syscalls_++;
+        io_uring_enter_counter_.Tick();
         int64_t start_timestamp = GetMonotonicNanoTimestamp();
         int ret = io_uring_submit_and_wait(&ring_, nr_wait);
         int64_t elasped_time = GetMonotonicNanoTimestamp() - start_timestamp;
@@ -288,14 +426,17 @@ void IOUring::EventLoopRunOnce(size_t* inflight_ops) {
         }
         io_uring_enter_time_stat_.AddSample(gsl::narrow_cast<int>(elasped_time));
     } else {
+        num_enter_syscalls_++;
+        io_uring_enter_counter_.Tick();
         int64_t start_timestamp = GetMonotonicNanoTimestamp();
-        int ret = io_uring_wait_cqes(&ring_, &cqe, nr_wait, &cqe_wait_timeout_, nullptr);
+        int ret = io_uring_submit_and_wait_timeout(
+            &ring_, &cqe, nr_wait, &cqe_wait_timeout_, nullptr);
         int64_t elasped_time = GetMonotonicNanoTimestamp() - start_timestamp;
         if (ret < 0) {
             if (ret == -ETIME) {
                 wait_timeout_counter_.Tick();
             } else {
-                LOG(FATAL) << "io_uring_wait_cqes failed: " << ERRNO_LOGSTR(-ret);
+                LOG(FATAL) << "io_uring_submit_and_wait_timeout failed: " << ERRNO_LOGSTR(-ret);
             }
         }
         io_uring_enter_time_stat_.AddSample(gsl::narrow_cast<int>(elasped_time));
@@ -318,9 +459,14 @@ void IOUring::EventLoopRunOnce(size_t* inflight_ops) {
         uint64_t op_id = DCHECK_NOTNULL(cqe)->user_data;
         DCHECK(ops_.contains(op_id));
         Op* op = ops_[op_id];
-        ops_.erase(op_id);
+        bool more = (cqe->flags & IORING_CQE_F_MORE) != 0;
+        if (!more) {
+            ops_.erase(op_id);
+        }
         OnOpComplete(op, cqe);
-        op_pool_.Return(op);
+        if (!more) {
+            op_pool_.Return(op);
+        }
         io_uring_cqe_seen(&ring_, cqe);
         count++;
     }
@@ -330,6 +476,9 @@ void IOUring::EventLoopRunOnce(size_t* inflight_ops) {
         average_op_time_stat_.AddSample(gsl::narrow_cast<int>(elasped_time / count));
         completed_ops_counter_.Tick(count);
         completed_ops_stat_.AddSample(gsl::narrow_cast<int>(count));
+        syscalls_per_kop_stat_.AddSample(
+            gsl::narrow_cast<int>(num_enter_syscalls_ * 1000 / static_cast<size_t>(count)));
+        num_enter_syscalls_ = 0;
     }
     if (VLOG_IS_ON(2)) {
         VLOG(2) << "Inflight ops:";
@@ -352,6 +501,7 @@ void IOUring::EventLoopRunOnce(size_t* inflight_ops) {
     OP_VAR->flags = 0;                \
     OP_VAR->buf = nullptr;            \
     OP_VAR->buf_len = 0;              \
+    OP_VAR->offset = 0;               \
     OP_VAR->root_op = kInvalidOpId;   \
     OP_VAR->next_op = kInvalidOpId;   \
     ops_[op->id] = op
@@ -396,6 +546,19 @@ IOUring::Op* IOUring::AllocSendAllOp(Descriptor* desc, std::span<const char> dat
     return op;
 }
 
+IOUring::Op* IOUring::AllocSendMsgOp(Descriptor* desc, std::unique_ptr<SendMsgContext> ctx) {
+    ALLOC_OP(kSendMsg, op);
+    op->desc = desc;
+    DCHECK_LT(ctx->iov_offset, ctx->iovecs.size());
+    memset(&ctx->msg, 0, sizeof(ctx->msg));
+    ctx->msg.msg_iov = ctx->iovecs.data() + ctx->iov_offset;
+    ctx->msg.msg_iovlen = std::min<size_t>(ctx->iovecs.size() - ctx->iov_offset, IOV_MAX);
+    op->sendmsg_ctx = ctx.get();
+    sendmsg_ctxs_[op->id] = std::move(ctx);
+    desc->op_count++;
+    return op;
+}
+
 IOUring::Op* IOUring::AllocCloseOp(int fd) {
     ALLOC_OP(kClose, op);
     op->fd = fd;
@@ -433,10 +596,15 @@ void IOUring::UnregisterFd(Descriptor* desc) {
 #pragma clang diagnostic ignored "-Wshorten-64-to-32"
 #endif
 
-void IOUring::EnqueueOp(Op* op) {
+struct io_uring_sqe* IOUring::EnqueueOp(Op* op) {
     VLOG_F(2, "EnqueueOp: id={}, type={}, fd={}",
            (op->id >> 8), kOpTypeStr[op_type(op)], op_fd(op));
     struct io_uring_sqe* sqe = io_uring_get_sqe(&ring_);
+    while (sqe == nullptr) {
+        // SQ ring is full, submit to make room
+        SubmitSqes();
+        sqe = io_uring_get_sqe(&ring_);
+    }
     switch (op_type(op)) {
     case kConnect:
         io_uring_prep_connect(sqe, op_fd_idx(op), op->addr, op->addrlen);
@@ -444,6 +612,12 @@ void IOUring::EnqueueOp(Op* op) {
         break;
     case kRead:
         DCHECK_NOTNULL(op->desc)->active_read_op = op;
+        if (op->flags & kOpFlagMultishot) {
+            io_uring_prep_recv_multishot(sqe, op_fd_idx(op), nullptr, 0, 0);
+            sqe->buf_group = op->buf_gid;
+            io_uring_sqe_set_flags(sqe, IOSQE_FIXED_FILE | IOSQE_BUFFER_SELECT);
+            break;
+        }
         if (op->flags & kOpFlagUseRecv) {
             io_uring_prep_recv(sqe, op_fd_idx(op), op->buf, op->buf_len, 0);
         } else {
@@ -452,11 +626,19 @@ void IOUring::EnqueueOp(Op* op) {
         io_uring_sqe_set_flags(sqe, IOSQE_FIXED_FILE | IOSQE_ASYNC);
         break;
     case kWrite:
-        io_uring_prep_write(sqe, op_fd_idx(op), op->data, op->data_len, 0);
+        io_uring_prep_write(sqe, op_fd_idx(op), op->data, op->data_len, op->offset);
         io_uring_sqe_set_flags(sqe, IOSQE_FIXED_FILE);
         break;
     case kSendAll:
-        io_uring_prep_send(sqe, op_fd_idx(op), op->data, op->data_len, 0);
+        // For linked sends, MSG_WAITALL makes the kernel retry partial writes,
+        // and a short send fails the rest of the chain
+        io_uring_prep_send(sqe, op_fd_idx(op), op->data, op->data_len,
+                           (op->flags & kOpFlagLinked) ? MSG_WAITALL : 0);
+        io_uring_sqe_set_flags(sqe, IOSQE_FIXED_FILE);
+        break;
+    case kSendMsg:
+        io_uring_prep_sendmsg(sqe, op_fd_idx(op), &op->sendmsg_ctx->msg,
+                              (op->flags & kOpFlagLinked) ? MSG_WAITALL : 0);
         io_uring_sqe_set_flags(sqe, IOSQE_FIXED_FILE);
         break;
     case kClose:
@@ -471,6 +653,7 @@ void IOUring::EnqueueOp(Op* op) {
         UNREACHABLE();
     }
     io_uring_sqe_set_data(sqe, reinterpret_cast<void*>(op->id));
+    return sqe;
 }
 
 #ifdef __CLANG_CONVERSION_DIAGNOSTIC_ENABLED
@@ -487,13 +670,28 @@ void IOUring::OnOpComplete(Op* op, struct io_uring_cqe* cqe) {
         HandleConnectComplete(op, res);
         break;
     case kRead:
-        HandleReadOpComplete(op, res, &next_op);
+        if (op->flags & kOpFlagMultishot) {
+            HandleMultishotRecvComplete(op, cqe, &next_op);
+        } else {
+            HandleReadOpComplete(op, res, &next_op);
+        }
         break;
     case kWrite:
         HandleWriteOpComplete(op, res);
         break;
     case kSendAll:
-        HandleSendallOpComplete(op, res, &next_op);
+        if (op->flags & kOpFlagLinked) {
+            HandleLinkedSendComplete(op, res);
+        } else {
+            HandleSendallOpComplete(op, res, &next_op);
+        }
+        break;
+    case kSendMsg:
+        if (op->flags & kOpFlagLinked) {
+            HandleLinkedSendComplete(op, res);
+        } else {
+            HandleSendMsgOpComplete(op, res, &next_op);
+        }
         break;
     case kClose:
         HandleCloseOpComplete(op, res);
@@ -515,6 +713,10 @@ void IOUring::OnOpComplete(Op* op, struct io_uring_cqe* cqe) {
     if (next_op != nullptr) {
         EnqueueOp(next_op);
     }
+    if (cqe->flags & IORING_CQE_F_MORE) {
+        // Multishot op stays active
+        return;
+    }
     if (op->desc != nullptr) {
         op->desc->op_count--;
         if (op->desc->op_count == 0 && op->desc->close_op != nullptr) {
@@ -568,6 +770,70 @@ void IOUring::HandleReadOpComplete(Op* op, int res, Op** next_op) {
     }
 }
 
+void IOUring::HandleMultishotRecvComplete(Op* op, struct io_uring_cqe* cqe, Op** next_op) {
+    DCHECK_EQ(op_type(op), kRead);
+    DCHECK(read_cbs_.contains(op->id));
+    DCHECK(buf_rings_.contains(op->buf_gid));
+    BufferRing* buf_ring = buf_rings_[op->buf_gid].get();
+    int res = cqe->res;
+    bool more = (cqe->flags & IORING_CQE_F_MORE) != 0;
+    bool repeat = false;
+    if (res >= 0) {
+        if (cqe->flags & IORING_CQE_F_BUFFER) {
+            uint16_t bid = gsl::narrow_cast<uint16_t>(cqe->flags >> IORING_CQE_BUFFER_SHIFT);
+            DCHECK_LT(bid, buf_ring->num_bufs);
+            if ((op->flags & kOpFlagCancelled) == 0) {
+                std::span<const char> data(buf_ring->buffers.get() + buf_ring->buf_size * bid,
+                                           static_cast<size_t>(res));
+                repeat = read_cbs_[op->id](0, data);
+            }
+            RecycleRingBuffer(buf_ring, bid);
+        } else {
+            DCHECK_EQ(res, 0);
+            repeat = read_cbs_[op->id](0, EMPTY_CHAR_SPAN);
+        }
+    } else if (res == -ENOBUFS || res == -EAGAIN || res == -EINTR) {
+        // Buffer ring ran out of buffers, re-arm once this shot terminates
+        repeat = true;
+    } else if (res == -ECANCELED) {
+        LOG(INFO) << "Multishot RecvOp cancelled";
+    } else {
+        errno = -res;
+        repeat = read_cbs_[op->id](-1, EMPTY_CHAR_SPAN);
+    }
+    if (more) {
+        if (!repeat && (op->flags & kOpFlagCancelled) == 0) {
+            op->flags |= kOpFlagCancelled;
+            EnqueueOp(AllocCancelOp(op->id));
+            if (op->desc->active_read_op == op) {
+                op->desc->active_read_op = nullptr;
+            }
+        }
+        return;
+    }
+    if (op->desc->active_read_op == op) {
+        op->desc->active_read_op = nullptr;
+    }
+    if ((op->flags & kOpFlagRepeat) != 0
+            && (op->flags & kOpFlagCancelled) == 0
+            && op->desc->close_op == nullptr
+            && repeat) {
+        Op* new_op = AllocReadOp(op->desc, op->buf_gid, std::span<char>(), op->flags);
+        read_cbs_[new_op->id].swap(read_cbs_[op->id]);
+        read_cbs_.erase(op->id);
+        *next_op = new_op;
+    } else {
+        read_cbs_.erase(op->id);
+    }
+}
+
+void IOUring::RecycleRingBuffer(BufferRing* buf_ring, uint16_t bid) {
+    io_uring_buf_ring_add(buf_ring->ring, buf_ring->buffers.get() + buf_ring->buf_size * bid,
+                          gsl::narrow_cast<uint32_t>(buf_ring->buf_size), bid,
+                          io_uring_buf_ring_mask(buf_ring->num_bufs), 0);
+    io_uring_buf_ring_advance(buf_ring->ring, 1);
+}
+
 void IOUring::HandleWriteOpComplete(Op* op, int res) {
     DCHECK_EQ(op_type(op), kWrite);
     DCHECK(write_cbs_.contains(op->id));
@@ -646,6 +912,91 @@ void IOUring::HandleSendallOpComplete(Op* op, int res, Op** next_op) {
     }
 }
 
+void IOUring::HandleSendMsgOpComplete(Op* op, int res, Op** next_op) {
+    DCHECK_EQ(op_type(op), kSendMsg);
+    DCHECK(sendall_cbs_.contains(op->id));
+    DCHECK(sendmsg_ctxs_.contains(op->id));
+    DCHECK(op->desc != nullptr);
+    SendAllCallback cb;
+    cb.swap(sendall_cbs_[op->id]);
+    sendall_cbs_.erase(op->id);
+    std::unique_ptr<SendMsgContext> ctx = std::move(sendmsg_ctxs_[op->id]);
+    sendmsg_ctxs_.erase(op->id);
+    if (res >= 0) {
+        size_t nwrite = gsl::narrow_cast<size_t>(res);
+        while (nwrite > 0) {
+            DCHECK_LT(ctx->iov_offset, ctx->iovecs.size());
+            struct iovec* iov = &ctx->iovecs[ctx->iov_offset];
+            if (nwrite >= iov->iov_len) {
+                nwrite -= iov->iov_len;
+                ctx->iov_offset++;
+            } else {
+                iov->iov_base = reinterpret_cast<char*>(iov->iov_base) + nwrite;
+                iov->iov_len -= nwrite;
+                nwrite = 0;
+            }
+        }
+        if (ctx->iov_offset == ctx->iovecs.size()) {
+            cb(0);
+            if (op->desc->last_send_op == op) {
+                DCHECK_EQ(op->next_op, kInvalidOpId);
+                op->desc->last_send_op = nullptr;
+            }
+        } else {
+            Op* new_op = AllocSendMsgOp(op->desc, std::move(ctx));
+            new_op->next_op = op->next_op;
+            sendall_cbs_[new_op->id].swap(cb);
+            if (op->desc->last_send_op == op) {
+                DCHECK_EQ(op->next_op, kInvalidOpId);
+                op->desc->last_send_op = new_op;
+            }
+            *next_op = new_op;
+        }
+    } else {
+        errno = -res;
+        cb(-1);
+        if (op->desc->last_send_op == op) {
+            DCHECK_EQ(op->next_op, kInvalidOpId);
+            op->desc->last_send_op = nullptr;
+        }
+    }
+}
+
+void IOUring::HandleLinkedSendComplete(Op* op, int res) {
+    DCHECK(op->flags & kOpFlagLinked);
+    DCHECK(op->desc != nullptr);
+    DCHECK_GT(op->desc->inflight_sends, 0U);
+    op->desc->inflight_sends--;
+    size_t expected_size = 0;
+    if (op_type(op) == kSendMsg) {
+        DCHECK(sendmsg_ctxs_.contains(op->id));
+        const struct msghdr& msg = sendmsg_ctxs_[op->id]->msg;
+        for (size_t i = 0; i < msg.msg_iovlen; i++) {
+            expected_size += msg.msg_iov[i].iov_len;
+        }
+        sendmsg_ctxs_.erase(op->id);
+    } else {
+        expected_size = op->data_len;
+    }
+    if (res >= 0 && static_cast<size_t>(res) != expected_size) {
+        HLOG_F(ERROR, "Short send on fd {}: {} of {} bytes", op->desc->fd, res, expected_size);
+        res = -EIO;
+    }
+    if (!sendall_cbs_.contains(op->id)) {
+        // Non-final chunk of a vectored send
+        return;
+    }
+    SendAllCallback cb;
+    cb.swap(sendall_cbs_[op->id]);
+    sendall_cbs_.erase(op->id);
+    if (res >= 0) {
+        cb(0);
+    } else {
+        errno = -res;
+        cb(-1);
+    }
+}
+
 void IOUring::HandleCloseOpComplete(Op* op, int res) {
     DCHECK_EQ(op_type(op), kClose);
     if (res < 0) {
@@ -18,6 +18,11 @@ public:
     ~IOUring();
 
     void PrepareBuffers(uint16_t gid, size_t buf_size);
+    // Register a kernel-provided buffer ring for the group. StartRecv on this
+    // group then uses multishot recv, where the kernel picks buffers from the
+    // ring. Returns false if disabled by flags or not supported, in which
+    // case the caller should use PrepareBuffers instead.
+    bool PrepareBufferRing(uint16_t gid, size_t buf_size);
     bool RegisterFd(int fd);
 
     using ConnectCallback = std::function<void(int /* status */)>;
@@ -31,11 +36,15 @@ public:
     // Partial write may happen. The caller is responsible for handling partial writes.
     using WriteCallback = std::function<void(int /* status */, size_t /* nwrite */)>;
     bool Write(int fd, std::span<const char> data, WriteCallback cb);
+    // Same as Write, but writes at the given offset of a regular file
+    bool WriteAt(int fd, std::span<const char> data, uint64_t offset, WriteCallback cb);
 
     // Only works for sockets. Partial write will not happen.
     // IOUring implementation will correctly order all SendAll writes.
     using SendAllCallback = std::function<void(int /* status */)>;
     bool SendAll(int sockfd, std::span<const char> data, SendAllCallback cb);
+    // Gathers all spans with sendmsg, without copying them. The caller must
+    // keep the data alive until cb is invoked.
     bool SendAll(int sockfd, const std::vector<std::span<const char>>& data_vec,
                  SendAllCallback cb);
 
@@ -49,11 +58,23 @@ private:
     static std::atomic<int> next_uring_id_;
     struct io_uring ring_;
     struct __kernel_timespec cqe_wait_timeout_;
+    bool sqpoll_;
+    // If enabled, SendAll ops issued on the same fd within one event loop
+    // iteration are submitted together as an IOSQE_IO_LINK chain
+    bool link_sends_;
 
     std::string log_header_;
 
     absl::flat_hash_map</* gid */ uint16_t, std::unique_ptr<utils::BufferPool>> buf_pools_;
 
+    struct BufferRing {
+        struct io_uring_buf_ring* ring;
+        std::unique_ptr<char[]>   buffers;
+        size_t                    buf_size;
+        uint32_t                  num_bufs;
+    };
+    absl::flat_hash_map</* gid */ uint16_t, std::unique_ptr<BufferRing>> buf_rings_;
+
     struct Op;
     struct Descriptor {
         int fd;
@@ -62,10 +83,13 @@ private:
         Op* active_read_op;
         Op* last_send_op;
         Op* close_op;
+        std::vector<Op*> pending_sends;  // Used when link_sends_ is enabled
+        size_t inflight_sends;
     };
     std::vector<Descriptor> fds_;
     std::vector<size_t> free_fd_slots_;
     absl::flat_hash_map</* fd */ int, /* index */ size_t> fd_indices_;
+    std::vector<Descriptor*> descs_with_pending_sends_;
 
     enum OpType {
         kConnect = 0,
@@ -73,7 +97,8 @@ private:
         kWrite   = 2,
         kSendAll = 3,
         kClose   = 4,
-        kCancel  = 5
+        kCancel  = 5,
+        kSendMsg = 6
     };
     static constexpr const char* kOpTypeStr[] = {
         "Connect",
@@ -81,13 +106,22 @@ private:
         "Write",
         "SendAll",
         "Close",
-        "Cancel"
+        "Cancel",
+        "SendMsg"
+    };
+
+    struct SendMsgContext {
+        struct msghdr msg;
+        std::vector<struct iovec> iovecs;
+        size_t iov_offset;   // First iovec not fully sent
     };
 
     enum {
         kOpFlagRepeat    = 1 << 0,
         kOpFlagUseRecv   = 1 << 1,
         kOpFlagCancelled = 1 << 2,
+        kOpFlagMultishot = 1 << 3,
+        kOpFlagLinked    = 1 << 4,
     };
     static constexpr uint64_t kInvalidOpId = std::numeric_limits<uint64_t>::max();
     static constexpr size_t kInvalidFdIndex = std::numeric_limits<size_t>::max();
@@ -101,14 +135,16 @@ private:
             char* buf;                    // Used by kRead
             const char* data;             // Used by kWrite, kSendAll
             const struct sockaddr* addr;  // Used by kConnect
+            SendMsgContext* sendmsg_ctx;  // Used by kSendMsg
         };
         union {
             size_t buf_len;   // Used by kRead
             size_t data_len;  // Used by kWrite, kSendAll
             size_t addrlen;   // Used by kConnect
         };
+        uint64_t offset;     // Used by kWrite
         uint64_t root_op;    // Used by kSendAll
-        uint64_t next_op;    // Used by kSendAll, kCancel
+        uint64_t next_op;    // Used by kSendAll, kSendMsg, kCancel
     };
 
     uint64_t next_op_id_;
@@ -120,14 +156,18 @@ private:
     absl::flat_hash_map</* op_id */ uint64_t, WriteCallback> write_cbs_;
     absl::flat_hash_map</* op_id */ uint64_t, SendAllCallback> sendall_cbs_;
     absl::flat_hash_map</* op_id */ uint64_t, CloseCallback> close_cbs_;
+    absl::flat_hash_map</* op_id */ uint64_t, std::unique_ptr<SendMsgContext>> sendmsg_ctxs_;
 
     stat::Counter ev_loop_counter_;
     stat::Counter wait_timeout_counter_;
     stat::Counter completed_ops_counter_;
+    stat::Counter io_uring_enter_counter_;
     stat::StatisticsCollector<int> io_uring_enter_time_stat_;
     stat::StatisticsCollector<int> completed_ops_stat_;
     stat::StatisticsCollector<int> ev_loop_time_stat_;
     stat::StatisticsCollector<int> average_op_time_stat_;
+    stat::StatisticsCollector<int> syscalls_per_kop_stat_;
+    size_t num_enter_syscalls_;
 
     inline OpType op_type(const Op* op) { return gsl::narrow_cast<OpType>(op->id & 0xff); }
     inline int op_fd(const Op* op) {
@@ -148,19 +188,28 @@ private:
     Op* AllocReadOp(Descriptor* desc, uint16_t buf_gid, std::span<char> buf, uint16_t flags);
     Op* AllocWriteOp(Descriptor* desc, std::span<const char> data);
     Op* AllocSendAllOp(Descriptor* desc, std::span<const char> data);
+    Op* AllocSendMsgOp(Descriptor* desc, std::unique_ptr<SendMsgContext> ctx);
     Op* AllocCloseOp(int fd);
     Op* AllocCancelOp(uint64_t op_id);
 
     void UnregisterFd(Descriptor* desc);
-    void EnqueueOp(Op* op);
+    struct io_uring_sqe* EnqueueOp(Op* op);
+    void QueueSendOp(Descriptor* desc, Op* op);
+    void FlushPendingSends();
+    bool SubmitNeedsEnter();
+    void SubmitSqes();
     void OnOpComplete(Op* op, struct io_uring_cqe* cqe);
 
     void HandleConnectComplete(Op* op, int res);
     void HandleReadOpComplete(Op* op, int res, Op** next_op);
+    void HandleMultishotRecvComplete(Op* op, struct io_uring_cqe* cqe, Op** next_op);
     void HandleWriteOpComplete(Op* op, int res);
     void HandleSendallOpComplete(Op* op, int res, Op** next_op);
+    void HandleSendMsgOpComplete(Op* op, int res, Op** next_op);
+    void HandleLinkedSendComplete(Op* op, int res);
     void HandleCloseOpComplete(Op* op, int res);
 
+    void RecycleRingBuffer(BufferRing* buf_ring, uint16_t bid);
     void CleanUpFn();
 
     DISALLOW_COPY_AND_ASSIGN(IOUring);
@@ -50,6 +50,15 @@ void ReportCpuRelatedPerfEventValues(std::string_view header,
               << gsl::narrow_cast<double>(values[1]) / loop_count << " per loop";
 }
 
+size_t ReadResidentBytes() {
+    FILE* fin = fopen("/proc/self/statm", "r");
+    PCHECK(fin != nullptr) << "Failed to open /proc/self/statm";
+    size_t total_pages, resident_pages;
+    CHECK_EQ(fscanf(fin, "%zu %zu", &total_pages, &resident_pages), 2);
+    fclose(fin);
+    return resident_pages * static_cast<size_t>(getpagesize());
+}
+
 BenchLoop::BenchLoop(LoopFn fn)
     : fn_(fn), max_duration_(absl::InfiniteDuration()),
       max_loop_count_(std::numeric_limits<size_t>::max()),
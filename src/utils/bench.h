@@ -17,6 +17,9 @@ void ReportCpuRelatedPerfEventValues(std::string_view header,
                                      utils::PerfEventGroup* perf_event_group,
                                      absl::Duration duration, size_t loop_count);
 
+// Resident set size of this process, from /proc/self/statm
+size_t ReadResidentBytes();
+
 class BenchLoop {
 public:
     using LoopFn = std::function<bool()>;
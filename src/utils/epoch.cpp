@@ -0,0 +1,90 @@
+#include "utils/epoch.h"
+
+namespace faas {
+namespace utils {
+
+namespace {
+static constexpr uint64_t kIdleEpoch = std::numeric_limits<uint64_t>::max();
+static constexpr size_t   kMaxThreads = 256;
+
+struct alignas(__FAAS_CACHE_LINE_SIZE) EpochSlot {
+    std::atomic<uint64_t> epoch{kIdleEpoch};
+};
+
+struct RetiredObject {
+    uint64_t              epoch;
+    std::function<void()> deleter;
+};
+
+static EpochSlot                  epoch_slots[kMaxThreads];
+static std::atomic<size_t>        next_epoch_slot{0};
+static std::atomic<uint64_t>      global_epoch{0};
+static thread_local EpochSlot*    epoch_slot{nullptr};
+static thread_local int           guard_depth{0};
+
+static absl::Mutex                retire_mu;
+static std::vector<RetiredObject> retired_objects ABSL_GUARDED_BY(retire_mu);
+
+static EpochSlot* GetThreadLocalEpochSlot() {
+    if (epoch_slot == nullptr) {
+        size_t slot_idx = next_epoch_slot.fetch_add(1);
+        if (slot_idx >= kMaxThreads) {
+            LOG(FATAL) << "Not enough statically allocated epoch slots, "
+                          "consider enlarge kMaxThreads";
+        }
+        epoch_slot = &epoch_slots[slot_idx];
+    }
+    return epoch_slot;
+}
+
+static uint64_t MinActiveEpoch() {
+    size_t num_slots = std::min(next_epoch_slot.load(), kMaxThreads);
+    uint64_t min_epoch = kIdleEpoch;
+    for (size_t i = 0; i < num_slots; i++) {
+        min_epoch = std::min(min_epoch, epoch_slots[i].epoch.load());
+    }
+    return min_epoch;
+}
+}  // namespace
+
+EpochGuard::EpochGuard() {
+    if (guard_depth++ == 0) {
+        GetThreadLocalEpochSlot()->epoch.store(global_epoch.load());
+    }
+}
+
+EpochGuard::~EpochGuard() {
+    DCHECK_GT(guard_depth, 0);
+    if (--guard_depth == 0) {
+        epoch_slot->epoch.store(kIdleEpoch, std::memory_order_release);
+    }
+}
+
+void EpochRetire(std::function<void()> deleter) {
+    std::vector<std::function<void()>> ready;
+    {
+        absl::MutexLock lk(&retire_mu);
+        retired_objects.push_back(RetiredObject {
+            .epoch = global_epoch.fetch_add(1),
+            .deleter = std::move(deleter)
+        });
+        // Readers that entered at or before the retire epoch may still
+        // hold the object
+        uint64_t min_epoch = MinActiveEpoch();
+        auto iter = retired_objects.begin();
+        while (iter != retired_objects.end()) {
+            if (iter->epoch < min_epoch) {
+                ready.push_back(std::move(iter->deleter));
+                iter = retired_objects.erase(iter);
+            } else {
+                iter++;
+            }
+        }
+    }
+    for (auto& fn : ready) {
+        fn();
+    }
+}
+
+}  // namespace utils
+}  // namespace faas
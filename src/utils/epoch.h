@@ -0,0 +1,52 @@
+#pragma once
+
+#ifndef __FAAS_SRC
+#error utils/epoch.h cannot be included outside
+#endif
+
+#include "base/common.h"
+
+namespace faas {
+namespace utils {
+
+// Epoch-based reclamation. Readers enter a critical section with EpochGuard,
+// and objects retired with EpochRetire are deleted only after every thread
+// that might still observe them has left its critical section.
+class EpochGuard {
+public:
+    EpochGuard();
+    ~EpochGuard();
+
+private:
+    DISALLOW_COPY_AND_ASSIGN(EpochGuard);
+};
+
+// Thread-safe. `deleter` runs on some later caller of EpochRetire.
+void EpochRetire(std::function<void()> deleter);
+
+// Pointer to an immutable object, published by writers and loaded by readers
+// within an EpochGuard. Writers should be serialized externally.
+template<class T>
+class EpochPtr {
+public:
+    EpochPtr() : ptr_(nullptr) {}
+    ~EpochPtr() { delete ptr_.load(std::memory_order_relaxed); }
+
+    // Must be called within an EpochGuard, which keeps the object alive
+    const T* Load() const { return ptr_.load(std::memory_order_acquire); }
+
+    void Publish(std::unique_ptr<const T> target) {
+        const T* old_ptr = ptr_.exchange(target.release(), std::memory_order_seq_cst);
+        if (old_ptr != nullptr) {
+            EpochRetire([old_ptr] { delete old_ptr; });
+        }
+    }
+
+private:
+    std::atomic<const T*> ptr_;
+
+    DISALLOW_COPY_AND_ASSIGN(EpochPtr);
+};
+
+}  // namespace utils
+}  // namespace faas
@@ -60,9 +60,9 @@ public:
             LOG(WARNING) << "ExpMovingAvgExt is supposed to handle non-negative sample values";
             return;
         }
-        if (last_timestamp_us_ > 0 && timestamp_us <= last_timestamp_us_) {
-            return;
-        }
+        // Samples not later than the last one, e.g. taken within the same
+        // microsecond, count as taken 1us after it
+        int64_t elapsed_us = std::max<int64_t>(1, timestamp_us - last_timestamp_us_);
         if (n_samples_ < min_samples_) {
             if (p_ == 0) {
                 avg_ += std::log(static_cast<double>(sample)) / min_samples_;
@@ -72,7 +72,7 @@ public:
         } else {
             double alpha = alpha_;
             if (tau_us_ > 0) {
-                alpha = 1.0 - std::exp(-(timestamp_us - last_timestamp_us_) / tau_us_);
+                alpha = 1.0 - std::exp(-elapsed_us / tau_us_);
             }
             if (p_ == 0) {
                 avg_ += alpha * (std::log(static_cast<double>(sample)) - avg_);
@@ -80,7 +80,7 @@ public:
                 avg_ += alpha * (std::pow(static_cast<double>(sample), p_) - avg_);
             }
         }
-        last_timestamp_us_ = timestamp_us;
+        last_timestamp_us_ = std::max(last_timestamp_us_, timestamp_us);
         n_samples_++;
     }
 
@@ -103,6 +103,20 @@ std::optional<int> Create(std::string_view full_path) {
     return fd;
 }
 
+bool SyncDirectory(std::string_view path) {
+    int fd = open(std::string(path).c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    if (fd == -1) {
+        PLOG_F(ERROR, "Open directory {} failed", path);
+        return false;
+    }
+    bool success = (fsync(fd) == 0);
+    if (!success) {
+        PLOG_F(ERROR, "Sync directory {} failed", path);
+    }
+    close(fd);
+    return success;
+}
+
 std::string JoinPath(std::string_view path1, std::string_view path2) {
     return fmt::format("{}/{}", path1, path2);
 }
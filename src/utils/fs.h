@@ -18,6 +18,9 @@ bool ReadContents(std::string_view path, std::string* contents);
 std::optional<int> Open(std::string_view full_path, int flags);
 std::optional<int> Create(std::string_view full_path);
 
+// Makes creations, renames and removals of files within the directory durable
+bool SyncDirectory(std::string_view path);
+
 std::string JoinPath(std::string_view path1, std::string_view path2);
 std::string JoinPath(std::string_view path1, std::string_view path2, std::string_view path3);
 
@@ -35,3 +35,11 @@ func GetFuncCallOutputShmName(fullCallId uint64) string {
 func GetFuncCallOutputFifoName(fullCallId uint64) string {
 	return fmt.Sprintf("%d.o", fullCallId)
 }
+
+func GetSharedLogReadRangeShmName(fullCallId uint64, clientData uint64) string {
+	return fmt.Sprintf("%d.r%d", fullCallId, clientData)
+}
+
+func GetSharedLogAppendBatchShmName(fullCallId uint64, clientData uint64) string {
+	return fmt.Sprintf("%d.a%d", fullCallId, clientData)
+}
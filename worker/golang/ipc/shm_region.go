@@ -90,7 +90,12 @@ func (r *ShmRegion) Close() {
 }
 
 func (r *ShmRegion) Remove() {
-	os.Remove(shmFullPath(r.Name))
+	ShmRemove(r.Name)
+}
+
+// Removes the region by name, e.g. when it is never opened
+func ShmRemove(name string) {
+	os.Remove(shmFullPath(name))
 }
 
 func shmFullPath(shmName string) string {
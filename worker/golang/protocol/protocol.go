@@ -48,13 +48,15 @@ const (
 
 // SharedLogOpType enum
 const (
-	SharedLogOpType_INVALID     uint16 = 0x00
-	SharedLogOpType_APPEND      uint16 = 0x01
-	SharedLogOpType_READ_NEXT   uint16 = 0x02
-	SharedLogOpType_READ_PREV   uint16 = 0x03
-	SharedLogOpType_TRIM        uint16 = 0x04
-	SharedLogOpType_SET_AUXDATA uint16 = 0x05
-	SharedLogOpType_READ_NEXT_B uint16 = 0x06
+	SharedLogOpType_INVALID      uint16 = 0x00
+	SharedLogOpType_APPEND       uint16 = 0x01
+	SharedLogOpType_READ_NEXT    uint16 = 0x02
+	SharedLogOpType_READ_PREV    uint16 = 0x03
+	SharedLogOpType_TRIM         uint16 = 0x04
+	SharedLogOpType_SET_AUXDATA  uint16 = 0x05
+	SharedLogOpType_READ_NEXT_B  uint16 = 0x06
+	SharedLogOpType_READ_RANGE   uint16 = 0x07
+	SharedLogOpType_APPEND_BATCH uint16 = 0x08
 )
 
 // SharedLogResultType enum
@@ -75,6 +77,7 @@ const (
 )
 
 const MaxLogSeqnum = uint64(0xffff000000000000)
+const InvalidLogSeqNum = ^uint64(0)
 
 const MessageTypeBits = 4
 
@@ -86,6 +89,11 @@ const MessageFullByteSize = 2560
 const MessageInlineDataSize = MessageFullByteSize - MessageHeaderByteSize
 
 const SharedLogTagByteSize = 8
+const SharedLogReadRangeRecordHeaderByteSize = 16
+const SharedLogAppendBatchRecordHeaderByteSize = 8
+
+// Seqnums of an append batch are returned inline
+const MaxSharedLogAppendBatchSize = MessageInlineDataSize / 8
 
 const (
 	FLAG_FuncWorkerUseEngineSocket uint32 = (1 << 0)
@@ -127,6 +135,14 @@ func GetLogAuxDataSizeFromMessage(buffer []byte) int {
 	return int(binary.LittleEndian.Uint16(buffer[38:40]))
 }
 
+func GetLogRangeCountFromMessage(buffer []byte) int {
+	return int(binary.LittleEndian.Uint32(buffer[56:60]))
+}
+
+func GetLogBatchSizeFromMessage(buffer []byte) int {
+	return int(binary.LittleEndian.Uint32(buffer[56:60]))
+}
+
 func GetLogClientDataFromMessage(buffer []byte) uint64 {
 	return binary.LittleEndian.Uint64(buffer[48:56])
 }
@@ -210,6 +226,17 @@ func NewSharedLogAppendMessage(currentCallId uint64, myClientId uint16, numTags
 	return buffer
 }
 
+func NewSharedLogAppendBatchMessage(currentCallId uint64, myClientId uint16, batchSize uint32, clientData uint64) []byte {
+	buffer := NewEmptyMessage()
+	tmp := (currentCallId << MessageTypeBits) + uint64(MessageType_SHARED_LOG_OP)
+	binary.LittleEndian.PutUint64(buffer[0:8], tmp)
+	binary.LittleEndian.PutUint16(buffer[32:34], SharedLogOpType_APPEND_BATCH)
+	binary.LittleEndian.PutUint16(buffer[34:36], myClientId)
+	binary.LittleEndian.PutUint64(buffer[48:56], clientData)
+	binary.LittleEndian.PutUint32(buffer[56:60], batchSize)
+	return buffer
+}
+
 func NewSharedLogReadMessage(currentCallId uint64, myClientId uint16, tag uint64, seqNum uint64, direction int, block bool, clientData uint64) []byte {
 	buffer := NewEmptyMessage()
 	tmp := (currentCallId << MessageTypeBits) + uint64(MessageType_SHARED_LOG_OP)
@@ -230,6 +257,20 @@ func NewSharedLogReadMessage(currentCallId uint64, myClientId uint16, tag uint64
 	return buffer
 }
 
+func NewSharedLogReadRangeMessage(currentCallId uint64, myClientId uint16, tag uint64, seqNum uint64, maxCount uint32, maxBytes uint32, clientData uint64) []byte {
+	buffer := NewEmptyMessage()
+	tmp := (currentCallId << MessageTypeBits) + uint64(MessageType_SHARED_LOG_OP)
+	binary.LittleEndian.PutUint64(buffer[0:8], tmp)
+	binary.LittleEndian.PutUint16(buffer[32:34], SharedLogOpType_READ_RANGE)
+	binary.LittleEndian.PutUint16(buffer[34:36], myClientId)
+	binary.LittleEndian.PutUint64(buffer[40:48], tag)
+	binary.LittleEndian.PutUint64(buffer[48:56], clientData)
+	binary.LittleEndian.PutUint64(buffer[8:16], seqNum)
+	binary.LittleEndian.PutUint32(buffer[56:60], maxCount)
+	binary.LittleEndian.PutUint32(buffer[60:64], maxBytes)
+	return buffer
+}
+
 func NewSharedLogSetAuxDataMessage(currentCallId uint64, myClientId uint16, seqNum uint64, clientData uint64) []byte {
 	buffer := NewEmptyMessage()
 	tmp := (currentCallId << MessageTypeBits) + uint64(MessageType_SHARED_LOG_OP)
@@ -2,6 +2,7 @@ package types
 
 import (
 	"context"
+	"fmt"
 )
 
 type LogEntry struct {
@@ -11,6 +12,18 @@ type LogEntry struct {
 	AuxData []byte
 }
 
+// Returned by SharedLogAppendBatch along with seqnums, if some log entries
+// of the batch are discarded
+type LogBatchDiscardedError struct {
+	// Indices of discarded log entries in the batch, in increasing order
+	Discarded []int
+	BatchSize int
+}
+
+func (e *LogBatchDiscardedError) Error() string {
+	return fmt.Sprintf("%d of %d log entries in the batch are discarded", len(e.Discarded), e.BatchSize)
+}
+
 type Environment interface {
 	InvokeFunc(ctx context.Context, funcName string, input []byte) ( /* output */ []byte, error)
 	InvokeFuncAsync(ctx context.Context, funcName string, input []byte) error
@@ -21,6 +34,10 @@ type Environment interface {
 	// Shared log operations
 	// Append a new log entry, tags must be non-zero
 	SharedLogAppend(ctx context.Context, tags []uint64, data []byte) ( /* seqnum */ uint64, error)
+	// Append a batch of log entries in one operation, returns their seqnums in order.
+	// If any entry is discarded, seqnums are returned along with a *LogBatchDiscardedError
+	// listing the discarded entries, whose seqnums are zero
+	SharedLogAppendBatch(ctx context.Context, tags [][]uint64, data [][]byte) ( /* seqnums */ []uint64, error)
 	// Read the first log with `tag` whose seqnum >= given `seqNum`
 	// `tag`==0 means considering log with any tag, including empty tag
 	SharedLogReadNext(ctx context.Context, tag uint64, seqNum uint64) (*LogEntry, error)
@@ -28,6 +45,9 @@ type Environment interface {
 	// Read the last log with `tag` whose seqnum <= given `seqNum`
 	// `tag`==0 means considering log with any tag, including empty tag
 	SharedLogReadPrev(ctx context.Context, tag uint64, seqNum uint64) (*LogEntry, error)
+	// Read up to `maxCount` logs with `tag` whose seqnums >= given `seqNum`, in order.
+	// The batch stops early once it exceeds `maxBytes`; zero means no limit for both
+	SharedLogReadRange(ctx context.Context, tag uint64, seqNum uint64, maxCount int, maxBytes int) ([]*LogEntry, error)
 	// Alias for ReadPrev(tag, MaxSeqNum)
 	SharedLogCheckTail(ctx context.Context, tag uint64) (*LogEntry, error)
 	// Set auxiliary data for log entry of given `seqNum`
@@ -595,6 +595,100 @@ func (w *FuncWorker) SharedLogAppend(ctx context.Context, tags []uint64, data []
 	}
 }
 
+// Implement types.Environment
+func (w *FuncWorker) SharedLogAppendBatch(ctx context.Context, tags [][]uint64, data [][]byte) ([]uint64, error) {
+	batchSize := len(data)
+	if batchSize == 0 || batchSize > protocol.MaxSharedLogAppendBatchSize {
+		return nil, fmt.Errorf("Invalid batch size %d, expect 1 to %d log entries", batchSize, protocol.MaxSharedLogAppendBatchSize)
+	}
+	if len(tags) != batchSize {
+		return nil, fmt.Errorf("Tags of %d log entries given for a batch of %d", len(tags), batchSize)
+	}
+	records := make([]byte, 0, batchSize*protocol.SharedLogAppendBatchRecordHeaderByteSize)
+	header := make([]byte, protocol.SharedLogAppendBatchRecordHeaderByteSize)
+	for i := 0; i < batchSize; i++ {
+		if len(data[i]) == 0 {
+			return nil, fmt.Errorf("Data cannot be empty")
+		}
+		entryTags, err := checkAndDuplicateTags(tags[i])
+		if err != nil {
+			return nil, err
+		}
+		if len(data[i])+len(entryTags)*protocol.SharedLogTagByteSize > protocol.MessageInlineDataSize {
+			return nil, fmt.Errorf("Data too larger (size=%d, num_tags=%d), expect no more than %d bytes", len(data[i]), len(entryTags), protocol.MessageInlineDataSize)
+		}
+		binary.LittleEndian.PutUint32(header[0:4], uint32(len(data[i])))
+		binary.LittleEndian.PutUint16(header[4:6], uint16(len(entryTags)))
+		records = append(records, header...)
+		records = append(records, protocol.BuildLogTagsBuffer(entryTags)...)
+		records = append(records, data[i]...)
+	}
+
+	sleepDuration := 5 * time.Millisecond
+	remainingRetries := 4
+
+	for {
+		id := atomic.AddUint64(&w.nextLogOpId, 1)
+		currentCallId := atomic.LoadUint64(&w.currentCall)
+		message := protocol.NewSharedLogAppendBatchMessage(currentCallId, w.clientId, uint32(batchSize), id)
+		if len(records) <= protocol.MessageInlineDataSize {
+			protocol.FillInlineDataInMessage(message, records)
+		} else {
+			// The engine removes the region once records are copied out
+			region, err := ipc.ShmCreate(ipc.GetSharedLogAppendBatchShmName(currentCallId, id), len(records))
+			if err != nil {
+				return nil, fmt.Errorf("ShmCreate failed: %v", err)
+			}
+			copy(region.Data, records)
+			region.Close()
+			protocol.SetPayloadSizeInMessage(message, -int32(len(records)))
+		}
+
+		w.mux.Lock()
+		outputChan := make(chan []byte, 1)
+		w.outgoingLogOps[id] = outputChan
+		_, err := w.outputPipe.Write(message)
+		w.mux.Unlock()
+		if err != nil {
+			return nil, err
+		}
+
+		response := <-outputChan
+		result := protocol.GetSharedLogResultTypeFromMessage(response)
+		if result == protocol.SharedLogResultType_APPEND_OK {
+			responseData := protocol.GetInlineDataFromMessage(response)
+			if protocol.GetLogBatchSizeFromMessage(response) != batchSize || len(responseData) != batchSize*8 {
+				return nil, fmt.Errorf("Unexpected response for append batch")
+			}
+			seqNums := make([]uint64, batchSize)
+			var discarded []int
+			for i := 0; i < batchSize; i++ {
+				seqNums[i] = binary.LittleEndian.Uint64(responseData[i*8:])
+				if seqNums[i] == protocol.InvalidLogSeqNum {
+					seqNums[i] = 0
+					discarded = append(discarded, i)
+				}
+			}
+			if len(discarded) > 0 {
+				return seqNums, &types.LogBatchDiscardedError{Discarded: discarded, BatchSize: batchSize}
+			}
+			return seqNums, nil
+		} else if result == protocol.SharedLogResultType_DISCARDED {
+			log.Printf("[ERROR] Append batch discarded, will retry")
+			if remainingRetries > 0 {
+				time.Sleep(sleepDuration)
+				sleepDuration *= 2
+				remainingRetries--
+				continue
+			} else {
+				return nil, fmt.Errorf("Failed to append log batch")
+			}
+		} else {
+			return nil, fmt.Errorf("Failed to append log batch")
+		}
+	}
+}
+
 func buildLogEntryFromReadResponse(response []byte) *types.LogEntry {
 	seqNum := protocol.GetLogSeqNumFromMessage(response)
 	numTags := protocol.GetLogNumTagsFromMessage(response)
@@ -617,12 +711,10 @@ func buildLogEntryFromReadResponse(response []byte) *types.LogEntry {
 	}
 }
 
-func (w *FuncWorker) sharedLogReadCommon(ctx context.Context, message []byte, opId uint64) (*types.LogEntry, error) {
-	// count := atomic.AddInt32(&w.sharedLogReadCount, int32(1))
-	// if count > 16 {
-	// 	log.Printf("[WARN] Make %d-th shared log read request", count)
-	// }
-
+// Sends a shared log op and waits for its response. If ctx is done first,
+// returns a nil response, and calls onLateResponse (if not nil) with the
+// response once it arrives, to release resources the response refers to.
+func (w *FuncWorker) sharedLogOpCommon(ctx context.Context, message []byte, opId uint64, onLateResponse func([]byte)) ([]byte, error) {
 	w.mux.Lock()
 	outputChan := make(chan []byte, 1)
 	w.outgoingLogOps[opId] = outputChan
@@ -632,11 +724,28 @@ func (w *FuncWorker) sharedLogReadCommon(ctx context.Context, message []byte, op
 		return nil, err
 	}
 
-	var response []byte
 	select {
 	case <-ctx.Done():
+		if onLateResponse != nil {
+			go func() {
+				onLateResponse(<-outputChan)
+			}()
+		}
 		return nil, nil
-	case response = <-outputChan:
+	case response := <-outputChan:
+		return response, nil
+	}
+}
+
+func (w *FuncWorker) sharedLogReadCommon(ctx context.Context, message []byte, opId uint64) (*types.LogEntry, error) {
+	// count := atomic.AddInt32(&w.sharedLogReadCount, int32(1))
+	// if count > 16 {
+	// 	log.Printf("[WARN] Make %d-th shared log read request", count)
+	// }
+
+	response, err := w.sharedLogOpCommon(ctx, message, opId, nil)
+	if err != nil || response == nil {
+		return nil, err
 	}
 	result := protocol.GetSharedLogResultTypeFromMessage(response)
 	if result == protocol.SharedLogResultType_READ_OK {
@@ -678,6 +787,80 @@ func (w *FuncWorker) SharedLogReadPrev(ctx context.Context, tag uint64, seqNum u
 	return w.sharedLogReadCommon(ctx, message, id)
 }
 
+func buildLogEntriesFromReadRangeResponse(records []byte, count int) ([]*types.LogEntry, error) {
+	logEntries := make([]*types.LogEntry, 0, count)
+	for i := 0; i < count; i++ {
+		if len(records) < protocol.SharedLogReadRangeRecordHeaderByteSize {
+			return nil, fmt.Errorf("Truncated record header in read range response")
+		}
+		seqNum := binary.LittleEndian.Uint64(records[0:8])
+		dataSize := int(binary.LittleEndian.Uint32(records[8:12]))
+		numTags := int(binary.LittleEndian.Uint16(records[12:14]))
+		auxDataSize := int(binary.LittleEndian.Uint16(records[14:16]))
+		records = records[protocol.SharedLogReadRangeRecordHeaderByteSize:]
+		tagsSize := numTags * protocol.SharedLogTagByteSize
+		if len(records) < tagsSize+dataSize+auxDataSize {
+			return nil, fmt.Errorf("Truncated record in read range response")
+		}
+		tags := make([]uint64, numTags)
+		for j := 0; j < numTags; j++ {
+			tags[j] = binary.LittleEndian.Uint64(records[j*protocol.SharedLogTagByteSize:])
+		}
+		// Copy out data, as records may live in a shm region
+		data := make([]byte, dataSize+auxDataSize)
+		copy(data, records[tagsSize:tagsSize+dataSize+auxDataSize])
+		logEntries = append(logEntries, &types.LogEntry{
+			SeqNum:  seqNum,
+			Tags:    tags,
+			Data:    data[:dataSize],
+			AuxData: data[dataSize:],
+		})
+		records = records[tagsSize+dataSize+auxDataSize:]
+	}
+	return logEntries, nil
+}
+
+// Implement types.Environment
+func (w *FuncWorker) SharedLogReadRange(ctx context.Context, tag uint64, seqNum uint64, maxCount int, maxBytes int) ([]*types.LogEntry, error) {
+	id := atomic.AddUint64(&w.nextLogOpId, 1)
+	currentCallId := atomic.LoadUint64(&w.currentCall)
+	message := protocol.NewSharedLogReadRangeMessage(currentCallId, w.clientId, tag, seqNum, uint32(maxCount), uint32(maxBytes), id)
+
+	// Records not fitting inline are passed in a shm region, which the
+	// reader removes on every path, including responses arriving after ctx
+	// is done
+	shmName := ipc.GetSharedLogReadRangeShmName(currentCallId, id)
+	inShm := func(response []byte) bool {
+		return protocol.GetSharedLogResultTypeFromMessage(response) == protocol.SharedLogResultType_READ_OK &&
+			protocol.GetPayloadSizeFromMessage(response) < 0
+	}
+	response, err := w.sharedLogOpCommon(ctx, message, id, func(response []byte) {
+		if inShm(response) {
+			ipc.ShmRemove(shmName)
+		}
+	})
+	if err != nil || response == nil {
+		return nil, err
+	}
+	result := protocol.GetSharedLogResultTypeFromMessage(response)
+	if result == protocol.SharedLogResultType_EMPTY {
+		return nil, nil
+	} else if result != protocol.SharedLogResultType_READ_OK {
+		return nil, fmt.Errorf("Failed to read log range")
+	}
+	count := protocol.GetLogRangeCountFromMessage(response)
+	if !inShm(response) {
+		return buildLogEntriesFromReadRangeResponse(protocol.GetInlineDataFromMessage(response), count)
+	}
+	defer ipc.ShmRemove(shmName)
+	region, err := ipc.ShmOpen(shmName, true)
+	if err != nil {
+		return nil, fmt.Errorf("ShmOpen %s failed: %v", shmName, err)
+	}
+	defer region.Close()
+	return buildLogEntriesFromReadRangeResponse(region.Data, count)
+}
+
 // Implement types.Environment
 func (w *FuncWorker) SharedLogCheckTail(ctx context.Context, tag uint64) (*types.LogEntry, error) {
 	return w.SharedLogReadPrev(ctx, tag, protocol.MaxLogSeqnum)